@@ -0,0 +1,450 @@
+#include "Benchmark.h"
+#include "Router.h"
+#include "Metric.h"
+#include "TimeMeasurer.h"
+#include "IndexedDaryHeap.h"
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+namespace simpleroute {
+namespace {
+
+struct CountingPathVisitor: public Router::PathVisitor {
+	uint64_t nodeCount;
+	CountingPathVisitor() : nodeCount(0) {}
+	virtual void visit(uint32_t) override {
+		++nodeCount;
+	}
+};
+
+template<typename T_EP>
+void benchmarkQueue(const Graph & g, const T_EP & ep, detail::DijkstraRouterBase::QueueType qt, const std::vector< std::pair<uint32_t, uint32_t> > & queries, const char * name, std::ostream & out) {
+	detail::DijkstraRouter<T_EP> router(&g, ep);
+	router.setQueueType(qt);
+	
+	uint64_t settledNodes = 0;
+	CountingPathVisitor pv;
+	TimeMeasurer tm;
+	tm.begin();
+	for(const auto & q : queries) {
+		router.route(q.first, q.second, &pv);
+		settledNodes += router.stats().settledNodes;
+	}
+	tm.end();
+	out << "\t" << name << ": " << tm.elapsedMilliSeconds() << " ms total, ";
+	out << (double)tm.elapsedTime()/queries.size() << " us/query, ";
+	out << (double)settledNodes/queries.size() << " settled nodes/query, ";
+	out << (double)pv.nodeCount/queries.size() << " path nodes/query\n";
+}
+
+///Counts the hardware cache misses of the calling thread, not available on all systems (e.g. in most containers)
+class CacheMissCounter {
+public:
+	CacheMissCounter() : m_fd(-1) {
+#ifdef __linux__
+		struct perf_event_attr pe;
+		::memset(&pe, 0, sizeof(pe));
+		pe.type = PERF_TYPE_HARDWARE;
+		pe.size = sizeof(pe);
+		pe.config = PERF_COUNT_HW_CACHE_MISSES;
+		pe.disabled = 1;
+		pe.exclude_kernel = 1;
+		pe.exclude_hv = 1;
+		m_fd = ::syscall(__NR_perf_event_open, &pe, 0, -1, -1, 0);
+#endif
+	}
+	~CacheMissCounter() {
+#ifdef __linux__
+		if (m_fd >= 0) {
+			::close(m_fd);
+		}
+#endif
+	}
+	inline bool valid() const { return m_fd >= 0; }
+	void begin() {
+#ifdef __linux__
+		if (valid()) {
+			::ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+			::ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+	///number of cache misses since begin()
+	uint64_t end() {
+		uint64_t count = 0;
+#ifdef __linux__
+		if (valid()) {
+			::ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+			if (::read(m_fd, &count, sizeof(count)) != sizeof(count)) {
+				count = 0;
+			}
+		}
+#endif
+		return count;
+	}
+private:
+	int m_fd;
+};
+
+}//end namespace
+
+void benchmarkNodeOrder(const Graph & g, uint32_t queryCount, int accessType, std::ostream & out) {
+	if (!g.nodeCount() || !queryCount) {
+		return;
+	}
+	std::mt19937 rng(0xC0FFEE);
+	std::uniform_int_distribution<uint32_t> nodeDist(0, g.nodeCount()-1);
+	std::vector< std::pair<uint32_t, uint32_t> > queries;
+	for(uint32_t i(0); i < queryCount; ++i) {
+		queries.emplace_back(nodeDist(rng), nodeDist(rng));
+	}
+	
+	struct OrderInfo {
+		int order;
+		const char * name;
+	};
+	const OrderInfo orderInfos[] = {
+		{-1, "input order"},
+		{Graph::NO_Z_ORDER, "Z-order"},
+		{Graph::NO_HILBERT, "Hilbert order"}
+	};
+	
+	out << "Node order benchmark with " << queries.size() << " Dijkstra queries using the distance metric\n";
+	for(const OrderInfo & oi : orderInfos) {
+		Graph og(g);
+		std::vector< std::pair<uint32_t, uint32_t> > myQueries(queries);
+		TimeMeasurer tm;
+		if (oi.order >= 0) {
+			tm.begin();
+			std::vector<uint32_t> newIds = og.reorderNodes((Graph::NodeOrder) oi.order);
+			tm.end();
+			for(auto & q : myQueries) {
+				q.first = newIds[q.first];
+				q.second = newIds[q.second];
+			}
+		}
+		//average difference of the ids of adjacent nodes
+		uint64_t idGap = 0;
+		for(uint32_t i(0), s(og.edgeCount()); i < s; ++i) {
+			const Graph::Edge & e = og.edge(i);
+			idGap += (e.source < e.target ? e.target - e.source : e.source - e.target);
+		}
+		
+		detail::DijkstraRouter<Router::DistanceEdgePreferences> router(&og, Router::DistanceEdgePreferences(accessType));
+		uint64_t settledNodes = 0;
+		CountingPathVisitor pv;
+		CacheMissCounter cmc;
+		TimeMeasurer qtm;
+		cmc.begin();
+		qtm.begin();
+		for(const auto & q : myQueries) {
+			router.route(q.first, q.second, &pv);
+			settledNodes += router.stats().settledNodes;
+		}
+		qtm.end();
+		uint64_t cacheMisses = cmc.end();
+		
+		out << "\t" << oi.name << ": ";
+		if (oi.order >= 0) {
+			out << "reordering took " << tm.elapsedMilliSeconds() << " ms, ";
+		}
+		out << (double)idGap/std::max<uint32_t>(og.edgeCount(), 1) << " average edge id gap, ";
+		out << (double)qtm.elapsedTime()/myQueries.size() << " us/query, ";
+		out << (double)settledNodes/myQueries.size() << " settled nodes/query, ";
+		if (cmc.valid()) {
+			out << (double)cacheMisses/myQueries.size() << " cache misses/query\n";
+		}
+		else {
+			out << "cache misses not available\n";
+		}
+	}
+	out << std::flush;
+}
+
+void benchmarkDijkstraQueues(const Graph & g, uint32_t queryCount, int accessType, std::ostream & out) {
+	if (!g.nodeCount()) {
+		return;
+	}
+	std::mt19937 rng(0xC0FFEE);
+	std::uniform_int_distribution<uint32_t> nodeDist(0, g.nodeCount()-1);
+	std::vector< std::pair<uint32_t, uint32_t> > queries;
+	for(uint32_t i(0); i < queryCount; ++i) {
+		queries.emplace_back(nodeDist(rng), nodeDist(rng));
+	}
+	
+	struct QueueInfo {
+		detail::DijkstraRouterBase::QueueType qt;
+		const char * name;
+	};
+	const QueueInfo queueInfos[] = {
+		{detail::DijkstraRouterBase::QT_SET, "std::set"},
+		{detail::DijkstraRouterBase::QT_PRIO_QUEUE, "std::priority_queue"},
+		{detail::DijkstraRouterBase::QT_DARY_HEAP, "4-ary heap"},
+		{detail::DijkstraRouterBase::QT_RADIX_HEAP, "radix heap"}
+	};
+	
+	for(bool timeMetric : {false, true}) {
+		out << "Dijkstra queue benchmark with " << queries.size() << " queries using the " << (timeMetric ? "time" : "distance") << " metric\n";
+		for(const QueueInfo & qi : queueInfos) {
+			if (timeMetric) {
+				benchmarkQueue(g, Router::TimeEdgePreferences(accessType, 130.0), qi.qt, queries, qi.name, out);
+			}
+			else {
+				benchmarkQueue(g, Router::DistanceEdgePreferences(accessType), qi.qt, queries, qi.name, out);
+			}
+		}
+		//the same queries with materialised weights
+		Metric metric;
+		if (timeMetric) {
+			metric = Metric(&g, Router::TimeEdgePreferences(accessType, 130.0), 1000.0);
+		}
+		else {
+			metric = Metric(&g, Router::DistanceEdgePreferences(accessType), 1.0);
+		}
+		for(const QueueInfo & qi : queueInfos) {
+			std::string name = std::string(qi.name) + " (metric)";
+			benchmarkQueue(g, Router::MetricEdgePreferences(&metric), qi.qt, queries, name.c_str(), out);
+		}
+	}
+	out << std::flush;
+}
+
+RouterBenchmarkResult::RouterBenchmarkResult() :
+queryCount(0), foundCount(0), p50(0), p90(0), p99(0), max(0), mean(0), settledNodes(0), relaxedEdges(0), queriesPerSecond(0)
+{}
+
+BenchmarkQuerySet randomQueries(const Graph & g, uint32_t count, uint32_t seed) {
+	BenchmarkQuerySet qs;
+	qs.name = "random";
+	if (!g.nodeCount()) {
+		return qs;
+	}
+	std::mt19937 rng(seed);
+	std::uniform_int_distribution<uint32_t> nodeDist(0, g.nodeCount()-1);
+	qs.queries.reserve(count);
+	for(uint32_t i(0); i < count; ++i) {
+		uint32_t source = nodeDist(rng);
+		qs.queries.emplace_back(source, nodeDist(rng));
+	}
+	return qs;
+}
+
+std::vector<BenchmarkQuerySet> dijkstraRankQueries(const Metric & metric, uint32_t sourceCount, uint32_t seed) {
+	const Graph & g = metric.graph();
+	std::vector<BenchmarkQuerySet> result;
+	if (!g.nodeCount()) {
+		return result;
+	}
+	std::mt19937 rng(seed);
+	std::uniform_int_distribution<uint32_t> nodeDist(0, g.nodeCount()-1);
+	std::vector<uint64_t> dist(g.nodeCount(), std::numeric_limits<uint64_t>::max());
+	std::vector<uint32_t> settled;
+	IndexedDaryHeap<uint64_t, 4> border(g.nodeCount());
+	for(uint32_t i(0); i < sourceCount; ++i) {
+		uint32_t source = nodeDist(rng);
+		settled.clear();
+		dist[source] = 0;
+		border.push(source, 0);
+		while (!border.empty()) {
+			uint32_t curNodeId = border.top();
+			border.pop();
+			settled.push_back(curNodeId);
+			for(uint32_t edgeId(g.node(curNodeId).begin), end(g.node(curNodeId).end); edgeId < end; ++edgeId) {
+				if (!metric.accessAllowed(edgeId)) {
+					continue;
+				}
+				uint32_t nextNodeId = metric.target(edgeId);
+				uint64_t nw = dist[curNodeId] + metric.weight(edgeId);
+				if (nw < dist[nextNodeId]) {
+					if (border.contains(nextNodeId)) {
+						border.decreaseKey(nextNodeId, nw);
+					}
+					else {
+						border.push(nextNodeId, nw);
+					}
+					dist[nextNodeId] = nw;
+				}
+			}
+		}
+		//the source has rank 0, the 2^k-th settled node has rank 2^k
+		for(uint32_t k(1); (uint64_t(1) << k) < settled.size(); ++k) {
+			if (result.size() < k) {
+				result.resize(k);
+				result.back().name = "rank-" + std::to_string(k);
+			}
+			result[k-1].queries.emplace_back(source, settled[uint64_t(1) << k]);
+		}
+		//only reset what was touched
+		for(uint32_t nodeId : settled) {
+			dist[nodeId] = std::numeric_limits<uint64_t>::max();
+		}
+	}
+	return result;
+}
+
+RouterBenchmarkResult benchmarkRouter(Router & router, const BenchmarkQuerySet & qs) {
+	typedef std::chrono::steady_clock Clock;
+	RouterBenchmarkResult r;
+	r.queryCount = qs.queries.size();
+	if (!r.queryCount) {
+		return r;
+	}
+	CountingPathVisitor pv;
+	for(uint32_t i(0), s(std::min<uint32_t>(r.queryCount, 8)); i < s; ++i) {
+		router.route(qs.queries[i].source, qs.queries[i].target, &pv);
+	}
+	std::vector<double> latencies;
+	latencies.reserve(r.queryCount);
+	uint64_t settledNodes = 0;
+	uint64_t relaxedEdges = 0;
+	for(const BenchmarkQuery & q : qs.queries) {
+		pv.nodeCount = 0;
+		Clock::time_point begin = Clock::now();
+		router.route(q.source, q.target, &pv);
+		Clock::time_point end = Clock::now();
+		latencies.push_back(std::chrono::duration<double, std::micro>(end-begin).count());
+		settledNodes += router.stats().settledNodes;
+		relaxedEdges += router.stats().relaxedEdges;
+		r.foundCount += (pv.nodeCount ? 1 : 0);
+	}
+	double total = std::accumulate(latencies.begin(), latencies.end(), 0.0);
+	std::sort(latencies.begin(), latencies.end());
+	//nearest-rank percentiles
+	auto percentile = [&latencies](double p) -> double {
+		std::size_t rank = std::ceil(p/100.0*latencies.size());
+		return latencies.at(std::max<std::size_t>(rank, 1)-1);
+	};
+	r.p50 = percentile(50);
+	r.p90 = percentile(90);
+	r.p99 = percentile(99);
+	r.max = latencies.back();
+	r.mean = total/r.queryCount;
+	r.settledNodes = (double)settledNodes/r.queryCount;
+	r.relaxedEdges = (double)relaxedEdges/r.queryCount;
+	r.queriesPerSecond = (total > 0 ? r.queryCount/(total/1000000.0) : 0);
+	return r;
+}
+
+void printBenchmarkHeader(std::ostream & out) {
+	out << "router,query_set,queries,found,p50_us,p90_us,p99_us,max_us,mean_us,settled_nodes,relaxed_edges,queries_per_second\n";
+}
+
+void printBenchmarkResult(const std::string & routerName, const std::string & querySetName, const RouterBenchmarkResult & r, std::ostream & out) {
+	out << routerName << ',' << querySetName << ',' << r.queryCount << ',' << r.foundCount << ',';
+	out << r.p50 << ',' << r.p90 << ',' << r.p99 << ',' << r.max << ',' << r.mean << ',';
+	out << r.settledNodes << ',' << r.relaxedEdges << ',' << r.queriesPerSecond << '\n';
+}
+
+std::vector<uint32_t> randomNodes(const Graph & g, uint32_t count, uint32_t seed) {
+	std::vector<uint32_t> nodes;
+	if (!g.nodeCount()) {
+		return nodes;
+	}
+	std::mt19937 rng(seed);
+	std::uniform_int_distribution<uint32_t> nodeDist(0, g.nodeCount()-1);
+	nodes.reserve(count);
+	for(uint32_t i(0); i < count; ++i) {
+		nodes.push_back(nodeDist(rng));
+	}
+	return nodes;
+}
+
+BatchBenchmarkResult::BatchBenchmarkResult() :
+runCount(0), weightCount(0), reachedCount(0), p50(0), p90(0), max(0), mean(0), weightsPerSecond(0)
+{}
+
+namespace {
+
+///fills the timings of r from the latencies of its r.runCount calls
+void summarizeBatch(std::vector<double> & latencies, uint64_t reachedCount, BatchBenchmarkResult & r) {
+	double total = std::accumulate(latencies.begin(), latencies.end(), 0.0);
+	std::sort(latencies.begin(), latencies.end());
+	//nearest-rank percentiles
+	auto percentile = [&latencies](double p) -> double {
+		std::size_t rank = std::ceil(p/100.0*latencies.size());
+		return latencies.at(std::max<std::size_t>(rank, 1)-1);
+	};
+	r.p50 = percentile(50);
+	r.p90 = percentile(90);
+	r.max = latencies.back();
+	r.mean = total/r.runCount;
+	r.reachedCount = (double)reachedCount/r.runCount;
+	r.weightsPerSecond = (total > 0 ? r.weightCount*r.runCount/(total/1000.0) : 0);
+}
+
+}//end namespace
+
+BatchBenchmarkResult benchmarkMatrixRouter(MatrixRouter & router, const std::vector<uint32_t> & sources, const std::vector<uint32_t> & targets, uint32_t runCount) {
+	typedef std::chrono::steady_clock Clock;
+	BatchBenchmarkResult r;
+	r.runCount = runCount;
+	r.weightCount = uint64_t(sources.size())*targets.size();
+	if (!r.runCount) {
+		return r;
+	}
+	DistanceMatrix dm;
+	router.calculate(sources, targets, dm);
+	std::vector<double> latencies;
+	latencies.reserve(r.runCount);
+	uint64_t reachedCount = 0;
+	for(uint32_t i(0); i < r.runCount; ++i) {
+		Clock::time_point begin = Clock::now();
+		router.calculate(sources, targets, dm);
+		Clock::time_point end = Clock::now();
+		latencies.push_back(std::chrono::duration<double, std::milli>(end-begin).count());
+		reachedCount += r.weightCount - std::count(dm.data(), dm.data()+r.weightCount, DistanceMatrix::infinite_weight);
+	}
+	summarizeBatch(latencies, reachedCount, r);
+	return r;
+}
+
+BatchBenchmarkResult benchmarkOneToAllRouter(const Graph & g, OneToAllRouter & router, const std::vector<uint32_t> & sources, OneToAllRouter::WeightType budget) {
+	typedef std::chrono::steady_clock Clock;
+	BatchBenchmarkResult r;
+	r.runCount = sources.size();
+	r.weightCount = g.nodeCount();
+	if (!r.runCount) {
+		return r;
+	}
+	sserialize::SimpleBitVector reached;
+	router.calculate(sources.front(), budget, 0, &reached);
+	std::vector<double> latencies;
+	latencies.reserve(r.runCount);
+	uint64_t reachedCount = 0;
+	for(uint32_t source : sources) {
+		Clock::time_point begin = Clock::now();
+		router.calculate(source, budget, 0, &reached);
+		Clock::time_point end = Clock::now();
+		latencies.push_back(std::chrono::duration<double, std::milli>(end-begin).count());
+		for(std::size_t i(0), s(reached.wordCount()); i < s; ++i) {
+			reachedCount += __builtin_popcountll(reached.word(i));
+		}
+	}
+	summarizeBatch(latencies, reachedCount, r);
+	return r;
+}
+
+void printBatchBenchmarkHeader(std::ostream & out) {
+	out << "router,case,runs,weights,reached,p50_ms,p90_ms,max_ms,mean_ms,weights_per_second\n";
+}
+
+void printBatchBenchmarkResult(const std::string & routerName, const std::string & caseName, const BatchBenchmarkResult & r, std::ostream & out) {
+	out << routerName << ',' << caseName << ',' << r.runCount << ',' << r.weightCount << ',' << r.reachedCount << ',';
+	out << r.p50 << ',' << r.p90 << ',' << r.max << ',' << r.mean << ',' << r.weightsPerSecond << '\n';
+}
+
+}//end namespace simpleroute
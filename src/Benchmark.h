@@ -0,0 +1,101 @@
+#ifndef SIMPLE_ROUTE_BENCHMARK_H
+#define SIMPLE_ROUTE_BENCHMARK_H
+#include "Graph.h"
+#include "Router.h"
+#include "MatrixRouter.h"
+#include "OneToAllRouter.h"
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace simpleroute {
+
+class Metric;
+
+struct BenchmarkQuery {
+	uint32_t source;
+	uint32_t target;
+	BenchmarkQuery(uint32_t source, uint32_t target) : source(source), target(target) {}
+};
+
+struct BenchmarkQuerySet {
+	///"random" or "rank-<k>" for Dijkstra rank 2^k
+	std::string name;
+	std::vector<BenchmarkQuery> queries;
+};
+
+///count uniform random node pairs, the same seed gives the same queries on the same graph
+BenchmarkQuerySet randomQueries(const Graph & g, uint32_t count, uint32_t seed);
+
+///Picks sourceCount random sources and runs a Dijkstra search with metric from each of them.
+///The node settled as 2^k-th node is the target of the query of the set "rank-<k>", hence set k holds queries of Dijkstra rank 2^k.
+///Returns one set per k from 1 up to the largest rank reached from any source
+std::vector<BenchmarkQuerySet> dijkstraRankQueries(const Metric & metric, uint32_t sourceCount, uint32_t seed);
+
+struct RouterBenchmarkResult {
+	uint32_t queryCount;
+	///number of queries that found a path
+	uint32_t foundCount;
+	///latency percentiles in microseconds
+	double p50;
+	double p90;
+	double p99;
+	double max;
+	double mean;
+	///averages per query, see Router::Stats
+	double settledNodes;
+	double relaxedEdges;
+	double queriesPerSecond;
+	RouterBenchmarkResult();
+};
+
+///Runs all queries of qs with router and measures every query on its own with a monotonic clock.
+///The first few queries are run once before the measurement to create the search workspaces
+RouterBenchmarkResult benchmarkRouter(Router & router, const BenchmarkQuerySet & qs);
+
+///column names of printBenchmarkResult
+void printBenchmarkHeader(std::ostream & out);
+///one csv line
+void printBenchmarkResult(const std::string & routerName, const std::string & querySetName, const RouterBenchmarkResult & r, std::ostream & out);
+
+///count uniform random nodes, the same seed gives the same nodes on the same graph
+std::vector<uint32_t> randomNodes(const Graph & g, uint32_t count, uint32_t seed);
+
+///Result of routers that calculate many weights per call, e.g. MatrixRouter and OneToAllRouter
+struct BatchBenchmarkResult {
+	///number of measured calls
+	uint32_t runCount;
+	///weights calculated per call
+	uint64_t weightCount;
+	///average number of finite weights per call
+	double reachedCount;
+	///latency percentiles per call in milliseconds
+	double p50;
+	double p90;
+	double max;
+	double mean;
+	double weightsPerSecond;
+	BatchBenchmarkResult();
+};
+
+///Calculates the matrix of sources and targets runCount times with router after one unmeasured call
+BatchBenchmarkResult benchmarkMatrixRouter(MatrixRouter & router, const std::vector<uint32_t> & sources, const std::vector<uint32_t> & targets, uint32_t runCount);
+
+///Runs router on g once per source with budget and measures every source on its own, the first source is run once before the measurement
+BatchBenchmarkResult benchmarkOneToAllRouter(const Graph & g, OneToAllRouter & router, const std::vector<uint32_t> & sources, OneToAllRouter::WeightType budget);
+
+///column names of printBatchBenchmarkResult
+void printBatchBenchmarkHeader(std::ostream & out);
+///one csv line
+void printBatchBenchmarkResult(const std::string & routerName, const std::string & caseName, const BatchBenchmarkResult & r, std::ostream & out);
+
+///Runs the same random queries with every queue type of DijkstraRouter for the distance and time metric and prints the timings
+void benchmarkDijkstraQueues(const Graph & g, uint32_t queryCount, int accessType, std::ostream & out);
+
+///Runs the same random Dijkstra queries on copies of g in its input order, Z-order and Hilbert order, see Graph::reorderNodes
+///Prints the timings and, if the system allows it, the hardware cache misses. g should be loaded without spatial sort
+void benchmarkNodeOrder(const Graph & g, uint32_t queryCount, int accessType, std::ostream & out);
+
+}//end namespace simpleroute
+
+#endif
@@ -0,0 +1,35 @@
+#include "CHGraph.h"
+#include <algorithm>
+
+namespace simpleroute {
+
+CHInfo::CHInfo() {}
+
+CHInfo::~CHInfo() {}
+
+uint32_t CHInfo::shortcutCount() const {
+	uint32_t count = 0;
+	for(const CHEdge & e : m_edges) {
+		if (e.isShortcut()) {
+			++count;
+		}
+	}
+	return count;
+}
+
+void CHInfo::printStats(std::ostream & out) const {
+	uint32_t maxLevel = 0;
+	for(uint32_t i(0), s(nodeCount()); i < s; ++i) {
+		maxLevel = std::max(maxLevel, m_nodes[i].level);
+	}
+	out << "CHInfo::stats {\n";
+	out << "\t#Nodes: " << nodeCount() << "\n";
+	out << "\t#Edges: " << edgeCount() << "\n";
+	out << "\t#Shortcuts: " << shortcutCount() << "\n";
+	out << "\t#Up edges: " << m_upEdges.size() << "\n";
+	out << "\t#Down edges: " << m_downEdges.size() << "\n";
+	out << "\tmax level: " << maxLevel << "\n";
+	out << "}";
+}
+
+}//end namespace simpleroute
@@ -4,47 +4,96 @@
 #include <limits>
 #include <stdint.h>
 #include <string>
+#include <ostream>
 #include "Graph.h"
 
 namespace simpleroute {
 
 class CHConstructor;
 
+///Contraction hierarchy of a Graph for a single edge preference.
+///All edges (original edges and shortcuts) are stored in a single array.
+///The upward graph of a node holds its edges leading to nodes of higher level.
+///The downward graph of a node holds the edges coming from nodes of higher level,
+///these have to be traversed backwards by the backward search.
 class CHInfo {
 private:
 	friend class CHConstructor;
 public:
 	typedef uint32_t WeightType;
+	static constexpr WeightType infinite_weight = std::numeric_limits<WeightType>::max();
+	static constexpr uint32_t invalid_edge = 0xFFFFFFFF;
 
 	struct Node {
 		uint32_t level;
-		uint32_t shortCutsBegin;
-		uint32_t shortCutsEnd;
+		uint32_t upEdgesBegin;
+		uint32_t downEdgesBegin;
 	};
-	
+
 	struct CHEdge {
+		uint32_t source;
+		uint32_t target;
 		WeightType weight;
+		///id of the edge in the base graph, invalid_edge for shortcuts
+		uint32_t baseEdgeId;
+		///a shortcut consists of the edges firstChild (source->middle) and secondChild (middle->target)
+		uint32_t firstChild;
+		uint32_t secondChild;
+		inline bool isShortcut() const { return baseEdgeId == invalid_edge; }
 	};
+
+	typedef std::vector<uint32_t>::const_iterator ConstEdgeRefIterator;
 public:
 	CHInfo();
 	~CHInfo();
-	const Node & node(uint32_t id) const;
-	const WeightType & weight(uint32_t id) const;
-	//in the real graph, these point into the other direction
-	const Graph::Edge reverseEdge(uint32_t id) const;
-	Graph::ConstEdgeIterator reverseEdgesBegin(uint32_t nodeId) const;
-	Graph::ConstEdgeIterator reverseEdgesEnd(uint32_t nodeId) const;
-	const Graph::Edge shortcut(uint32_t id) const;
+	inline uint32_t nodeCount() const { return (m_nodes.size() ? m_nodes.size()-1 : 0); }
+	inline uint32_t edgeCount() const { return m_edges.size(); }
+	uint32_t shortcutCount() const;
+	inline const Node & node(uint32_t id) const { return m_nodes[id]; }
+	inline const CHEdge & edge(uint32_t id) const { return m_edges[id]; }
+	inline const WeightType & weight(uint32_t id) const { return m_edges[id].weight; }
+
+	///edges with source nodeId
+	inline ConstEdgeRefIterator upEdgesBegin(uint32_t nodeId) const { return m_upEdges.cbegin() + m_nodes[nodeId].upEdgesBegin; }
+	inline ConstEdgeRefIterator upEdgesEnd(uint32_t nodeId) const { return m_upEdges.cbegin() + m_nodes[nodeId+1].upEdgesBegin; }
+	///edges with target nodeId
+	inline ConstEdgeRefIterator downEdgesBegin(uint32_t nodeId) const { return m_downEdges.cbegin() + m_nodes[nodeId].downEdgesBegin; }
+	inline ConstEdgeRefIterator downEdgesEnd(uint32_t nodeId) const { return m_downEdges.cbegin() + m_nodes[nodeId+1].downEdgesBegin; }
+
+	///write the base graph nodes of the path represented by edge edgeId to out, the source of the edge is omitted
+	template<typename TOutputIterator>
+	void unpack(uint32_t edgeId, TOutputIterator out) const;
+
+	void printStats(std::ostream & out) const;
 private:
 	typedef std::vector<Node> NodesContainer;
-	typedef std::vector<WeightType> WeightTypeContainer;
-	typedef std::vector<Graph::Edge> EdgesContainer;
+	typedef std::vector<CHEdge> EdgesContainer;
+	typedef std::vector<uint32_t> EdgeRefsContainer;
 private:
+	///nodeCount()+1 entries, the last one is a sentinel holding the end of the edge refs
 	NodesContainer m_nodes;
-	WeightType m_weights;
 	EdgesContainer m_edges;
+	EdgeRefsContainer m_upEdges;
+	EdgeRefsContainer m_downEdges;
 };
 
+template<typename TOutputIterator>
+void CHInfo::unpack(uint32_t edgeId, TOutputIterator out) const {
+	std::vector<uint32_t> stack(1, edgeId);
+	while (stack.size()) {
+		const CHEdge & e = edge(stack.back());
+		stack.pop_back();
+		if (e.isShortcut()) {
+			stack.push_back(e.secondChild);
+			stack.push_back(e.firstChild);
+		}
+		else {
+			*out = e.target;
+			++out;
+		}
+	}
+}
+
 }//end namespace simpleroute
 
 #endif
@@ -0,0 +1,280 @@
+#include "ChConstructor.h"
+#include "TimeMeasurer.h"
+#include <queue>
+#include <cmath>
+#include <ostream>
+#include <assert.h>
+
+namespace simpleroute {
+namespace detail {
+
+///Local Dijkstra search used to find witness paths, one instance per thread
+struct WitnessSearch {
+	typedef uint64_t Distance;
+	static constexpr Distance infinite_distance = std::numeric_limits<Distance>::max();
+	typedef std::pair<Distance, uint32_t> QueueEntry;
+	typedef std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry> > Queue;
+
+	std::vector<Distance> distances;
+	std::vector<uint32_t> touched;
+	Queue queue;
+
+	///search from source without using ignoreNode and nodes that already have a level
+	///stops if the distance exceeds maxDistance or settleLimit nodes were settled
+	void run(const CHConstructor::DynamicGraph & cg, const CHInfo & ch, uint32_t source, uint32_t ignoreNode, Distance maxDistance, uint32_t settleLimit) {
+		if (distances.size() != cg.nodeCount()) {
+			distances.assign(cg.nodeCount(), infinite_distance);
+		}
+		set(source, 0);
+		queue.emplace(0, source);
+		uint32_t settled = 0;
+		while (queue.size() && settled < settleLimit) {
+			QueueEntry qe = queue.top();
+			queue.pop();
+			if (qe.first > distances[qe.second]) {
+				continue;
+			}
+			if (qe.first > maxDistance) {
+				break;
+			}
+			++settled;
+			for(auto it(cg.outgoingEdgesBegin(qe.second)), end(cg.outgoingEdgesEnd(qe.second)); it != end; ++it) {
+				if (it->other == ignoreNode || ch.node(it->other).level != CHConstructor::initial_node_level) {
+					continue;
+				}
+				Distance nd = qe.first + it->edgeWeight;
+				if (nd < distances[it->other]) {
+					set(it->other, nd);
+					queue.emplace(nd, it->other);
+				}
+			}
+		}
+		queue = Queue();
+	}
+
+	inline Distance distance(uint32_t nodeId) const { return distances[nodeId]; }
+
+	///only resets the touched nodes
+	void reset() {
+		for(uint32_t nodeId : touched) {
+			distances[nodeId] = infinite_distance;
+		}
+		touched.clear();
+	}
+private:
+	inline void set(uint32_t nodeId, Distance d) {
+		if (distances[nodeId] == infinite_distance) {
+			touched.push_back(nodeId);
+		}
+		distances[nodeId] = d;
+	}
+};
+
+}//end namespace detail
+
+struct CHConstructor::PriorityTraits {
+	typedef int32_t Weight;
+	struct Weighter {
+		const std::vector<int32_t> * priorities;
+		Weighter(const std::vector<int32_t> * priorities) : priorities(priorities) {}
+		inline Weight operator()(uint32_t nodeId) const { return (*priorities)[nodeId]; }
+	};
+	typedef std::less<Weight> WeightCompareLess;
+	const CHConstructor * c;
+	PriorityTraits(const CHConstructor * c) : c(c) {}
+	Weighter weighter() { return Weighter(&(c->m_priorities)); }
+	WeightCompareLess weightCompareLess() { return WeightCompareLess(); }
+};
+
+CHConstructor::CHConstructor(const Graph* g, CHInfo* ch) :
+m_g(g),
+m_ch(ch),
+m_cg(g->nodeCount()),
+m_witnessSearchSettleLimit(500)
+{}
+
+CHConstructor::~CHConstructor() {}
+
+void CHConstructor::shortcuts(uint32_t nodeId, detail::WitnessSearch & ws, std::vector<Shortcut> & out) const {
+	const DynamicGraph::Node & n = m_cg.node(nodeId);
+	for(uint32_t inPos(0), inS(n.incomingEdges.size()); inPos < inS; ++inPos) {
+		const DynamicGraph::Edge & inEdge = n.incomingEdges[inPos];
+		uint64_t maxOutWeight = 0;
+		bool hasTarget = false;
+		for(const DynamicGraph::Edge & outEdge : n.outgoingEdges) {
+			if (outEdge.other != inEdge.other) {
+				maxOutWeight = std::max<uint64_t>(maxOutWeight, outEdge.edgeWeight);
+				hasTarget = true;
+			}
+		}
+		if (!hasTarget) {
+			continue;
+		}
+		ws.run(m_cg, *m_ch, inEdge.other, nodeId, (uint64_t)inEdge.edgeWeight + maxOutWeight, m_witnessSearchSettleLimit);
+		for(uint32_t outPos(0), outS(n.outgoingEdges.size()); outPos < outS; ++outPos) {
+			const DynamicGraph::Edge & outEdge = n.outgoingEdges[outPos];
+			if (outEdge.other == inEdge.other) {
+				continue;
+			}
+			uint64_t viaWeight = (uint64_t)inEdge.edgeWeight + outEdge.edgeWeight;
+			if (ws.distance(outEdge.other) > viaWeight) {
+				//weights are saturated, paths of this length do not exist in practice
+				out.emplace_back(inPos, outPos, std::min<uint64_t>(viaWeight, CHInfo::infinite_weight-1));
+			}
+		}
+		ws.reset();
+	}
+}
+
+void CHConstructor::contract(uint32_t nodeId, const std::vector<Shortcut> & nodeShortcuts) {
+	const DynamicGraph::Node & n = m_cg.node(nodeId);
+	std::vector<uint32_t> inIds, outIds;
+	inIds.reserve(n.incomingEdges.size());
+	outIds.reserve(n.outgoingEdges.size());
+	//all remaining edges of the node lead to or come from nodes with a higher level
+	for(const DynamicGraph::Edge & e : n.outgoingEdges) {
+		outIds.push_back(m_ch->m_edges.size());
+		m_ch->m_edges.push_back(CHInfo::CHEdge{nodeId, e.other, e.edgeWeight, e.baseEdgeId, e.firstChild, e.secondChild});
+	}
+	for(const DynamicGraph::Edge & e : n.incomingEdges) {
+		inIds.push_back(m_ch->m_edges.size());
+		m_ch->m_edges.push_back(CHInfo::CHEdge{e.other, nodeId, e.edgeWeight, e.baseEdgeId, e.firstChild, e.secondChild});
+	}
+	for(const Shortcut & sc : nodeShortcuts) {
+		m_cg.addEdge(n.incomingEdges[sc.inEdge].other, n.outgoingEdges[sc.outEdge].other, sc.weight, CHInfo::invalid_edge, inIds[sc.inEdge], outIds[sc.outEdge]);
+	}
+	m_cg.isolate(nodeId, [this](uint32_t neighbor) {
+		m_deletedNeighbors[neighbor] += 1;
+		m_dirty[neighbor] = true;
+	});
+}
+
+void CHConstructor::finalize() {
+	uint32_t nodeCount = m_g->nodeCount();
+	CHInfo::NodesContainer & nodes = m_ch->m_nodes;
+	for(CHInfo::Node & n : nodes) {
+		n.upEdgesBegin = 0;
+		n.downEdgesBegin = 0;
+	}
+	//count the edges of each node in the begin of the next node, then compute the prefix sums
+	for(const CHInfo::CHEdge & e : m_ch->m_edges) {
+		if (nodes[e.source].level < nodes[e.target].level) {
+			nodes[e.source+1].upEdgesBegin += 1;
+		}
+		else {
+			nodes[e.target+1].downEdgesBegin += 1;
+		}
+	}
+	for(uint32_t i(1); i <= nodeCount; ++i) {
+		nodes[i].upEdgesBegin += nodes[i-1].upEdgesBegin;
+		nodes[i].downEdgesBegin += nodes[i-1].downEdgesBegin;
+	}
+	m_ch->m_upEdges.resize(nodes[nodeCount].upEdgesBegin);
+	m_ch->m_downEdges.resize(nodes[nodeCount].downEdgesBegin);
+	std::vector<uint32_t> upPos(nodeCount), downPos(nodeCount);
+	for(uint32_t i(0); i < nodeCount; ++i) {
+		upPos[i] = nodes[i].upEdgesBegin;
+		downPos[i] = nodes[i].downEdgesBegin;
+	}
+	for(uint32_t edgeId(0), s(m_ch->m_edges.size()); edgeId < s; ++edgeId) {
+		const CHInfo::CHEdge & e = m_ch->m_edges[edgeId];
+		if (nodes[e.source].level < nodes[e.target].level) {
+			m_ch->m_upEdges[upPos[e.source]++] = edgeId;
+		}
+		else {
+			m_ch->m_downEdges[downPos[e.target]++] = edgeId;
+		}
+	}
+}
+
+void CHConstructor::run(const Router::AccessAllowanceWeightEdgePreferences * ep, double weightFactor, std::ostream & log, uint32_t threadCount) {
+	run(Metric(m_g, *ep, weightFactor, threadCount), log, threadCount);
+}
+
+void CHConstructor::run(const Metric & metric, std::ostream & log, uint32_t threadCount) {
+	if (!threadCount) {
+		threadCount = defaultThreadCount();
+	}
+	TimeMeasurer tm;
+	tm.begin();
+
+	uint32_t nodeCount = m_g->nodeCount();
+	m_ch->m_nodes.assign(nodeCount+1, CHInfo::Node{initial_node_level, 0, 0});
+	m_ch->m_edges.clear();
+	m_ch->m_upEdges.clear();
+	m_ch->m_downEdges.clear();
+
+	for(uint32_t edgeId(0), s(m_g->edgeCount()); edgeId < s; ++edgeId) {
+		if (!metric.accessAllowed(edgeId)) {
+			continue;
+		}
+		const Graph::Edge & e = m_g->edge(edgeId);
+		m_cg.addEdge(e.source, e.target, metric.weight(edgeId), edgeId, CHInfo::invalid_edge, CHInfo::invalid_edge);
+	}
+
+	m_remaining.resize(nodeCount);
+	for(uint32_t i(0); i < nodeCount; ++i) {
+		m_remaining[i] = i;
+	}
+	m_priorities.assign(nodeCount, 0);
+	m_deletedNeighbors.assign(nodeCount, 0);
+	m_dirty.assign(nodeCount, true);
+
+	std::vector<detail::WitnessSearch> witnessSearches(threadCount);
+	std::vector<uint32_t> dirtyNodes;
+	std::vector<uint32_t> independentSet;
+	std::vector< std::vector<Shortcut> > independentSetShortcuts;
+
+	for(uint32_t level(0); m_remaining.size(); ++level) {
+		//update the priorities of nodes whose neighborhood changed
+		dirtyNodes.clear();
+		for(uint32_t nodeId : m_remaining) {
+			if (m_dirty[nodeId]) {
+				dirtyNodes.push_back(nodeId);
+				m_dirty[nodeId] = false;
+			}
+		}
+		parallelFor(0, dirtyNodes.size(), [this, &dirtyNodes, &witnessSearches](uint32_t i, uint32_t threadId) {
+			uint32_t nodeId = dirtyNodes[i];
+			std::vector<Shortcut> tmp;
+			shortcuts(nodeId, witnessSearches[threadId], tmp);
+			const DynamicGraph::Node & n = m_cg.node(nodeId);
+			//edge difference + number of contracted neighbors
+			m_priorities[nodeId] = (int32_t)tmp.size() - (int32_t)(n.incomingEdges.size() + n.outgoingEdges.size()) + m_deletedNeighbors[nodeId];
+		}, threadCount);
+
+		independentSet.clear();
+		getIndependentSet(PriorityTraits(this), std::back_inserter(independentSet), threadCount);
+		assert(independentSet.size());
+
+		//witness searches ignore nodes with a level, hence they do not use other nodes of the independent set
+		for(uint32_t nodeId : independentSet) {
+			m_ch->m_nodes[nodeId].level = level;
+		}
+
+		independentSetShortcuts.assign(independentSet.size(), std::vector<Shortcut>());
+		parallelFor(0, independentSet.size(), [this, &independentSet, &independentSetShortcuts, &witnessSearches](uint32_t i, uint32_t threadId) {
+			shortcuts(independentSet[i], witnessSearches[threadId], independentSetShortcuts[i]);
+		}, threadCount, 16);
+
+		for(uint32_t i(0), s(independentSet.size()); i < s; ++i) {
+			contract(independentSet[i], independentSetShortcuts[i]);
+		}
+
+		m_remaining.erase(std::remove_if(m_remaining.begin(), m_remaining.end(), [this](uint32_t nodeId) {
+			return m_ch->m_nodes[nodeId].level != initial_node_level;
+		}), m_remaining.end());
+	}
+	finalize();
+
+	m_cg = DynamicGraph(0);
+	std::vector<uint32_t>().swap(m_remaining);
+	std::vector<int32_t>().swap(m_priorities);
+	std::vector<uint32_t>().swap(m_deletedNeighbors);
+	std::vector<bool>().swap(m_dirty);
+
+	tm.end();
+	log << "Contraction took " << tm.elapsedMilliSeconds() << " ms using " << threadCount << " threads" << std::endl;
+}
+
+}//end namespace simpleroute
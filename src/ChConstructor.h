@@ -1,175 +1,237 @@
 #ifndef SIMPLEROUTE_CHCONSTRUCTOR_H
 #define SIMPLEROUTE_CHCONSTRUCTOR_H
 #include "Graph.h"
+#include "CHGraph.h"
+#include "Router.h"
+#include "Metric.h"
+#include "ParallelFor.h"
 #include <algorithm>
-#include <unordered_set>
+#include <vector>
+#include <ostream>
 
 namespace simpleroute {
 namespace detail {
 
+///Dynamic graph used during the contraction.
+///Every node stores its incoming and outgoing edges to not yet contracted nodes
 template<typename T_EDGE_WEIGHT>
 class CHGraph {
 public:
 	typedef T_EDGE_WEIGHT EdgeWeight;
 	struct Edge {
-		static constexpr uint32_t is_shortcut_marker = 0xFFFFFFFF;
-		uint32_t baseEdgeId;
-		uint32_t target;
+		///target for outgoing edges, source for incoming edges
+		uint32_t other;
 		EdgeWeight edgeWeight;
-		bool isShortcunt() const { return baseEdgeId == is_shortcut_marker; }
+		///see CHInfo::CHEdge
+		uint32_t baseEdgeId;
+		uint32_t firstChild;
+		uint32_t secondChild;
+		Edge(uint32_t other, EdgeWeight edgeWeight, uint32_t baseEdgeId, uint32_t firstChild, uint32_t secondChild) :
+		other(other), edgeWeight(edgeWeight), baseEdgeId(baseEdgeId), firstChild(firstChild), secondChild(secondChild)
+		{}
+		bool isShortcut() const { return baseEdgeId == CHInfo::invalid_edge; }
 	};
+	typedef std::vector<Edge> EdgesContainer;
+	typedef typename EdgesContainer::const_iterator const_edge_iterator;
 	struct Node {
-		uint32_t baseNodeId;
-		uint32_t incomingEdgesBegin;
-		uint32_t outgoingEdgesBegin;
+		EdgesContainer incomingEdges;
+		EdgesContainer outgoingEdges;
 	};
-	
-	typedef std::vector<Edge> EdgesContainer;
 	typedef std::vector<Node> NodesContainer;
-	typedef EdgesContainer::const_iterator const_edge_iterator;
-	
-	
 public:
-	CHGraph(Graph * g);
+	CHGraph(uint32_t nodeCount) : m_nodes(nodeCount) {}
 	virtual ~CHGraph() {}
-	Node const & node(uint32_t id) const { return m_nodes.at(id); }
-	NodesContainer const & nodes() const { return m_nodes; }
-	NodesContainer & nodes() { return m_nodes; }
-	
-	Edge const & incomingEdge(uint32_t id) const {
-		return incomingEdges().at(id);
-	}
-	const_edge_iterator incomingEdgesBegin(uint32_t nodeId) const {
-		return incomingEdges().begin() + node(nodeId).incomingEdgesBegin;
-	}
-	const_edge_iterator incomingEdgesEnd(uint32_t nodeId) const {
-		return (nodeId+1 < m_nodes.size() ? incomingEdgesBegin(nodeId+1) : m_incomingEdges.end());
-	}
-	EdgesContainer const & incomingEdges() const {
-		return m_incomingEdges;
-	}
-	EdgesContainer & incomingEdges() const {
-		return m_incomingEdges;
-	}
-	
-	Edge const & outgoingEdge(uint32_t id) const {
-		return m_outgoingEdges.at(id);
-	}
-	const_edge_iterator outgoingEdgesBegin(uint32_t nodeId) const {
-		return outgoingEdges().begin() + node(nodeId).outgoingEdgesBegin;
-	}
-	const_edge_iterator outgoingEdgesEnd(uint32_t nodeId) const {
-		return (nodeId+1 < m_nodes.size() ? outgoingEdgesBegin(nodeId+1): outgoingEdges().end());
-	}
-	EdgesContainer const & outgoingEdges() const {
-		return m_outgoingEdges;
-	}
-	EdgesContainer & outgoingEdges() const {
-		return m_outgoingEdges;
-	}
-	
-	void contract(const std::unordered_set<uint32_t> & contractNodes, std::vector< std::pair<uint32_t, Edge> > & shortcuts);
-	
+	inline uint32_t nodeCount() const { return m_nodes.size(); }
+	Node const & node(uint32_t id) const { return m_nodes[id]; }
+
+	const_edge_iterator incomingEdgesBegin(uint32_t nodeId) const { return node(nodeId).incomingEdges.cbegin(); }
+	const_edge_iterator incomingEdgesEnd(uint32_t nodeId) const { return node(nodeId).incomingEdges.cend(); }
+	const_edge_iterator outgoingEdgesBegin(uint32_t nodeId) const { return node(nodeId).outgoingEdges.cbegin(); }
+	const_edge_iterator outgoingEdgesEnd(uint32_t nodeId) const { return node(nodeId).outgoingEdges.cend(); }
+
+	///add the edge source->target, if it already exists it is replaced if the new one has a smaller weight
+	void addEdge(uint32_t source, uint32_t target, EdgeWeight w, uint32_t baseEdgeId, uint32_t firstChild, uint32_t secondChild);
+	///remove all edges of nodeId, calls neighborFunc(neighborId) for every neighbor
+	template<typename T_NEIGHBOR_FUNC>
+	void isolate(uint32_t nodeId, T_NEIGHBOR_FUNC neighborFunc);
+private:
+	static bool update(EdgesContainer & edges, const Edge & e);
+	static void remove(EdgesContainer & edges, uint32_t other);
 private:
-	EdgesContainer m_incomingEdges;
-	EdgesContainer m_outgoingEdges;
 	NodesContainer m_nodes;
-	Graph * m_g;
 };
 
-CHGraph::CHGraph(Graph* g) :
-m_g(g)
-{
-	m_nodes.reserve(m_g->nodeCount());
-	m_outgoingEdges.reserve(m_g->edgeCount());
-	Node n;
-	Edge e;
-	for(uint32_t nodeId(0), s(m_g->nodeCount()); i < s; ++i) {
-		n.baseId = nodeId;
-		n.incomingEdgesBegin = 0;
-		n.outgoingEdgesBegin = m_outgoingEdges.size();
-		m_nodes.emplace_back(n);
-		for(auto it(m_g->edgesBegin(nodeId)), its(m_g->edgesEnd(nodeId)); it != its; ++it) {
-			e.
-			m_outgoingEdges.emplace_back(e);
+template<typename T_EDGE_WEIGHT>
+bool CHGraph<T_EDGE_WEIGHT>::update(EdgesContainer & edges, const Edge & e) {
+	for(Edge & x : edges) {
+		if (x.other == e.other) {
+			if (e.edgeWeight < x.edgeWeight) {
+				x = e;
+			}
+			return true;
 		}
 	}
-	
+	return false;
 }
 
+template<typename T_EDGE_WEIGHT>
+void CHGraph<T_EDGE_WEIGHT>::remove(EdgesContainer & edges, uint32_t other) {
+	for(uint32_t i(0), s(edges.size()); i < s; ++i) {
+		if (edges[i].other == other) {
+			edges[i] = edges.back();
+			edges.pop_back();
+			return;
+		}
+	}
+}
 
-void CHGraph::contract(const std::unordered_set< uint32_t >& contractNodes, std::vector< std::pair< uint32_t, Edge > > & shortcuts) {
+template<typename T_EDGE_WEIGHT>
+void CHGraph<T_EDGE_WEIGHT>::addEdge(uint32_t source, uint32_t target, EdgeWeight w, uint32_t baseEdgeId, uint32_t firstChild, uint32_t secondChild) {
+	if (source == target) {
+		return;
+	}
+	Edge e(target, w, baseEdgeId, firstChild, secondChild);
+	if (!update(m_nodes[source].outgoingEdges, e)) {
+		m_nodes[source].outgoingEdges.push_back(e);
+	}
+	e.other = source;
+	if (!update(m_nodes[target].incomingEdges, e)) {
+		m_nodes[target].incomingEdges.push_back(e);
+	}
+}
 
+template<typename T_EDGE_WEIGHT>
+template<typename T_NEIGHBOR_FUNC>
+void CHGraph<T_EDGE_WEIGHT>::isolate(uint32_t nodeId, T_NEIGHBOR_FUNC neighborFunc) {
+	Node & n = m_nodes[nodeId];
+	for(const Edge & e : n.outgoingEdges) {
+		remove(m_nodes[e.other].incomingEdges, nodeId);
+		neighborFunc(e.other);
+	}
+	for(const Edge & e : n.incomingEdges) {
+		remove(m_nodes[e.other].outgoingEdges, nodeId);
+		neighborFunc(e.other);
+	}
+	EdgesContainer().swap(n.outgoingEdges);
+	EdgesContainer().swap(n.incomingEdges);
 }
 
+struct WitnessSearch;
 
-}
+}//end namespace detail
 
-class CHContstructor {
+///Creates a contraction hierarchy.
+///Each round computes an independent set of nodes with locally minimal priority and contracts it.
+///Priorities and shortcuts (including the witness searches) are computed in parallel,
+///only inserting the shortcuts into the graph is sequential.
+class CHConstructor {
 public:
 	static constexpr uint32_t initial_node_level = 0xFFFFFFFF;
+	typedef CHInfo::WeightType WeightType;
+	typedef detail::CHGraph<WeightType> DynamicGraph;
 public:
-	CHContstructor();
-	virtual CHContstructor();
-	
+	CHConstructor(const Graph * g, CHInfo * ch);
+	virtual ~CHConstructor();
+	///Contract the graph using the weights of metric, edges with infinite weight are ignored.
+	///@param log receives the time the contraction took
+	///@param threadCount 0 uses all cores
+	void run(const Metric & metric, std::ostream & log, uint32_t threadCount = 0);
+	///Same as above with the metric created from ep and weightFactor, see Metric
+	void run(const Router::AccessAllowanceWeightEdgePreferences * ep, double weightFactor, std::ostream & log, uint32_t threadCount = 0);
+	///maximum number of nodes settled by a single witness search
+	void setWitnessSearchSettleLimit(uint32_t limit) { m_witnessSearchSettleLimit = limit; }
 protected:
-	template<typename T_WEIGHT_PRED>
-	void getIndependentSet(T_WEIGHT_PRED wp);
+	struct Shortcut {
+		///position of the edges within the incoming/outgoing edges of the contracted node
+		uint32_t inEdge;
+		uint32_t outEdge;
+		WeightType weight;
+		Shortcut(uint32_t inEdge, uint32_t outEdge, WeightType weight) : inEdge(inEdge), outEdge(outEdge), weight(weight) {}
+	};
+	struct PriorityTraits;
 protected:
-	Graph * m_g;
+	/**
+	  * Writes an independent set of the uncontracted nodes to out.
+	  * A node is part of the set if its weight is smaller than the weight of all its uncontracted neighbors.
+	  * struct Traits {
+	  *   typedef <> Weight;
+	  *   struct Weighter {
+	  *     Weight operator()(uint32_t nodeId) const;
+	  *   };
+	  *   struct WeightCompareLess {
+	  *     bool operator()(const Weight & a, const Weight & b) const;
+	  *   };
+	  *   Weighter weighter();
+	  *   WeightCompareLess weightCompareLess();
+	  * }
+	  */
+	template<typename T_TRAITS, typename T_OUTPUT_ITERATOR>
+	void getIndependentSet(T_TRAITS traits, T_OUTPUT_ITERATOR out, uint32_t threadCount);
+	///compute the necessary shortcuts if nodeId would be contracted, nodes with a level are ignored by witness searches
+	void shortcuts(uint32_t nodeId, detail::WitnessSearch & ws, std::vector<Shortcut> & out) const;
+	///contract nodeId and insert the shortcuts, this is not thread-safe
+	void contract(uint32_t nodeId, const std::vector<Shortcut> & nodeShortcuts);
+	///creates the up and down edge lists of m_ch
+	void finalize();
+protected:
+	const Graph * m_g;
 	CHInfo * m_ch;
+	DynamicGraph m_cg;
+	///uncontracted nodes
+	std::vector<uint32_t> m_remaining;
+	std::vector<int32_t> m_priorities;
+	std::vector<uint32_t> m_deletedNeighbors;
+	std::vector<bool> m_dirty;
+	uint32_t m_witnessSearchSettleLimit;
 };
 
-/**
-  * struct Traits {
-  *   typedef <> Weight;
-  *   struct Weighter {
-  *     Weight operator()(Graph * g, CHInfo * ch, uint32_t nodeId);
-  *   };
-  *   struct WeightCompareLess {
-  *     bool operator(const Weight & a, const Weight & b) const;
-  *   };
-  *   Weighter weighter();
-  *   WeightCompareLess weightCompareLess();
-  * }
-  */
 template<typename T_TRAITS, typename T_OUTPUT_ITERATOR>
-void CHContstructor::getIndependentSet(T_TRAITS traits, T_OUTPUT_ITERATOR out) {
+void CHConstructor::getIndependentSet(T_TRAITS traits, T_OUTPUT_ITERATOR out, uint32_t threadCount) {
 	typedef T_TRAITS Traits;
-	typedef typename Traits::Weight Weight;
 	typedef typename Traits::Weighter Weighter;
-	typedef typename Traits::WeighterCompareLess WeighterCompareLess;
-	
+	typedef typename Traits::WeightCompareLess WeightCompareLess;
+
 	Weighter weighter( traits.weighter() );
-	WeighterCompareLess weightCompareLess( traits.weightCompareLess() );
-	
-	std::vector<std::pair<Weight, uint32_t> > nodeWeights;
-	
-	for(uint32_t nodeId(0), s(m_g->nodeCount()); nodeId < s; ++nodeId) {
-		if (m_ch->node(nodeId).level == initial_node_level) {
-			nodeWeights.emplace_back(weighter(m_g, m_ch, nodeId), nodeId);
+	WeightCompareLess weightCompareLess( traits.weightCompareLess() );
+
+	//ties are broken by the node id
+	auto smaller = [&weighter, &weightCompareLess](uint32_t a, uint32_t b) -> bool {
+		auto wa = weighter(a);
+		auto wb = weighter(b);
+		if (weightCompareLess(wa, wb)) {
+			return true;
 		}
-	}
-	
-	using std::sort;
-	sort(nodeWeights.begin(), nodeWeights.end(), weightCompareLess);
-	
-	std::unordered_set<uint32_t> removedNodes;
-	for(auto it(nodeWeights.begin()), s(nodeWeights.end()); it != s; ++it) {
-		if (removedNodes.count(it->second)) { //neighbor already picked
-			continue;
+		if (weightCompareLess(wb, wa)) {
+			return false;
+		}
+		return a < b;
+	};
+
+	//vector<bool> is not thread-safe for concurrent writes
+	std::vector<uint8_t> selected(m_remaining.size(), 0);
+	parallelFor(0, m_remaining.size(), [this, &selected, &smaller](uint32_t i, uint32_t) {
+		uint32_t nodeId = m_remaining[i];
+		for(auto it(m_cg.outgoingEdgesBegin(nodeId)), end(m_cg.outgoingEdgesEnd(nodeId)); it != end; ++it) {
+			if (!smaller(nodeId, it->other)) {
+				return;
+			}
 		}
-		Graph::Node n(m_g->node(it->second));
-		//first the outgoing edges
-		for(auto eIt(m_g->edgesBegin(it->second)), eS(m_g->edgesEnd(it->second)); eIt != eS; ++eIt) {
-			const Graph::Edge & e = *eIt;
-			if (m_ch->node(e.target).level == initial_node_level) {
-				
+		for(auto it(m_cg.incomingEdgesBegin(nodeId)), end(m_cg.incomingEdgesEnd(nodeId)); it != end; ++it) {
+			if (!smaller(nodeId, it->other)) {
+				return;
 			}
 		}
+		selected[i] = 1;
+	}, threadCount);
+
+	for(uint32_t i(0), s(m_remaining.size()); i < s; ++i) {
+		if (selected[i]) {
+			*out = m_remaining[i];
+			++out;
+		}
 	}
 }
 
 }//end namespace
 
-#endif
\ No newline at end of file
+#endif
@@ -1,86 +1,352 @@
 #include "Graph.h"
 
-#include <iostream>
+#include <ostream>
 #include <algorithm>
 #include <assert.h>
 
-#include "Grid.h"
+#include "ParallelFor.h"
+#include "SpaceFillingCurve.h"
+#include "TimeMeasurer.h"
 
 namespace simpleroute {
 	
-Graph Graph::fromPBF(const std::string & path, bool spatialSort, int accessTypes) {
+Graph Graph::fromPBF(const std::string & path, bool spatialSort, std::ostream & log, int accessTypes) {
 	
 	Graph g( memgraph::Graph::fromPBF(path, accessTypes) );
 	
-	//now sort the nodes/edges according to their closesnes for more access-locality during dijkstra runs
-	//We use the grid for this. One grid cell should have no more than about 1K nodes.
-	//Let's assume the nodes are evenly distributed
-	//(which is not the case, but locality should still be preserved for densly populaterd areas)
-	//only do this if there are enoug nodes
-	uint32_t binCount = g.nodes().size()/1024;
+	//sort the nodes/edges according to their closeness for more access-locality during dijkstra runs
+	if (spatialSort && g.nodeCount()) {
+		log << "Clustering graph nodes" << std::endl;
+		TimeMeasurer tm;
+		tm.begin();
+		g.reorderNodes(NO_HILBERT);
+		tm.end();
+		log << "Clustering completed in " << tm.elapsedMilliSeconds() << " ms" << std::endl;
+	}
 	
-	if (spatialSort && binCount > 100) {
-		std::cout << "Clustering graph nodes" << std::endl;
-		g.printStats(std::cout);
-		std::cout << std::endl;
-		
-		uint32_t latCount, lonCount;
-		double minLat, maxLat, minLon, maxLon;
-		g.bbox(minLat, maxLat, minLon, maxLon);
-		
-// 		double area = (maxLat-minLat)*(maxLon-minLon);
-		
-		//scale both axis proprionaly to their extent
-		latCount = (binCount/(maxLat-minLat))/2;//(maxLat-minLat)/(area*2)*binCount;
-		lonCount = (binCount/(maxLon-minLon))/2;//(maxLon-minLon)/(area*2)*binCount;
-		
-		//create a new graph with sorted nodes
-		Graph myG;
-		myG.edges().reserve(g.edges().size());
-		myG.nodeInfos().reserve(g.nodeInfos().size());
-		myG.nodes().reserve(g.nodes().size());
-		{
-			Grid grid(&g, latCount, lonCount);
-			grid.printStats(std::cout);
-			std::vector<uint32_t> oldNodeId2newNodeId;
-			oldNodeId2newNodeId.resize(g.nodes().size());
-			for(uint32_t i(0), s(grid.binCount()); i < s; ++i) {
-				for(Grid::ConstNodeRefIterator refIt(grid.binNodesBegin(i)), refEnd(grid.binNodesEnd(i)); refIt != refEnd; ++refIt) {
-					oldNodeId2newNodeId.at(*refIt) = myG.nodes().size();
-					const Node & on = g.nodes().at(*refIt);
-					
-					Node nn;
-					nn.begin = myG.edges().size();
-					nn.end = nn.begin + on.edgeCount();
-					
-					myG.nodes().push_back(nn);
-					myG.nodeInfos().push_back( g.nodeInfos().at(*refIt) );
-					myG.edges().insert(myG.edges().end(), g.edges().begin()+on.begin, g.edges().begin()+on.end);
-				}
-			}
-			//adjust the nodeIds in the edges since these are still the old ids
-			for(uint32_t i(0), s(myG.edgeCount()); i < s; ++i) {
-				Graph::Edge & e = myG.edges().at(i);
-				e.source = oldNodeId2newNodeId.at(e.source);
-				e.target = oldNodeId2newNodeId.at(e.target);
-			}
-			//sort the target edges for every node
-			for(uint32_t i(0), s(myG.nodeCount()); i < s; ++i) {
-				Graph::Node & n = myG.nodes().at(i);
-				std::sort(myG.edges().begin()+n.begin, myG.edges().begin()+n.end, [](const Graph::Edge & a, const Graph::Edge & b) {
-					return a.target < b.target;
-				});
-			}
+	g.createReverseEdges();
+	
+	return g;
+}
+
+uint32_t Graph::reverseEdge(uint32_t edgeId) const {
+	const Edge & e = edge(edgeId);
+	for(uint32_t revEdgeId(node(e.target).begin), end(node(e.target).end); revEdgeId < end; ++revEdgeId) {
+		if (edge(revEdgeId).target == e.source) {
+			return revEdgeId;
+		}
+	}
+	return invalid_edge;
+}
+
+Graph::Route Graph::routeInfo(const PhantomNode & start, std::vector<uint32_t> && nodes, const PhantomNode & end, double vehicleMaxSpeed, int accessTypes) const {
+	//distance and time of the traversed part of an edge, the whole edge is measured by memgraph to use the same speeds as the route
+	auto partialEdge = [&](uint32_t from, uint32_t to, double fraction, Route & r) {
+		Route er = memgraph::Graph::routeInfo(std::vector<uint32_t>{from, to}, vehicleMaxSpeed, accessTypes);
+		r.distance += fraction*er.distance;
+		r.time += fraction*er.time;
+	};
+	const Edge & se = edge(start.edgeId);
+	const Edge & te = edge(end.edgeId);
+	Route r;
+	if (!nodes.size()) {
+		r.distance = 0;
+		r.time = 0;
+		double endOffset = (end.edgeId == start.edgeId ? end.offset : 1.0-end.offset);
+		if (endOffset >= start.offset) {
+			partialEdge(se.source, se.target, endOffset-start.offset, r);
+		}
+		else {
+			partialEdge(se.target, se.source, start.offset-endOffset, r);
+		}
+		return r;
+	}
+	uint32_t firstNode = nodes.front();
+	uint32_t lastNode = nodes.back();
+	r = memgraph::Graph::routeInfo(std::move(nodes), vehicleMaxSpeed, accessTypes);
+	if (firstNode == se.target) {
+		partialEdge(se.source, se.target, 1.0-start.offset, r);
+	}
+	else {
+		partialEdge(se.target, se.source, start.offset, r);
+	}
+	if (lastNode == te.source) {
+		partialEdge(te.source, te.target, end.offset, r);
+	}
+	else {
+		partialEdge(te.target, te.source, 1.0-end.offset, r);
+	}
+	return r;
+}
+
+namespace {
+
+///moves v[i] to v[dest[i]] by following the cycles of the permutation, dest is the identity afterwards
+template<typename T>
+void permuteInPlace(std::vector<T> & v, std::vector<uint32_t> & dest) {
+	for(uint32_t i(0), s(v.size()); i < s; ++i) {
+		while (dest[i] != i) {
+			uint32_t j = dest[i];
+			std::swap(v[i], v[j]);
+			std::swap(dest[i], dest[j]);
 		}
-		assert(myG.edgeCount() == g.edgeCount());
-		assert(myG.nodes().size() == g.nodes().size());
-		assert(myG.nodeInfos().size() == g.nodeInfos().size());
-		
-		g = std::move(myG);
-		std::cout << "Clustering completed" << std::endl;
+	}
+}
+
+}//end namespace
+
+std::vector<uint32_t> Graph::reorderNodes(NodeOrder order, uint32_t threadCount) {
+	uint32_t nc = nodeCount();
+	std::vector<uint32_t> newIds(nc);
+	if (!nc) {
+		return newIds;
 	}
 	
-	return g;
+	//fixed-point coordinates relative to the bounding box
+	double minLat, maxLat, minLon, maxLon;
+	bbox(minLat, maxLat, minLon, maxLon);
+	double latScale = (maxLat > minLat ? double(0xFFFFFFFF)/(maxLat-minLat) : 0.0);
+	double lonScale = (maxLon > minLon ? double(0xFFFFFFFF)/(maxLon-minLon) : 0.0);
+	
+	std::vector< std::pair<uint64_t, uint32_t> > keys(nc);
+	parallelFor(0, nc, [&](uint32_t i, uint32_t) {
+		const NodeInfo & ni = nodeInfo(i);
+		uint32_t x = std::min<double>((ni.lon-minLon)*lonScale, 0xFFFFFFFF);
+		uint32_t y = std::min<double>((ni.lat-minLat)*latScale, 0xFFFFFFFF);
+		keys[i].first = (order == NO_Z_ORDER ? zOrderIndex(x, y) : hilbertIndex(x, y));
+		keys[i].second = i;
+	}, threadCount, 4096);
+	parallelSort(keys.begin(), keys.end(), std::less< std::pair<uint64_t, uint32_t> >(), threadCount);
+	for(uint32_t i(0); i < nc; ++i) {
+		newIds[keys[i].second] = i;
+	}
+	std::vector< std::pair<uint64_t, uint32_t> >().swap(keys);
+	
+	//new position of every edge, the edges of a node stay consecutive
+	std::vector<uint32_t> edgeDest(edgeCount());
+	{
+		std::vector<Node> newNodes(nc);
+		for(uint32_t i(0); i < nc; ++i) {
+			newNodes[newIds[i]].end = node(i).edgeCount();
+		}
+		uint32_t offset = 0;
+		for(Node & n : newNodes) {
+			n.begin = offset;
+			offset += n.end;
+			n.end = offset;
+		}
+		parallelFor(0, nc, [&](uint32_t i, uint32_t) {
+			const Node & on = node(i);
+			uint32_t begin = newNodes[newIds[i]].begin;
+			for(uint32_t edgeId(on.begin); edgeId < on.end; ++edgeId) {
+				edgeDest[edgeId] = begin + (edgeId - on.begin);
+			}
+		}, threadCount, 4096);
+		nodes() = std::move(newNodes);
+	}
+	permuteInPlace(edges(), edgeDest);
+	std::vector<uint32_t>().swap(edgeDest);
+	
+	{
+		std::vector<uint32_t> nodeDest(newIds);
+		permuteInPlace(nodeInfos(), nodeDest);
+	}
+	
+	//adjust the node ids in the edges and sort the edges of every node by target
+	parallelFor(0, nc, [&](uint32_t i, uint32_t) {
+		const Node & n = node(i);
+		for(uint32_t edgeId(n.begin); edgeId < n.end; ++edgeId) {
+			Edge & e = edges()[edgeId];
+			e.source = newIds[e.source];
+			e.target = newIds[e.target];
+		}
+		std::sort(edges().begin()+n.begin, edges().begin()+n.end, [](const Edge & a, const Edge & b) {
+			return a.target < b.target;
+		});
+	}, threadCount, 1024);
+	
+	if (hasReverseEdges()) {
+		createReverseEdges();
+	}
+	return newIds;
+}
+
+void Graph::createReverseEdges() {
+	//counting sort of the edge ids by their target
+	m_reverseEdgesBegin.assign(nodeCount()+1, 0);
+	for(uint32_t i(0), s(edgeCount()); i < s; ++i) {
+		++m_reverseEdgesBegin.at(edge(i).target+1);
+	}
+	for(uint32_t i(1), s(m_reverseEdgesBegin.size()); i < s; ++i) {
+		m_reverseEdgesBegin[i] += m_reverseEdgesBegin[i-1];
+	}
+	std::vector<uint32_t>().swap(m_reverseEdgesEnd);
+	m_reverseEdges.resize(edgeCount());
+	std::vector<uint32_t> pos(m_reverseEdgesBegin.begin(), m_reverseEdgesBegin.end()-1);
+	for(uint32_t i(0), s(edgeCount()); i < s; ++i) {
+		m_reverseEdges[pos[edge(i).target]++] = i;
+	}
+}
+
+void Graph::clearReverseEdges() {
+	std::vector<uint32_t>().swap(m_reverseEdgesBegin);
+	std::vector<uint32_t>().swap(m_reverseEdgesEnd);
+	std::vector<uint32_t>().swap(m_reverseEdges);
+}
+
+uint32_t Graph::addNode(const NodeInfo & ni) {
+	bool reverseEdges = hasReverseEdges();
+	uint32_t nodeId = nodeCount();
+	Node n;
+	n.begin = n.end = edgeCount();
+	nodes().push_back(n);
+	nodeInfos().push_back(ni);
+	if (reverseEdges) {
+		//the sentinel becomes the empty range of the new node
+		uint32_t end = m_reverseEdges.size();
+		m_reverseEdgesBegin.back() = end;
+		m_reverseEdgesBegin.push_back(end);
+		if (m_reverseEdgesEnd.size()) {
+			m_reverseEdgesEnd.push_back(end);
+		}
+	}
+	return nodeId;
+}
+
+uint32_t Graph::addEdge(const Edge & e, std::vector< std::pair<uint32_t, uint32_t> > & movedEdges) {
+	Node & n = nodes()[e.source];
+	if (n.end != edgeCount()) {
+		uint32_t newBegin = edgeCount();
+		for(uint32_t edgeId(n.begin); edgeId < n.end; ++edgeId) {
+			Edge moved = edge(edgeId);
+			edges().push_back(moved);
+			renameReverseEdge(moved.target, edgeId, edges().size()-1);
+			movedEdges.emplace_back(edgeId, edges().size()-1);
+			Edge & unused = edges()[edgeId];
+			unused.target = unused.source;
+			unused.distance = 0;
+			unused.access = Edge::AT_NONE;
+		}
+		m_unusedEdgeCount += n.edgeCount();
+		n.begin = newBegin;
+		n.end = edgeCount();
+	}
+	edges().push_back(e);
+	uint32_t edgeId = n.end;
+	n.end += 1;
+	addReverseEdge(e.target, edgeId);
+	return edgeId;
+}
+
+void Graph::removeEdge(uint32_t edgeId, std::vector< std::pair<uint32_t, uint32_t> > & movedEdges) {
+	Node & n = nodes()[edge(edgeId).source];
+	uint32_t lastEdgeId = n.end-1;
+	removeReverseEdge(edge(edgeId).target, edgeId);
+	if (edgeId != lastEdgeId) {
+		edges()[edgeId] = edge(lastEdgeId);
+		renameReverseEdge(edge(edgeId).target, lastEdgeId, edgeId);
+		movedEdges.emplace_back(lastEdgeId, edgeId);
+	}
+	n.end -= 1;
+	//the last slot is not popped either, empty ranges of nodes added by addNode() may begin behind it
+	Edge & unused = edges()[lastEdgeId];
+	unused.target = unused.source;
+	unused.distance = 0;
+	unused.access = Edge::AT_NONE;
+	m_unusedEdgeCount += 1;
+}
+
+void Graph::compactEdges() {
+	if (!m_unusedEdgeCount) {
+		//removed reverse edges leave gaps without unused edge slots
+		if (m_reverseEdgesEnd.size()) {
+			createReverseEdges();
+		}
+		return;
+	}
+	//the edges of node i follow those of node i-1 again, the unused slots are moved behind the last edge
+	std::vector<uint32_t> edgeDest(edgeCount(), invalid_edge);
+	uint32_t offset = 0;
+	for(Node & n : nodes()) {
+		uint32_t begin = offset;
+		for(uint32_t edgeId(n.begin); edgeId < n.end; ++edgeId) {
+			edgeDest[edgeId] = offset;
+			offset += 1;
+		}
+		n.begin = begin;
+		n.end = offset;
+	}
+	uint32_t usedEdgeCount = offset;
+	for(uint32_t & dest : edgeDest) {
+		if (dest == invalid_edge) {
+			dest = offset;
+			offset += 1;
+		}
+	}
+	permuteInPlace(edges(), edgeDest);
+	edges().resize(usedEdgeCount);
+	m_unusedEdgeCount = 0;
+	if (hasReverseEdges()) {
+		createReverseEdges();
+	}
+}
+
+void Graph::moveReverseEdges(uint32_t nodeId) {
+	if (m_reverseEdgesEnd.empty()) {
+		m_reverseEdgesEnd.assign(m_reverseEdgesBegin.begin()+1, m_reverseEdgesBegin.end());
+	}
+	uint32_t & begin = m_reverseEdgesBegin[nodeId];
+	uint32_t & end = m_reverseEdgesEnd[nodeId];
+	if (end == m_reverseEdges.size()) {
+		return;
+	}
+	uint32_t newBegin = m_reverseEdges.size();
+	for(uint32_t i(begin); i < end; ++i) {
+		uint32_t edgeId = m_reverseEdges[i];
+		m_reverseEdges.push_back(edgeId);
+	}
+	begin = newBegin;
+	end = m_reverseEdges.size();
+}
+
+void Graph::addReverseEdge(uint32_t nodeId, uint32_t edgeId) {
+	if (!hasReverseEdges()) {
+		return;
+	}
+	moveReverseEdges(nodeId);
+	m_reverseEdges.push_back(edgeId);
+	m_reverseEdgesEnd[nodeId] += 1;
+}
+
+void Graph::removeReverseEdge(uint32_t nodeId, uint32_t edgeId) {
+	if (!hasReverseEdges()) {
+		return;
+	}
+	if (m_reverseEdgesEnd.empty()) {
+		m_reverseEdgesEnd.assign(m_reverseEdgesBegin.begin()+1, m_reverseEdgesBegin.end());
+	}
+	uint32_t & end = m_reverseEdgesEnd[nodeId];
+	for(uint32_t i(m_reverseEdgesBegin[nodeId]); i < end; ++i) {
+		if (m_reverseEdges[i] == edgeId) {
+			m_reverseEdges[i] = m_reverseEdges[end-1];
+			end -= 1;
+			return;
+		}
+	}
+	assert(false);
+}
+
+void Graph::renameReverseEdge(uint32_t nodeId, uint32_t oldEdgeId, uint32_t newEdgeId) {
+	if (!hasReverseEdges()) {
+		return;
+	}
+	for(uint32_t i(m_reverseEdgesBegin[nodeId]), end(reverseEdgesEnd(nodeId)-m_reverseEdges.cbegin()); i < end; ++i) {
+		if (m_reverseEdges[i] == oldEdgeId) {
+			m_reverseEdges[i] = newEdgeId;
+			return;
+		}
+	}
+	assert(false);
 }
 
 }//end namespace
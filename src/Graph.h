@@ -2,35 +2,138 @@
 #define SIMPLE_ROUTE_GRAPH_H
 
 #include <memgraph/Graph.h>
+#include <vector>
+#include <utility>
+#include <ostream>
 
 namespace simpleroute {
 
+class GraphSnapshot;
+
 struct Graph: memgraph::Graph {
-	Graph() {}
-	Graph(const memgraph::Graph & g) : memgraph::Graph(g) {}
-	Graph(const Graph & g) : memgraph::Graph(g) {}
-	Graph(memgraph::Graph && g) : memgraph::Graph(std::move(g)) {}
-	Graph(Graph && g) : memgraph::Graph(std::move(g)) {}
+	friend class GraphSnapshot;
+	///iterates over edge ids
+	typedef std::vector<uint32_t>::const_iterator ConstEdgeRefIterator;
+	///space-filling curves for reorderNodes()
+	typedef enum { NO_HILBERT, NO_Z_ORDER } NodeOrder;
+	static constexpr uint32_t invalid_edge = 0xFFFFFFFF;
+	///A position on an edge that is not a node, e.g. a click snapped to the closest edge, see Grid::closestEdge
+	struct PhantomNode {
+		uint32_t edgeId;
+		///position on the edge from its source (0.0) to its target (1.0)
+		double offset;
+		PhantomNode() : edgeId(invalid_edge), offset(0.0) {}
+		PhantomNode(uint32_t edgeId, double offset) : edgeId(edgeId), offset(offset) {}
+		inline bool valid() const { return edgeId != invalid_edge; }
+	};
+	
+	using memgraph::Graph::routeInfo;
+	
+	Graph() : m_unusedEdgeCount(0) {}
+	Graph(const memgraph::Graph & g) : memgraph::Graph(g), m_unusedEdgeCount(0) {}
+	Graph(const Graph & g) :
+	memgraph::Graph(g),
+	m_reverseEdgesBegin(g.m_reverseEdgesBegin),
+	m_reverseEdgesEnd(g.m_reverseEdgesEnd),
+	m_reverseEdges(g.m_reverseEdges),
+	m_unusedEdgeCount(g.m_unusedEdgeCount)
+	{}
+	Graph(memgraph::Graph && g) : memgraph::Graph(std::move(g)), m_unusedEdgeCount(0) {}
+	Graph(Graph && g) :
+	memgraph::Graph(std::move(g)),
+	m_reverseEdgesBegin(std::move(g.m_reverseEdgesBegin)),
+	m_reverseEdgesEnd(std::move(g.m_reverseEdgesEnd)),
+	m_reverseEdges(std::move(g.m_reverseEdges)),
+	m_unusedEdgeCount(g.m_unusedEdgeCount)
+	{}
 	
 	Graph & operator=(const Graph & g) {
 		memgraph::Graph::operator=(g);
+		m_reverseEdgesBegin = g.m_reverseEdgesBegin;
+		m_reverseEdgesEnd = g.m_reverseEdgesEnd;
+		m_reverseEdges = g.m_reverseEdges;
+		m_unusedEdgeCount = g.m_unusedEdgeCount;
 		return *this;
 	}
 	Graph & operator=(const memgraph::Graph & g) {
 		memgraph::Graph::operator=(g);
+		clearReverseEdges();
+		m_unusedEdgeCount = 0;
 		return *this;
 	}
 	Graph & operator=(Graph && g) {
 		memgraph::Graph::operator=(std::move(g));
+		m_reverseEdgesBegin = std::move(g.m_reverseEdgesBegin);
+		m_reverseEdgesEnd = std::move(g.m_reverseEdgesEnd);
+		m_reverseEdges = std::move(g.m_reverseEdges);
+		m_unusedEdgeCount = g.m_unusedEdgeCount;
 		return *this;
 	}
 	Graph & operator=(memgraph::Graph && g) {
 		memgraph::Graph::operator=(std::move(g));
+		clearReverseEdges();
+		m_unusedEdgeCount = 0;
 		return *this;
 	}
 	virtual ~Graph() {}
 	
-	static Graph fromPBF(const std::string & path, bool spatialSort, int accessTypes = Edge::AT_ALL);
+	///Creates the reverse adjacency: the ids of the incoming edges of every node.
+	///This has to be called again if the edges change
+	void createReverseEdges();
+	void clearReverseEdges();
+	inline bool hasReverseEdges() const { return m_reverseEdgesBegin.size() == nodeCount()+1; }
+	///ids of the edges whose target is nodeId, only valid if hasReverseEdges()
+	inline ConstEdgeRefIterator reverseEdgesBegin(uint32_t nodeId) const { return m_reverseEdges.cbegin() + m_reverseEdgesBegin[nodeId]; }
+	inline ConstEdgeRefIterator reverseEdgesEnd(uint32_t nodeId) const {
+		return m_reverseEdges.cbegin() + (m_reverseEdgesEnd.size() ? m_reverseEdgesEnd[nodeId] : m_reverseEdgesBegin[nodeId+1]);
+	}
+	
+	///id of an edge from the target of edgeId to its source, invalid_edge if there is none
+	uint32_t reverseEdge(uint32_t edgeId) const;
+	
+	///Route info of a path between two phantom nodes, nodes are the graph nodes in between as reported by Router::route(const PhantomNode &...).
+	///The parts of the edges of start and end are added in proportion to their offsets, nodes is empty if both lie on the same edge
+	Route routeInfo(const PhantomNode & start, std::vector<uint32_t> && nodes, const PhantomNode & end, double vehicleMaxSpeed, int accessTypes) const;
+	
+	///Renumbers the nodes along a space-filling curve through their coordinates for more access-locality during searches.
+	///Edges are moved to the new position of their source and sorted by target, the reverse edges are recreated if present.
+	///The extra memory is linear in the number of nodes and edges, but no copy of the graph is created
+	///@param threadCount 0 uses all cores
+	///@return the new id of every node
+	std::vector<uint32_t> reorderNodes(NodeOrder order, uint32_t threadCount = 0);
+	
+	///Appends a node without edges and returns its id, the ids of the other nodes do not change
+	uint32_t addNode(const NodeInfo & ni);
+	///Adds e to the edges of e.source and returns its id, the reverse edges are updated if present.
+	///If the slot behind the edges of the source is in use they are moved behind the last edge first,
+	///their (old id, new id) pairs are appended to movedEdges and the slots they leave become unused
+	uint32_t addEdge(const Edge & e, std::vector< std::pair<uint32_t, uint32_t> > & movedEdges);
+	///Removes an edge, the reverse edges are updated if present.
+	///The last edge of its source takes its id and is appended to movedEdges, the slot of the last edge becomes unused
+	void removeEdge(uint32_t edgeId, std::vector< std::pair<uint32_t, uint32_t> > & movedEdges);
+	///Slots in edges() that belong to no node after addEdge() or removeEdge().
+	///They are edges from a node to itself without access types and are not in the reverse edges
+	inline uint32_t unusedEdgeCount() const { return m_unusedEdgeCount; }
+	///Removes the unused slots and the gaps in the reverse edges, the edges keep their order. Edge ids change, the reverse edges are recreated if present.
+	///reorderNodes() and GraphSnapshot::write expect a graph without unused slots
+	void compactEdges();
+	
+	///the reverse adjacency is created as well, spatialSort reorders the nodes along a Hilbert curve
+	static Graph fromPBF(const std::string & path, bool spatialSort, std::ostream & log, int accessTypes = Edge::AT_ALL);
+private:
+	///copies the reverse edges of nodeId behind the last one, afterwards the slot behind them is free
+	void moveReverseEdges(uint32_t nodeId);
+	void addReverseEdge(uint32_t nodeId, uint32_t edgeId);
+	void removeReverseEdge(uint32_t nodeId, uint32_t edgeId);
+	void renameReverseEdge(uint32_t nodeId, uint32_t oldEdgeId, uint32_t newEdgeId);
+private:
+	///offsets into m_reverseEdges with a sentinel at nodeCount()
+	std::vector<uint32_t> m_reverseEdgesBegin;
+	///Empty as long as the reverse edges of node i end where those of node i+1 begin.
+	///Otherwise the end of the reverse edges of every node, ranges moved by addEdge() leave gaps in m_reverseEdges
+	std::vector<uint32_t> m_reverseEdgesEnd;
+	std::vector<uint32_t> m_reverseEdges;
+	uint32_t m_unusedEdgeCount;
 };
 	
 }
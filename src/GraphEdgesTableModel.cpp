@@ -26,9 +26,10 @@ void GraphEdgesTable::setModel(QAbstractItemModel* m) {
 	m_sizeHintForColumn = model()->headerData( 0, Qt::Vertical, Qt::SizeHintRole ).toSize().width();
 }
 
-GraphEdgesTableModel::GraphEdgesTableModel(QObject* parent, const StatePtr& state) :
+GraphEdgesTableModel::GraphEdgesTableModel(QObject* parent, const StateHolderPtr& states) :
 QAbstractTableModel(parent),
-m_state(state)
+m_states(states),
+m_state(states->current())
 {}
 
 GraphEdgesTableModel::~GraphEdgesTableModel() {}
@@ -163,6 +164,7 @@ void GraphEdgesTableModel::headerClicked(int logicalindex) {
 
 void GraphEdgesTableModel::resetData() {
 	emit beginResetModel();
+	m_state = m_states->current();
 	emit endResetModel();
 }
 
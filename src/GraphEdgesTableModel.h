@@ -25,10 +25,12 @@ private:
 	typedef enum { CN_SOURCE=0, CN_TARGET=1, CN_TYPE=2, CN_ACCESS=3,
 					CN_LENGTH=4, CN_MAXSPEED=5, CN_SHOW=6, CN_COL_COUNT=CN_SHOW+1} ColNames;
 private:
+	StateHolderPtr m_states;
+	///the state shown by the model, it is updated by resetData
 	StatePtr m_state;
 	
 public:
-	GraphEdgesTableModel(QObject * parent, const StatePtr & state);
+	GraphEdgesTableModel(QObject * parent, const StateHolderPtr & states);
 	virtual ~GraphEdgesTableModel();
 	virtual int rowCount(const QModelIndex&) const override;
 	virtual int columnCount(const QModelIndex&) const override;
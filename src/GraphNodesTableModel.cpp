@@ -3,9 +3,10 @@
 
 namespace simpleroute {
 
-GraphNodesTableModel::GraphNodesTableModel(QObject* parent, const StatePtr& state) :
+GraphNodesTableModel::GraphNodesTableModel(QObject* parent, const StateHolderPtr& states) :
 QAbstractTableModel(parent),
-m_state(state)
+m_states(states),
+m_state(states->current())
 {}
 
 GraphNodesTableModel::~GraphNodesTableModel() {}
@@ -86,6 +87,7 @@ QVariant GraphNodesTableModel::data(const QModelIndex& index, int role) const {
 
 void GraphNodesTableModel::resetData() {
 	emit beginResetModel();
+	m_state = m_states->current();
 	emit endResetModel();
 }
 
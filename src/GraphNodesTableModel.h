@@ -10,10 +10,12 @@ class GraphNodesTableModel: public QAbstractTableModel {
 private:
 	typedef enum { CN_OSMID=0, CN_LAT=1, CN_LON=2, CN_EDGE_COUNT=3, CN_START_EDGE=4, CN_SHOW=5, CN_COL_COUNT=CN_SHOW+1} ColNames;
 private:
+	StateHolderPtr m_states;
+	///the state shown by the model, it is updated by resetData
 	StatePtr m_state;
 	
 public:
-	GraphNodesTableModel(QObject * parent, const StatePtr & state);
+	GraphNodesTableModel(QObject * parent, const StateHolderPtr & states);
 	virtual ~GraphNodesTableModel();
 	virtual int rowCount(const QModelIndex&) const;
 	virtual int columnCount(const QModelIndex&) const;
@@ -0,0 +1,291 @@
+#include "GraphSnapshot.h"
+#include "TimeMeasurer.h"
+#include <fstream>
+#include <stdexcept>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <sys/stat.h>
+
+namespace simpleroute {
+namespace {
+
+static constexpr uint32_t file_magic = 0x53475253; //"SRGS"
+static constexpr uint32_t byte_order_mark = 0x01020304;
+static constexpr uint64_t section_alignment = 64;
+
+typedef enum {
+	S_NODES, S_NODE_INFOS, S_EDGES, S_REVERSE_EDGES_BEGIN, S_REVERSE_EDGES, S_GRID_BINS, S_GRID_NODE_REFS, S_COUNT
+} SectionType;
+
+struct Section {
+	///offset from the beginning of the file
+	uint64_t offset;
+	uint64_t count;
+};
+
+struct Header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t byteOrder;
+	uint32_t nodeSize;
+	uint32_t nodeInfoSize;
+	uint32_t edgeSize;
+	uint32_t binSize;
+	int32_t accessTypes;
+	uint32_t spatialSort;
+	uint32_t latCount;
+	uint32_t lonCount;
+	uint32_t reserved;
+	uint64_t sourceSize;
+	int64_t sourceMTime;
+	double gridMinLat;
+	double gridMaxLat;
+	double gridMinLon;
+	double gridMaxLon;
+	uint32_t gridLatCount;
+	uint32_t gridLonCount;
+	Section sections[S_COUNT];
+};
+
+void sourceInfo(const std::string & sourcePath, uint64_t & size, int64_t & mtime) {
+	struct stat st;
+	if (::stat(sourcePath.c_str(), &st) != 0) {
+		throw std::runtime_error("GraphSnapshot: could not stat " + sourcePath);
+	}
+	size = st.st_size;
+	mtime = st.st_mtime;
+}
+
+template<typename T>
+void setSection(Header & h, SectionType st, const std::vector<T> & v, uint64_t & offset) {
+	h.sections[st].offset = offset;
+	h.sections[st].count = v.size();
+	offset += v.size()*sizeof(T);
+	offset = (offset + section_alignment - 1) / section_alignment * section_alignment;
+}
+
+template<typename T>
+void writeSection(std::ostream & out, const Header & h, SectionType st, const std::vector<T> & v) {
+	uint64_t pos = out.tellp();
+	static const char padding[section_alignment] = {0};
+	out.write(padding, h.sections[st].offset - pos);
+	out.write(reinterpret_cast<const char*>(v.data()), v.size()*sizeof(T));
+}
+
+///reads the section straight into v, fileSize bounds the section before v is allocated
+template<typename T>
+void readSection(std::istream & in, uint64_t fileSize, const Header & h, SectionType st, std::vector<T> & v) {
+	const Section & s = h.sections[st];
+	if (s.offset > fileSize || s.count > (fileSize - s.offset)/sizeof(T)) {
+		throw std::runtime_error("GraphSnapshot: truncated snapshot");
+	}
+	v.resize(s.count);
+	in.seekg(s.offset);
+	in.read(reinterpret_cast<char*>(v.data()), s.count*sizeof(T));
+	if (!in) {
+		throw std::runtime_error("GraphSnapshot: could not read snapshot");
+	}
+}
+
+}//end namespace
+
+void GraphSnapshot::write(const std::string & path, const std::string & sourcePath, const Options & options, const Graph & graph, const Grid & grid) {
+	if (graph.unusedEdgeCount() || graph.m_reverseEdgesEnd.size()) {
+		throw std::runtime_error("GraphSnapshot: the graph has unused edge slots or gaps in its reverse edges, see Graph::compactEdges");
+	}
+	if (grid.m_binLimits.size()) {
+		throw std::runtime_error("GraphSnapshot: the grid has gaps, see Grid::compact");
+	}
+	if (grid.m_nodeRefs.size() != graph.nodeCount()) {
+		throw std::runtime_error("GraphSnapshot: the grid does not contain every node of the graph");
+	}
+	Header h;
+	::memset(&h, 0, sizeof(Header));
+	h.magic = file_magic;
+	h.version = file_version;
+	h.byteOrder = byte_order_mark;
+	h.nodeSize = sizeof(Graph::Node);
+	h.nodeInfoSize = sizeof(Graph::NodeInfo);
+	h.edgeSize = sizeof(Graph::Edge);
+	h.binSize = sizeof(Grid::Bin);
+	h.accessTypes = options.accessTypes;
+	h.spatialSort = options.spatialSort;
+	h.latCount = options.latCount;
+	h.lonCount = options.lonCount;
+	sourceInfo(sourcePath, h.sourceSize, h.sourceMTime);
+	h.gridMinLat = grid.m_minLat;
+	h.gridMaxLat = grid.m_maxLat;
+	h.gridMinLon = grid.m_minLon;
+	h.gridMaxLon = grid.m_maxLon;
+	h.gridLatCount = grid.m_latCount;
+	h.gridLonCount = grid.m_lonCount;
+
+	uint64_t offset = (sizeof(Header) + section_alignment - 1) / section_alignment * section_alignment;
+	setSection(h, S_NODES, graph.nodes(), offset);
+	setSection(h, S_NODE_INFOS, graph.nodeInfos(), offset);
+	setSection(h, S_EDGES, graph.edges(), offset);
+	setSection(h, S_REVERSE_EDGES_BEGIN, graph.m_reverseEdgesBegin, offset);
+	setSection(h, S_REVERSE_EDGES, graph.m_reverseEdges, offset);
+	setSection(h, S_GRID_BINS, grid.m_bins, offset);
+	setSection(h, S_GRID_NODE_REFS, grid.m_nodeRefs, offset);
+
+	//write to a temporary file first, concurrent readers never see a partial snapshot
+	std::string tmpPath = path + ".tmp";
+	{
+		std::ofstream out(tmpPath, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!out.is_open()) {
+			throw std::runtime_error("GraphSnapshot: could not open " + tmpPath + " for writing");
+		}
+		out.write(reinterpret_cast<const char*>(&h), sizeof(Header));
+		writeSection(out, h, S_NODES, graph.nodes());
+		writeSection(out, h, S_NODE_INFOS, graph.nodeInfos());
+		writeSection(out, h, S_EDGES, graph.edges());
+		writeSection(out, h, S_REVERSE_EDGES_BEGIN, graph.m_reverseEdgesBegin);
+		writeSection(out, h, S_REVERSE_EDGES, graph.m_reverseEdges);
+		writeSection(out, h, S_GRID_BINS, grid.m_bins);
+		writeSection(out, h, S_GRID_NODE_REFS, grid.m_nodeRefs);
+		out.flush();
+		if (!out) {
+			out.close();
+			std::remove(tmpPath.c_str());
+			throw std::runtime_error("GraphSnapshot: could not write " + tmpPath);
+		}
+	}
+	if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+		std::remove(tmpPath.c_str());
+		throw std::runtime_error("GraphSnapshot: could not rename " + tmpPath + " to " + path);
+	}
+}
+
+void GraphSnapshot::read(const std::string & path, const std::string & sourcePath, const Options & options, Graph & graph, Grid & grid) {
+	std::ifstream in(path, std::ios::in | std::ios::binary);
+	if (!in.is_open()) {
+		throw std::runtime_error("GraphSnapshot: could not open " + path);
+	}
+	in.seekg(0, std::ios::end);
+	uint64_t fileSize = in.tellg();
+	in.seekg(0);
+	Header h;
+	if (fileSize < sizeof(Header) || !in.read(reinterpret_cast<char*>(&h), sizeof(Header))) {
+		throw std::runtime_error("GraphSnapshot: " + path + " is too small");
+	}
+
+	if (h.magic != file_magic || h.version != file_version || h.byteOrder != byte_order_mark ||
+		h.nodeSize != sizeof(Graph::Node) || h.nodeInfoSize != sizeof(Graph::NodeInfo) ||
+		h.edgeSize != sizeof(Graph::Edge) || h.binSize != sizeof(Grid::Bin))
+	{
+		throw std::runtime_error("GraphSnapshot: " + path + " has an unsupported format");
+	}
+	uint64_t sourceSize;
+	int64_t sourceMTime;
+	sourceInfo(sourcePath, sourceSize, sourceMTime);
+	if (h.sourceSize != sourceSize || h.sourceMTime != sourceMTime) {
+		throw std::runtime_error("GraphSnapshot: " + path + " is outdated");
+	}
+	if (h.accessTypes != options.accessTypes || (bool)h.spatialSort != options.spatialSort ||
+		h.latCount != options.latCount || h.lonCount != options.lonCount)
+	{
+		throw std::runtime_error("GraphSnapshot: " + path + " was created with different options");
+	}
+
+	Graph g;
+	readSection(in, fileSize, h, S_NODES, g.nodes());
+	readSection(in, fileSize, h, S_NODE_INFOS, g.nodeInfos());
+	readSection(in, fileSize, h, S_EDGES, g.edges());
+	readSection(in, fileSize, h, S_REVERSE_EDGES_BEGIN, g.m_reverseEdgesBegin);
+	readSection(in, fileSize, h, S_REVERSE_EDGES, g.m_reverseEdges);
+	if (!g.hasReverseEdges() || g.m_reverseEdges.size() != g.edgeCount()) {
+		throw std::runtime_error("GraphSnapshot: " + path + " is inconsistent");
+	}
+
+	Grid gr;
+	gr.m_minLat = h.gridMinLat;
+	gr.m_maxLat = h.gridMaxLat;
+	gr.m_minLon = h.gridMinLon;
+	gr.m_maxLon = h.gridMaxLon;
+	gr.m_latCount = h.gridLatCount;
+	gr.m_lonCount = h.gridLonCount;
+	readSection(in, fileSize, h, S_GRID_BINS, gr.m_bins);
+	readSection(in, fileSize, h, S_GRID_NODE_REFS, gr.m_nodeRefs);
+	if (gr.m_bins.size() != uint64_t(gr.m_latCount)*gr.m_lonCount || gr.m_nodeRefs.size() != g.nodeCount()) {
+		throw std::runtime_error("GraphSnapshot: " + path + " is inconsistent");
+	}
+
+	//the routers and the grid index the arrays without bounds checks, hence every reference is checked once
+	uint64_t nodeCount = g.nodeCount();
+	uint64_t edgeCount = g.edgeCount();
+	bool valid = true;
+	for(const Graph::Node & n : g.nodes()) {
+		valid &= n.begin <= n.end && n.end <= edgeCount;
+	}
+	for(const Graph::Edge & e : g.edges()) {
+		valid &= e.source < nodeCount && e.target < nodeCount;
+	}
+	for(uint64_t i(0); i < nodeCount; ++i) {
+		valid &= g.m_reverseEdgesBegin[i] <= g.m_reverseEdgesBegin[i+1];
+	}
+	valid &= g.m_reverseEdgesBegin.back() <= g.m_reverseEdges.size();
+	for(uint32_t edgeId : g.m_reverseEdges) {
+		valid &= edgeId < edgeCount;
+	}
+	for(const Grid::Bin & b : gr.m_bins) {
+		valid &= b.begin <= b.end && b.end <= gr.m_nodeRefs.size();
+	}
+	for(uint32_t nodeId : gr.m_nodeRefs) {
+		valid &= nodeId < nodeCount;
+	}
+	if (!valid) {
+		throw std::runtime_error("GraphSnapshot: " + path + " references nodes or edges out of range");
+	}
+
+	graph = std::move(g);
+	gr.m_g = &graph;
+	grid = std::move(gr);
+}
+
+std::string GraphSnapshot::path(const std::string & sourcePath) {
+	return sourcePath + ".snapshot";
+}
+
+void GraphSnapshot::load(const std::string & sourcePath, const Options & options, bool useSnapshot, Graph & graph, Grid & grid, std::ostream & log) {
+	std::string snapshotPath = path(sourcePath);
+	if (useSnapshot) {
+		try {
+			TimeMeasurer tm;
+			tm.begin();
+			read(snapshotPath, sourcePath, options, graph, grid);
+			tm.end();
+			log << "Read graph snapshot " << snapshotPath << " in " << tm.elapsedMilliSeconds() << " ms" << std::endl;
+			graph.printStats(log);
+			log << std::endl;
+			grid.printStats(log);
+			log << std::endl;
+			return;
+		}
+		catch (const std::exception & e) {
+			log << e.what() << std::endl;
+		}
+	}
+	
+	log << "Parsing graph from " << sourcePath << std::endl;
+	graph = Graph::fromPBF(sourcePath, options.spatialSort, log, options.accessTypes);
+	graph.printStats(log);
+	log << std::endl;
+	log << "Creating grid" << std::endl;
+	grid = Grid(&graph, options.latCount, options.lonCount);
+	grid.printStats(log);
+	log << std::endl;
+	
+	if (useSnapshot) {
+		log << "Writing graph snapshot " << snapshotPath << std::endl;
+		try {
+			write(snapshotPath, sourcePath, options, graph, grid);
+		}
+		catch (const std::exception & e) {
+			log << e.what() << std::endl;
+		}
+	}
+}
+
+}//end namespace simpleroute
@@ -0,0 +1,46 @@
+#ifndef SIMPLE_ROUTE_GRAPH_SNAPSHOT_H
+#define SIMPLE_ROUTE_GRAPH_SNAPSHOT_H
+#include "Graph.h"
+#include "Grid.h"
+#include <string>
+#include <ostream>
+#include <stdint.h>
+
+namespace simpleroute {
+
+///Binary snapshot of a Graph (including its reverse edges) and its Grid.
+///The file starts with a versioned header followed by the raw arrays, each aligned to 64 bytes.
+///A snapshot is only valid for the source file (size and modification time) and the load options it was created with.
+///Reading copies every array with a single read() straight into its std::vector without any parsing and checks all node and edge references once.
+///The arrays are not served from a mapping of the file: memgraph::Graph owns its nodes and edges as std::vector
+///and Graph and Grid are modified in place (see GraphUpdater). Hence every process holds its own copy.
+///The arrays are stored in host byte order, the header records the sizes of all structs to reject foreign snapshots.
+class GraphSnapshot {
+public:
+	static constexpr uint32_t file_version = 1;
+	///options that change the content of a snapshot
+	struct Options {
+		int accessTypes;
+		bool spatialSort;
+		uint32_t latCount;
+		uint32_t lonCount;
+		Options() : accessTypes(0), spatialSort(false), latCount(0), lonCount(0) {}
+	};
+public:
+	///Throws std::runtime_error on failure, if graph or grid were changed in place and not compacted (see Graph::compactEdges and Grid::compact)
+	///or if nodes were removed from the grid by GraphUpdater
+	static void write(const std::string & path, const std::string & sourcePath, const Options & options, const Graph & graph, const Grid & grid);
+	///Throws std::runtime_error if the snapshot can not be read or does not match sourcePath and options.
+	///grid refers to graph afterwards
+	static void read(const std::string & path, const std::string & sourcePath, const Options & options, Graph & graph, Grid & grid);
+	///Reads graph and grid from the snapshot next to sourcePath if useSnapshot is set and the snapshot is valid.
+	///Otherwise parses sourcePath, creates the grid and (if useSnapshot is set) writes the snapshot.
+	///Progress and snapshot errors are written to log, parse errors are not caught
+	static void load(const std::string & sourcePath, const Options & options, bool useSnapshot, Graph & graph, Grid & grid, std::ostream & log);
+	///path of the snapshot of sourcePath
+	static std::string path(const std::string & sourcePath);
+};
+
+}//end namespace simpleroute
+
+#endif
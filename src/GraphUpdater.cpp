@@ -0,0 +1,456 @@
+#include "GraphUpdater.h"
+#include "util.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <map>
+
+namespace simpleroute {
+namespace {
+
+inline uint64_t nodePair(uint32_t a, uint32_t b) {
+	return (uint64_t(std::min(a, b)) << 32) | std::max(a, b);
+}
+
+///leading number of a maxspeed value in km/h, 0 if there is none
+uint32_t parseMaxSpeed(const std::string & value) {
+	uint32_t speed = ::strtoul(value.c_str(), 0, 10);
+	if (value.find("mph") != std::string::npos) {
+		speed = ::lround(speed*1.609344);
+	}
+	return speed;
+}
+
+///key with the largest count, counts must not be empty
+template<typename T>
+T mostFrequent(const std::map<T, uint32_t> & counts) {
+	typedef typename std::map<T, uint32_t>::value_type Count;
+	return std::max_element(counts.begin(), counts.end(), [](const Count & a, const Count & b) { return a.second < b.second; })->first;
+}
+
+}//end namespace
+
+void GraphUpdater::Stats::print(std::ostream & out) const {
+	out << "GraphUpdater::stats {\n";
+	out << "\t#added nodes: " << addedNodes << "\n";
+	out << "\t#moved nodes: " << movedNodes << "\n";
+	out << "\t#removed nodes: " << removedNodes << "\n";
+	out << "\t#added edges: " << addedEdges << "\n";
+	out << "\t#changed edges: " << changedEdges << "\n";
+	out << "\t#removed edges: " << removedEdges << "\n";
+	out << "\t#skipped ways: " << skippedWays << "\n";
+	out << "}";
+}
+
+GraphUpdater::GraphUpdater(Graph * g, Grid * grid, int accessTypes) :
+m_g(g),
+m_grid(grid),
+m_accessTypes(accessTypes),
+m_distanceScale(1.0)
+{
+	m_nodeIds.reserve(m_g->nodeCount());
+	for(uint32_t i(0), s(m_g->nodeCount()); i < s; ++i) {
+		m_nodeIds[m_g->nodeInfo(i).osmId] = i;
+	}
+
+	//the defaults of memgraph are not known here, the most frequent values of the existing edges are used instead
+	std::vector< std::map<uint32_t, uint32_t> > speedCounts;
+	std::vector< std::map<int, uint32_t> > accessCounts;
+	for(const Graph::Edge & e : m_g->edges()) {
+		if (e.type < 0 || e.access == Graph::Edge::AT_NONE) {
+			continue;
+		}
+		if (uint32_t(e.type) >= speedCounts.size()) {
+			speedCounts.resize(e.type+1);
+			accessCounts.resize(e.type+1);
+		}
+		speedCounts[e.type][e.speed] += 1;
+		accessCounts[e.type][e.access] += 1;
+	}
+	m_typeSpeeds.assign(speedCounts.size(), 0);
+	m_typeAccess.assign(speedCounts.size(), Graph::Edge::AT_NONE);
+	for(uint32_t type(0), s(speedCounts.size()); type < s; ++type) {
+		if (speedCounts[type].empty() || !Graph::Edge::edge_type_2_osm_highway_value[type]) {
+			continue;
+		}
+		m_typeSpeeds[type] = mostFrequent(speedCounts[type]);
+		m_typeAccess[type] = mostFrequent(accessCounts[type]);
+		m_highwayTypes[Graph::Edge::edge_type_2_osm_highway_value[type]] = type;
+	}
+
+	//median ratio of a sample of edges
+	std::vector<double> scales;
+	uint32_t step = std::max<uint32_t>(1, m_g->edgeCount()/1024);
+	for(uint32_t edgeId(0), s(m_g->edgeCount()); edgeId < s; edgeId += step) {
+		const Graph::Edge & e = m_g->edge(edgeId);
+		const Graph::NodeInfo & si = m_g->nodeInfo(e.source);
+		const Graph::NodeInfo & ti = m_g->nodeInfo(e.target);
+		double meters = std::fabs( distanceTo(si.lat, si.lon, ti.lat, ti.lon) );
+		if (meters >= 1.0 && e.distance) {
+			scales.push_back(e.distance/meters);
+		}
+	}
+	if (scales.size()) {
+		std::nth_element(scales.begin(), scales.begin()+scales.size()/2, scales.end());
+		m_distanceScale = scales[scales.size()/2];
+	}
+}
+
+GraphUpdater::~GraphUpdater() {}
+
+GraphUpdater::Stats GraphUpdater::apply(const std::string & path) {
+	return apply(OsmChange::fromFile(path));
+}
+
+GraphUpdater::Stats GraphUpdater::apply(const OsmChange & oc) {
+	Stats stats;
+	//position of the last version of every node of the change
+	std::unordered_map<int64_t, uint32_t> changedNodes;
+	for(uint32_t i(0), s(oc.nodes.size()); i < s; ++i) {
+		changedNodes[oc.nodes[i].id] = i;
+	}
+	//nodes that are not in the graph yet are added by the ways that use them
+	for(uint32_t i(0), s(oc.nodes.size()); i < s; ++i) {
+		const OsmChange::Node & n = oc.nodes[i];
+		std::unordered_map<int64_t, uint32_t>::const_iterator it = m_nodeIds.find(n.id);
+		if (changedNodes[n.id] != i || it == m_nodeIds.end()) {
+			continue;
+		}
+		if (n.action == OsmChange::A_DELETE) {
+			removeNode(it->second, stats);
+		}
+		else {
+			moveNode(it->second, n.lat, n.lon, stats);
+		}
+	}
+	for(const OsmChange::Way & w : oc.ways) {
+		applyWay(w, oc, changedNodes, stats);
+	}
+	index();
+	if (needsCompaction()) {
+		compact();
+	}
+	return stats;
+}
+
+void GraphUpdater::compact() {
+	m_g->compactEdges();
+	m_grid->compact();
+	if (m_grid->hasEdgeIndex()) {
+		m_grid->createEdgeIndex();
+	}
+}
+
+bool GraphUpdater::wayAttributes(const OsmChange::Way & w, WayAttributes & wa) const {
+	std::unordered_map<std::string, int>::const_iterator it = m_highwayTypes.find(w.tag("highway"));
+	if (it == m_highwayTypes.end()) {
+		return false;
+	}
+	wa.type = it->second;
+	wa.speed = m_typeSpeeds[wa.type];
+	uint32_t maxSpeed = parseMaxSpeed(w.tag("maxspeed"));
+	if (maxSpeed) {
+		wa.speed = maxSpeed;
+	}
+	int access = m_typeAccess[wa.type];
+	auto accessTag = [&w, &access](const char * key, int accessTypes) {
+		const std::string & value = w.tag(key);
+		if (value == "no" || value == "private") {
+			access &= ~accessTypes;
+		}
+		else if (value == "yes" || value == "designated" || value == "permissive") {
+			access |= accessTypes;
+		}
+	};
+	//general restrictions first, the specific ones override them
+	accessTag("access", Graph::Edge::AT_ALL);
+	accessTag("vehicle", Graph::Edge::AT_CAR | Graph::Edge::AT_BIKE);
+	accessTag("motor_vehicle", Graph::Edge::AT_CAR);
+	accessTag("motorcar", Graph::Edge::AT_CAR);
+	accessTag("bicycle", Graph::Edge::AT_BIKE);
+	accessTag("foot", Graph::Edge::AT_FOOT);
+	access &= m_accessTypes;
+
+	//pedestrians may walk in both directions
+	const std::string & oneway = w.tag("oneway");
+	int onewayAccess = Graph::Edge::AT_CAR | (w.tag("oneway:bicycle") == "no" ? 0 : Graph::Edge::AT_BIKE);
+	wa.forwardAccess = access;
+	wa.backwardAccess = access;
+	if (oneway == "yes" || oneway == "1" || oneway == "true" || w.tag("junction") == "roundabout") {
+		wa.backwardAccess &= ~onewayAccess;
+	}
+	else if (oneway == "-1") {
+		wa.forwardAccess &= ~onewayAccess;
+	}
+	return wa.forwardAccess || wa.backwardAccess;
+}
+
+uint32_t GraphUpdater::findEdge(uint32_t source, uint32_t target) const {
+	for(uint32_t edgeId(m_g->node(source).begin), end(m_g->node(source).end); edgeId < end; ++edgeId) {
+		if (m_g->edge(edgeId).target == target) {
+			return edgeId;
+		}
+	}
+	return Graph::invalid_edge;
+}
+
+void GraphUpdater::touch(uint32_t a, uint32_t b) {
+	if (!m_grid->hasEdgeIndex() || !m_touched.insert(nodePair(a, b)).second) {
+		return;
+	}
+	//parallel edges are indexed as well
+	for(uint32_t source : {a, b}) {
+		uint32_t target = (source == a ? b : a);
+		for(uint32_t edgeId(m_g->node(source).begin), end(m_g->node(source).end); edgeId < end; ++edgeId) {
+			if (m_g->edge(edgeId).target == target) {
+				m_grid->removeEdgeRef(edgeId);
+			}
+		}
+		if (a == b) {
+			break;
+		}
+	}
+}
+
+void GraphUpdater::touchNode(uint32_t nodeId) {
+	std::vector< std::pair<uint32_t, uint32_t> > edges;
+	incidentEdges(nodeId, edges);
+	for(const std::pair<uint32_t, uint32_t> & e : edges) {
+		touch(e.first, e.second);
+	}
+}
+
+void GraphUpdater::index() {
+	//the same choice of two opposite edges as Grid::createEdgeIndex
+	for(uint64_t touched : m_touched) {
+		uint32_t a = touched >> 32;
+		uint32_t b = touched & 0xFFFFFFFF;
+		for(uint32_t source : {a, b}) {
+			uint32_t target = (source == a ? b : a);
+			bool hasOpposite = (findEdge(target, source) != Graph::invalid_edge);
+			for(uint32_t edgeId(m_g->node(source).begin), end(m_g->node(source).end); edgeId < end; ++edgeId) {
+				if (m_g->edge(edgeId).target == target && (source < target || !hasOpposite)) {
+					m_grid->addEdgeRef(edgeId);
+				}
+			}
+			if (a == b) {
+				break;
+			}
+		}
+	}
+	m_touched.clear();
+}
+
+void GraphUpdater::renameEdges() {
+	for(const std::pair<uint32_t, uint32_t> & moved : m_movedEdges) {
+		m_grid->renameEdgeRef(moved.first, moved.second);
+	}
+	m_movedEdges.clear();
+}
+
+void GraphUpdater::setEdge(uint32_t source, uint32_t target, const WayAttributes & wa, int access, Stats & stats) {
+	if (!access) {
+		removeEdge(source, target, stats);
+		return;
+	}
+	touch(source, target);
+	uint32_t edgeId = findEdge(source, target);
+	if (edgeId != Graph::invalid_edge) {
+		Graph::Edge & e = m_g->edges()[edgeId];
+		if (e.type != wa.type || e.speed != wa.speed || e.access != access) {
+			e.type = wa.type;
+			e.speed = wa.speed;
+			e.access = access;
+			stats.changedEdges += 1;
+		}
+		return;
+	}
+	Graph::Edge e;
+	e.source = source;
+	e.target = target;
+	e.distance = edgeDistance(source, target);
+	e.speed = wa.speed;
+	e.type = wa.type;
+	e.access = access;
+	m_g->addEdge(e, m_movedEdges);
+	renameEdges();
+	stats.addedEdges += 1;
+}
+
+void GraphUpdater::removeEdge(uint32_t source, uint32_t target, Stats & stats) {
+	touch(source, target);
+	uint32_t edgeId;
+	while ((edgeId = findEdge(source, target)) != Graph::invalid_edge) {
+		m_g->removeEdge(edgeId, m_movedEdges);
+		renameEdges();
+		stats.removedEdges += 1;
+	}
+}
+
+void GraphUpdater::incidentEdges(uint32_t nodeId, std::vector< std::pair<uint32_t, uint32_t> > & edges) const {
+	for(Graph::ConstEdgeIterator it(m_g->edgesBegin(nodeId)), end(m_g->edgesEnd(nodeId)); it != end; ++it) {
+		edges.emplace_back(nodeId, it->target);
+		if (!m_g->hasReverseEdges() && findEdge(it->target, nodeId) != Graph::invalid_edge) {
+			edges.emplace_back(it->target, nodeId);
+		}
+	}
+	if (m_g->hasReverseEdges()) {
+		for(Graph::ConstEdgeRefIterator it(m_g->reverseEdgesBegin(nodeId)), end(m_g->reverseEdgesEnd(nodeId)); it != end; ++it) {
+			edges.emplace_back(m_g->edge(*it).source, nodeId);
+		}
+	}
+}
+
+void GraphUpdater::moveNode(uint32_t nodeId, double lat, double lon, Stats & stats) {
+	bool removed = m_removedNodes.count(nodeId);
+	Graph::NodeInfo & ni = m_g->nodeInfos()[nodeId];
+	if (!removed && ni.lat == lat && ni.lon == lon) {
+		return;
+	}
+	touchNode(nodeId);
+	if (!removed) {
+		m_grid->removeNode(nodeId, ni.lat, ni.lon);
+	}
+	ni.lat = lat;
+	ni.lon = lon;
+	m_grid->addNode(nodeId);
+	m_removedNodes.erase(nodeId);
+
+	std::vector< std::pair<uint32_t, uint32_t> > edges;
+	incidentEdges(nodeId, edges);
+	for(const std::pair<uint32_t, uint32_t> & e : edges) {
+		for(uint32_t edgeId(m_g->node(e.first).begin), end(m_g->node(e.first).end); edgeId < end; ++edgeId) {
+			if (m_g->edge(edgeId).target == e.second) {
+				m_g->edges()[edgeId].distance = edgeDistance(e.first, e.second);
+			}
+		}
+	}
+	stats.movedNodes += 1;
+}
+
+void GraphUpdater::removeNode(uint32_t nodeId, Stats & stats) {
+	if (m_removedNodes.count(nodeId)) {
+		return;
+	}
+	std::vector< std::pair<uint32_t, uint32_t> > edges;
+	incidentEdges(nodeId, edges);
+	for(const std::pair<uint32_t, uint32_t> & e : edges) {
+		removeEdge(e.first, e.second, stats);
+	}
+	const Graph::NodeInfo & ni = m_g->nodeInfo(nodeId);
+	m_grid->removeNode(nodeId, ni.lat, ni.lon);
+	m_removedNodes.insert(nodeId);
+	stats.removedNodes += 1;
+}
+
+uint32_t GraphUpdater::resolveNode(int64_t ref, const OsmChange & oc, const std::unordered_map<int64_t, uint32_t> & changedNodes, bool create, Stats & stats) {
+	std::unordered_map<int64_t, uint32_t>::const_iterator it = m_nodeIds.find(ref);
+	if (it != m_nodeIds.end()) {
+		return (m_removedNodes.count(it->second) ? invalid_node : it->second);
+	}
+	if (!create || !canResolveNode(ref, oc, changedNodes)) {
+		return invalid_node;
+	}
+	const OsmChange::Node & n = oc.nodes[changedNodes.find(ref)->second];
+	Graph::NodeInfo ni;
+	ni.osmId = n.id;
+	ni.lat = n.lat;
+	ni.lon = n.lon;
+	uint32_t nodeId = m_g->addNode(ni);
+	m_grid->addNode(nodeId);
+	m_nodeIds[ref] = nodeId;
+	stats.addedNodes += 1;
+	return nodeId;
+}
+
+bool GraphUpdater::canResolveNode(int64_t ref, const OsmChange & oc, const std::unordered_map<int64_t, uint32_t> & changedNodes) const {
+	std::unordered_map<int64_t, uint32_t>::const_iterator it = m_nodeIds.find(ref);
+	if (it != m_nodeIds.end()) {
+		return !m_removedNodes.count(it->second);
+	}
+	std::unordered_map<int64_t, uint32_t>::const_iterator changed = changedNodes.find(ref);
+	return changed != changedNodes.end() && oc.nodes[changed->second].action != OsmChange::A_DELETE;
+}
+
+void GraphUpdater::applyWay(const OsmChange::Way & w, const OsmChange & oc, const std::unordered_map<int64_t, uint32_t> & changedNodes, Stats & stats) {
+	WayAttributes wa;
+	bool road = (w.action != OsmChange::A_DELETE && wayAttributes(w, wa));
+
+	//only nodes of a segment are added, a way may pass nodes of the change that are not part of any road
+	std::vector<bool> resolvable(w.refs.size(), false);
+	for(uint32_t i(0), s(w.refs.size()); road && i < s; ++i) {
+		resolvable[i] = canResolveNode(w.refs[i], oc, changedNodes);
+	}
+	std::vector<uint32_t> nodeIds;
+	nodeIds.reserve(w.refs.size());
+	for(uint32_t i(0), s(w.refs.size()); i < s; ++i) {
+		bool create = resolvable[i] && ((i > 0 && resolvable[i-1]) || (i+1 < s && resolvable[i+1]));
+		nodeIds.push_back(resolveNode(w.refs[i], oc, changedNodes, create, stats));
+	}
+	std::unordered_set<uint64_t> segments;
+	for(uint32_t i(1), s(nodeIds.size()); i < s; ++i) {
+		if (nodeIds[i-1] != invalid_node && nodeIds[i] != invalid_node) {
+			segments.insert(nodePair(nodeIds[i-1], nodeIds[i]));
+		}
+	}
+
+	//the segments of the old version that are not part of the new one
+	std::unordered_map<int64_t, std::vector<uint32_t> >::iterator old = m_wayNodes.find(w.id);
+	if (old != m_wayNodes.end()) {
+		const std::vector<uint32_t> & oldIds = old->second;
+		for(uint32_t i(1), s(oldIds.size()); i < s; ++i) {
+			if (oldIds[i-1] != invalid_node && oldIds[i] != invalid_node && (!road || !segments.count(nodePair(oldIds[i-1], oldIds[i])))) {
+				removeEdge(oldIds[i-1], oldIds[i], stats);
+				removeEdge(oldIds[i], oldIds[i-1], stats);
+			}
+		}
+	}
+	if (road && w.action != OsmChange::A_CREATE) {
+		//edges of the same type between nodes of the way that are not consecutive anymore, e.g. after a node was inserted between them.
+		//Other types are likely other roads between two nodes of the way, without a type there is no way to tell them apart
+		std::unordered_set<uint32_t> wayNodes(nodeIds.begin(), nodeIds.end());
+		std::vector< std::pair<uint32_t, uint32_t> > obsolete;
+		for(uint32_t nodeId : wayNodes) {
+			if (nodeId == invalid_node) {
+				continue;
+			}
+			for(Graph::ConstEdgeIterator it(m_g->edgesBegin(nodeId)), end(m_g->edgesEnd(nodeId)); it != end; ++it) {
+				if (wayNodes.count(it->target) && it->type == wa.type && !segments.count(nodePair(nodeId, it->target))) {
+					obsolete.emplace_back(nodeId, it->target);
+				}
+			}
+		}
+		for(const std::pair<uint32_t, uint32_t> & e : obsolete) {
+			removeEdge(e.first, e.second, stats);
+		}
+	}
+
+	if (!road) {
+		m_wayNodes.erase(w.id);
+		if (w.action != OsmChange::A_DELETE) {
+			stats.skippedWays += 1;
+		}
+		return;
+	}
+	for(uint32_t i(1), s(nodeIds.size()); i < s; ++i) {
+		uint32_t a = nodeIds[i-1];
+		uint32_t b = nodeIds[i];
+		if (a == invalid_node || b == invalid_node || a == b) {
+			continue;
+		}
+		setEdge(a, b, wa, wa.forwardAccess, stats);
+		setEdge(b, a, wa, wa.backwardAccess, stats);
+	}
+	if (segments.empty()) {
+		stats.skippedWays += 1;
+	}
+	m_wayNodes[w.id] = std::move(nodeIds);
+}
+
+uint32_t GraphUpdater::edgeDistance(uint32_t source, uint32_t target) const {
+	const Graph::NodeInfo & s = m_g->nodeInfo(source);
+	const Graph::NodeInfo & t = m_g->nodeInfo(target);
+	return ::lround(std::fabs( distanceTo(s.lat, s.lon, t.lat, t.lon) )*m_distanceScale);
+}
+
+}//end namespace simpleroute
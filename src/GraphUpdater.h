@@ -0,0 +1,119 @@
+#ifndef SIMPLE_ROUTE_GRAPH_UPDATER_H
+#define SIMPLE_ROUTE_GRAPH_UPDATER_H
+#include "Graph.h"
+#include "Grid.h"
+#include "OsmChange.h"
+#include <unordered_map>
+#include <unordered_set>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <stdint.h>
+
+namespace simpleroute {
+
+///Applies OpenStreetMap change files to a loaded graph and its grid without rebuilding them.
+///The work of apply() is proportional to the size of the change, node ids do not change and new nodes are appended.
+///New edges are appended behind the edges of their source, which may move them and leave unused slots, see Graph::addEdge.
+///compact() removes the unused slots once they exceed 1/compaction_divisor of the edges.
+///
+///The graph has no way ids, hence the edges of a way are found by their nodes:
+///an edge belongs to a modified or deleted way if both of its nodes are consecutive in the old version of the way.
+///Old versions are only known for ways added or modified by this updater, edges of the same type between two nodes
+///of a modified road that are no longer consecutive are removed as well. A deleted way or a way that is no road anymore only removes
+///the segments of its known old version, if its version is unknown it keeps its edges unless its nodes are deleted.
+///Edge types, default speeds and access types are taken from the edges of the graph for the same highway value.
+///Ways that refer to nodes which are neither in the graph nor in the same change skip the segments of these nodes.
+///Incoming edges of moved or deleted nodes are found by the reverse edges, without them only those with an opposite edge are found.
+///
+///Data derived from the edges (Metric, CHInfo, LandmarkInfo) has to be recreated after apply(),
+///the edge index of the grid is kept up to date, the grid and the node vectors are updated in place.
+///The graph and the grid must not be used by other threads during apply() and compact()
+class GraphUpdater {
+public:
+	static constexpr uint32_t compaction_divisor = 32;
+	struct Stats {
+		uint32_t addedNodes;
+		uint32_t movedNodes;
+		uint32_t removedNodes;
+		uint32_t addedEdges;
+		uint32_t changedEdges;
+		uint32_t removedEdges;
+		///ways whose segments could not be resolved or that are no roads
+		uint32_t skippedWays;
+		Stats() : addedNodes(0), movedNodes(0), removedNodes(0), addedEdges(0), changedEdges(0), removedEdges(0), skippedWays(0) {}
+		void print(std::ostream & out) const;
+	};
+public:
+	///Creates the osm id lookup of the nodes and the defaults of the edge types, which is linear in the size of the graph.
+	///grid has to be the grid of g, edges get the access types in accessTypes only
+	GraphUpdater(Graph * g, Grid * grid, int accessTypes);
+	~GraphUpdater();
+	///applies a change, compacts if necessary
+	Stats apply(const OsmChange & oc);
+	///reads the change file and applies it, throws std::runtime_error if it can not be read
+	Stats apply(const std::string & path);
+	///removes the unused edge slots of the graph and the gaps in the grid, recreates the edge index if it exists
+	void compact();
+	inline bool needsCompaction() const { return m_g->unusedEdgeCount() > m_g->edgeCount()/compaction_divisor; }
+private:
+	///attributes of the edges of a way for both directions
+	struct WayAttributes {
+		int type;
+		uint32_t speed;
+		int forwardAccess;
+		int backwardAccess;
+	};
+	typedef std::vector< std::pair<uint32_t, uint32_t> > MovedEdges;
+	static constexpr uint32_t invalid_node = 0xFFFFFFFF;
+private:
+	///returns false if the way is no road for accessTypes
+	bool wayAttributes(const OsmChange::Way & w, WayAttributes & wa) const;
+	///id of the edge from source to target, Graph::invalid_edge if there is none
+	uint32_t findEdge(uint32_t source, uint32_t target) const;
+	///Takes the edges between a and b out of the edge index until index() adds them again at the end of apply().
+	///Has to be called before any of them or the coordinates of a or b change
+	void touch(uint32_t a, uint32_t b);
+	void touchNode(uint32_t nodeId);
+	///adds the edges between the touched nodes to the edge index
+	void index();
+	///adds, changes or removes (access AT_NONE) the edge from source to target
+	void setEdge(uint32_t source, uint32_t target, const WayAttributes & wa, int access, Stats & stats);
+	void removeEdge(uint32_t source, uint32_t target, Stats & stats);
+	///the edges in m_movedEdges changed their ids, adjusts the edge index
+	void renameEdges();
+	void moveNode(uint32_t nodeId, double lat, double lon, Stats & stats);
+	void removeNode(uint32_t nodeId, Stats & stats);
+	///nodes of the edges from and to nodeId as (source, target)
+	void incidentEdges(uint32_t nodeId, std::vector< std::pair<uint32_t, uint32_t> > & edges) const;
+	///true if ref is in the graph or changedNodes has its coordinates
+	bool canResolveNode(int64_t ref, const OsmChange & oc, const std::unordered_map<int64_t, uint32_t> & changedNodes) const;
+	///Graph id of the osm node ref, invalid_node if it is unknown.
+	///A node that is not in the graph yet is added if create is set and changedNodes has its coordinates
+	uint32_t resolveNode(int64_t ref, const OsmChange & oc, const std::unordered_map<int64_t, uint32_t> & changedNodes, bool create, Stats & stats);
+	void applyWay(const OsmChange::Way & w, const OsmChange & oc, const std::unordered_map<int64_t, uint32_t> & changedNodes, Stats & stats);
+	///Edge::distance in the unit of the graph
+	uint32_t edgeDistance(uint32_t source, uint32_t target) const;
+private:
+	Graph * m_g;
+	Grid * m_grid;
+	int m_accessTypes;
+	std::unordered_map<int64_t, uint32_t> m_nodeIds;
+	///nodes deleted by a change, they keep their ids but are neither in the grid nor have edges
+	std::unordered_set<uint32_t> m_removedNodes;
+	///node ids of the ways added or modified by this updater
+	std::unordered_map<int64_t, std::vector<uint32_t> > m_wayNodes;
+	std::unordered_map<std::string, int> m_highwayTypes;
+	///most frequent speed and access types of the edges of every type
+	std::vector<uint32_t> m_typeSpeeds;
+	std::vector<int> m_typeAccess;
+	///Edge::distance per meter
+	double m_distanceScale;
+	///pairs of nodes whose edges are not in the edge index during apply()
+	std::unordered_set<uint64_t> m_touched;
+	MovedEdges m_movedEdges;
+};
+
+}//end namespace simpleroute
+
+#endif
@@ -5,8 +5,13 @@
 #include <assert.h>
 #include <iostream>
 #include <cmath>
+#include <limits>
 
 #include "Graph.h"
+#include "ParallelFor.h"
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#endif
 #define GRID_PADDING 0.001
 
 namespace simpleroute {
@@ -20,6 +25,11 @@ m_latCount(other.m_latCount),
 m_lonCount(other.m_lonCount),
 m_bins(other.m_bins),
 m_nodeRefs(other.m_nodeRefs),
+m_binLimits(other.m_binLimits),
+m_edgeBins(other.m_edgeBins),
+m_edgeRefs(other.m_edgeRefs),
+m_edgeBinLimits(other.m_edgeBinLimits),
+m_nodeVectors(other.m_nodeVectors),
 m_g(other.m_g)
 {}
 
@@ -32,6 +42,11 @@ m_latCount(other.m_latCount),
 m_lonCount(other.m_lonCount),
 m_bins( std::move(other.m_bins) ),
 m_nodeRefs( std::move(other.m_nodeRefs) ),
+m_binLimits( std::move(other.m_binLimits) ),
+m_edgeBins( std::move(other.m_edgeBins) ),
+m_edgeRefs( std::move(other.m_edgeRefs) ),
+m_edgeBinLimits( std::move(other.m_edgeBinLimits) ),
+m_nodeVectors( std::move(other.m_nodeVectors) ),
 m_g(other.m_g)
 {}
 
@@ -54,6 +69,11 @@ Grid& Grid::operator=(Grid&& other) {
 	m_lonCount = other.m_lonCount;
 	m_bins = std::move(other.m_bins);
 	m_nodeRefs = std::move(other.m_nodeRefs);
+	m_binLimits = std::move(other.m_binLimits);
+	m_edgeBins = std::move(other.m_edgeBins);
+	m_edgeRefs = std::move(other.m_edgeRefs);
+	m_edgeBinLimits = std::move(other.m_edgeBinLimits);
+	m_nodeVectors = std::move(other.m_nodeVectors);
 	m_g = other.m_g;
 	return *this;
 }
@@ -67,6 +87,11 @@ Grid& Grid::operator=(const Grid& other) {
 	m_lonCount = other.m_lonCount;
 	m_bins = other.m_bins;
 	m_nodeRefs = other.m_nodeRefs;
+	m_binLimits = other.m_binLimits;
+	m_edgeBins = other.m_edgeBins;
+	m_edgeRefs = other.m_edgeRefs;
+	m_edgeBinLimits = other.m_edgeBinLimits;
+	m_nodeVectors = other.m_nodeVectors;
 	m_g = other.m_g;
 	return *this;
 }
@@ -90,8 +115,8 @@ m_latCount(latCount),
 m_lonCount(lonCount),
 m_g(g)
 {
-	if (! (m_latCount*m_lonCount)) {
-		throw std::runtime_error("Can not create a grid with 0 grid cells");
+	if (!m_latCount || !m_lonCount) {
+		autoDimensions(m_g, auto_target_occupancy, m_latCount, m_lonCount);
 	}
 
 	m_g->bbox(m_minLat, m_maxLat, m_minLon, m_maxLon);
@@ -135,14 +160,49 @@ m_g(g)
 	}
 }
 
-struct BinInfo {
-	uint32_t latBin;
-	uint32_t lonBin;
-	double distance;
-	BinInfo(uint32_t latBin, uint32_t lonBin, double distance) :
-	latBin(latBin), lonBin(lonBin), distance(distance)
-	{}
-};
+void Grid::autoDimensions(const Graph * g, uint32_t targetOccupancy, uint32_t & latCount, uint32_t & lonCount) {
+	latCount = lonCount = 1;
+	uint32_t nodeCount = g->nodeCount();
+	targetOccupancy = std::max<uint32_t>(targetOccupancy, 1);
+	if (nodeCount <= targetOccupancy) {
+		return;
+	}
+	double minLat, maxLat, minLon, maxLon;
+	g->bbox(minLat, maxLat, minLon, maxLon);
+	minLat -= GRID_PADDING;
+	minLon -= GRID_PADDING;
+	maxLat += GRID_PADDING;
+	maxLon += GRID_PADDING;
+	//the width of a degree of lon shrinks towards the poles
+	double height = maxLat-minLat;
+	double width = std::max((maxLon-minLon)*::cos((minLat+maxLat)/2.0*(M_PI/180.0)), GRID_PADDING);
+	
+	double maxBins = nodeCount;
+	double binCount = double(nodeCount)/targetOccupancy;
+	std::vector<uint32_t> binSizes;
+	//every round measures the occupancy with the current dimensions and scales the number of bins accordingly.
+	//The occupancy is averaged over the nodes since a query near a node scans the bin of that node
+	for(uint32_t round(0); round < 8; ++round) {
+		latCount = std::max(1.0, std::min(::round(::sqrt(binCount*height/width)), binCount));
+		lonCount = std::max(1.0, ::round(binCount/latCount));
+		binSizes.assign(uint64_t(latCount)*lonCount, 0);
+		for(uint32_t i(0); i < nodeCount; ++i) {
+			const Graph::NodeInfo & ni = g->nodeInfo(i);
+			uint32_t latBin = ((ni.lat-minLat)*latCount)/(maxLat-minLat);
+			uint32_t lonBin = ((ni.lon-minLon)*lonCount)/(maxLon-minLon);
+			++binSizes[uint64_t(latBin)*lonCount+lonBin];
+		}
+		double occupancy = 0.0;
+		for(uint32_t binSize : binSizes) {
+			occupancy += double(binSize)*binSize;
+		}
+		occupancy /= nodeCount;
+		if (occupancy < 1.5*targetOccupancy || binCount >= maxBins) {
+			break;
+		}
+		binCount = std::min(maxBins, binCount*occupancy/targetOccupancy);
+	}
+}
 
 struct SearchBorder {
 	int32_t latCount;
@@ -166,7 +226,7 @@ struct SearchBorder {
 		return !(latCenter + radius >= latCount && latCenter - radius < 0 && lonCenter + radius >= lonCount && lonCenter - radius < 0);
 	}
 	
-	//circle around the border
+	//circle around the border, every bin with a chebyshev distance of radius to the center is visited exactly once
 	//TP(uint32_t latBin, uint32_t lonBin)
 	template<typename TP>
 	void visit(TP p) const {
@@ -174,36 +234,33 @@ struct SearchBorder {
 			p(latCenter, lonCenter);
 			return;
 		}
-		if (lonCenter - radius >= 0) { //the bottom lons
+		//the left and right columns including the corners
+		int32_t latBinBegin = std::max<int32_t>(0, latCenter-radius);
+		int32_t latBinEnd = std::min<int32_t>(latCenter+radius+1, latCount);
+		if (lonCenter - radius >= 0) {
 			int32_t lonBin = lonCenter - radius;
-			int32_t latBin = std::max<int32_t>(0, latCenter-radius);
-			int32_t latBinEnd = std::min<int32_t>(latCenter+radius, latCount);
-			for(; latBin < latBinEnd; ++latBin) {
+			for(int32_t latBin(latBinBegin); latBin < latBinEnd; ++latBin) {
 				p(latBin, lonBin);
 			}
 		}
-		//the top lons
 		if (lonCenter + radius < lonCount) {
 			int32_t lonBin = lonCenter + radius;
-			int32_t latBin = std::max<int32_t>(0, latCenter-radius);
-			int32_t latBinEnd = std::min<int32_t>(latCenter+radius, latCount);
-			for(; latBin < latBinEnd; ++latBin) {
+			for(int32_t latBin(latBinBegin); latBin < latBinEnd; ++latBin) {
 				p(latBin, lonBin);
 			}
 		}
+		//the bottom and top rows without the corners
+		int32_t lonBinBegin = std::max<int32_t>(0, lonCenter-radius+1);
+		int32_t lonBinEnd = std::min<int32_t>(lonCenter+radius, lonCount);
 		if (latCenter - radius >= 0) {
 			int32_t latBin = latCenter - radius;
-			int32_t lonBin = std::max<int32_t>(0, lonCenter-radius-1);
-			int32_t lonBinEnd = std::min<int32_t>(lonCenter+radius-1, latCount);
-			for(; lonBin < lonBinEnd; ++lonBin) {
+			for(int32_t lonBin(lonBinBegin); lonBin < lonBinEnd; ++lonBin) {
 				p(latBin, lonBin);
 			}
 		}
 		if (latCenter + radius < latCount) {
 			int32_t latBin = latCenter + radius;
-			int32_t lonBin = std::max<int32_t>(0, lonCenter-radius-1);
-			int32_t lonBinEnd = std::min<int32_t>(lonCenter+radius-1, latCount);
-			for(; lonBin < lonBinEnd; ++lonBin) {
+			for(int32_t lonBin(lonBinBegin); lonBin < lonBinEnd; ++lonBin) {
 				p(latBin, lonBin);
 			}
 		}
@@ -279,82 +336,576 @@ double Grid::binDistance(uint32_t latBin, uint32_t lonBin, double lat, double lo
 	}
 }
 
+void Grid::clippedBin(double lat, double lon, uint32_t & latBin, uint32_t & lonBin) const {
+	//clip coordinates to find the first bin, will cost more than doing it correctly, but should work
+	if (lat < m_minLat) {
+		lat = m_minLat+GRID_PADDING;
+	}
+	else if (lat >= m_maxLat) {
+		lat = m_maxLat-GRID_PADDING;
+	}
+	if (lon < m_minLon) {
+		lon = m_minLon+GRID_PADDING;
+	}
+	else if (lon >= m_maxLon) {
+		lon = m_maxLon-GRID_PADDING;
+	}
+	bin(lat, lon, latBin, lonBin);
+}
+
+//The query point lies in the center bin, hence every bin of a ring is further away than some bin of the previous ring.
+//Once no bin of a ring is within the bound, no bin of an outer ring can be.
+//This also holds if binDistance() only returns a lower bound of the distance
+template<typename TBinDistance, typename TBound, typename TScan>
+void Grid::ringSearch(double lat, double lon, const std::vector<Bin> & bins, TBinDistance binDistance, TBound bound, TScan scan) const {
+	uint32_t latBin, lonBin;
+	clippedBin(lat, lon, latBin, lonBin);
+	for(SearchBorder sb(m_latCount, m_lonCount, latBin, lonBin); sb.valid(); sb.grow()) {
+		bool binWithinBound = false;
+		sb.visit([&](uint32_t latBin, uint32_t lonBin) {
+			if (binDistance(latBin, lonBin) > bound()) {
+				return;
+			}
+			binWithinBound = true;
+			const Bin & b = bins[this->bin(latBin, lonBin)];
+			if (b.size()) {
+				scan(b);
+			}
+		});
+		if (!binWithinBound) {
+			break;
+		}
+	}
+}
+
+template<typename TBound, typename TScan>
+void Grid::ringSearch(double lat, double lon, const std::vector<Bin> & bins, TBound bound, TScan scan) const {
+	ringSearch(lat, lon, bins, [this, lat, lon](uint32_t latBin, uint32_t lonBin) {
+		return this->binDistance(latBin, lonBin, lat, lon);
+	}, bound, scan);
+}
+
 uint32_t Grid::closest(double lat, double lon) const {
+	uint32_t bestMatch = std::numeric_limits<uint32_t>::max();
+	double bestMatchDistance = std::numeric_limits<double>::max();
 	if (!m_nodeRefs.size()) {
-		return std::numeric_limits<uint32_t>::max();
+		return bestMatch;
 	}
+	ringSearch(lat, lon, m_bins, [&bestMatchDistance]() { return bestMatchDistance; }, [&](const Bin & b) {
+		for(uint32_t i(b.begin); i < b.end; ++i) {
+			uint32_t nr = m_nodeRefs[i];
+			const Graph::NodeInfo & ni = m_g->nodeInfo(nr);
+			double nDist = std::fabs( distanceTo(lat, lon, ni.lat, ni.lon) );
+			if (nDist < bestMatchDistance) {
+				bestMatchDistance = nDist;
+				bestMatch = nr;
+			}
+		}
+	});
+	assert(bestMatch != std::numeric_limits<uint32_t>::max());
+	return bestMatch;
+}
 
-	uint32_t latBin, lonBin;
-	{
-		//clip coordinates to find the first bin, will cost more than doing it correctly, but should work
-		double myLat(lat), myLon(lon);
-		if (myLat < m_minLat) {
-			myLat = m_minLat+GRID_PADDING;
+void Grid::kNearest(double lat, double lon, uint32_t k, std::vector<NodeDistance> & result) const {
+	result.clear();
+	if (!k || !m_nodeRefs.size()) {
+		return;
+	}
+	//max-heap of the k closest nodes found so far, the front is the furthest one
+	auto closer = [](const NodeDistance & a, const NodeDistance & b) { return a.distance < b.distance; };
+	auto bound = [&result, k]() {
+		return (result.size() < k ? std::numeric_limits<double>::max() : result.front().distance);
+	};
+	ringSearch(lat, lon, m_bins, bound, [&](const Bin & b) {
+		for(uint32_t i(b.begin); i < b.end; ++i) {
+			uint32_t nr = m_nodeRefs[i];
+			const Graph::NodeInfo & ni = m_g->nodeInfo(nr);
+			double nDist = std::fabs( distanceTo(lat, lon, ni.lat, ni.lon) );
+			if (result.size() < k) {
+				result.emplace_back(nr, nDist);
+				std::push_heap(result.begin(), result.end(), closer);
+			}
+			else if (nDist < result.front().distance) {
+				std::pop_heap(result.begin(), result.end(), closer);
+				result.back() = NodeDistance(nr, nDist);
+				std::push_heap(result.begin(), result.end(), closer);
+			}
+		}
+	});
+	std::sort_heap(result.begin(), result.end(), closer);
+}
+
+void Grid::withinRadius(double lat, double lon, double radius, std::vector<NodeDistance> & result) const {
+	result.clear();
+	if (!m_nodeRefs.size()) {
+		return;
+	}
+	ringSearch(lat, lon, m_bins, [radius]() { return radius; }, [&](const Bin & b) {
+		for(uint32_t i(b.begin); i < b.end; ++i) {
+			uint32_t nr = m_nodeRefs[i];
+			const Graph::NodeInfo & ni = m_g->nodeInfo(nr);
+			double nDist = std::fabs( distanceTo(lat, lon, ni.lat, ni.lon) );
+			if (nDist <= radius) {
+				result.emplace_back(nr, nDist);
+			}
+		}
+	});
+	std::sort(result.begin(), result.end(), [](const NodeDistance & a, const NodeDistance & b) {
+		return a.distance < b.distance;
+	});
+}
+
+namespace {
+
+inline void unitVector(double lat, double lon, double & x, double & y, double & z) {
+	double phi = lat*(M_PI/180.0);
+	double lambda = lon*(M_PI/180.0);
+	x = ::cos(phi)*::cos(lambda);
+	y = ::cos(phi)*::sin(lambda);
+	z = ::sin(phi);
+}
+
+///great-circle distance in meters of a squared chord length between unit vectors, same radius as distanceTo
+inline double chordDistance(double chord2) {
+	return 2.0*6371000.0*::asin( std::min(1.0, ::sqrt(chord2)/2.0) );
+}
+
+///Finds the smallest squared chord length between q and the vectors in [begin, end) that is smaller than best.
+///Updates best and bestPos and returns true if there is one, ties are resolved in favour of the smaller position
+bool minChord2Scalar(const double * x, const double * y, const double * z, uint32_t begin, uint32_t end, double qx, double qy, double qz, double & best, uint32_t & bestPos) {
+	bool found = false;
+	for(uint32_t i(begin); i < end; ++i) {
+		double dx = x[i]-qx;
+		double dy = y[i]-qy;
+		double dz = z[i]-qz;
+		double d = dx*dx + dy*dy + dz*dz;
+		if (d < best) {
+			best = d;
+			bestPos = i;
+			found = true;
+		}
+	}
+	return found;
+}
+
+#if defined(__GNUC__) && defined(__x86_64__)
+//compiled for AVX2 independent of the build flags, only called if the cpu supports it
+__attribute__((target("avx2,fma")))
+bool minChord2Avx2(const double * x, const double * y, const double * z, uint32_t begin, uint32_t end, double qx, double qy, double qz, double & best, uint32_t & bestPos) {
+	if (end - begin < 8) {
+		return minChord2Scalar(x, y, z, begin, end, qx, qy, qz, best, bestPos);
+	}
+	const __m256d vqx = _mm256_set1_pd(qx);
+	const __m256d vqy = _mm256_set1_pd(qy);
+	const __m256d vqz = _mm256_set1_pd(qz);
+	const __m256d four = _mm256_set1_pd(4.0);
+	__m256d vbest = _mm256_set1_pd(best);
+	//positions are stored as doubles, they are exact up to 2^53
+	__m256d vbestPos = _mm256_set1_pd(-1.0);
+	__m256d vpos = _mm256_setr_pd(begin, begin+1, begin+2, begin+3);
+	uint32_t i(begin);
+	for(; i+4 <= end; i += 4) {
+		__m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x+i), vqx);
+		__m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y+i), vqy);
+		__m256d dz = _mm256_sub_pd(_mm256_loadu_pd(z+i), vqz);
+		__m256d d = _mm256_fmadd_pd(dz, dz, _mm256_fmadd_pd(dy, dy, _mm256_mul_pd(dx, dx)));
+		__m256d smaller = _mm256_cmp_pd(d, vbest, _CMP_LT_OQ);
+		vbest = _mm256_blendv_pd(vbest, d, smaller);
+		vbestPos = _mm256_blendv_pd(vbestPos, vpos, smaller);
+		vpos = _mm256_add_pd(vpos, four);
+	}
+	double lanes[4];
+	double lanePos[4];
+	_mm256_storeu_pd(lanes, vbest);
+	_mm256_storeu_pd(lanePos, vbestPos);
+	bool found = false;
+	for(uint32_t lane(0); lane < 4; ++lane) {
+		if (lanePos[lane] < 0.0) {
+			continue;
 		}
-		else if (myLat >= m_maxLat) {
-			myLat = m_maxLat-GRID_PADDING;
+		if (lanes[lane] < best || (found && lanes[lane] == best && uint32_t(lanePos[lane]) < bestPos)) {
+			best = lanes[lane];
+			bestPos = lanePos[lane];
+			found = true;
 		}
-		if (myLon < m_minLon) {
-			myLon = m_minLon+GRID_PADDING;
+	}
+	return minChord2Scalar(x, y, z, i, end, qx, qy, qz, best, bestPos) || found;
+}
+
+bool minChord2(const double * x, const double * y, const double * z, uint32_t begin, uint32_t end, double qx, double qy, double qz, double & best, uint32_t & bestPos) {
+	static const bool hasAvx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+	if (hasAvx2) {
+		return minChord2Avx2(x, y, z, begin, end, qx, qy, qz, best, bestPos);
+	}
+	return minChord2Scalar(x, y, z, begin, end, qx, qy, qz, best, bestPos);
+}
+#else
+bool minChord2(const double * x, const double * y, const double * z, uint32_t begin, uint32_t end, double qx, double qy, double qz, double & best, uint32_t & bestPos) {
+	return minChord2Scalar(x, y, z, begin, end, qx, qy, qz, best, bestPos);
+}
+#endif
+
+}//end namespace
+
+void Grid::computeNodeVectors(NodeVectors & nv) const {
+	nv.x.resize(m_nodeRefs.size());
+	nv.y.resize(m_nodeRefs.size());
+	nv.z.resize(m_nodeRefs.size());
+	parallelFor(0, m_nodeRefs.size(), [this, &nv](uint32_t i, uint32_t) {
+		const Graph::NodeInfo & ni = m_g->nodeInfo(m_nodeRefs[i]);
+		unitVector(ni.lat, ni.lon, nv.x[i], nv.y[i], nv.z[i]);
+	}, 0, 4096);
+}
+
+void Grid::createNodeVectors() {
+	computeNodeVectors(m_nodeVectors);
+}
+
+//The squared chord length between unit vectors grows with the great-circle distance,
+//hence the closest node is the same as with distanceTo but the kernel only needs additions and multiplications
+uint32_t Grid::closestVector(double lat, double lon, const NodeVectors & nv) const {
+	double qx, qy, qz;
+	unitVector(lat, lon, qx, qy, qz);
+	double bestChord2 = std::numeric_limits<double>::max();
+	double bestDistance = std::numeric_limits<double>::max();
+	uint32_t bestPos = std::numeric_limits<uint32_t>::max();
+	double cosLat = ::cos(lat*(M_PI/180.0));
+	//lower bound of the haversine formula from the gaps in lat and lon between the point and the bin,
+	//cos(lat) of the bin is bounded by the bin corner closer to a pole. Costs a fraction of binDistance()
+	auto binBound = [&](uint32_t latBin, uint32_t lonBin) -> double {
+		double minLat, maxLat, minLon, maxLon;
+		binCorners(latBin, lonBin, minLat, maxLat, minLon, maxLon);
+		double latGap = std::max(0.0, std::max(minLat-lat, lat-maxLat))*(M_PI/180.0);
+		double lonGap = std::min(180.0, std::max(0.0, std::max(minLon-lon, lon-maxLon)))*(M_PI/180.0);
+		if (lonGap == 0.0) {
+			return 6371000.0*latGap;
 		}
-		else if (myLon >= m_maxLon) {
-			myLon = m_maxLon-GRID_PADDING;
+		double sinLatGap = ::sin(latGap/2.0);
+		double sinLonGap = ::sin(lonGap/2.0);
+		double cosBinLat = ::cos(std::max(std::fabs(minLat), std::fabs(maxLat))*(M_PI/180.0));
+		double a = sinLatGap*sinLatGap + cosLat*cosBinLat*sinLonGap*sinLonGap;
+		return 2.0*6371000.0*::asin( std::min(1.0, ::sqrt(a)) );
+	};
+	ringSearch(lat, lon, m_bins, binBound, [&bestDistance]() { return bestDistance; }, [&](const Bin & b) {
+		if (minChord2(nv.x.data(), nv.y.data(), nv.z.data(), b.begin, b.end, qx, qy, qz, bestChord2, bestPos)) {
+			bestDistance = chordDistance(bestChord2);
 		}
-		bin(myLat, myLon, latBin, lonBin);
+	});
+	return bestPos;
+}
+
+void Grid::closest(const std::vector<double> & lat, const std::vector<double> & lon, std::vector<uint32_t> & result, uint32_t threadCount) const {
+	uint32_t count = std::min(lat.size(), lon.size());
+	result.assign(count, std::numeric_limits<uint32_t>::max());
+	if (!count || !m_nodeRefs.size()) {
+		return;
+	}
+	NodeVectors tmp;
+	const NodeVectors * nv = &m_nodeVectors;
+	if (!hasNodeVectors()) {
+		computeNodeVectors(tmp);
+		nv = &tmp;
 	}
 	
-	SearchBorder sb(m_latCount, m_lonCount, latBin, lonBin);
+	//queries of the same bin scan the same nodes, processing them one after another keeps these in the cache
+	std::vector< std::pair<uint32_t, uint32_t> > order(count);
+	parallelFor(0, count, [&](uint32_t i, uint32_t) {
+		uint32_t latBin, lonBin;
+		clippedBin(lat[i], lon[i], latBin, lonBin);
+		order[i] = std::make_pair(bin(latBin, lonBin), i);
+	}, threadCount, 4096);
+	parallelSort(order.begin(), order.end(), [](const std::pair<uint32_t, uint32_t> & a, const std::pair<uint32_t, uint32_t> & b) {
+		return a < b;
+	}, threadCount);
 	
-	uint32_t bestMatch = std::numeric_limits<uint32_t>::max();
-	double bestMatchDistance = std::numeric_limits<double>::max();
+	parallelFor(0, count, [&](uint32_t i, uint32_t) {
+		uint32_t queryId = order[i].second;
+		result[queryId] = m_nodeRefs[closestVector(lat[queryId], lon[queryId], *nv)];
+	}, threadCount, 256);
+}
+
+void Grid::edgeBinRange(uint32_t edgeId, uint32_t & latBegin, uint32_t & latEnd, uint32_t & lonBegin, uint32_t & lonEnd) const {
+	const Graph::Edge & e = m_g->edge(edgeId);
+	const Graph::NodeInfo & s = m_g->nodeInfo(e.source);
+	const Graph::NodeInfo & t = m_g->nodeInfo(e.target);
+	clippedBin(std::min(s.lat, t.lat), std::min(s.lon, t.lon), latBegin, lonBegin);
+	clippedBin(std::max(s.lat, t.lat), std::max(s.lon, t.lon), latEnd, lonEnd);
+	++latEnd;
+	++lonEnd;
+}
+
+void Grid::createEdgeIndex() {
+	const Graph & g = *m_g;
+	//of two opposite edges only the one with the smaller source is stored, a phantom node covers both directions.
+	//Unused slots left by Graph::addEdge() and Graph::removeEdge() belong to no node
+	bool hasUnused = g.unusedEdgeCount();
+	auto indexed = [&g, hasUnused](uint32_t edgeId) {
+		const Graph::Edge & e = g.edge(edgeId);
+		if (hasUnused && e.source == e.target && e.access == Graph::Edge::AT_NONE) {
+			return false;
+		}
+		return e.source < e.target || g.reverseEdge(edgeId) == Graph::invalid_edge;
+	};
 	
-	std::vector<BinInfo> wq;
-	wq.push_back(BinInfo(latBin, lonBin, binDistance(latBin, lonBin, lat, lon)));
-	while(sb.valid()) { //there always is at least one node closest
-		while(wq.size()) {
-			BinInfo bi = wq.back();
-			if (bi.distance >= bestMatchDistance) { //all other bins are even further away, so we found our node
-				assert(bestMatch != std::numeric_limits<uint32_t>::max());
-				return bestMatch;
+	//same two passes as in the constructor
+	m_edgeBins.assign(m_bins.size(), Bin(0, 0));
+	std::vector<uint32_t>().swap(m_edgeBinLimits);
+	uint32_t latBegin, latEnd, lonBegin, lonEnd;
+	for(uint32_t edgeId(0), s(g.edgeCount()); edgeId < s; ++edgeId) {
+		if (!indexed(edgeId)) {
+			continue;
+		}
+		edgeBinRange(edgeId, latBegin, latEnd, lonBegin, lonEnd);
+		for(uint32_t latBin(latBegin); latBin < latEnd; ++latBin) {
+			for(uint32_t lonBin(lonBegin); lonBin < lonEnd; ++lonBin) {
+				m_edgeBins[bin(latBin, lonBin)].end += 1;
 			}
-			const Bin & b = m_bins.at(bin(bi.latBin, bi.lonBin));
-			wq.pop_back();
-			for(uint32_t i(b.begin); i < b.end; ++i) {
-				uint32_t nr = m_nodeRefs.at(i);
-				const Graph::NodeInfo & ni = m_g->nodeInfo(nr);
-				double nDist = std::fabs( distanceTo(lat, lon, ni.lat, ni.lon) );
-				if (nDist < bestMatchDistance) {
-					bestMatchDistance = nDist;
-					bestMatch = nr;
-				}
+		}
+	}
+	uint32_t curOff = 0;
+	for(Bin & b : m_edgeBins) {
+		b.begin = curOff;
+		curOff += b.end;
+		b.end = b.begin;
+	}
+	m_edgeRefs.resize(curOff);
+	for(uint32_t edgeId(0), s(g.edgeCount()); edgeId < s; ++edgeId) {
+		if (!indexed(edgeId)) {
+			continue;
+		}
+		edgeBinRange(edgeId, latBegin, latEnd, lonBegin, lonEnd);
+		for(uint32_t latBin(latBegin); latBin < latEnd; ++latBin) {
+			for(uint32_t lonBin(lonBegin); lonBin < lonEnd; ++lonBin) {
+				Bin & b = m_edgeBins[bin(latBin, lonBin)];
+				m_edgeRefs[b.end] = edgeId;
+				b.end += 1;
 			}
 		}
-		sb.grow();
-		
-		//check sourroundig for alternatives
-		sb.visit([&wq, &bestMatch, &bestMatchDistance, lat, lon, this](uint32_t latBin, uint32_t lonBin) {
-			double binDist = this->binDistance(latBin, lonBin, lat, lon);
-			if (binDist < bestMatchDistance && this->m_bins.at(this->bin(latBin, lonBin)).size()) {
-				wq.push_back(BinInfo(latBin, lonBin, binDist));
+	}
+}
+
+bool Grid::closestEdge(double lat, double lon, uint32_t accessTypeMask, EdgeMatch & match) const {
+	match = EdgeMatch();
+	match.distance = std::numeric_limits<double>::max();
+	if (!hasEdgeIndex()) {
+		return false;
+	}
+	//an edge is in every bin its bounding box intersects, this includes the bin of its closest point.
+	//Hence the search does not stop before that bin is scanned
+	ringSearch(lat, lon, m_edgeBins, [&match]() { return match.distance; }, [&](const Bin & b) {
+		for(uint32_t i(b.begin); i < b.end; ++i) {
+			uint32_t edgeId = m_edgeRefs[i];
+			const Graph::Edge & e = m_g->edge(edgeId);
+			uint32_t reverseEdgeId = Graph::invalid_edge;
+			if (!(e.access & accessTypeMask) && ((reverseEdgeId = m_g->reverseEdge(edgeId)) == Graph::invalid_edge || !(m_g->edge(reverseEdgeId).access & accessTypeMask))) {
+				continue;
 			}
-		});
-		assert(bestMatchDistance != 0.0 || wq.size() == 0);
-		//sort wq descending, so the smallest is at the back
-		std::sort(wq.begin(), wq.end(), [](const BinInfo & a, const BinInfo & b) {
-			return a.distance >= b.distance;
-		});
+			const Graph::NodeInfo & s = m_g->nodeInfo(e.source);
+			const Graph::NodeInfo & t = m_g->nodeInfo(e.target);
+			double length = std::fabs( distanceTo(s.lat, s.lon, t.lat, t.lon) );
+			double along = (length > 0.0 ? alongTrackDistance(s.lat, s.lon, t.lat, t.lon, lat, lon) : 0.0);
+			double offset, eDist;
+			if (along <= 0.0) {
+				offset = 0.0;
+				eDist = std::fabs( distanceTo(lat, lon, s.lat, s.lon) );
+			}
+			else if (along >= length) {
+				offset = 1.0;
+				eDist = std::fabs( distanceTo(lat, lon, t.lat, t.lon) );
+			}
+			else {
+				offset = along/length;
+				eDist = std::fabs( crossTrackDistance(s.lat, s.lon, t.lat, t.lon, lat, lon) );
+			}
+			if (eDist < match.distance) {
+				match.edgeId = edgeId;
+				match.offset = offset;
+				match.distance = eDist;
+			}
+		}
+	});
+	if (match.edgeId == 0xFFFFFFFF) {
+		return false;
+	}
+	//the edges are short enough to interpolate linearly
+	const Graph::Edge & e = m_g->edge(match.edgeId);
+	const Graph::NodeInfo & s = m_g->nodeInfo(e.source);
+	const Graph::NodeInfo & t = m_g->nodeInfo(e.target);
+	match.lat = s.lat + match.offset*(t.lat-s.lat);
+	match.lon = s.lon + match.offset*(t.lon-s.lon);
+	return true;
+}
+
+void Grid::initLimits(const std::vector<Bin> & bins, std::vector<uint32_t> & limits) {
+	if (limits.size() == bins.size()) {
+		return;
+	}
+	//the bins were created consecutively, none of them has room left
+	limits.resize(bins.size());
+	for(uint32_t i(0), s(bins.size()); i < s; ++i) {
+		limits[i] = bins[i].end;
+	}
+}
+
+template<typename TRelocate>
+uint32_t Grid::reserveRef(std::vector<Bin> & bins, std::vector<uint32_t> & limits, std::vector<uint32_t> & refs, uint32_t binId, TRelocate relocate) {
+	initLimits(bins, limits);
+	Bin & b = bins[binId];
+	if (b.end == limits[binId]) {
+		//doubling the capacity keeps the copies linear in the number of entries added to the bin
+		uint32_t capacity = std::max<uint32_t>(2*b.size(), 4);
+		uint32_t newBegin = refs.size();
+		refs.resize(newBegin+capacity);
+		std::copy(refs.begin()+b.begin, refs.begin()+b.end, refs.begin()+newBegin);
+		relocate(b.begin, newBegin, b.size());
+		b.end = newBegin+b.size();
+		b.begin = newBegin;
+		limits[binId] = newBegin+capacity;
+	}
+	b.end += 1;
+	return b.end-1;
+}
+
+template<typename TMove>
+bool Grid::eraseRef(std::vector<Bin> & bins, std::vector<uint32_t> & limits, std::vector<uint32_t> & refs, uint32_t binId, uint32_t ref, TMove move) {
+	initLimits(bins, limits);
+	Bin & b = bins[binId];
+	for(uint32_t i(b.begin); i < b.end; ++i) {
+		if (refs[i] == ref) {
+			b.end -= 1;
+			if (i != b.end) {
+				refs[i] = refs[b.end];
+				move(b.end, i);
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+void Grid::addNode(uint32_t nodeId) {
+	const Graph::NodeInfo & ni = m_g->nodeInfo(nodeId);
+	uint32_t latBin, lonBin;
+	clippedBin(ni.lat, ni.lon, latBin, lonBin);
+	bool nodeVectors = hasNodeVectors();
+	uint32_t pos = reserveRef(m_bins, m_binLimits, m_nodeRefs, bin(latBin, lonBin), [this, nodeVectors](uint32_t oldBegin, uint32_t newBegin, uint32_t count) {
+		if (!nodeVectors) {
+			return;
+		}
+		for(std::vector<double> * v : {&m_nodeVectors.x, &m_nodeVectors.y, &m_nodeVectors.z}) {
+			v->resize(m_nodeRefs.size());
+			std::copy(v->begin()+oldBegin, v->begin()+oldBegin+count, v->begin()+newBegin);
+		}
+	});
+	m_nodeRefs[pos] = nodeId;
+	if (nodeVectors) {
+		unitVector(ni.lat, ni.lon, m_nodeVectors.x[pos], m_nodeVectors.y[pos], m_nodeVectors.z[pos]);
+	}
+}
+
+void Grid::removeNode(uint32_t nodeId, double lat, double lon) {
+	uint32_t latBin, lonBin;
+	clippedBin(lat, lon, latBin, lonBin);
+	bool nodeVectors = hasNodeVectors();
+	bool removed = eraseRef(m_bins, m_binLimits, m_nodeRefs, bin(latBin, lonBin), nodeId, [this, nodeVectors](uint32_t from, uint32_t to) {
+		if (nodeVectors) {
+			m_nodeVectors.x[to] = m_nodeVectors.x[from];
+			m_nodeVectors.y[to] = m_nodeVectors.y[from];
+			m_nodeVectors.z[to] = m_nodeVectors.z[from];
+		}
+	});
+	assert(removed);
+	(void)removed;
+}
+
+void Grid::addEdgeRef(uint32_t edgeId) {
+	if (!hasEdgeIndex()) {
+		return;
+	}
+	uint32_t latBegin, latEnd, lonBegin, lonEnd;
+	edgeBinRange(edgeId, latBegin, latEnd, lonBegin, lonEnd);
+	for(uint32_t latBin(latBegin); latBin < latEnd; ++latBin) {
+		for(uint32_t lonBin(lonBegin); lonBin < lonEnd; ++lonBin) {
+			uint32_t pos = reserveRef(m_edgeBins, m_edgeBinLimits, m_edgeRefs, bin(latBin, lonBin), [](uint32_t, uint32_t, uint32_t) {});
+			m_edgeRefs[pos] = edgeId;
+		}
+	}
+}
+
+void Grid::removeEdgeRef(uint32_t edgeId) {
+	if (!hasEdgeIndex()) {
+		return;
+	}
+	uint32_t latBegin, latEnd, lonBegin, lonEnd;
+	edgeBinRange(edgeId, latBegin, latEnd, lonBegin, lonEnd);
+	for(uint32_t latBin(latBegin); latBin < latEnd; ++latBin) {
+		for(uint32_t lonBin(lonBegin); lonBin < lonEnd; ++lonBin) {
+			eraseRef(m_edgeBins, m_edgeBinLimits, m_edgeRefs, bin(latBin, lonBin), edgeId, [](uint32_t, uint32_t) {});
+		}
+	}
+}
+
+void Grid::renameEdgeRef(uint32_t oldEdgeId, uint32_t newEdgeId) {
+	if (!hasEdgeIndex()) {
+		return;
+	}
+	uint32_t latBegin, latEnd, lonBegin, lonEnd;
+	edgeBinRange(newEdgeId, latBegin, latEnd, lonBegin, lonEnd);
+	for(uint32_t latBin(latBegin); latBin < latEnd; ++latBin) {
+		for(uint32_t lonBin(lonBegin); lonBin < lonEnd; ++lonBin) {
+			const Bin & b = m_edgeBins[bin(latBin, lonBin)];
+			std::replace(m_edgeRefs.begin()+b.begin, m_edgeRefs.begin()+b.end, oldEdgeId, newEdgeId);
+		}
+	}
+}
+
+void Grid::compact() {
+	if (m_binLimits.size()) {
+		bool nodeVectors = hasNodeVectors();
+		uint32_t nodeCount = 0;
+		for(const Bin & b : m_bins) {
+			nodeCount += b.size();
+		}
+		std::vector<uint32_t> nodeRefs;
+		NodeVectors nv;
+		nodeRefs.reserve(nodeCount);
+		for(Bin & b : m_bins) {
+			uint32_t newBegin = nodeRefs.size();
+			nodeRefs.insert(nodeRefs.end(), m_nodeRefs.begin()+b.begin, m_nodeRefs.begin()+b.end);
+			if (nodeVectors) {
+				nv.x.insert(nv.x.end(), m_nodeVectors.x.begin()+b.begin, m_nodeVectors.x.begin()+b.end);
+				nv.y.insert(nv.y.end(), m_nodeVectors.y.begin()+b.begin, m_nodeVectors.y.begin()+b.end);
+				nv.z.insert(nv.z.end(), m_nodeVectors.z.begin()+b.begin, m_nodeVectors.z.begin()+b.end);
+			}
+			b.begin = newBegin;
+			b.end = nodeRefs.size();
+		}
+		m_nodeRefs = std::move(nodeRefs);
+		m_nodeVectors = std::move(nv);
+		std::vector<uint32_t>().swap(m_binLimits);
+	}
+	if (m_edgeBinLimits.size()) {
+		std::vector<uint32_t> edgeRefs;
+		for(Bin & b : m_edgeBins) {
+			uint32_t newBegin = edgeRefs.size();
+			edgeRefs.insert(edgeRefs.end(), m_edgeRefs.begin()+b.begin, m_edgeRefs.begin()+b.end);
+			b.begin = newBegin;
+			b.end = edgeRefs.size();
+		}
+		m_edgeRefs = std::move(edgeRefs);
+		std::vector<uint32_t>().swap(m_edgeBinLimits);
 	}
-	assert(bestMatch != std::numeric_limits<uint32_t>::max());
-	return bestMatch;
 }
 
 void Grid::printStats(std::ostream & out) {
 	uint32_t maxNC = 0;
 	uint32_t minNC = 0xFFFFFFFF;
+	uint32_t occupiedCount = 0;
 	
 	for(const Bin & bin : m_bins) {
 		maxNC = std::max(maxNC, bin.size());
 		minNC = std::min(minNC, bin.size());
+		occupiedCount += (bin.size() ? 1 : 0);
 	}
 
 	out << "Grid::stats {\n";
@@ -363,6 +914,8 @@ void Grid::printStats(std::ostream & out) {
 	out << "\tavg bin size: " << (double)m_nodeRefs.size()/(m_latCount*m_lonCount)<< "\n";
 	out << "\tmax bin size: " << maxNC << "\n";
 	out << "\tmin bin size: " << minNC << "\n";
+	out << "\tnon-empty bins: " << occupiedCount << "\n";
+	out << "\tavg non-empty bin size: " << (occupiedCount ? (double)m_nodeRefs.size()/occupiedCount : 0.0) << "\n";
 	out << "}";
 }
 
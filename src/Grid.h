@@ -7,15 +7,38 @@
 namespace simpleroute {
 	
 class Graph;
+class GraphSnapshot;
 
 //only usefull in conjcuntion with the graph
 class Grid {
+	friend class GraphSnapshot;
 public:
 	typedef std::vector<uint32_t>::const_iterator ConstNodeRefIterator; 
+	///number of nodes in the bin of an average node the automatic dimensions aim for
+	static constexpr uint32_t auto_target_occupancy = 16;
+	struct NodeDistance {
+		uint32_t nodeId;
+		///in meters
+		double distance;
+		NodeDistance(uint32_t nodeId, double distance) : nodeId(nodeId), distance(distance) {}
+	};
+	///closest point on an edge, see closestEdge()
+	struct EdgeMatch {
+		uint32_t edgeId;
+		///position of the point on the edge from its source (0.0) to its target (1.0)
+		double offset;
+		///in meters
+		double distance;
+		///coordinates of the point
+		double lat;
+		double lon;
+		EdgeMatch() : edgeId(0xFFFFFFFF), offset(0.0), distance(0.0), lat(0.0), lon(0.0) {}
+	};
 public:
 	Grid();
 	Grid(Grid && other);
 	Grid(const Grid & other);
+	///A latCount or lonCount of 0 chooses both with autoDimensions() and auto_target_occupancy
 	Grid(const Graph * g, uint32_t latCount, uint32_t lonCount);
 	virtual ~Grid() {}
 	Grid & operator=(const Grid & other);
@@ -23,7 +46,52 @@ public:
 	
 	///return id of the closest node, does not consider wrap-around, returns std::numeric_limits<uint32_t>::max() if no node was found
 	uint32_t closest(double lat, double lon) const;
+	///closest() for many points, result[i] is the closest node of (lat[i], lon[i]).
+	///The points are processed in the order of their bins in chunks distributed over threadCount threads (0 uses all cores).
+	///Uses the node vectors if they were created, otherwise they are computed for this call
+	void closest(const std::vector<double> & lat, const std::vector<double> & lon, std::vector<uint32_t> & result, uint32_t threadCount = 0) const;
+	///Stores the nodes as unit vectors in the order of the bins for the batch version of closest().
+	///Needs 24 bytes per node, this has to be called again if the nodes change
+	void createNodeVectors();
+	inline bool hasNodeVectors() const { return m_nodeVectors.x.size() == m_nodeRefs.size() && m_nodeRefs.size(); }
+	///the (at most) k closest nodes ordered by ascending distance, does not consider wrap-around
+	///result is used as bounded heap during the search, it does not allocate if its capacity is at least k
+	void kNearest(double lat, double lon, uint32_t k, std::vector<NodeDistance> & result) const;
+	///all nodes within radius (in meters) ordered by ascending distance, does not consider wrap-around
+	///result keeps its capacity, reuse it to avoid allocations
+	void withinRadius(double lat, double lon, double radius, std::vector<NodeDistance> & result) const;
+	
+	///Creates the edge index: the ids of the edges whose bounding box intersects a bin.
+	///Of two opposite edges only one is stored. This has to be called again if the edges change
+	void createEdgeIndex();
+	inline bool hasEdgeIndex() const { return m_edgeBins.size() == m_bins.size() && m_bins.size(); }
+	///Closest point on any edge with an access type in accessTypeMask, only valid if hasEdgeIndex().
+	///The edge is straight between its nodes. Returns false if there is no such edge
+	bool closestEdge(double lat, double lon, uint32_t accessTypeMask, EdgeMatch & match) const;
 	
+	///In-place updates for changes of the graph, see GraphUpdater.
+	///A bin without room for another entry is moved behind the last bin with room to grow, compact() removes the gaps this leaves.
+	///Nodes outside of the bounding box of the grid go to the border bins, searches may miss them until the grid is recreated.
+	///The node vectors are updated if they exist
+	void addNode(uint32_t nodeId);
+	///lat and lon are the coordinates of the node when it was added
+	void removeNode(uint32_t nodeId, double lat, double lon);
+	///Adds an edge to the edge index if it exists, the bins are those of the current coordinates of its nodes.
+	///The caller decides which of two opposite edges is indexed, see createEdgeIndex()
+	void addEdgeRef(uint32_t edgeId);
+	///removes an edge from the edge index, its nodes have to be at the coordinates they had when it was added
+	void removeEdgeRef(uint32_t edgeId);
+	///the edge oldEdgeId of the edge index is now the edge newEdgeId of the graph
+	void renameEdgeRef(uint32_t oldEdgeId, uint32_t newEdgeId);
+	///removes the gaps left by the in-place updates
+	void compact();
+	
+	///Dimensions for the graph such that the bin of an average node holds about targetOccupancy nodes and the bins are roughly square in meters.
+	///A resolution derived from the node count alone puts most nodes of a graph with dense cities and empty areas into few bins,
+	///hence the resolution is raised until the occupancy reaches the target. The number of bins is at most the number of nodes
+	static void autoDimensions(const Graph * g, uint32_t targetOccupancy, uint32_t & latCount, uint32_t & lonCount);
+	inline uint32_t latCount() const { return m_latCount; }
+	inline uint32_t lonCount() const { return m_lonCount; }
 	inline uint32_t binCount() const { return m_bins.size(); }
 	ConstNodeRefIterator binNodesBegin(uint32_t bin) const { return m_nodeRefs.cbegin() + m_bins.at(bin).begin; }
 	ConstNodeRefIterator binNodesEnd(uint32_t bin) const { return m_nodeRefs.cbegin() + m_bins.at(bin).end; }
@@ -32,20 +100,56 @@ public:
 	
 	bool selfCheck();
 	
-private:
-	uint32_t bin(uint32_t latBin, uint32_t lonBin) const;
-	void bin(double lat, double lon, uint32_t & latBin, uint32_t & lonBin) const;
-	
-	void binCorners(uint32_t latBin, uint32_t lonBin, double & minLat, double & maxLat, double & minLon, double & maxLon) const;
-	
-	double binDistance(uint32_t latBin, uint32_t lonBin, double lat, double lon) const;
 private:
 	struct Bin {
 		uint32_t begin;
 		uint32_t end;
+		Bin() : begin(0), end(0) {}
 		Bin(uint32_t begin, uint32_t end) : begin(begin), end(end) {}
 		inline uint32_t size() const { return end-begin; }
 	};
+	///structure of arrays of the unit vectors of the nodes, entry i belongs to the node m_nodeRefs[i]
+	struct NodeVectors {
+		std::vector<double> x;
+		std::vector<double> y;
+		std::vector<double> z;
+	};
+private:
+	uint32_t bin(uint32_t latBin, uint32_t lonBin) const;
+	void bin(double lat, double lon, uint32_t & latBin, uint32_t & lonBin) const;
+	
+	void binCorners(uint32_t latBin, uint32_t lonBin, double & minLat, double & maxLat, double & minLon, double & maxLon) const;
+	
+	double binDistance(uint32_t latBin, uint32_t lonBin, double lat, double lon) const;
+	
+	///bin of the coordinates, coordinates outside of the grid are clipped to the border bins
+	void clippedBin(double lat, double lon, uint32_t & latBin, uint32_t & lonBin) const;
+	
+	///Visits the bins in growing rings around the bin of (lat, lon) and calls scan(const Bin &) for every non-empty bin of bins
+	///whose distance binDistance(latBin, lonBin) is at most bound(). The search stops after the first ring without such a bin.
+	///bound() may shrink during the search
+	template<typename TBinDistance, typename TBound, typename TScan>
+	void ringSearch(double lat, double lon, const std::vector<Bin> & bins, TBinDistance binDistance, TBound bound, TScan scan) const;
+	///same as above with the distance of binDistance(uint32_t, uint32_t, double, double)
+	template<typename TBound, typename TScan>
+	void ringSearch(double lat, double lon, const std::vector<Bin> & bins, TBound bound, TScan scan) const;
+	
+	///limits of bins that were created consecutively, does nothing if limits exist already
+	static void initLimits(const std::vector<Bin> & bins, std::vector<uint32_t> & limits);
+	///Position for a new entry at the end of bins[binId], the bin is moved behind the last bin if it has no room left in limits.
+	///relocate(oldBegin, newBegin, count) copies data that is stored parallel to refs, refs has its new size already
+	template<typename TRelocate>
+	static uint32_t reserveRef(std::vector<Bin> & bins, std::vector<uint32_t> & limits, std::vector<uint32_t> & refs, uint32_t binId, TRelocate relocate);
+	///Removes the entry ref of bins[binId] by moving the last entry of the bin into its place, returns false if there is no such entry.
+	///move(from, to) copies data that is stored parallel to refs
+	template<typename TMove>
+	static bool eraseRef(std::vector<Bin> & bins, std::vector<uint32_t> & limits, std::vector<uint32_t> & refs, uint32_t binId, uint32_t ref, TMove move);
+	///bins covered by the bounding box of an edge, the bounding box is clipped to the grid
+	void edgeBinRange(uint32_t edgeId, uint32_t & latBegin, uint32_t & latEnd, uint32_t & lonBegin, uint32_t & lonEnd) const;
+	
+	void computeNodeVectors(NodeVectors & nv) const;
+	///same as closest() but compares the squared chord lengths of the unit vectors, returns the position in m_nodeRefs
+	uint32_t closestVector(double lat, double lon, const NodeVectors & nv) const;
 private:
 	double m_minLat;
 	double m_maxLat;
@@ -55,6 +159,14 @@ private:
 	uint32_t m_lonCount;
 	std::vector<Bin> m_bins;
 	std::vector<uint32_t> m_nodeRefs;
+	///end of the room of every bin in m_nodeRefs, empty until the first in-place update, see addNode()
+	std::vector<uint32_t> m_binLimits;
+	///edge index with the same layout as m_bins and m_nodeRefs, empty if it was not created
+	std::vector<Bin> m_edgeBins;
+	std::vector<uint32_t> m_edgeRefs;
+	std::vector<uint32_t> m_edgeBinLimits;
+	///empty if they were not created
+	NodeVectors m_nodeVectors;
 	const Graph * m_g;
 };
 
@@ -0,0 +1,143 @@
+#ifndef SIMPLE_ROUTE_INDEXED_DARY_HEAP_H
+#define SIMPLE_ROUTE_INDEXED_DARY_HEAP_H
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+#include <assert.h>
+
+namespace simpleroute {
+
+///Min-heap of ids in [0, idCount) with an arity of T_ARITY.
+///The position of every id is tracked which allows a true decrease-key operation.
+///Keys and ids are stored next to each other, children of a node are consecutive in memory.
+template<typename T_KEY, uint32_t T_ARITY = 4>
+class IndexedDaryHeap {
+public:
+	typedef T_KEY Key;
+	static constexpr uint32_t arity = T_ARITY;
+	static constexpr uint32_t npos = 0xFFFFFFFF;
+public:
+	IndexedDaryHeap() {}
+	IndexedDaryHeap(uint32_t idCount) : m_pos(idCount, npos) {}
+	~IndexedDaryHeap() {}
+	///set the number of ids, this is O(1) if idCount did not change
+	void resize(uint32_t idCount);
+	inline bool empty() const { return m_heap.empty(); }
+	inline uint32_t size() const { return m_heap.size(); }
+	inline bool contains(uint32_t id) const { return m_pos[id] != npos; }
+	inline uint32_t top() const { return m_heap.front().id; }
+	inline const Key & topKey() const { return m_heap.front().key; }
+	///id must not be in the heap
+	void push(uint32_t id, const Key & key);
+	///id must be in the heap and key must not be larger than its current key
+	void decreaseKey(uint32_t id, const Key & key);
+	void pop();
+	///removes all remaining ids, this is O(size())
+	void clear();
+private:
+	struct Entry {
+		Key key;
+		uint32_t id;
+		Entry(const Key & key, uint32_t id) : key(key), id(id) {}
+	};
+private:
+	void siftUp(uint32_t pos);
+	void siftDown(uint32_t pos);
+	inline void place(uint32_t pos, const Entry & e) {
+		m_heap[pos] = e;
+		m_pos[e.id] = pos;
+	}
+private:
+	std::vector<Entry> m_heap;
+	std::vector<uint32_t> m_pos;
+};
+
+template<typename T_KEY, uint32_t T_ARITY>
+void IndexedDaryHeap<T_KEY, T_ARITY>::resize(uint32_t idCount) {
+	if (m_pos.size() != idCount) {
+		m_heap.clear();
+		m_pos.assign(idCount, npos);
+	}
+}
+
+template<typename T_KEY, uint32_t T_ARITY>
+void IndexedDaryHeap<T_KEY, T_ARITY>::push(uint32_t id, const Key & key) {
+	assert(!contains(id));
+	m_heap.emplace_back(key, id);
+	m_pos[id] = m_heap.size()-1;
+	siftUp(m_heap.size()-1);
+}
+
+template<typename T_KEY, uint32_t T_ARITY>
+void IndexedDaryHeap<T_KEY, T_ARITY>::decreaseKey(uint32_t id, const Key & key) {
+	assert(contains(id));
+	uint32_t pos = m_pos[id];
+	assert(!(m_heap[pos].key < key));
+	m_heap[pos].key = key;
+	siftUp(pos);
+}
+
+template<typename T_KEY, uint32_t T_ARITY>
+void IndexedDaryHeap<T_KEY, T_ARITY>::pop() {
+	assert(!empty());
+	m_pos[m_heap.front().id] = npos;
+	if (m_heap.size() > 1) {
+		place(0, m_heap.back());
+		m_heap.pop_back();
+		siftDown(0);
+	}
+	else {
+		m_heap.pop_back();
+	}
+}
+
+template<typename T_KEY, uint32_t T_ARITY>
+void IndexedDaryHeap<T_KEY, T_ARITY>::clear() {
+	for(const Entry & e : m_heap) {
+		m_pos[e.id] = npos;
+	}
+	m_heap.clear();
+}
+
+template<typename T_KEY, uint32_t T_ARITY>
+void IndexedDaryHeap<T_KEY, T_ARITY>::siftUp(uint32_t pos) {
+	Entry e = m_heap[pos];
+	while (pos) {
+		uint32_t parent = (pos-1)/arity;
+		if (!(e.key < m_heap[parent].key)) {
+			break;
+		}
+		place(pos, m_heap[parent]);
+		pos = parent;
+	}
+	place(pos, e);
+}
+
+template<typename T_KEY, uint32_t T_ARITY>
+void IndexedDaryHeap<T_KEY, T_ARITY>::siftDown(uint32_t pos) {
+	Entry e = m_heap[pos];
+	uint32_t s = m_heap.size();
+	while (true) {
+		uint32_t firstChild = pos*arity+1;
+		if (firstChild >= s) {
+			break;
+		}
+		uint32_t childEnd = std::min<uint32_t>(firstChild+arity, s);
+		uint32_t minChild = firstChild;
+		for(uint32_t child(firstChild+1); child < childEnd; ++child) {
+			if (m_heap[child].key < m_heap[minChild].key) {
+				minChild = child;
+			}
+		}
+		if (!(m_heap[minChild].key < e.key)) {
+			break;
+		}
+		place(pos, m_heap[minChild]);
+		pos = minChild;
+	}
+	place(pos, e);
+}
+
+}//end namespace simpleroute
+
+#endif
@@ -0,0 +1,314 @@
+#include "Landmarks.h"
+#include "IndexedDaryHeap.h"
+#include "ParallelFor.h"
+#include "TimeMeasurer.h"
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <algorithm>
+#include <ostream>
+
+namespace simpleroute {
+namespace {
+
+static constexpr uint64_t unreachable = std::numeric_limits<uint64_t>::max();
+static constexpr uint32_t file_magic = 0x4D4C5253; //"SRLM"
+
+///One-to-all Dijkstra from all sources at once, backward searches follow the reverse edges.
+///parents and settleOrder are optional
+void oneToAll(const Metric & metric, const std::vector<uint32_t> & sources, bool backward,
+	std::vector<uint64_t> & dist, std::vector<uint32_t> * parents, std::vector<uint32_t> * settleOrder)
+{
+	const Graph & g = metric.graph();
+	dist.assign(g.nodeCount(), unreachable);
+	if (parents) {
+		parents->assign(g.nodeCount(), 0xFFFFFFFF);
+	}
+	if (settleOrder) {
+		settleOrder->clear();
+	}
+	IndexedDaryHeap<uint64_t, 4> border(g.nodeCount());
+	for(uint32_t s : sources) {
+		if (dist[s]) {
+			dist[s] = 0;
+			border.push(s, 0);
+		}
+	}
+	auto relax = [&](uint32_t curNodeId, uint32_t nextNodeId, uint32_t edgeId) {
+		if (!metric.accessAllowed(edgeId)) {
+			return;
+		}
+		uint64_t nw = dist[curNodeId] + metric.weight(edgeId);
+		if (nw < dist[nextNodeId]) {
+			if (border.contains(nextNodeId)) {
+				border.decreaseKey(nextNodeId, nw);
+			}
+			else {
+				border.push(nextNodeId, nw);
+			}
+			dist[nextNodeId] = nw;
+			if (parents) {
+				(*parents)[nextNodeId] = curNodeId;
+			}
+		}
+	};
+	while (!border.empty()) {
+		uint32_t curNodeId = border.top();
+		border.pop();
+		if (settleOrder) {
+			settleOrder->push_back(curNodeId);
+		}
+		if (backward) {
+			for(Graph::ConstEdgeRefIterator it(g.reverseEdgesBegin(curNodeId)), end(g.reverseEdgesEnd(curNodeId)); it != end; ++it) {
+				relax(curNodeId, g.edge(*it).source, *it);
+			}
+		}
+		else {
+			for(uint32_t edgeId(g.node(curNodeId).begin), end(g.node(curNodeId).end); edgeId < end; ++edgeId) {
+				relax(curNodeId, metric.target(edgeId), edgeId);
+			}
+		}
+	}
+}
+
+template<typename T>
+void writeValue(std::ostream & out, const T & v) {
+	out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+template<typename T>
+void writeVector(std::ostream & out, const std::vector<T> & v) {
+	writeValue<uint64_t>(out, v.size());
+	out.write(reinterpret_cast<const char*>(v.data()), v.size()*sizeof(T));
+}
+
+template<typename T>
+void readValue(std::istream & in, T & v) {
+	in.read(reinterpret_cast<char*>(&v), sizeof(T));
+}
+
+template<typename T>
+void readVector(std::istream & in, std::vector<T> & v, uint64_t maxSize) {
+	uint64_t size = 0;
+	readValue(in, size);
+	if (!in || size > maxSize) {
+		throw std::runtime_error("LandmarkInfo: corrupt file");
+	}
+	v.resize(size);
+	in.read(reinterpret_cast<char*>(v.data()), size*sizeof(T));
+}
+
+}//end namespace
+
+LandmarkInfo::LandmarkInfo() :
+m_nodeCount(0),
+m_edgeCount(0),
+m_metricChecksum(0)
+{}
+
+LandmarkInfo::~LandmarkInfo() {}
+
+void LandmarkInfo::create(const Metric & metric, uint32_t landmarkCount, SelectionStrategy ss, std::ostream & log, uint32_t threadCount) {
+	TimeMeasurer tm;
+	tm.begin();
+
+	m_nodeCount = metric.graph().nodeCount();
+	m_edgeCount = metric.graph().edgeCount();
+	m_metricChecksum = metric.checksum();
+	m_landmarks.clear();
+	m_fromLandmark.clear();
+	m_toLandmark.clear();
+	if (!m_nodeCount) {
+		return;
+	}
+	landmarkCount = std::min(landmarkCount, m_nodeCount);
+
+	if (ss == LS_AVOID) {
+		selectAvoid(metric, landmarkCount, threadCount);
+	}
+	else {
+		selectFarthest(metric, landmarkCount, threadCount);
+	}
+
+	tm.end();
+	log << "Landmark selection took " << tm.elapsedMilliSeconds() << " ms" << std::endl;
+}
+
+void LandmarkInfo::computeDistances(const Metric & metric, uint32_t i, bool backward, std::vector<WeightType> & dest) const {
+	std::vector<uint64_t> dist;
+	oneToAll(metric, std::vector<uint32_t>(1, m_landmarks[i]), backward, dist, 0, 0);
+	//every run writes its own column
+	for(uint32_t nodeId(0); nodeId < m_nodeCount; ++nodeId) {
+		dest[uint64_t(nodeId)*landmarkCount()+i] = std::min<uint64_t>(dist[nodeId], infinite_weight);
+	}
+}
+
+void LandmarkInfo::computeDistances(const Metric & metric, uint32_t begin, uint32_t end, uint32_t threadCount) {
+	m_fromLandmark.resize(uint64_t(m_nodeCount)*landmarkCount(), infinite_weight);
+	m_toLandmark.resize(uint64_t(m_nodeCount)*landmarkCount(), infinite_weight);
+	//the columns of the landmarks before begin have to be moved since the row length changed
+	uint32_t oldCount = begin;
+	if (oldCount && oldCount != landmarkCount()) {
+		for(std::vector<WeightType> * table : {&m_fromLandmark, &m_toLandmark}) {
+			for(uint32_t nodeId(m_nodeCount); nodeId > 0; --nodeId) {
+				for(uint32_t i(oldCount); i > 0; --i) {
+					(*table)[uint64_t(nodeId-1)*landmarkCount()+i-1] = (*table)[uint64_t(nodeId-1)*oldCount+i-1];
+				}
+			}
+		}
+	}
+	parallelFor(2*begin, 2*end, [this, &metric](uint32_t run, uint32_t) {
+		bool backward = run & 0x1;
+		computeDistances(metric, run/2, backward, (backward ? m_toLandmark : m_fromLandmark));
+	}, threadCount, 1);
+}
+
+void LandmarkInfo::selectFarthest(const Metric & metric, uint32_t landmarkCount, uint32_t threadCount) {
+	std::mt19937 rng(m_nodeCount);
+	std::vector<uint64_t> dist;
+	//start with the node farthest away from a random node
+	std::vector<uint32_t> sources(1, std::uniform_int_distribution<uint32_t>(0, m_nodeCount-1)(rng));
+	while (m_landmarks.size() < landmarkCount) {
+		oneToAll(metric, sources, false, dist, 0, 0);
+		uint32_t farthest = 0xFFFFFFFF;
+		for(uint32_t nodeId(0); nodeId < m_nodeCount; ++nodeId) {
+			if (dist[nodeId] != unreachable && (farthest == 0xFFFFFFFF || dist[nodeId] > dist[farthest])) {
+				farthest = nodeId;
+			}
+		}
+		//all reachable nodes are landmarks, continue in another component
+		if (farthest == 0xFFFFFFFF || !dist[farthest]) {
+			farthest = std::uniform_int_distribution<uint32_t>(0, m_nodeCount-1)(rng);
+			if (std::find(m_landmarks.begin(), m_landmarks.end(), farthest) != m_landmarks.end()) {
+				continue;
+			}
+		}
+		m_landmarks.push_back(farthest);
+		sources = m_landmarks;
+	}
+	computeDistances(metric, 0, landmarkCount, threadCount);
+}
+
+void LandmarkInfo::selectAvoid(const Metric & metric, uint32_t landmarkCount, uint32_t threadCount) {
+	std::mt19937 rng(m_nodeCount);
+	std::vector<uint64_t> dist;
+	std::vector<uint32_t> parents;
+	std::vector<uint32_t> settleOrder;
+	std::vector<uint64_t> size;
+	std::vector<uint8_t> isLandmark(m_nodeCount, 0);
+	std::vector<uint8_t> covered;
+	std::vector<uint32_t> bestChild;
+	while (m_landmarks.size() < landmarkCount) {
+		//shortest path tree of a random root
+		uint32_t root = std::uniform_int_distribution<uint32_t>(0, m_nodeCount-1)(rng);
+		oneToAll(metric, std::vector<uint32_t>(1, root), false, dist, &parents, &settleOrder);
+
+		//the size of a node is the sum of the lower bound errors in its subtree, 0 if the subtree has a landmark (it is covered)
+		size.assign(m_nodeCount, 0);
+		for(uint32_t nodeId : settleOrder) {
+			uint64_t lb = 0;
+			for(uint32_t i(0), s(m_landmarks.size()); i < s; ++i) {
+				lb = std::max(lb, lowerBound(root, nodeId, i));
+			}
+			size[nodeId] = dist[nodeId] - std::min(lb, dist[nodeId]);
+		}
+		bestChild.assign(m_nodeCount, 0xFFFFFFFF);
+		covered.assign(isLandmark.begin(), isLandmark.end());
+		//children are settled after their parent
+		for(std::vector<uint32_t>::const_reverse_iterator it(settleOrder.crbegin()), end(settleOrder.crend()); it != end; ++it) {
+			uint32_t nodeId = *it;
+			if (nodeId == root) {
+				continue;
+			}
+			uint32_t parent = parents[nodeId];
+			if (covered[nodeId]) {
+				size[nodeId] = 0;
+				covered[parent] = 1;
+				continue;
+			}
+			if (bestChild[parent] == 0xFFFFFFFF || size[bestChild[parent]] < size[nodeId]) {
+				bestChild[parent] = nodeId;
+			}
+			size[parent] += size[nodeId];
+		}
+
+		//descend along the children with the largest size until a leaf is reached
+		uint32_t leaf = root;
+		while (bestChild[leaf] != 0xFFFFFFFF) {
+			leaf = bestChild[leaf];
+		}
+		//the whole tree is covered, fall back to a random node
+		if (isLandmark[leaf]) {
+			leaf = std::uniform_int_distribution<uint32_t>(0, m_nodeCount-1)(rng);
+			if (isLandmark[leaf]) {
+				continue;
+			}
+		}
+		m_landmarks.push_back(leaf);
+		isLandmark[leaf] = 1;
+		//the lower bounds of the next tree need the distances of this landmark
+		computeDistances(metric, m_landmarks.size()-1, m_landmarks.size(), threadCount);
+	}
+}
+
+void LandmarkInfo::write(const std::string & path) const {
+	std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!out.is_open()) {
+		throw std::runtime_error("LandmarkInfo: could not open " + path + " for writing");
+	}
+	writeValue(out, file_magic);
+	writeValue(out, file_version);
+	writeValue(out, m_nodeCount);
+	writeValue(out, m_edgeCount);
+	writeValue(out, m_metricChecksum);
+	writeVector(out, m_landmarks);
+	writeVector(out, m_fromLandmark);
+	writeVector(out, m_toLandmark);
+	out.flush();
+	if (!out) {
+		throw std::runtime_error("LandmarkInfo: could not write " + path);
+	}
+}
+
+void LandmarkInfo::read(const std::string & path, const Metric & metric, uint32_t landmarkCount) {
+	std::ifstream in(path, std::ios::in | std::ios::binary);
+	if (!in.is_open()) {
+		throw std::runtime_error("LandmarkInfo: could not open " + path);
+	}
+	uint32_t magic = 0, version = 0;
+	readValue(in, magic);
+	readValue(in, version);
+	if (!in || magic != file_magic || version != file_version) {
+		throw std::runtime_error("LandmarkInfo: " + path + " has an unsupported format");
+	}
+	readValue(in, m_nodeCount);
+	readValue(in, m_edgeCount);
+	readValue(in, m_metricChecksum);
+	if (!in || m_nodeCount != metric.graph().nodeCount() || m_edgeCount != metric.graph().edgeCount() || m_metricChecksum != metric.checksum()) {
+		*this = LandmarkInfo();
+		throw std::runtime_error("LandmarkInfo: " + path + " was created for a different graph or metric");
+	}
+	readVector(in, m_landmarks, m_nodeCount);
+	if (in && landmarkCount && m_landmarks.size() != landmarkCount) {
+		uint32_t fileLandmarkCount = m_landmarks.size();
+		*this = LandmarkInfo();
+		throw std::runtime_error("LandmarkInfo: " + path + " has " + std::to_string(fileLandmarkCount) + " landmarks instead of " + std::to_string(landmarkCount));
+	}
+	uint64_t tableSize = uint64_t(m_nodeCount)*m_landmarks.size();
+	readVector(in, m_fromLandmark, tableSize);
+	readVector(in, m_toLandmark, tableSize);
+	if (!in || m_fromLandmark.size() != tableSize || m_toLandmark.size() != tableSize) {
+		*this = LandmarkInfo();
+		throw std::runtime_error("LandmarkInfo: " + path + " is truncated");
+	}
+}
+
+void LandmarkInfo::printStats(std::ostream & out) const {
+	out << "LandmarkInfo::stats {\n";
+	out << "\t#Nodes: " << nodeCount() << "\n";
+	out << "\t#Landmarks: " << landmarkCount() << "\n";
+	out << "\tstorage: " << (m_fromLandmark.size()+m_toLandmark.size())*sizeof(WeightType)/(1024*1024) << " MiB\n";
+	out << "}";
+}
+
+}//end namespace simpleroute
@@ -0,0 +1,89 @@
+#ifndef SIMPLE_ROUTE_LANDMARKS_H
+#define SIMPLE_ROUTE_LANDMARKS_H
+#include <vector>
+#include <limits>
+#include <string>
+#include <ostream>
+#include <stdint.h>
+#include "Graph.h"
+#include "Metric.h"
+
+namespace simpleroute {
+
+///Landmark distances for ALT (A*, landmarks and triangle inequality) of a single Metric.
+///For every node and landmark the weight of the shortest path from the landmark to the node
+///and from the node to the landmark is stored. The entries of a node are consecutive in memory.
+///By the triangle inequality d(L,t) - d(L,v) <= d(v,t) and d(v,L) - d(t,L) <= d(v,t) for every landmark L.
+class LandmarkInfo {
+public:
+	typedef uint32_t WeightType;
+	///unreachable or not representable as WeightType
+	static constexpr WeightType infinite_weight = std::numeric_limits<WeightType>::max();
+	///file format version of write()
+	static constexpr uint32_t file_version = 1;
+	///number of landmarks created if none is requested
+	static constexpr uint32_t default_landmark_count = 16;
+	typedef enum {
+		///the next landmark is the node farthest away from all selected landmarks
+		LS_FARTHEST,
+		///the next landmark is in the region of a shortest path tree with the worst lower bounds, see Goldberg and Werneck
+		LS_AVOID
+	} SelectionStrategy;
+public:
+	LandmarkInfo();
+	~LandmarkInfo();
+	///select landmarkCount landmarks and compute their distances, the graph of metric needs the reverse edges
+	///@param threadCount 0 uses all cores
+	void create(const Metric & metric, uint32_t landmarkCount, SelectionStrategy ss, std::ostream & log, uint32_t threadCount = 0);
+	inline uint32_t nodeCount() const { return m_nodeCount; }
+	inline uint32_t landmarkCount() const { return m_landmarks.size(); }
+	inline uint32_t landmark(uint32_t i) const { return m_landmarks[i]; }
+	///weight of the shortest path from landmark i to nodeId
+	inline WeightType fromLandmark(uint32_t nodeId, uint32_t i) const { return m_fromLandmark[uint64_t(nodeId)*landmarkCount()+i]; }
+	///weight of the shortest path from nodeId to landmark i
+	inline WeightType toLandmark(uint32_t nodeId, uint32_t i) const { return m_toLandmark[uint64_t(nodeId)*landmarkCount()+i]; }
+	///lower bound of the weight of the shortest path from source to target using landmark i
+	inline uint64_t lowerBound(uint32_t source, uint32_t target, uint32_t i) const;
+
+	///Stores the table in a binary file. Throws std::runtime_error on failure
+	void write(const std::string & path) const;
+	///Reads a table written by write(). Throws std::runtime_error on failure, if it was not created from metric
+	///or if it does not have landmarkCount landmarks. A landmarkCount of 0 accepts any number of landmarks
+	void read(const std::string & path, const Metric & metric, uint32_t landmarkCount = 0);
+	void printStats(std::ostream & out) const;
+private:
+	///weights of the shortest paths from (backward=false) or to (backward=true) landmark i, written to column i of dest
+	void computeDistances(const Metric & metric, uint32_t i, bool backward, std::vector<WeightType> & dest) const;
+	void selectFarthest(const Metric & metric, uint32_t landmarkCount, uint32_t threadCount);
+	void selectAvoid(const Metric & metric, uint32_t landmarkCount, uint32_t threadCount);
+	///compute the distances of landmarks in [begin, end)
+	void computeDistances(const Metric & metric, uint32_t begin, uint32_t end, uint32_t threadCount);
+private:
+	uint32_t m_nodeCount;
+	uint32_t m_edgeCount;
+	///Metric::checksum() of the metric the table was created from
+	uint64_t m_metricChecksum;
+	std::vector<uint32_t> m_landmarks;
+	std::vector<WeightType> m_fromLandmark;
+	std::vector<WeightType> m_toLandmark;
+};
+
+inline uint64_t LandmarkInfo::lowerBound(uint32_t source, uint32_t target, uint32_t i) const {
+	uint64_t lb = 0;
+	WeightType ls = fromLandmark(source, i);
+	WeightType lt = fromLandmark(target, i);
+	//an infinite weight does not give any information
+	if (ls != infinite_weight && lt != infinite_weight && lt > ls) {
+		lb = lt - ls;
+	}
+	WeightType sl = toLandmark(source, i);
+	WeightType tl = toLandmark(target, i);
+	if (sl != infinite_weight && tl != infinite_weight && sl > tl) {
+		lb = std::max<uint64_t>(lb, sl - tl);
+	}
+	return lb;
+}
+
+}//end namespace simpleroute
+
+#endif
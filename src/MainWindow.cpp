@@ -1,29 +1,41 @@
 #include "MainWindow.h"
-#include <QMessageBox>
 #include <QTableView>
 #include <QComboBox>
 #include <QHBoxLayout>
 #include <QVBoxLayout>
 #include <QHeaderView>
 #include <QLabel>
+#include <QRunnable>
+#include <QPushButton>
 #include <iostream>
 
 #include "MarbleMap.h"
 #include "GraphNodesTableModel.h"
 #include "GraphEdgesTableModel.h"
 #include "TimeMeasurer.h"
+#include "RouterFactory.h"
 
 namespace simpleroute {
 namespace detail {
 
-BackgroundRouter::BackgroundRouter(QObject * parent, const StatePtr& state) :
+BackgroundRouter::BackgroundRouter(QObject * parent, const StateHolderPtr& states) :
 QObject(parent),
-m_state(state),
-m_srcNode(0xFFFFFFFF),
-m_tgtNode(0xFFFFFFFF)
-{}
+m_states(states),
+m_hasRequest(false),
+m_latSrc(0.0),
+m_lonSrc(0.0),
+m_latTgt(0.0),
+m_lonTgt(0.0),
+m_requestId(0)
+{
+	//routeFinished is emitted by the pool threads, hence the connection is queued
+	connect(this, SIGNAL(routeFinished(Graph::Route,double,quint64)), this, SLOT(deliverRoute(Graph::Route,double,quint64)), Qt::QueuedConnection);
+}
 
-BackgroundRouter::~BackgroundRouter() {}
+BackgroundRouter::~BackgroundRouter() {
+	cancel();
+	m_pool.waitForDone();
+}
 
 struct MyPathVisitor: public simpleroute::Router::PathVisitor {
 	std::vector<uint32_t> p;
@@ -32,91 +44,132 @@ struct MyPathVisitor: public simpleroute::Router::PathVisitor {
 	}
 };
 
+class RouteJob: public QRunnable {
+public:
+	RouteJob(BackgroundRouter * br, double latSrc, double lonSrc, double latTgt, double lonTgt, int rt, int accessType, quint64 requestId, const CancellationTokenPtr & ct) :
+	m_br(br), m_latSrc(latSrc), m_lonSrc(lonSrc), m_latTgt(latTgt), m_lonTgt(lonTgt), m_rt(rt), m_accessType(accessType), m_requestId(requestId), m_ct(ct)
+	{}
+	virtual void run() override {
+		//superseded before it was started
+		if (m_ct->cancelled()) {
+			return;
+		}
+		m_br->calculate(m_latSrc, m_lonSrc, m_latTgt, m_lonTgt, m_rt, m_accessType, m_requestId, m_ct);
+	}
+private:
+	BackgroundRouter * m_br;
+	double m_latSrc;
+	double m_lonSrc;
+	double m_latTgt;
+	double m_lonTgt;
+	int m_rt;
+	int m_accessType;
+	quint64 m_requestId;
+	CancellationTokenPtr m_ct;
+};
+
 void BackgroundRouter::reroute(int rt, int accessType) {
-	if (m_srcNode != 0xFFFFFFFF && m_tgtNode != 0xFFFFFFFF) {
-		route(m_srcNode, m_tgtNode, rt, accessType);
+	if (m_hasRequest) {
+		route(m_latSrc, m_lonSrc, m_latTgt, m_lonTgt, rt, accessType);
 	}
 }
 
-void BackgroundRouter::route(uint32_t srcNode, uint32_t tgtNode, int rt, int accessType) {
-
-	double vehicleMaxSpeed = 0.0;
-	if (Graph::Edge::AT_FOOT & accessType) {
-		vehicleMaxSpeed = 5.0;
+void BackgroundRouter::cancel() {
+	if (m_cancellationToken) {
+		m_cancellationToken->cancel();
+		m_cancellationToken.reset();
 	}
-	if (Graph::Edge::AT_BIKE & accessType) {
-		vehicleMaxSpeed = 15.0;
+	++m_requestId;
+}
+
+void BackgroundRouter::route(double latSrc, double lonSrc, double latTgt, double lonTgt, int rt, int accessType) {
+	cancel();
+	m_hasRequest = true;
+	m_latSrc = latSrc;
+	m_lonSrc = lonSrc;
+	m_latTgt = latTgt;
+	m_lonTgt = lonTgt;
+	m_cancellationToken = std::make_shared<CancellationToken>();
+	m_pool.start(new RouteJob(this, latSrc, lonSrc, latTgt, lonTgt, rt, accessType, m_requestId, m_cancellationToken));
+}
+
+void BackgroundRouter::deliverRoute(const Graph::Route & route, double duration, quint64 requestId) {
+	if (requestId == m_requestId) {
+		emit routeCalculated(route, duration);
 	}
-	if (Graph::Edge::AT_CAR & accessType) {
-		vehicleMaxSpeed = 130.0;
+}
+
+void BackgroundRouter::calculate(double latSrc, double lonSrc, double latTgt, double lonTgt, int rt, int accessType, quint64 requestId, const CancellationTokenPtr & ct) {
+	//the snapshot keeps the state alive until the route is done even if it is replaced in the meantime
+	StatePtr state = m_states->current();
+	Grid::EdgeMatch srcMatch, tgtMatch;
+	if (!state->grid.closestEdge(latSrc, lonSrc, accessType, srcMatch) || !state->grid.closestEdge(latTgt, lonTgt, accessType, tgtMatch)) {
+		std::cout << "Either source or target edge could not be found" << std::endl;
+		emit routeFinished(state->graph.routeInfo(std::vector<uint32_t>(), 0.0, accessType), 0.0, requestId);
+		return;
 	}
+	Graph::PhantomNode src(srcMatch.edgeId, srcMatch.offset);
+	Graph::PhantomNode tgt(tgtMatch.edgeId, tgtMatch.offset);
 	
-	Router * router;
-	bool usePrioQueue = false;
-	switch (rt) {
-	case Router::DIJKSTRA_PRIO_QUEUE_DISTANCE:
-		usePrioQueue = true;
-	case Router::DIJKSTRA_SET_DISTANCE:
-		{
-			detail::DijkstraRouter * tmp = new detail::DijkstraRouter(&(m_state->graph));
-			tmp->setEP( new detail::DijkstraRouter::DistanceEdgePreferences(accessType) );
-			tmp->setHeapType(usePrioQueue);
-			router = tmp;
-		}
-		break;
-	case Router::DIJKSTRA_PRIO_QUEUE_TIME:
-		usePrioQueue = true;
-	case Router::DIJKSTRA_SET_TIME:
-		{
-			detail::DijkstraRouter * tmp = new detail::DijkstraRouter(&(m_state->graph));
-			tmp->setEP( new detail::DijkstraRouter::TimeEdgePreferences(accessType, vehicleMaxSpeed) );
-			tmp->setHeapType(usePrioQueue);
-			router = tmp;
-		}
-		break;
-	case Router::A_STAR_DISTANCE:
-		{
-			detail::AStarRouter * tmp = new detail::AStarRouter(&(m_state->graph));
-			router = tmp;
-		}
-		break;
-	case Router::HOP_DISTANCE:
-	default:
-		{
-			detail::HopDistanceRouter * tmp = new detail::HopDistanceRouter(&(m_state->graph));
-			tmp->setEP( new Router::AccessAllowanceEdgePreferences(accessType) );
-			router = tmp;
-		}
-		break;
+	double vehicleMaxSpeed = RouterFactory::vehicleMaxSpeed(accessType);
+	bool isTimeMetric = RouterFactory::timeMetric(rt);
+	int requiredData = RouterFactory::requiredData(rt);
+	
+	//weighted routers use the materialised weights of the profile, see State::metric
+	const Metric * metric = 0;
+	const CHInfo * ch = 0;
+	const LandmarkInfo * li = 0;
+	if (requiredData & RouterFactory::RD_METRIC) {
+		metric = &(state->metric(accessType, isTimeMetric, vehicleMaxSpeed));
 	}
+	if (requiredData & RouterFactory::RD_CH) {
+		ch = &(state->chInfo(accessType, isTimeMetric, vehicleMaxSpeed));
+	}
+	if (requiredData & RouterFactory::RD_LANDMARKS) {
+		li = &(state->landmarkInfo(accessType, isTimeMetric, vehicleMaxSpeed));
+	}
+	std::unique_ptr<Router> router(RouterFactory::create(rt, &(state->graph), accessType, metric, ch, li));
+	router->setCancellationToken(ct);
 
-	m_srcNode = srcNode;
-	m_tgtNode = tgtNode;
-	std::cout << "Calculating route from " << srcNode << " to " << tgtNode << std::endl;
+	std::cout << "Calculating route from edge " << src.edgeId << " to edge " << tgt.edgeId << std::endl;
 	MyPathVisitor pv;
-	//make sure the router is valid during usage
 	TimeMeasurer tm;
 	tm.begin();
-	router->route(srcNode, tgtNode, &pv);
-	Graph::Route r = m_state->graph.routeInfo(std::move(pv.p), vehicleMaxSpeed, accessType);
+	bool found = router->route(src, tgt, &pv);
+	if (router->stats().cancelled) {
+		std::cout << "Cancelled route from edge " << src.edgeId << " to edge " << tgt.edgeId << " after settling " << router->stats().settledNodes << " nodes" << std::endl;
+		return;
+	}
+	Graph::Route r = (found ? state->graph.routeInfo(src, std::move(pv.p), tgt, vehicleMaxSpeed, accessType) : state->graph.routeInfo(std::vector<uint32_t>(), vehicleMaxSpeed, accessType));
 	tm.end();
-	std::cout << "Calculated route from " << srcNode << " to " << tgtNode << " with " << r.nodes.size() << " hops in " << tm.elapsedMilliSeconds() << " ms" << std::endl;
-	delete router;
-	emit routeCalculated(r, tm.elapsedMilliSeconds());
+	std::cout << "Calculated route from edge " << src.edgeId << " to edge " << tgt.edgeId << " with " << r.nodes.size() << " hops in " << tm.elapsedMilliSeconds() << " ms settling " << router->stats().settledNodes << " nodes" << std::endl;
+	emit routeFinished(r, tm.elapsedMilliSeconds(), requestId);
 }
 
 }//end namespace
 
-MainWindow::MainWindow(const StatePtr & state ):
+class StateLoadJob: public QRunnable {
+public:
+	StateLoadJob(MainWindow * mw, const Config & cfg) : m_mw(mw), m_cfg(cfg) {}
+	virtual void run() override {
+		m_mw->loadState(m_cfg);
+	}
+private:
+	MainWindow * m_mw;
+	Config m_cfg;
+};
+
+MainWindow::MainWindow(const StateHolderPtr & states):
 QMainWindow(),
-m_state(state),
-m_br(this, state)
+m_states(states),
+m_br(this, states),
+m_reloading(false)
 {
-	m_map = new MarbleMap(this, m_state);
+	m_map = new MarbleMap(this, m_states);
 	m_map->setMapThemeId("earth/openstreetmap/openstreetmap.dgml");
 	
-	m_nodesTableModel = new GraphNodesTableModel(this, m_state);
-	m_edgesTableModel = new GraphEdgesTableModel(this, m_state);
+	m_nodesTableModel = new GraphNodesTableModel(this, m_states);
+	m_edgesTableModel = new GraphEdgesTableModel(this, m_states);
 	
 	m_nodesTableView = new QTableView(this);
 	m_nodesTableView->setModel(m_nodesTableModel);
@@ -136,16 +189,29 @@ m_br(this, state)
 	m_routerSelection->addItem("Dijkstra std::set time", QVariant(Router::DIJKSTRA_SET_TIME));
 	m_routerSelection->addItem("Dijkstra std::priority_queue distance", QVariant(Router::DIJKSTRA_PRIO_QUEUE_DISTANCE));
 	m_routerSelection->addItem("Dijkstra std::priority_queue time", QVariant(Router::DIJKSTRA_PRIO_QUEUE_TIME));
+	m_routerSelection->addItem("Dijkstra 4-ary heap distance", QVariant(Router::DIJKSTRA_DARY_HEAP_DISTANCE));
+	m_routerSelection->addItem("Dijkstra 4-ary heap time", QVariant(Router::DIJKSTRA_DARY_HEAP_TIME));
+	m_routerSelection->addItem("Dijkstra radix heap distance", QVariant(Router::DIJKSTRA_RADIX_HEAP_DISTANCE));
+	m_routerSelection->addItem("Dijkstra radix heap time", QVariant(Router::DIJKSTRA_RADIX_HEAP_TIME));
+	m_routerSelection->addItem("Bidirectional Dijkstra distance", QVariant(Router::BI_DIJKSTRA_DISTANCE));
+	m_routerSelection->addItem("Bidirectional Dijkstra time", QVariant(Router::BI_DIJKSTRA_TIME));
+	m_routerSelection->addItem("ALT distance", QVariant(Router::ALT_DISTANCE));
+	m_routerSelection->addItem("ALT time", QVariant(Router::ALT_TIME));
 	m_routerSelection->addItem("A* distance", QVariant(Router::A_STAR_DISTANCE));
 	m_routerSelection->addItem("A* time", QVariant(Router::A_STAR_TIME));
+	m_routerSelection->addItem("CH distance", QVariant(Router::CH_DISTANCE));
+	m_routerSelection->addItem("CH time", QVariant(Router::CH_TIME));
 	
 	m_accessType = new QComboBox(this);
 	m_accessType->addItem("Foot", Graph::Edge::AT_FOOT);
 	m_accessType->addItem("Bike", Graph::Edge::AT_BIKE);
 	m_accessType->addItem("Car", Graph::Edge::AT_CAR);
 	
+	m_reloadButton = new QPushButton("Reload graph", this);
+	
 	cfgLayout->addWidget(m_routerSelection);
 	cfgLayout->addWidget(m_accessType);
+	cfgLayout->addWidget(m_reloadButton);
 	
 	QWidget * cfgWidget = new QWidget(this);
 	cfgWidget->setLayout(cfgLayout);
@@ -191,6 +257,9 @@ m_br(this, state)
 	
 	connect(m_routerSelection, SIGNAL(currentIndexChanged(int)), this, SLOT(routerConfigChanged()));
 	connect(m_accessType, SIGNAL(currentIndexChanged(int)), this, SLOT(routerConfigChanged()));
+	connect(m_reloadButton, SIGNAL(clicked()), this, SLOT(reloadState()));
+	//stateLoadFinished is emitted by the reload thread, hence the connection is queued
+	connect(this, SIGNAL(stateLoadFinished()), this, SLOT(stateLoaded()), Qt::QueuedConnection);
 	
 	//connect background router
 	connect(&m_br, SIGNAL(routeCalculated(Graph::Route,double)), this, SLOT(routeCalculated(Graph::Route,double)));
@@ -212,7 +281,9 @@ m_br(this, state)
 	
 }
 
-MainWindow::~MainWindow() {}
+MainWindow::~MainWindow() {
+	m_reloadPool.waitForDone();
+}
 
 void MainWindow::calculateRoute(double latSrc, double lonSrc, double latTgt, double lonTgt) {
 	int algoSelection = m_routerSelection->currentIndex();
@@ -222,19 +293,9 @@ void MainWindow::calculateRoute(double latSrc, double lonSrc, double latTgt, dou
 		return;
 	}
 
-	uint32_t srcNode = m_state->grid.closest(latSrc, lonSrc);
-	uint32_t tgtNode = m_state->grid.closest(latTgt, lonTgt);
-
-	if (srcNode == std::numeric_limits<uint32_t>::max() || tgtNode == std::numeric_limits<uint32_t>::max()) {
-		QMessageBox msgBox;
-		msgBox.setText("Either source or target node could not be found");
-		msgBox.exec();
-	}
-	else {
-		algoSelection = m_routerSelection->itemData(algoSelection).toInt();
-		accessSelection = m_accessType->itemData(accessSelection).toInt();
-		m_br.route(srcNode, tgtNode, algoSelection, accessSelection); //will emit routeCalculated when done
-	}
+	algoSelection = m_routerSelection->itemData(algoSelection).toInt();
+	accessSelection = m_accessType->itemData(accessSelection).toInt();
+	m_br.route(latSrc, lonSrc, latTgt, lonTgt, algoSelection, accessSelection); //will emit routeCalculated when done
 }
 
 void MainWindow::routeCalculated(const Graph::Route& route, double duration) {
@@ -248,14 +309,16 @@ void MainWindow::routeCalculated(const Graph::Route& route, double duration) {
 }
 
 void MainWindow::clearShownNodes() {
-	MultiReaderSingleWriterLocker lck(m_state->enabledNodesLock, MultiReaderSingleWriterLocker::WRITE_LOCK);
-	m_state->enabledNodes.clear();
+	StatePtr state = m_states->current();
+	MultiReaderSingleWriterLocker lck(state->enabledNodesLock, MultiReaderSingleWriterLocker::WRITE_LOCK);
+	state->enabledNodes.clear();
 	emit shownNodesChanged();
 }
 
 void MainWindow::clearShownEdges() {
-	MultiReaderSingleWriterLocker lck(m_state->enabledEdgesLock, MultiReaderSingleWriterLocker::WRITE_LOCK);
-	m_state->enabledEdges.clear();
+	StatePtr state = m_states->current();
+	MultiReaderSingleWriterLocker lck(state->enabledEdgesLock, MultiReaderSingleWriterLocker::WRITE_LOCK);
+	state->enabledEdges.clear();
 	emit shownEdgesChanged();
 }
 
@@ -264,28 +327,30 @@ void MainWindow::scrollToNode(uint32_t nodeId) {
 }
 
 void MainWindow::scrollToNodeEdges(uint32_t nodeId) {
-	const Graph::Node & n = m_state->graph.node(nodeId);
+	const Graph::Node & n = m_states->current()->graph.node(nodeId);
 	m_edgesTableView->scrollTo(m_edgesTableModel->index(n.begin, 0));
 }
 
 void MainWindow::toggleNode(uint32_t nodeId) {
-	MultiReaderSingleWriterLocker lck(m_state->enabledNodesLock, MultiReaderSingleWriterLocker::WRITE_LOCK);
-	if (m_state->enabledNodes.count(nodeId)) {
-		m_state->enabledNodes.erase(nodeId);
+	StatePtr state = m_states->current();
+	MultiReaderSingleWriterLocker lck(state->enabledNodesLock, MultiReaderSingleWriterLocker::WRITE_LOCK);
+	if (state->enabledNodes.count(nodeId)) {
+		state->enabledNodes.erase(nodeId);
 	}
 	else {
-		m_state->enabledNodes.insert(nodeId);
+		state->enabledNodes.insert(nodeId);
 	}
 	emit shownNodesChanged();
 }
 
 void MainWindow::toggleEdge(uint32_t edgeId) {
-	MultiReaderSingleWriterLocker lck(m_state->enabledEdgesLock, MultiReaderSingleWriterLocker::WRITE_LOCK);
-	if (m_state->enabledEdges.count(edgeId)) {
-		m_state->enabledEdges.erase(edgeId);
+	StatePtr state = m_states->current();
+	MultiReaderSingleWriterLocker lck(state->enabledEdgesLock, MultiReaderSingleWriterLocker::WRITE_LOCK);
+	if (state->enabledEdges.count(edgeId)) {
+		state->enabledEdges.erase(edgeId);
 	}
 	else {
-		m_state->enabledEdges.insert(edgeId);
+		state->enabledEdges.insert(edgeId);
 	}
 	emit shownEdgesChanged();
 }
@@ -304,4 +369,50 @@ void MainWindow::routerConfigChanged() {
 	m_br.reroute(algoSelection, accessSelection);
 }
 
+void MainWindow::reloadState() {
+	if (m_reloading) {
+		return;
+	}
+	m_reloading = true;
+	m_reloadButton->setEnabled(false);
+	m_reloadPool.start(new StateLoadJob(this, m_states->current()->config));
+}
+
+void MainWindow::loadState(const Config & cfg) {
+	StatePtr state;
+	try {
+		state.reset(new State(cfg));
+	}
+	catch (const std::exception & e) {
+		std::cout << "Could not reload " << cfg.graphFileName << ": " << e.what() << std::endl;
+	}
+	{
+		std::lock_guard<std::mutex> lck(m_loadedStateMutex);
+		m_loadedState = state;
+	}
+	emit stateLoadFinished();
+}
+
+void MainWindow::stateLoaded() {
+	StatePtr state;
+	{
+		std::lock_guard<std::mutex> lck(m_loadedStateMutex);
+		state.swap(m_loadedState);
+	}
+	m_reloading = false;
+	m_reloadButton->setEnabled(true);
+	if (!state) {
+		return;
+	}
+	//node and edge ids of the previous state are meaningless now.
+	//The previous state is freed as soon as running routes and the map have dropped their snapshots
+	m_states->replace(state);
+	emit shownNodesChanged();
+	emit shownEdgesChanged();
+	std::cout << "Replaced the graph with " << state->graph.nodeCount() << " nodes and " << state->graph.edgeCount() << " edges" << std::endl;
+	//the route of the last request is calculated again on the new state, the running one is cancelled.
+	//The map shows the previous route until then
+	routerConfigChanged();
+}
+
 }//end namespace
@@ -1,12 +1,15 @@
 #ifndef SIMPLE_ROUTE_MAIN_WINDOW_H
 #define SIMPLE_ROUTE_MAIN_WINDOW_H
 #include <QMainWindow>
+#include <QThreadPool>
 #include <memory>
+#include <mutex>
 #include "State.h"
 
 class QTableView;
 class QComboBox;
 class QLabel;
+class QPushButton;
 
 namespace simpleroute {
 
@@ -18,20 +21,43 @@ class GraphEdgesTableModel;
 
 namespace detail {
 
+///Calculates routes on a thread pool, route() returns immediately.
+///A new request cancels the running one, only the result of the latest request is delivered by routeCalculated.
+///All slots have to be called from the thread the BackgroundRouter lives in
 class BackgroundRouter: public QObject {
 	Q_OBJECT
 public:
-	BackgroundRouter(QObject * parent, const StatePtr & state);
+	///routes are calculated on the state that is current when the calculation starts
+	BackgroundRouter(QObject * parent, const StateHolderPtr & states);
+	///cancels the running request and waits for the pool
 	~BackgroundRouter();
 public slots:
 	void reroute(int rt, int accessType);
-	void route(uint32_t srcNode, uint32_t tgtNode, int rt, int accessType);
+	///the route starts and ends at the closest edges the access type may use, see Grid::closestEdge
+	void route(double latSrc, double lonSrc, double latTgt, double lonTgt, int rt, int accessType);
+	///cancels the running request, nothing is delivered for it
+	void cancel();
 signals:
 	void routeCalculated(const Graph::Route & route, double duration);
+	///emitted by the pool threads, delivered queued to deliverRoute
+	void routeFinished(const Graph::Route & route, double duration, quint64 requestId);
+private slots:
+	void deliverRoute(const Graph::Route & route, double duration, quint64 requestId);
 private:
-	StatePtr m_state;
-	uint32_t m_srcNode;
-	uint32_t m_tgtNode;
+	friend class RouteJob;
+	void calculate(double latSrc, double lonSrc, double latTgt, double lonTgt, int rt, int accessType, quint64 requestId, const CancellationTokenPtr & ct);
+private:
+	StateHolderPtr m_states;
+	///coordinates of the last request, they are snapped again on reroute since the edges depend on the access type
+	bool m_hasRequest;
+	double m_latSrc;
+	double m_lonSrc;
+	double m_latTgt;
+	double m_lonTgt;
+	QThreadPool m_pool;
+	///id of the latest request, results of older requests are dropped
+	quint64 m_requestId;
+	CancellationTokenPtr m_cancellationToken;
 };
 
 }//end namespace detail
@@ -39,14 +65,20 @@ private:
 class MainWindow: public QMainWindow {
 	Q_OBJECT
 public:
-	MainWindow(const StatePtr & state);
+	MainWindow(const StateHolderPtr & states);
+	///waits for a running reload
 	virtual ~MainWindow();
 public slots:
 	void calculateRoute(double latSrc, double lonSrc, double latTgt, double lonTgt);
+	///loads the graph file of the current state again on a background thread and replaces the state once it is loaded.
+	///Routing and the map keep using the current state in the meantime, nothing happens if a reload is running
+	void reloadState();
 signals:
 	void routeCalculated(const Graph::Route & route);
 	void shownEdgesChanged();
 	void shownNodesChanged();
+	///emitted by the reload thread, delivered queued to stateLoaded
+	void stateLoadFinished();
 private Q_SLOTS:
 	void routeCalculated(const Graph::Route & route, double duration);
 	void scrollToNodeEdges(uint32_t nodeId);
@@ -56,9 +88,18 @@ private Q_SLOTS:
 	void clearShownNodes();
 	void clearShownEdges();
 	void routerConfigChanged();
+	void stateLoaded();
+private:
+	friend class StateLoadJob;
+	void loadState(const Config & cfg);
 private://data stuff
-	StatePtr m_state;
+	StateHolderPtr m_states;
 	detail::BackgroundRouter m_br;
+	QThreadPool m_reloadPool;
+	bool m_reloading;
+	///the state created by the reload thread, null if loading failed
+	StatePtr m_loadedState;
+	std::mutex m_loadedStateMutex;
 private://gui stuff
 	MarbleMap * m_map;
 	
@@ -72,6 +113,7 @@ private://gui stuff
 	QComboBox * m_accessType;
 	
 	QLabel * m_statsLabel;
+	QPushButton * m_reloadButton;
 };
 
 };
@@ -1,15 +1,25 @@
 #include "MarbleMap.h"
+#include "SimplifiedPolyline.h"
 #include <marble/GeoPainter.h>
 #include <marble/MarbleWidgetPopupMenu.h>
 #include <marble/MarbleWidgetInputHandler.h>
+#include <marble/ViewportParams.h>
+#include <marble/GeoDataLatLonAltBox.h>
 #include <QAction>
+#include <QVector>
+#include <QLineF>
+#include <QPointF>
+#include <QRunnable>
+#include <limits>
+#include <cmath>
+#include <algorithm>
 
 namespace simpleroute {
 
-MarbleMap::MyBaseLayer::MyBaseLayer(const QStringList& renderPos, qreal zVal, const StatePtr& state) :
+MarbleMap::MyBaseLayer::MyBaseLayer(const QStringList& renderPos, qreal zVal, const StateHolderPtr& states) :
 m_zValue(zVal),
 m_renderPosition(renderPos),
-m_state(state)
+m_states(states)
 {}
 
 QStringList MarbleMap::MyBaseLayer::renderPosition() const {
@@ -20,87 +30,320 @@ qreal MarbleMap::MyBaseLayer::zValue() const {
     return m_zValue;
 }
 
-MarbleMap::MyNodesLayer::MyNodesLayer(const QStringList& renderPos, qreal zVal, const StatePtr& state):
-MyLockableBaseLayer(renderPos, zVal, state)
+MarbleMap::ViewportIndex::ViewportIndex() :
+m_minLat(0.0),
+m_maxLat(0.0),
+m_minLon(0.0),
+m_maxLon(0.0),
+m_extentLat(0.0),
+m_extentLon(0.0),
+m_latCount(1),
+m_lonCount(1),
+m_binBegin(2, 0)
 {}
 
-bool MarbleMap::MyNodesLayer::render(Marble::GeoPainter* painter, Marble::ViewportParams*, const QString&, Marble::GeoSceneLayer*) {
-	MultiReaderSingleWriterLocker lck(lock(), MultiReaderSingleWriterLocker::READ_LOCK);
-	MultiReaderSingleWriterLocker nodeLock(state()->enabledNodesLock, MultiReaderSingleWriterLocker::READ_LOCK);
+void MarbleMap::ViewportIndex::create(std::vector<Item> && items, double extentLat, double extentLon) {
+	m_items = std::move(items);
+	m_extentLat = extentLat;
+	m_extentLon = extentLon;
+	m_minLat = m_minLon = std::numeric_limits<double>::max();
+	m_maxLat = m_maxLon = -std::numeric_limits<double>::max();
+	for(const Item & item : m_items) {
+		m_minLat = std::min(m_minLat, item.lat);
+		m_maxLat = std::max(m_maxLat, item.lat);
+		m_minLon = std::min(m_minLon, item.lon);
+		m_maxLon = std::max(m_maxLon, item.lon);
+	}
+	//about 8 items per bin, the bins are square in degrees
+	double height = std::max(m_maxLat-m_minLat, 1e-6);
+	double width = std::max(m_maxLon-m_minLon, 1e-6);
+	double binCount = std::max<double>(1.0, m_items.size()/8);
+	m_latCount = std::max(1.0, std::min(::round(::sqrt(binCount*height/width)), binCount));
+	m_lonCount = std::max(1.0, ::round(binCount/m_latCount));
 	
-	painter->setPen(Qt::green);
-	painter->setBrush(Qt::BrushStyle::SolidPattern);
+	//counting sort by bin
+	std::vector<uint32_t> itemBins(m_items.size());
+	m_binBegin.assign(m_latCount*m_lonCount+1, 0);
+	for(uint32_t i(0), s(m_items.size()); i < s; ++i) {
+		itemBins[i] = latBin(m_items[i].lat)*m_lonCount + lonBin(m_items[i].lon);
+		++m_binBegin[itemBins[i]+1];
+	}
+	for(uint32_t bin(0), s(m_latCount*m_lonCount); bin < s; ++bin) {
+		m_binBegin[bin+1] += m_binBegin[bin];
+	}
+	std::vector<Item> sortedItems(m_items.size());
+	std::vector<uint32_t> pos(m_binBegin.begin(), m_binBegin.end()-1);
+	for(uint32_t i(0), s(m_items.size()); i < s; ++i) {
+		sortedItems[pos[itemBins[i]]++] = m_items[i];
+	}
+	m_items = std::move(sortedItems);
+}
+
+uint32_t MarbleMap::ViewportIndex::latBin(double lat) const {
+	if (lat <= m_minLat) {
+		return 0;
+	}
+	return std::min<double>(m_latCount-1, ((lat-m_minLat)*m_latCount)/std::max(m_maxLat-m_minLat, 1e-6));
+}
+
+uint32_t MarbleMap::ViewportIndex::lonBin(double lon) const {
+	if (lon <= m_minLon) {
+		return 0;
+	}
+	return std::min<double>(m_lonCount-1, ((lon-m_minLon)*m_lonCount)/std::max(m_maxLon-m_minLon, 1e-6));
+}
+
+namespace {
+
+///The visible box of the map and cells of about the size of a pixel in it
+class ViewportCells {
+public:
+	ViewportCells(const Marble::ViewportParams * viewport) :
+	m_viewport(viewport)
+	{
+		const Marble::GeoDataLatLonAltBox & box = viewport->viewLatLonAltBox();
+		south = box.south(Marble::GeoDataCoordinates::Degree);
+		north = box.north(Marble::GeoDataCoordinates::Degree);
+		if (box.crossesDateLine()) {
+			west = -180.0;
+			east = 180.0;
+		}
+		else {
+			west = box.west(Marble::GeoDataCoordinates::Degree);
+			east = box.east(Marble::GeoDataCoordinates::Degree);
+		}
+		m_resolution = std::max(viewport->angularResolution()*RAD2DEG, 1e-9);
+	}
+	bool intersects(double minLat, double maxLat, double minLon, double maxLon) const {
+		return minLat <= north && maxLat >= south && minLon <= east && maxLon >= west;
+	}
+	///cells of coordinates far outside of the box are clamped, the cells of the box are exact
+	uint32_t cell(double lat, double lon) const {
+		return (axisCell(lat-south) << 16) | axisCell(lon-west);
+	}
+	///degrees per pixel
+	inline double resolution() const { return m_resolution; }
+	bool project(double lat, double lon, QPointF & p) const {
+		qreal x, y;
+		if (!m_viewport->screenCoordinates(lon*DEG2RAD, lat*DEG2RAD, x, y)) {
+			return false;
+		}
+		p = QPointF(x, y);
+		return true;
+	}
+public:
+	double south;
+	double north;
+	double west;
+	double east;
+private:
+	static constexpr double DEG2RAD = M_PI/180.0;
+	static constexpr double RAD2DEG = 180.0/M_PI;
+	uint32_t axisCell(double offset) const {
+		return std::max(0.0, std::min(65535.0, offset/m_resolution + 16384.0));
+	}
+private:
+	const Marble::ViewportParams * m_viewport;
+	///degrees per pixel
+	double m_resolution;
+};
+
+///labels are only drawn if there are at most this many nodes on the screen
+static constexpr int max_node_labels = 1000;
 
-	for(uint32_t nodeId : state()->enabledNodes) {
-		const Graph::NodeInfo & ni = state()->graph.nodeInfo(nodeId);
-		Marble::GeoDataCoordinates gp(ni.lon, ni.lat, 0.0, Marble::GeoDataCoordinates::Degree);
-		painter->drawEllipse(gp, 10, 10);
-		painter->drawText(gp, QString::number(nodeId));
+}//end namespace
+
+MarbleMap::MyNodesLayer::MyNodesLayer(const QStringList& renderPos, qreal zVal, const StateHolderPtr& states):
+MyLockableBaseLayer(renderPos, zVal, states),
+m_dirty(true)
+{}
+
+void MarbleMap::MyNodesLayer::invalidate() {
+	MultiReaderSingleWriterLocker lck(lock(), MultiReaderSingleWriterLocker::WRITE_LOCK);
+	m_dirty = true;
+}
+
+void MarbleMap::MyNodesLayer::updateIndex(const StatePtr & state) {
+	MultiReaderSingleWriterLocker nodeLock(state->enabledNodesLock, MultiReaderSingleWriterLocker::READ_LOCK);
+	std::vector<ViewportIndex::Item> items;
+	items.reserve(state->enabledNodes.size());
+	for(uint32_t nodeId : state->enabledNodes) {
+		const Graph::NodeInfo & ni = state->graph.nodeInfo(nodeId);
+		items.push_back(ViewportIndex::Item{ni.lat, ni.lon, nodeId});
+	}
+	m_index.create(std::move(items), 0.0, 0.0);
+	m_indexState = state;
+	m_dirty = false;
+}
+
+bool MarbleMap::MyNodesLayer::render(Marble::GeoPainter* painter, Marble::ViewportParams* viewport, const QString&, Marble::GeoSceneLayer*) {
+	//the index is updated by the render thread
+	MultiReaderSingleWriterLocker lck(lock(), MultiReaderSingleWriterLocker::WRITE_LOCK);
+	StatePtr s = state();
+	if (m_dirty || s != m_indexState) {
+		updateIndex(s);
+	}
+	
+	ViewportCells vc(viewport);
+	std::unordered_set<uint32_t> usedCells;
+	QVector<QPointF> points;
+	std::vector<uint32_t> pointNodes;
+	m_index.visit(vc.south, vc.north, vc.west, vc.east, [&](uint32_t nodeId) {
+		const Graph::NodeInfo & ni = s->graph.nodeInfo(nodeId);
+		QPointF p;
+		if (vc.intersects(ni.lat, ni.lat, ni.lon, ni.lon) && usedCells.insert(vc.cell(ni.lat, ni.lon)).second && vc.project(ni.lat, ni.lon, p)) {
+			points.push_back(p);
+			pointNodes.push_back(nodeId);
+		}
+	});
+	
+	//GeoPainter hides the screen coordinate overloads of QPainter
+	QPainter * qpainter = painter;
+	qpainter->setPen(Qt::green);
+	qpainter->setBrush(Qt::BrushStyle::SolidPattern);
+	for(const QPointF & p : points) {
+		qpainter->drawEllipse(p, 5, 5);
+	}
+	if (points.size() <= max_node_labels) {
+		for(int i(0); i < points.size(); ++i) {
+			qpainter->drawText(points[i], QString::number(pointNodes[i]));
+		}
 	}
 	return true;
 }
 
 
-MarbleMap::MyEdgesLayer::MyEdgesLayer(const QStringList& renderPos, qreal zVal, const StatePtr& state) :
-MyLockableBaseLayer(renderPos, zVal, state)
+MarbleMap::MyEdgesLayer::MyEdgesLayer(const QStringList& renderPos, qreal zVal, const StateHolderPtr& states) :
+MyLockableBaseLayer(renderPos, zVal, states),
+m_dirty(true)
 {}
 
-bool MarbleMap::MyEdgesLayer::render(Marble::GeoPainter* painter, Marble::ViewportParams* /*viewport*/, const QString& /*renderPos*/, Marble::GeoSceneLayer* /*layer*/) {
-	MultiReaderSingleWriterLocker lck(lock(), MultiReaderSingleWriterLocker::READ_LOCK);
-	MultiReaderSingleWriterLocker edgeLock(state()->enabledEdgesLock, MultiReaderSingleWriterLocker::READ_LOCK);
-	painter->setPen(QPen(QBrush(Qt::red, Qt::BrushStyle::SolidPattern), 3));
-	painter->setBrush(Qt::BrushStyle::SolidPattern);
-	Marble::GeoDataLineString l;
-	for(uint32_t edgeId : state()->enabledEdges) {
-		l.clear();
-		const Graph::Edge & e = state()->graph.edge(edgeId);
-		const Graph::NodeInfo & srcNi = state()->graph.nodeInfo(e.source);
-		const Graph::NodeInfo & tgtNi = state()->graph.nodeInfo(e.target);
-		
-		l.append(Marble::GeoDataCoordinates(srcNi.lon, srcNi.lat, 0.0, Marble::GeoDataCoordinates::Degree));
-		l.append(Marble::GeoDataCoordinates(tgtNi.lon, tgtNi.lat, 0.0, Marble::GeoDataCoordinates::Degree));
-		painter->drawPolyline(l);
+void MarbleMap::MyEdgesLayer::invalidate() {
+	MultiReaderSingleWriterLocker lck(lock(), MultiReaderSingleWriterLocker::WRITE_LOCK);
+	m_dirty = true;
+}
+
+void MarbleMap::MyEdgesLayer::updateIndex(const StatePtr & state) {
+	MultiReaderSingleWriterLocker edgeLock(state->enabledEdgesLock, MultiReaderSingleWriterLocker::READ_LOCK);
+	const Graph & g = state->graph;
+	std::vector<ViewportIndex::Item> items;
+	items.reserve(state->enabledEdges.size());
+	//edges are indexed by their midpoint
+	double extentLat = 0.0;
+	double extentLon = 0.0;
+	for(uint32_t edgeId : state->enabledEdges) {
+		const Graph::Edge & e = g.edge(edgeId);
+		const Graph::NodeInfo & srcNi = g.nodeInfo(e.source);
+		const Graph::NodeInfo & tgtNi = g.nodeInfo(e.target);
+		items.push_back(ViewportIndex::Item{(srcNi.lat+tgtNi.lat)/2.0, (srcNi.lon+tgtNi.lon)/2.0, edgeId});
+		extentLat = std::max(extentLat, ::fabs(srcNi.lat-tgtNi.lat)/2.0);
+		extentLon = std::max(extentLon, ::fabs(srcNi.lon-tgtNi.lon)/2.0);
 	}
+	m_index.create(std::move(items), extentLat, extentLon);
+	m_indexState = state;
+	m_dirty = false;
+}
+
+bool MarbleMap::MyEdgesLayer::render(Marble::GeoPainter* painter, Marble::ViewportParams* viewport, const QString& /*renderPos*/, Marble::GeoSceneLayer* /*layer*/) {
+	//the index is updated by the render thread
+	MultiReaderSingleWriterLocker lck(lock(), MultiReaderSingleWriterLocker::WRITE_LOCK);
+	StatePtr s = state();
+	if (m_dirty || s != m_indexState) {
+		updateIndex(s);
+	}
+	
+	//edges with the same cells are drawn once, edges within a single cell become points
+	ViewportCells vc(viewport);
+	std::unordered_set<uint64_t> usedSegments;
+	std::unordered_set<uint32_t> usedCells;
+	QVector<QLineF> lines;
+	QVector<QPointF> points;
+	const Graph & g = s->graph;
+	m_index.visit(vc.south, vc.north, vc.west, vc.east, [&](uint32_t edgeId) {
+		const Graph::Edge & e = g.edge(edgeId);
+		const Graph::NodeInfo & srcNi = g.nodeInfo(e.source);
+		const Graph::NodeInfo & tgtNi = g.nodeInfo(e.target);
+		if (!vc.intersects(std::min(srcNi.lat, tgtNi.lat), std::max(srcNi.lat, tgtNi.lat), std::min(srcNi.lon, tgtNi.lon), std::max(srcNi.lon, tgtNi.lon))) {
+			return;
+		}
+		uint32_t srcCell = vc.cell(srcNi.lat, srcNi.lon);
+		uint32_t tgtCell = vc.cell(tgtNi.lat, tgtNi.lon);
+		QPointF srcP, tgtP;
+		if (srcCell == tgtCell) {
+			if (usedCells.insert(srcCell).second && vc.project(srcNi.lat, srcNi.lon, srcP)) {
+				points.push_back(srcP);
+			}
+		}
+		else if (usedSegments.insert((uint64_t(std::min(srcCell, tgtCell)) << 32) | std::max(srcCell, tgtCell)).second &&
+				vc.project(srcNi.lat, srcNi.lon, srcP) && vc.project(tgtNi.lat, tgtNi.lon, tgtP))
+		{
+			lines.push_back(QLineF(srcP, tgtP));
+		}
+	});
+	
+	//all edges in a single call, GeoPainter hides the screen coordinate overloads of QPainter
+	QPainter * qpainter = painter;
+	qpainter->setPen(QPen(QBrush(Qt::red, Qt::BrushStyle::SolidPattern), 3));
+	qpainter->setBrush(Qt::BrushStyle::SolidPattern);
+	qpainter->drawLines(lines);
+	qpainter->drawPoints(points.data(), points.size());
 	return true;
 }
 
 
-MarbleMap::MyRouteLayer::MyRouteLayer(const QStringList& renderPos, qreal zVal, const StatePtr& state) :
-MyLockableBaseLayer(renderPos, zVal, state),
+MarbleMap::MyRouteLayer::MyRouteLayer(const QStringList& renderPos, qreal zVal, const StateHolderPtr& states) :
+MyLockableBaseLayer(renderPos, zVal, states),
+m_routeId(0),
 m_startNodeId(0xFFFFFFFF),
 m_endNodeId(0xFFFFFFFF)
 {}
 
-void MarbleMap::MyRouteLayer::setRoute(const Graph::Route & route) {
+uint64_t MarbleMap::MyRouteLayer::setRoute(const Graph::Route & route) {
 	MultiReaderSingleWriterLocker lck(lock(), MultiReaderSingleWriterLocker::WRITE_LOCK);
-	m_route.clear();
-	for(uint32_t nodeRef : route.nodes) {
-		const Graph::NodeInfo & ni = state()->graph.nodeInfo(nodeRef);
-		m_route.append(Marble::GeoDataCoordinates(ni.lon, ni.lat, 0.0, Marble::GeoDataCoordinates::Degree));
-	}
-	if (m_route.size() >= 2) {
+	m_routeLevels.clear();
+	m_simplifiedRoute = SimplifiedPolyline();
+	++m_routeId;
+	if (route.nodes.size() >= 2) {
 		m_startNodeId = route.nodes.front();
 		m_endNodeId = route.nodes.back();
 	}
+	return m_routeId;
+}
+
+bool MarbleMap::MyRouteLayer::setLevels(uint64_t routeId, std::vector<Marble::GeoDataLineString> && levels, SimplifiedPolyline && simplifiedRoute) {
+	MultiReaderSingleWriterLocker lck(lock(), MultiReaderSingleWriterLocker::WRITE_LOCK);
+	if (routeId != m_routeId) {
+		return false;
+	}
+	m_routeLevels = std::move(levels);
+	m_simplifiedRoute = std::move(simplifiedRoute);
+	return true;
 }
 
 void MarbleMap::MyRouteLayer::clear() {
 	MultiReaderSingleWriterLocker lck(lock(), MultiReaderSingleWriterLocker::WRITE_LOCK);
-	m_route.clear();
+	m_routeLevels.clear();
+	m_simplifiedRoute = SimplifiedPolyline();
+	++m_routeId;
 	m_startNodeId = 0xFFFFFFFF;
 	m_endNodeId = 0xFFFFFFFF;
 }
 
-bool MarbleMap::MyRouteLayer::render(Marble::GeoPainter* painter, Marble::ViewportParams* /*viewport*/, const QString& /*renderPos*/, Marble::GeoSceneLayer* /*layer*/) {
+bool MarbleMap::MyRouteLayer::render(Marble::GeoPainter* painter, Marble::ViewportParams* viewport, const QString& /*renderPos*/, Marble::GeoSceneLayer* /*layer*/) {
 	MultiReaderSingleWriterLocker lck(lock(), MultiReaderSingleWriterLocker::READ_LOCK);
 	painter->setPen(QPen(QBrush(Qt::blue, Qt::BrushStyle::SolidPattern), 3));
 	painter->setBrush(Qt::BrushStyle::SolidPattern);
-	painter->drawPolyline(m_route);
-	if (m_route.size() >= 2) {
-		painter->drawEllipse(m_route.first(), 10, 10);
-		painter->drawText(m_route.first(), QString::number(m_startNodeId));
-		painter->drawEllipse(m_route.last(), 10, 10);
-		painter->drawText(m_route.last(), QString::number(m_endNodeId));
+	if (m_routeLevels.size()) {
+		//deviations of half a pixel are not visible
+		double tolerance = ViewportCells(viewport).resolution()/2.0;
+		const Marble::GeoDataLineString & route = m_routeLevels.at(m_simplifiedRoute.level(tolerance));
+		painter->drawPolyline(route);
+		if (route.size() >= 2) {
+			painter->drawEllipse(route.first(), 10, 10);
+			painter->drawText(route.first(), QString::number(m_startNodeId));
+			painter->drawEllipse(route.last(), 10, 10);
+			painter->drawText(route.last(), QString::number(m_endNodeId));
+		}
 	}
 	
 	painter->setPen(QPen(QBrush(Qt::yellow, Qt::BrushStyle::SolidPattern), 3));
@@ -112,6 +355,21 @@ bool MarbleMap::MyRouteLayer::render(Marble::GeoPainter* painter, Marble::Viewpo
 	return true;
 }
 
+class RouteSimplificationJob: public QRunnable {
+public:
+	RouteSimplificationJob(MarbleMap * map, const StatePtr & state, const std::vector<uint32_t> & nodes, uint64_t routeId) :
+	m_map(map), m_state(state), m_nodes(nodes), m_routeId(routeId)
+	{}
+	virtual void run() override {
+		m_map->simplifyRoute(m_state, m_nodes, m_routeId);
+	}
+private:
+	MarbleMap * m_map;
+	StatePtr m_state;
+	std::vector<uint32_t> m_nodes;
+	uint64_t m_routeId;
+};
+
 void MarbleMap::RouteInfo::clear() {
 	srcLat = srcLon = tgtLat = tgtLon = std::numeric_limits<double>::max();
 }
@@ -120,13 +378,13 @@ bool MarbleMap::RouteInfo::valid() const {
 	return (srcLat != std::numeric_limits<double>::max() && tgtLat != std::numeric_limits<double>::max());
 }
 
-MarbleMap::MarbleMap(QWidget * parent, const StatePtr& state) :
+MarbleMap::MarbleMap(QWidget * parent, const StateHolderPtr& states) :
 MarbleWidget(parent),
-m_state(state)
+m_states(states)
 {
-	m_routeLayer = new MyRouteLayer({"HOVERS_ABOVE_SURFACE"}, 0.0, state);
-	m_nodesLayer = new MyNodesLayer({"HOVERS_ABOVE_SURFACE"}, 0.0, state);
-	m_edgesLayer = new MyEdgesLayer({"HOVERS_ABOVE_SURFACE"}, 0.0, state);
+	m_routeLayer = new MyRouteLayer({"HOVERS_ABOVE_SURFACE"}, 0.0, states);
+	m_nodesLayer = new MyNodesLayer({"HOVERS_ABOVE_SURFACE"}, 0.0, states);
+	m_edgesLayer = new MyEdgesLayer({"HOVERS_ABOVE_SURFACE"}, 0.0, states);
 	
 	QAction * routeSrcME = new QAction("Set as origin for routing", this);
 	QAction * routeTgtME = new QAction("Set as destination for routing", this);
@@ -143,9 +401,12 @@ m_state(state)
 	
 	connect(routeSrcME, SIGNAL(triggered(bool)), this, SLOT(routeSourceSelected()));
 	connect(routeTgtME, SIGNAL(triggered(bool)), this, SLOT(routeTargetSelected()));
+	//routeSimplified is emitted by the pool threads, hence the connection is queued
+	connect(this, SIGNAL(routeSimplified()), this, SLOT(update()), Qt::QueuedConnection);
 }
 
 MarbleMap::~MarbleMap() {
+	m_pool.waitForDone();
 	removeLayer(m_routeLayer);
 	removeLayer(m_nodesLayer);
 	removeLayer(m_edgesLayer);
@@ -155,10 +416,12 @@ MarbleMap::~MarbleMap() {
 }
 
 void MarbleMap::shownNodesChanged() {
+	m_nodesLayer->invalidate();
 	this->update();
 }
 
 void MarbleMap::shownEdgesChanged() {
+	m_edgesLayer->invalidate();
 	this->update();
 }
 
@@ -168,7 +431,7 @@ void MarbleMap::clearRoute() {
 }
 
 void MarbleMap::zoomToNode(uint32_t nodeId) {
-	const Graph::NodeInfo & ni = m_state->graph.nodeInfo(nodeId);
+	const Graph::NodeInfo & ni = m_states->current()->graph.nodeInfo(nodeId);
 	Marble::GeoDataCoordinates geo(ni.lon, ni.lat, 100.0, Marble::GeoDataCoordinates::Degree);
 	centerOn(geo);
 	setZoom(100000);
@@ -199,9 +462,31 @@ void MarbleMap::routeTargetSelected() {
 }
 
 void MarbleMap::displayRoute(const Graph::Route & route) {
-	m_routeLayer->setRoute(route);
+	uint64_t routeId = m_routeLayer->setRoute(route);
+	//the route was calculated on the current state, see MainWindow::stateLoaded
+	m_pool.start(new RouteSimplificationJob(this, m_states->current(), route.nodes, routeId));
 	this->update();
 }
 
+void MarbleMap::simplifyRoute(const StatePtr & state, const std::vector<uint32_t> & nodes, uint64_t routeId) {
+	std::vector<SimplifiedPolyline::Point> points;
+	points.reserve(nodes.size());
+	for(uint32_t nodeRef : nodes) {
+		const Graph::NodeInfo & ni = state->graph.nodeInfo(nodeRef);
+		points.push_back(SimplifiedPolyline::Point{ni.lat, ni.lon});
+	}
+	SimplifiedPolyline sp(std::move(points));
+	std::vector<Marble::GeoDataLineString> levels(sp.levelCount());
+	for(uint32_t level(0); level < sp.levelCount(); ++level) {
+		for(uint32_t i : sp.levelPoints(level)) {
+			const SimplifiedPolyline::Point & p = sp.points()[i];
+			levels[level].append(Marble::GeoDataCoordinates(p.lon, p.lat, 0.0, Marble::GeoDataCoordinates::Degree));
+		}
+	}
+	if (m_routeLayer->setLevels(routeId, std::move(levels), std::move(sp))) {
+		emit routeSimplified();
+	}
+}
+
 
 }//end namespace simpleroute
\ No newline at end of file
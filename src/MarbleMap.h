@@ -3,9 +3,12 @@
 #include <marble/MarbleWidget.h>
 #include <marble/LayerInterface.h>
 #include <marble/GeoDataLineString.h>
+#include <QThreadPool>
 #include <unordered_set>
+#include <vector>
 #include "State.h"
 #include "MultiReaderSingleWriterLock.h"
+#include "SimplifiedPolyline.h"
 
 namespace simpleroute {
 
@@ -17,11 +20,12 @@ private:
 	private:
 		qreal m_zValue;
 		QStringList m_renderPosition;
-		StatePtr m_state;
+		StateHolderPtr m_states;
 	protected:
-		const StatePtr & state() const { return m_state; }
+		///snapshot of the current state
+		StatePtr state() const { return m_states->current(); }
 	public:
-		MyBaseLayer(const QStringList & renderPos, qreal zVal, const StatePtr & state);
+		MyBaseLayer(const QStringList & renderPos, qreal zVal, const StateHolderPtr & states);
 		virtual ~MyBaseLayer() {}
 		virtual QStringList renderPosition() const;
 		virtual qreal zValue() const;
@@ -33,40 +37,118 @@ private:
 	protected:
 		inline MultiReaderSingleWriterLock & lock() { return m_lock;}
 	public:
-		MyLockableBaseLayer(const QStringList & renderPos, qreal zVal, const StatePtr & state) :
-		MyBaseLayer(renderPos, zVal, state) {}
+		MyLockableBaseLayer(const QStringList & renderPos, qreal zVal, const StateHolderPtr & states) :
+		MyBaseLayer(renderPos, zVal, states) {}
 		virtual ~MyLockableBaseLayer() {}
 	};
 	
+	///The route is drawn at the level of its simplification that matches the zoom, see SimplifiedPolyline.
+	///The levels are created by a job of the map after setRoute, the route is not drawn until they are set
 	class MyRouteLayer: public MyLockableBaseLayer {
 	private:
-		Marble::GeoDataLineString m_route;
+		std::vector<Marble::GeoDataLineString> m_routeLevels;
+		///selects the level to draw
+		SimplifiedPolyline m_simplifiedRoute;
+		///levels of other routes are dropped
+		uint64_t m_routeId;
 		uint32_t m_startNodeId;
 		uint32_t m_endNodeId;
 		Marble::GeoDataCoordinates m_startCoordinate;
 		Marble::GeoDataCoordinates m_endCoordinate;
 	public:
-		MyRouteLayer(const QStringList & renderPos, qreal zVal, const StatePtr & state);
+		MyRouteLayer(const QStringList & renderPos, qreal zVal, const StateHolderPtr & states);
 		virtual ~MyRouteLayer() {}
 		virtual bool render(Marble::GeoPainter *painter, Marble::ViewportParams * viewport, const QString & renderPos, Marble::GeoSceneLayer * layer);
-		void setRoute(const Graph::Route & route);
+		///returns the id of the route for setLevels
+		uint64_t setRoute(const Graph::Route & route);
+		///returns false if the route was replaced or cleared in the meantime
+		///levels holds a line string for every level of simplifiedRoute
+		bool setLevels(uint64_t routeId, std::vector<Marble::GeoDataLineString> && levels, SimplifiedPolyline && simplifiedRoute);
 		void setStartCoordinate(const Marble::GeoDataCoordinates & c) { m_startCoordinate = c; }
 		void setEndCoordinate(const Marble::GeoDataCoordinates & c) { m_endCoordinate = c; }
 		void clear();
 	};
 	
+	///Items binned by position to find those in the viewport.
+	///An item is found by every box that contains its position extended by the maximal extent of all items
+	class ViewportIndex {
+	public:
+		struct Item {
+			double lat;
+			double lon;
+			uint32_t id;
+		};
+	public:
+		ViewportIndex();
+		///extentLat and extentLon are the maximal distances in degrees of the geometry of an item from its position
+		void create(std::vector<Item> && items, double extentLat, double extentLon);
+		inline uint32_t size() const { return m_items.size(); }
+		///calls visitor(id) for all items whose bins intersect the box (in degrees)
+		template<typename T_VISITOR>
+		void visit(double south, double north, double west, double east, T_VISITOR visitor) const {
+			if (m_items.empty()) {
+				return;
+			}
+			uint32_t latBegin = latBin(south-m_extentLat), latEnd = latBin(north+m_extentLat);
+			uint32_t lonBegin = lonBin(west-m_extentLon), lonEnd = lonBin(east+m_extentLon);
+			for(uint32_t latPos(latBegin); latPos <= latEnd; ++latPos) {
+				for(uint32_t lonPos(lonBegin); lonPos <= lonEnd; ++lonPos) {
+					uint32_t bin = latPos*m_lonCount+lonPos;
+					for(uint32_t i(m_binBegin[bin]), end(m_binBegin[bin+1]); i < end; ++i) {
+						visitor(m_items[i].id);
+					}
+				}
+			}
+		}
+	private:
+		uint32_t latBin(double lat) const;
+		uint32_t lonBin(double lon) const;
+	private:
+		double m_minLat;
+		double m_maxLat;
+		double m_minLon;
+		double m_maxLon;
+		double m_extentLat;
+		double m_extentLon;
+		uint32_t m_latCount;
+		uint32_t m_lonCount;
+		///items of bin b are [m_binBegin[b], m_binBegin[b+1])
+		std::vector<uint32_t> m_binBegin;
+		std::vector<Item> m_items;
+	};
+	
+	///The layers index the enabled nodes (edges) on the next render after invalidate() or a replaced state and only draw those in the viewport.
+	///Items that fall into the same pixels are drawn once, hence the drawing work is bounded by the size of the viewport
 	class MyNodesLayer: public MyLockableBaseLayer {
+	private:
+		ViewportIndex m_index;
+		///the state of the indexed nodes
+		StatePtr m_indexState;
+		bool m_dirty;
+	private:
+		void updateIndex(const StatePtr & state);
 	public:
-		MyNodesLayer(const QStringList & renderPos, qreal zVal, const StatePtr & state);
+		MyNodesLayer(const QStringList & renderPos, qreal zVal, const StateHolderPtr & states);
 		virtual ~MyNodesLayer() {}
 		virtual bool render(Marble::GeoPainter *painter, Marble::ViewportParams * viewport, const QString & renderPos, Marble::GeoSceneLayer * layer);
+		///the enabled nodes changed
+		void invalidate();
 	};
 	
 	class MyEdgesLayer: public MyLockableBaseLayer {
+	private:
+		ViewportIndex m_index;
+		///the state of the indexed edges
+		StatePtr m_indexState;
+		bool m_dirty;
+	private:
+		void updateIndex(const StatePtr & state);
 	public:
-		MyEdgesLayer(const QStringList & renderPos, qreal zVal, const StatePtr & state);
+		MyEdgesLayer(const QStringList & renderPos, qreal zVal, const StateHolderPtr & states);
 		virtual ~MyEdgesLayer() {}
 		virtual bool render(Marble::GeoPainter *painter, Marble::ViewportParams * viewport, const QString & renderPos, Marble::GeoSceneLayer * layer);
+		///the enabled edges changed
+		void invalidate();
 	};
 	
 	struct RouteInfo {
@@ -80,15 +162,20 @@ private:
 	};
 	
 private:
-	StatePtr m_state;
+	friend class RouteSimplificationJob;
+	///simplifies the route off the gui thread, emits routeSimplified if the levels are still needed
+	void simplifyRoute(const StatePtr & state, const std::vector<uint32_t> & nodes, uint64_t routeId);
+private:
+	StateHolderPtr m_states;
 	MyRouteLayer * m_routeLayer;
 	MyNodesLayer * m_nodesLayer;
 	MyEdgesLayer * m_edgesLayer;
 	double m_lastMouseClickLat;
 	double m_lastMouseClickLon;
 	RouteInfo m_ri;
+	QThreadPool m_pool;
 public:
-	MarbleMap(QWidget * parent, const StatePtr & state);
+	MarbleMap(QWidget * parent, const StateHolderPtr & states);
 	virtual ~MarbleMap();
 public slots:
 	void displayRoute(const Graph::Route & route);
@@ -102,6 +189,8 @@ private slots:
 	void routeTargetSelected();
 signals:
 	void calculateRoute(double srcLat, double srcLon, double tgtLat, double tgtLon);
+	///emitted by the pool threads when the levels of the route are set
+	void routeSimplified();
 };
 
 
@@ -0,0 +1,223 @@
+#include "MatrixRouter.h"
+#include "Metric.h"
+#include "SearchWorkspace.h"
+#include "IndexedDaryHeap.h"
+#include "ParallelFor.h"
+#include <limits>
+
+namespace simpleroute {
+namespace {
+
+typedef SearchWorkspace<uint64_t> WeightWorkspace;
+typedef IndexedDaryHeap<uint64_t, 4> Border;
+
+static constexpr uint32_t npos = 0xFFFFFFFF;
+
+inline DistanceMatrix::WeightType saturate(uint64_t weight) {
+	return std::min<uint64_t>(weight, DistanceMatrix::infinite_weight-1);
+}
+
+///the heap of the calling thread, it keeps its storage between searches
+Border & threadLocalBorder(uint32_t idCount) {
+	static thread_local Border border;
+	border.resize(idCount);
+	return border;
+}
+
+struct BucketEntry {
+	uint32_t col;
+	uint64_t weight;
+	BucketEntry() : col(npos), weight(0) {}
+	BucketEntry(uint32_t col, uint64_t weight) : col(col), weight(weight) {}
+};
+
+struct NodeBucketEntry {
+	uint32_t nodeId;
+	BucketEntry entry;
+	NodeBucketEntry(uint32_t nodeId, uint32_t col, uint64_t weight) : nodeId(nodeId), entry(col, weight) {}
+};
+
+///Search in the upward graph of a contraction hierarchy with stall-on-demand, calls settled(nodeId, weight) for every settled node that is not stalled.
+///The forward search uses the up edges, the backward search traverses the down edges backwards
+template<typename T_SETTLED>
+void chUpwardSearch(const CHInfo & ch, uint32_t nodeCount, uint32_t startNode, bool backward, T_SETTLED settled) {
+	WeightWorkspace & weights = WeightWorkspace::threadLocal();
+	weights.reset(nodeCount);
+	Border & border = threadLocalBorder(nodeCount);
+	weights.emplace(startNode, 0);
+	border.push(startNode, 0);
+	while (!border.empty()) {
+		uint32_t curNodeId = border.top();
+		border.pop();
+		uint64_t curWeight = weights.at(curNodeId);
+
+		//same as in CHRouter::route
+		bool stalled = false;
+		for(CHInfo::ConstEdgeRefIterator it(backward ? ch.upEdgesBegin(curNodeId) : ch.downEdgesBegin(curNodeId)),
+			end(backward ? ch.upEdgesEnd(curNodeId) : ch.downEdgesEnd(curNodeId)); it != end && !stalled; ++it)
+		{
+			const CHInfo::CHEdge & e = ch.edge(*it);
+			uint32_t otherNodeId = (backward ? e.target : e.source);
+			stalled = (weights.count(otherNodeId) && weights.at(otherNodeId) + e.weight < curWeight);
+		}
+		if (stalled) {
+			continue;
+		}
+		settled(curNodeId, curWeight);
+
+		for(CHInfo::ConstEdgeRefIterator it(backward ? ch.downEdgesBegin(curNodeId) : ch.upEdgesBegin(curNodeId)),
+			end(backward ? ch.downEdgesEnd(curNodeId) : ch.upEdgesEnd(curNodeId)); it != end; ++it)
+		{
+			const CHInfo::CHEdge & e = ch.edge(*it);
+			uint32_t nextNodeId = (backward ? e.source : e.target);
+			uint64_t nw = curWeight + e.weight;
+			if (!weights.count(nextNodeId)) {
+				weights.emplace(nextNodeId, uint64_t(nw));
+				border.push(nextNodeId, nw);
+			}
+			else if (weights.at(nextNodeId) > nw && border.contains(nextNodeId)) {
+				weights.at(nextNodeId) = nw;
+				border.decreaseKey(nextNodeId, nw);
+			}
+		}
+	}
+}
+
+}//end namespace
+
+void DistanceMatrix::resize(uint32_t rowCount, uint32_t colCount) {
+	m_rowCount = rowCount;
+	m_colCount = colCount;
+	m_d.assign(uint64_t(rowCount)*colCount, infinite_weight);
+}
+
+namespace detail {
+
+DijkstraMatrixRouter::DijkstraMatrixRouter(const Graph * g, const Metric * metric) :
+MatrixRouter(g),
+m_metric(metric)
+{}
+
+void DijkstraMatrixRouter::calculate(const std::vector<uint32_t> & sources, const std::vector<uint32_t> & targets, DistanceMatrix & result) {
+	const Graph & g = graph();
+	const Metric & metric = *m_metric;
+	uint32_t nodeCount = g.nodeCount();
+	result.resize(sources.size(), targets.size());
+	if (!nodeCount || !targets.size()) {
+		return;
+	}
+
+	//the columns of a node as linked list, a node may be requested several times
+	std::vector<uint32_t> firstCol(nodeCount, npos);
+	std::vector<uint32_t> nextCol(targets.size(), npos);
+	uint32_t distinctTargetCount = 0;
+	for(uint32_t col(targets.size()); col > 0;) {
+		--col;
+		uint32_t nodeId = targets[col];
+		distinctTargetCount += (firstCol[nodeId] == npos ? 1 : 0);
+		nextCol[col] = firstCol[nodeId];
+		firstCol[nodeId] = col;
+	}
+
+	parallelFor(0, sources.size(), [&](uint32_t rowId, uint32_t) {
+		WeightWorkspace & weights = WeightWorkspace::threadLocal();
+		weights.reset(nodeCount);
+		Border & border = threadLocalBorder(nodeCount);
+		DistanceMatrix::WeightType * row = result.row(rowId);
+		uint32_t remainingTargets = distinctTargetCount;
+
+		weights.emplace(sources[rowId], 0);
+		border.push(sources[rowId], 0);
+		while (!border.empty() && remainingTargets) {
+			uint32_t curNodeId = border.top();
+			border.pop();
+			uint64_t curWeight = weights.at(curNodeId);
+
+			if (firstCol[curNodeId] != npos) {
+				--remainingTargets;
+				for(uint32_t col(firstCol[curNodeId]); col != npos; col = nextCol[col]) {
+					row[col] = saturate(curWeight);
+				}
+			}
+
+			for(uint32_t edgeId(g.node(curNodeId).begin), end(g.node(curNodeId).end); edgeId < end; ++edgeId) {
+				if (!metric.accessAllowed(edgeId)) {
+					continue;
+				}
+				uint32_t nextNodeId = metric.target(edgeId);
+				uint64_t nw = curWeight + metric.weight(edgeId);
+				if (!weights.count(nextNodeId)) {
+					weights.emplace(nextNodeId, uint64_t(nw));
+					border.push(nextNodeId, nw);
+				}
+				else if (weights.at(nextNodeId) > nw && border.contains(nextNodeId)) {
+					weights.at(nextNodeId) = nw;
+					border.decreaseKey(nextNodeId, nw);
+				}
+			}
+		}
+		//the search stops early, the heap is reused by the next source
+		border.clear();
+	}, threadCount(), 1);
+}
+
+CHMatrixRouter::CHMatrixRouter(const Graph * g, const CHInfo * chInfo) :
+MatrixRouter(g),
+m_chInfo(chInfo)
+{}
+
+void CHMatrixRouter::calculate(const std::vector<uint32_t> & sources, const std::vector<uint32_t> & targets, DistanceMatrix & result) {
+	const CHInfo & ch = *m_chInfo;
+	uint32_t nodeCount = ch.nodeCount();
+	result.resize(sources.size(), targets.size());
+	if (!nodeCount || !targets.size()) {
+		return;
+	}
+	uint32_t myThreadCount = (threadCount() ? threadCount() : defaultThreadCount());
+
+	//backward searches, every thread collects its bucket entries on its own
+	std::vector< std::vector<NodeBucketEntry> > threadEntries(myThreadCount);
+	parallelFor(0, targets.size(), [&](uint32_t col, uint32_t threadId) {
+		std::vector<NodeBucketEntry> & entries = threadEntries[threadId];
+		chUpwardSearch(ch, nodeCount, targets[col], true, [&entries, col](uint32_t nodeId, uint64_t weight) {
+			entries.emplace_back(nodeId, col, weight);
+		});
+	}, myThreadCount, 1);
+
+	//counting sort of the entries by node
+	std::vector<uint32_t> bucketBegin(nodeCount+1, 0);
+	for(const std::vector<NodeBucketEntry> & entries : threadEntries) {
+		for(const NodeBucketEntry & e : entries) {
+			++bucketBegin[e.nodeId+1];
+		}
+	}
+	for(uint32_t nodeId(0); nodeId < nodeCount; ++nodeId) {
+		bucketBegin[nodeId+1] += bucketBegin[nodeId];
+	}
+	std::vector<BucketEntry> buckets(bucketBegin.back());
+	{
+		std::vector<uint32_t> pos(bucketBegin.begin(), bucketBegin.end()-1);
+		for(std::vector<NodeBucketEntry> & entries : threadEntries) {
+			for(const NodeBucketEntry & e : entries) {
+				buckets[pos[e.nodeId]++] = e.entry;
+			}
+			entries = std::vector<NodeBucketEntry>();
+		}
+	}
+
+	//forward searches, every source writes its own row
+	parallelFor(0, sources.size(), [&](uint32_t rowId, uint32_t) {
+		DistanceMatrix::WeightType * row = result.row(rowId);
+		chUpwardSearch(ch, nodeCount, sources[rowId], false, [&](uint32_t nodeId, uint64_t weight) {
+			for(uint32_t i(bucketBegin[nodeId]), end(bucketBegin[nodeId+1]); i < end; ++i) {
+				const BucketEntry & be = buckets[i];
+				DistanceMatrix::WeightType w = saturate(weight + be.weight);
+				if (w < row[be.col]) {
+					row[be.col] = w;
+				}
+			}
+		});
+	}, myThreadCount, 1);
+}
+
+}}//end namespace
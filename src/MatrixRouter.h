@@ -0,0 +1,79 @@
+#ifndef SIMPLE_ROUTE_MATRIX_ROUTER_H
+#define SIMPLE_ROUTE_MATRIX_ROUTER_H
+#include "Graph.h"
+#include "CHGraph.h"
+#include <vector>
+#include <stdint.h>
+
+namespace simpleroute {
+
+class Metric;
+
+///Dense row-major matrix of shortest path weights, entry (row, col) is the weight from sources[row] to targets[col]
+class DistanceMatrix {
+public:
+	typedef uint32_t WeightType;
+	///weight of unreachable targets, reachable weights are saturated below it
+	static constexpr WeightType infinite_weight = 0xFFFFFFFF;
+public:
+	DistanceMatrix() : m_rowCount(0), m_colCount(0) {}
+	///all entries are infinite_weight afterwards
+	void resize(uint32_t rowCount, uint32_t colCount);
+	inline uint32_t rowCount() const { return m_rowCount; }
+	inline uint32_t colCount() const { return m_colCount; }
+	inline WeightType at(uint32_t row, uint32_t col) const { return m_d[uint64_t(row)*m_colCount+col]; }
+	inline WeightType * row(uint32_t row) { return m_d.data() + uint64_t(row)*m_colCount; }
+	inline const WeightType * row(uint32_t row) const { return m_d.data() + uint64_t(row)*m_colCount; }
+	inline const WeightType * data() const { return m_d.data(); }
+private:
+	uint32_t m_rowCount;
+	uint32_t m_colCount;
+	std::vector<WeightType> m_d;
+};
+
+///Calculates the weights of the shortest paths between all sources and all targets without building the paths.
+///The weights are in the units of the metric (or CH) the router was created with
+class MatrixRouter {
+public:
+	MatrixRouter(const Graph * g) : m_g(g), m_threadCount(0) {}
+	virtual ~MatrixRouter() {}
+	virtual void calculate(const std::vector<uint32_t> & sources, const std::vector<uint32_t> & targets, DistanceMatrix & result) = 0;
+	///0 uses all cores
+	inline void setThreadCount(uint32_t threadCount) { m_threadCount = threadCount; }
+protected:
+	inline const Graph & graph() const { return *m_g; }
+	inline uint32_t threadCount() const { return m_threadCount; }
+private:
+	const Graph * m_g;
+	uint32_t m_threadCount;
+};
+
+namespace detail {
+
+///One Dijkstra search per source which stops as soon as all targets are settled.
+///The sources are distributed over the threads, every thread writes its own rows
+class DijkstraMatrixRouter: public MatrixRouter {
+public:
+	DijkstraMatrixRouter(const Graph * g, const Metric * metric);
+	virtual ~DijkstraMatrixRouter() {}
+	virtual void calculate(const std::vector<uint32_t> & sources, const std::vector<uint32_t> & targets, DistanceMatrix & result) override;
+private:
+	const Metric * m_metric;
+};
+
+///Bucket based many-to-many algorithm on a contraction hierarchy:
+///A backward search in the downward graph of every target stores (target, weight) in a bucket of every node it settles.
+///Afterwards a forward search in the upward graph of every source scans the buckets of the nodes it settles.
+///Both phases run in parallel, the buckets are stored in a single array ordered by node
+class CHMatrixRouter: public MatrixRouter {
+public:
+	CHMatrixRouter(const Graph * g, const CHInfo * chInfo);
+	virtual ~CHMatrixRouter() {}
+	virtual void calculate(const std::vector<uint32_t> & sources, const std::vector<uint32_t> & targets, DistanceMatrix & result) override;
+private:
+	const CHInfo * m_chInfo;
+};
+
+}}//end namespace
+
+#endif
@@ -0,0 +1,56 @@
+#include "Metric.h"
+#include "ParallelFor.h"
+#include <cmath>
+#include <algorithm>
+
+namespace simpleroute {
+
+Metric::Metric() :
+m_g(0),
+m_weightFactor(1.0),
+m_lowerBoundFactor(0.0)
+{}
+
+Metric::Metric(const Graph * g, const Router::AccessAllowanceWeightEdgePreferences & ep, double weightFactor, uint32_t threadCount) :
+m_g(g),
+m_arcs(g->edgeCount()),
+m_weightFactor(weightFactor),
+m_lowerBoundFactor(ep.lowerBound(1.0)*weightFactor)
+{
+	parallelFor(0, g->edgeCount(), [this, &ep, g, weightFactor](uint32_t edgeId, uint32_t) {
+		const Graph::Edge & e = g->edge(edgeId);
+		Arc & a = m_arcs[edgeId];
+		a.target = e.target;
+		a.weight = infinite_weight;
+		if (ep.accessAllowed(e)) {
+			double w = std::ceil(ep.weight(e)*weightFactor);
+			a.weight = std::min<double>(w, infinite_weight-1);
+		}
+	}, threadCount, 4096);
+}
+
+Metric::~Metric() {}
+
+uint64_t Metric::checksum() const {
+	//FNV-1a
+	uint64_t h = 14695981039346656037ULL;
+	for(const Arc & a : m_arcs) {
+		h = (h ^ a.weight) * 1099511628211ULL;
+	}
+	return h;
+}
+
+uint32_t Metric::forbiddenEdgeCount() const {
+	return std::count_if(m_arcs.cbegin(), m_arcs.cend(), [](const Arc & a) { return a.weight == infinite_weight; });
+}
+
+void Metric::printStats(std::ostream & out) const {
+	out << "Metric::stats {\n";
+	out << "\t#Edges: " << edgeCount() << "\n";
+	out << "\t#Forbidden edges: " << forbiddenEdgeCount() << "\n";
+	out << "\tweight factor: " << m_weightFactor << "\n";
+	out << "\tstorage: " << m_arcs.size()*sizeof(Arc)/(1024*1024) << " MiB\n";
+	out << "}";
+}
+
+}//end namespace simpleroute
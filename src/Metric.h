@@ -0,0 +1,54 @@
+#ifndef SIMPLE_ROUTE_METRIC_H
+#define SIMPLE_ROUTE_METRIC_H
+#include "Graph.h"
+#include "Router.h"
+#include <vector>
+#include <ostream>
+#include <stdint.h>
+
+namespace simpleroute {
+
+///Edge weights of a profile (access types and metric) materialised once for all edges of a graph.
+///Targets and weights are stored in a packed array aligned with Graph::edges(),
+///hence a forward search only needs the edge ranges of the nodes and this array.
+///Edges that are not allowed by the profile have infinite_weight.
+class Metric {
+public:
+	typedef uint32_t WeightType;
+	static constexpr WeightType infinite_weight = 0xFFFFFFFF;
+	struct Arc {
+		uint32_t target;
+		WeightType weight;
+	};
+public:
+	Metric();
+	///The weight of an edge is ceil(ep.weight(e)*weightFactor), weightFactor is necessary for non-integral weights.
+	///Weights are rounded up to keep ep.lowerBound() admissible, see lowerBound()
+	///@param threadCount 0 uses all cores
+	Metric(const Graph * g, const Router::AccessAllowanceWeightEdgePreferences & ep, double weightFactor, uint32_t threadCount = 0);
+	~Metric();
+	inline const Graph & graph() const { return *m_g; }
+	inline uint32_t edgeCount() const { return m_arcs.size(); }
+	inline WeightType weight(uint32_t edgeId) const { return m_arcs[edgeId].weight; }
+	inline uint32_t target(uint32_t edgeId) const { return m_arcs[edgeId].target; }
+	inline bool accessAllowed(uint32_t edgeId) const { return m_arcs[edgeId].weight != infinite_weight; }
+	inline const Arc * arcs() const { return m_arcs.data(); }
+	inline double weightFactor() const { return m_weightFactor; }
+	///lower bound in the units of this metric, see Router::AccessAllowanceWeightEdgePreferences::lowerBound
+	inline double lowerBound(double distance) const { return m_lowerBoundFactor*distance; }
+	///hash of the weights to recognize data derived from this metric
+	uint64_t checksum() const;
+	///number of edges with infinite weight
+	uint32_t forbiddenEdgeCount() const;
+	void printStats(std::ostream & out) const;
+private:
+	const Graph * m_g;
+	std::vector<Arc> m_arcs;
+	double m_weightFactor;
+	///the lower bounds of all edge preferences are linear in the distance
+	double m_lowerBoundFactor;
+};
+
+}//end namespace simpleroute
+
+#endif
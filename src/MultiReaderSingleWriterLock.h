@@ -1,6 +1,9 @@
 #ifndef SIMPLE_ROUTE_MULTI_READER_SINGLE_WRITER_LOCK_H
 #define SIMPLE_ROUTE_MULTI_READER_SINGLE_WRITER_LOCK_H
-#include <QSemaphore>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <stdint.h>
 
 namespace simpleroute {
 
@@ -8,21 +11,84 @@ struct MultiReaderSingleWriterLockBase {
 	typedef enum { READ_LOCK=0x1, WRITE_LOCK=0x7FFFFFFF} LockType;
 };
 
+///Reader-writer lock whose readers only touch a counter of their own shard.
+///The shard of a thread is fixed on its first use, threads are distributed round-robin over the shards.
+///A reader increments its shard and backs off if a writer is present, a writer announces itself and waits until all shards are 0.
+///Hence uncontended reads do not share cache lines between cores and new readers do not starve a waiting writer.
+///Readers waiting for a writer block on the writer mutex, writers waiting for readers to leave yield.
+///Read locks are not recursive: a thread holding a read lock must not request another one while a writer may be waiting
 class MultiReaderSingleWriterLock: public MultiReaderSingleWriterLockBase {
 public:
-	MultiReaderSingleWriterLock() : m_s(WRITE_LOCK) {}
+	static constexpr uint32_t shard_count = 16;
+public:
+	MultiReaderSingleWriterLock() : m_writer(false) {
+		for(Shard & s : m_shards) {
+			s.readers.store(0, std::memory_order_relaxed);
+		}
+	}
+	MultiReaderSingleWriterLock(const MultiReaderSingleWriterLock & other) = delete;
+	MultiReaderSingleWriterLock & operator=(const MultiReaderSingleWriterLock & other) = delete;
 	~MultiReaderSingleWriterLock() {
-		m_s.acquire(WRITE_LOCK);
-		m_s.release(WRITE_LOCK);
+		lock(WRITE_LOCK);
+		unlock(WRITE_LOCK);
 	}
 	inline void lock(LockType lt) {
-		m_s.acquire(lt);
+		if (lt == READ_LOCK) {
+			lockRead();
+		}
+		else {
+			lockWrite();
+		}
 	}
 	inline void unlock(LockType lt) {
-		m_s.release(lt);
+		if (lt == READ_LOCK) {
+			m_shards[threadShard()].readers.fetch_sub(1, std::memory_order_release);
+		}
+		else {
+			m_writer.store(false, std::memory_order_release);
+			m_writerMutex.unlock();
+		}
+	}
+private:
+	///the counters of two shards are a cache line apart, hence they never share one.
+	///Padding instead of alignas keeps the lock usable as a member of objects created with new before C++17
+	struct Shard {
+		std::atomic<uint32_t> readers;
+		char padding[64-sizeof(std::atomic<uint32_t>)];
+	};
+private:
+	static uint32_t threadShard() {
+		static std::atomic<uint32_t> nextShard(0);
+		static thread_local uint32_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % shard_count;
+		return shard;
+	}
+	void lockRead() {
+		std::atomic<uint32_t> & readers = m_shards[threadShard()].readers;
+		while (true) {
+			//the increment and the load of m_writer are sequentially consistent with the store and the loads of lockWrite,
+			//hence either the writer sees the reader or the reader sees the writer
+			readers.fetch_add(1, std::memory_order_seq_cst);
+			if (!m_writer.load(std::memory_order_seq_cst)) {
+				return;
+			}
+			readers.fetch_sub(1, std::memory_order_release);
+			std::lock_guard<std::mutex> lck(m_writerMutex);
+		}
+	}
+	void lockWrite() {
+		m_writerMutex.lock();
+		m_writer.store(true, std::memory_order_seq_cst);
+		for(Shard & s : m_shards) {
+			while (s.readers.load(std::memory_order_seq_cst)) {
+				std::this_thread::yield();
+			}
+		}
 	}
 private:
-	QSemaphore m_s;
+	Shard m_shards[shard_count];
+	std::atomic<bool> m_writer;
+	///held by the writer for the whole write lock, serialises writers
+	std::mutex m_writerMutex;
 };
 
 class MultiReaderSingleWriterLocker: public MultiReaderSingleWriterLockBase {
@@ -39,4 +105,4 @@ public:
 
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,178 @@
+#include "OneToAllRouter.h"
+#include "Metric.h"
+#include "SearchWorkspace.h"
+#include "IndexedDaryHeap.h"
+#include "ParallelFor.h"
+#include <algorithm>
+
+namespace simpleroute {
+namespace {
+
+typedef SearchWorkspace<uint64_t> WeightWorkspace;
+typedef IndexedDaryHeap<uint64_t, 4> Border;
+
+Border & threadLocalBorder(uint32_t idCount) {
+	static thread_local Border border;
+	border.resize(idCount);
+	return border;
+}
+
+void prepareOutput(uint32_t nodeCount, std::vector<OneToAllRouter::WeightType> * weights, sserialize::SimpleBitVector * reached) {
+	if (weights) {
+		weights->assign(nodeCount, OneToAllRouter::infinite_weight);
+	}
+	if (reached) {
+		reached->resize(nodeCount);
+		reached->reset();
+	}
+}
+
+}//end namespace
+
+namespace detail {
+
+DijkstraOneToAllRouter::DijkstraOneToAllRouter(const Graph * g, const Metric * metric) :
+OneToAllRouter(g),
+m_metric(metric)
+{}
+
+void DijkstraOneToAllRouter::calculate(uint32_t source, WeightType budget, std::vector<WeightType> * weights, sserialize::SimpleBitVector * reached) {
+	const Graph & g = graph();
+	const Metric & metric = *m_metric;
+	uint32_t nodeCount = g.nodeCount();
+	prepareOutput(nodeCount, weights, reached);
+	if (source >= nodeCount) {
+		return;
+	}
+
+	WeightWorkspace & discoveredNodes = WeightWorkspace::threadLocal();
+	discoveredNodes.reset(nodeCount);
+	Border & border = threadLocalBorder(nodeCount);
+
+	discoveredNodes.emplace(source, 0);
+	border.push(source, 0);
+	while (!border.empty() && border.topKey() <= budget) {
+		uint32_t curNodeId = border.top();
+		border.pop();
+		uint64_t curWeight = discoveredNodes.at(curNodeId);
+		if (weights) {
+			(*weights)[curNodeId] = curWeight;
+		}
+		if (reached) {
+			reached->set(curNodeId);
+		}
+		for(uint32_t edgeId(g.node(curNodeId).begin), end(g.node(curNodeId).end); edgeId < end; ++edgeId) {
+			if (!metric.accessAllowed(edgeId)) {
+				continue;
+			}
+			uint32_t nextNodeId = metric.target(edgeId);
+			uint64_t nw = curWeight + metric.weight(edgeId);
+			if (nw > budget) {
+				continue;
+			}
+			if (!discoveredNodes.count(nextNodeId)) {
+				discoveredNodes.emplace(nextNodeId, uint64_t(nw));
+				border.push(nextNodeId, nw);
+			}
+			else if (discoveredNodes.at(nextNodeId) > nw && border.contains(nextNodeId)) {
+				discoveredNodes.at(nextNodeId) = nw;
+				border.decreaseKey(nextNodeId, nw);
+			}
+		}
+	}
+	border.clear();
+}
+
+PHASTRouter::PHASTRouter(const Graph * g, const CHInfo * chInfo) :
+OneToAllRouter(g),
+m_chInfo(chInfo)
+{
+	const CHInfo & ch = *m_chInfo;
+	uint32_t nodeCount = ch.nodeCount();
+	m_sweepNodes.resize(nodeCount);
+	for(uint32_t nodeId(0); nodeId < nodeCount; ++nodeId) {
+		m_sweepNodes[nodeId] = nodeId;
+	}
+	//ties are broken by id to keep the locality of the node order of the graph
+	parallelSort(m_sweepNodes.begin(), m_sweepNodes.end(), [&ch](uint32_t a, uint32_t b) {
+		return ch.node(a).level > ch.node(b).level || (ch.node(a).level == ch.node(b).level && a < b);
+	});
+	m_rank.resize(nodeCount);
+	for(uint32_t rank(0); rank < nodeCount; ++rank) {
+		m_rank[m_sweepNodes[rank]] = rank;
+	}
+	m_sweepEdgesBegin.resize(nodeCount+1);
+	m_sweepEdges.clear();
+	for(uint32_t rank(0); rank < nodeCount; ++rank) {
+		uint32_t nodeId = m_sweepNodes[rank];
+		m_sweepEdgesBegin[rank] = m_sweepEdges.size();
+		for(CHInfo::ConstEdgeRefIterator it(ch.downEdgesBegin(nodeId)), end(ch.downEdgesEnd(nodeId)); it != end; ++it) {
+			const CHInfo::CHEdge & e = ch.edge(*it);
+			m_sweepEdges.push_back(SweepEdge{m_rank[e.source], e.weight});
+		}
+	}
+	m_sweepEdgesBegin[nodeCount] = m_sweepEdges.size();
+	m_weights.resize(nodeCount);
+}
+
+void PHASTRouter::calculate(uint32_t source, WeightType budget, std::vector<WeightType> * weights, sserialize::SimpleBitVector * reached) {
+	const CHInfo & ch = *m_chInfo;
+	uint32_t nodeCount = ch.nodeCount();
+	prepareOutput(nodeCount, weights, reached);
+	if (source >= nodeCount) {
+		return;
+	}
+	std::fill(m_weights.begin(), m_weights.end(), infinite_weight);
+
+	//upward search, stall-on-demand is not necessary since the sweep corrects all weights
+	WeightWorkspace & discoveredNodes = WeightWorkspace::threadLocal();
+	discoveredNodes.reset(nodeCount);
+	Border & border = threadLocalBorder(nodeCount);
+	discoveredNodes.emplace(source, 0);
+	border.push(source, 0);
+	while (!border.empty()) {
+		uint32_t curNodeId = border.top();
+		border.pop();
+		uint64_t curWeight = discoveredNodes.at(curNodeId);
+		m_weights[m_rank[curNodeId]] = std::min<uint64_t>(curWeight, infinite_weight);
+		for(CHInfo::ConstEdgeRefIterator it(ch.upEdgesBegin(curNodeId)), end(ch.upEdgesEnd(curNodeId)); it != end; ++it) {
+			const CHInfo::CHEdge & e = ch.edge(*it);
+			uint64_t nw = curWeight + e.weight;
+			if (!discoveredNodes.count(e.target)) {
+				discoveredNodes.emplace(e.target, uint64_t(nw));
+				border.push(e.target, nw);
+			}
+			else if (discoveredNodes.at(e.target) > nw && border.contains(e.target)) {
+				discoveredNodes.at(e.target) = nw;
+				border.decreaseKey(e.target, nw);
+			}
+		}
+	}
+
+	//top-down sweep, the sources of the incoming edges of a node have a smaller rank and are final
+	const SweepEdge * edges = m_sweepEdges.data();
+	const uint32_t * edgesBegin = m_sweepEdgesBegin.data();
+	WeightType * w = m_weights.data();
+	for(uint32_t rank(0); rank < nodeCount; ++rank) {
+		uint64_t best = w[rank];
+		for(uint32_t i(edgesBegin[rank]), end(edgesBegin[rank+1]); i < end; ++i) {
+			best = std::min<uint64_t>(best, uint64_t(w[edges[i].sourceRank]) + edges[i].weight);
+		}
+		w[rank] = best;
+	}
+
+	for(uint32_t rank(0); rank < nodeCount; ++rank) {
+		if (w[rank] == infinite_weight || w[rank] > budget) {
+			continue;
+		}
+		uint32_t nodeId = m_sweepNodes[rank];
+		if (weights) {
+			(*weights)[nodeId] = w[rank];
+		}
+		if (reached) {
+			reached->set(nodeId);
+		}
+	}
+}
+
+}}//end namespace
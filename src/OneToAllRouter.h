@@ -0,0 +1,77 @@
+#ifndef SIMPLE_ROUTE_ONE_TO_ALL_ROUTER_H
+#define SIMPLE_ROUTE_ONE_TO_ALL_ROUTER_H
+#include "Graph.h"
+#include "CHGraph.h"
+#include "SimpleBitVector.h"
+#include <vector>
+#include <stdint.h>
+
+namespace simpleroute {
+
+class Metric;
+
+///Shortest path weights from a source to all nodes within a budget, e.g. for isochrones.
+///Weights and budget are in the units of the metric (or CH) the router was created with.
+///A router keeps buffers between calls, use one instance per thread
+class OneToAllRouter {
+public:
+	typedef uint32_t WeightType;
+	///weight of nodes that are not reachable within the budget
+	static constexpr WeightType infinite_weight = 0xFFFFFFFF;
+public:
+	OneToAllRouter(const Graph * g) : m_g(g) {}
+	virtual ~OneToAllRouter() {}
+	///weights (if not null) has an entry for every node afterwards, nodes outside of the budget have infinite_weight.
+	///reached (if not null) has the bits of the nodes within the budget set and all others cleared
+	virtual void calculate(uint32_t source, WeightType budget, std::vector<WeightType> * weights, sserialize::SimpleBitVector * reached) = 0;
+protected:
+	inline const Graph & graph() const { return *m_g; }
+private:
+	const Graph * m_g;
+};
+
+namespace detail {
+
+///Dijkstra search that stops at the first node beyond the budget, hence the work is proportional to the reached area
+class DijkstraOneToAllRouter: public OneToAllRouter {
+public:
+	DijkstraOneToAllRouter(const Graph * g, const Metric * metric);
+	virtual ~DijkstraOneToAllRouter() {}
+	virtual void calculate(uint32_t source, WeightType budget, std::vector<WeightType> * weights, sserialize::SimpleBitVector * reached) override;
+private:
+	const Metric * m_metric;
+};
+
+///PHAST on a contraction hierarchy: a search in the upward graph of the source followed by a linear sweep over all nodes in descending level.
+///The sweep relaxes the incoming down edges of every node, these only come from nodes of higher level which are already final.
+///The constructor renumbers the nodes by descending level and stores the incoming edges in sweep order,
+///hence the sweep walks the nodes and their edges sequentially and the sources of the edges lie before the current node.
+///The weights of the edge sources are indirect loads, the level order only keeps them close to the current node
+///The work does not depend on the budget, it pays off for large budgets and many sources
+class PHASTRouter: public OneToAllRouter {
+public:
+	PHASTRouter(const Graph * g, const CHInfo * chInfo);
+	virtual ~PHASTRouter() {}
+	virtual void calculate(uint32_t source, WeightType budget, std::vector<WeightType> * weights, sserialize::SimpleBitVector * reached) override;
+private:
+	struct SweepEdge {
+		///position of the source in the sweep order
+		uint32_t sourceRank;
+		WeightType weight;
+	};
+private:
+	const CHInfo * m_chInfo;
+	///node ids in sweep order
+	std::vector<uint32_t> m_sweepNodes;
+	///position of every node in the sweep order
+	std::vector<uint32_t> m_rank;
+	///incoming down edges of the node at rank r are [m_sweepEdgesBegin[r], m_sweepEdgesBegin[r+1])
+	std::vector<uint32_t> m_sweepEdgesBegin;
+	std::vector<SweepEdge> m_sweepEdges;
+	///weights by rank
+	std::vector<WeightType> m_weights;
+};
+
+}}//end namespace
+
+#endif
@@ -0,0 +1,345 @@
+#include "OsmChange.h"
+#include <zlib.h>
+#include <stdexcept>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+
+namespace simpleroute {
+namespace {
+
+///Start and end tags of an xml file, text between the tags is skipped.
+///Reads gzip compressed and plain files, zlib passes the latter through
+class XmlTagReader {
+public:
+	struct Tag {
+		std::string name;
+		std::vector< std::pair<std::string, std::string> > attributes;
+		bool closing;
+		bool selfClosing;
+		///value of the attribute name, 0 if there is none
+		const std::string * attribute(const char * name) const {
+			for(const std::pair<std::string, std::string> & a : attributes) {
+				if (a.first == name) {
+					return &a.second;
+				}
+			}
+			return 0;
+		}
+	};
+public:
+	XmlTagReader(const std::string & path) : m_path(path), m_pos(0), m_eof(false) {
+		m_file = ::gzopen(path.c_str(), "rb");
+		if (!m_file) {
+			throw std::runtime_error("OsmChange: could not open " + path);
+		}
+		::gzbuffer(m_file, 1 << 17);
+	}
+	~XmlTagReader() {
+		::gzclose(m_file);
+	}
+	///returns false at the end of the file
+	bool next(Tag & tag) {
+		while (true) {
+			size_t begin = find('<', m_pos);
+			if (begin == std::string::npos) {
+				return false;
+			}
+			//the tag starts at m_pos from here on, fill() moves it to the front of the buffer
+			m_pos = begin;
+			while (m_buffer.size()-m_pos < 4 && fill()) {}
+			if (m_buffer.compare(m_pos, 4, "<!--") == 0) {
+				m_pos = findString("-->", m_pos+4)+3;
+				continue;
+			}
+			size_t end = findTagEnd(m_pos+1);
+			//processing instructions and declarations
+			if (m_buffer[m_pos+1] == '?' || m_buffer[m_pos+1] == '!') {
+				m_pos = end+1;
+				continue;
+			}
+			parse(m_pos+1, end, tag);
+			m_pos = end+1;
+			return true;
+		}
+	}
+private:
+	///reads the next chunk, returns false at the end of the file
+	bool fill() {
+		if (m_eof) {
+			return false;
+		}
+		if (m_pos) {
+			m_buffer.erase(0, m_pos);
+			m_pos = 0;
+		}
+		char chunk[1 << 16];
+		int count = ::gzread(m_file, chunk, sizeof(chunk));
+		if (count < 0) {
+			throw std::runtime_error("OsmChange: could not read " + m_path);
+		}
+		if (!count) {
+			m_eof = true;
+			return false;
+		}
+		m_buffer.append(chunk, count);
+		return true;
+	}
+	///position of c at or after pos, fills the buffer as necessary. fill() shifts all positions by m_pos
+	size_t find(char c, size_t pos) {
+		while (true) {
+			size_t result = m_buffer.find(c, pos);
+			if (result != std::string::npos) {
+				return result;
+			}
+			size_t consumed = m_pos;
+			pos = m_buffer.size();
+			if (!fill()) {
+				return std::string::npos;
+			}
+			pos -= consumed;
+		}
+	}
+	size_t findString(const char * str, size_t pos) {
+		while (true) {
+			size_t result = m_buffer.find(str, pos);
+			if (result != std::string::npos) {
+				return result;
+			}
+			size_t consumed = m_pos;
+			pos = (m_buffer.size() > ::strlen(str) ? m_buffer.size()-::strlen(str) : 0);
+			if (!fill()) {
+				throw std::runtime_error("OsmChange: " + m_path + " ends inside of a comment");
+			}
+			pos = (pos > consumed ? pos-consumed : 0);
+		}
+	}
+	///position of the '>' that ends the tag starting at pos, '>' may appear in quoted attribute values
+	size_t findTagEnd(size_t pos) {
+		char quote = 0;
+		while (true) {
+			for(size_t s(m_buffer.size()); pos < s; ++pos) {
+				char c = m_buffer[pos];
+				if (quote) {
+					quote = (c == quote ? 0 : quote);
+				}
+				else if (c == '"' || c == '\'') {
+					quote = c;
+				}
+				else if (c == '>') {
+					return pos;
+				}
+			}
+			size_t consumed = m_pos;
+			if (!fill()) {
+				throw std::runtime_error("OsmChange: " + m_path + " ends inside of a tag");
+			}
+			pos -= consumed;
+		}
+	}
+	///parses the tag between '<' and '>' excluding both
+	void parse(size_t begin, size_t end, Tag & tag) {
+		const char * it = m_buffer.data()+begin;
+		const char * e = m_buffer.data()+end;
+		tag.closing = (it < e && *it == '/');
+		if (tag.closing) {
+			++it;
+		}
+		tag.selfClosing = (it < e && *(e-1) == '/');
+		if (tag.selfClosing) {
+			--e;
+		}
+		const char * nameEnd = it;
+		while (nameEnd < e && !::isspace((unsigned char)*nameEnd)) {
+			++nameEnd;
+		}
+		tag.name.assign(it, nameEnd);
+		tag.attributes.clear();
+		it = nameEnd;
+		while (true) {
+			while (it < e && ::isspace((unsigned char)*it)) {
+				++it;
+			}
+			const char * eq = static_cast<const char*>(::memchr(it, '=', e-it));
+			if (!eq || eq+1 >= e || (eq[1] != '"' && eq[1] != '\'')) {
+				break;
+			}
+			const char * valueEnd = static_cast<const char*>(::memchr(eq+2, eq[1], e-(eq+2)));
+			if (!valueEnd) {
+				break;
+			}
+			const char * keyEnd = eq;
+			while (keyEnd > it && ::isspace((unsigned char)*(keyEnd-1))) {
+				--keyEnd;
+			}
+			tag.attributes.emplace_back(std::string(it, keyEnd), std::string());
+			unescape(eq+2, valueEnd, tag.attributes.back().second);
+			it = valueEnd+1;
+		}
+	}
+	static void unescape(const char * begin, const char * end, std::string & out) {
+		out.clear();
+		while (begin < end) {
+			const char * amp = static_cast<const char*>(::memchr(begin, '&', end-begin));
+			if (!amp) {
+				out.append(begin, end);
+				return;
+			}
+			out.append(begin, amp);
+			const char * semicolon = static_cast<const char*>(::memchr(amp, ';', end-amp));
+			if (!semicolon) {
+				out.append(amp, end);
+				return;
+			}
+			std::string entity(amp+1, semicolon);
+			if (entity == "amp") {
+				out += '&';
+			}
+			else if (entity == "lt") {
+				out += '<';
+			}
+			else if (entity == "gt") {
+				out += '>';
+			}
+			else if (entity == "quot") {
+				out += '"';
+			}
+			else if (entity == "apos") {
+				out += '\'';
+			}
+			else if (entity.size() > 1 && entity[0] == '#') {
+				uint32_t cp = (entity[1] == 'x' ? ::strtoul(entity.c_str()+2, 0, 16) : ::strtoul(entity.c_str()+1, 0, 10));
+				appendUtf8(cp, out);
+			}
+			else {
+				out.append(amp, semicolon+1);
+			}
+			begin = semicolon+1;
+		}
+	}
+	static void appendUtf8(uint32_t cp, std::string & out) {
+		if (cp < 0x80) {
+			out += char(cp);
+		}
+		else if (cp < 0x800) {
+			out += char(0xC0 | (cp >> 6));
+			out += char(0x80 | (cp & 0x3F));
+		}
+		else if (cp < 0x10000) {
+			out += char(0xE0 | (cp >> 12));
+			out += char(0x80 | ((cp >> 6) & 0x3F));
+			out += char(0x80 | (cp & 0x3F));
+		}
+		else {
+			out += char(0xF0 | (cp >> 18));
+			out += char(0x80 | ((cp >> 12) & 0x3F));
+			out += char(0x80 | ((cp >> 6) & 0x3F));
+			out += char(0x80 | (cp & 0x3F));
+		}
+	}
+private:
+	std::string m_path;
+	gzFile m_file;
+	std::string m_buffer;
+	///everything before m_pos is parsed
+	size_t m_pos;
+	bool m_eof;
+};
+
+int64_t parseId(const std::string * value) {
+	if (!value) {
+		return 0;
+	}
+	return ::strtoll(value->c_str(), 0, 10);
+}
+
+///strtod depends on the locale, the decimal separator of osm is always a point
+double parseCoordinate(const std::string * value) {
+	if (!value) {
+		return 0.0;
+	}
+	const char * it = value->c_str();
+	double sign = 1.0;
+	if (*it == '-') {
+		sign = -1.0;
+		++it;
+	}
+	double result = 0.0;
+	for(; *it >= '0' && *it <= '9'; ++it) {
+		result = result*10.0 + (*it-'0');
+	}
+	if (*it == '.') {
+		double scale = 1.0;
+		for(++it; *it >= '0' && *it <= '9'; ++it) {
+			result = result*10.0 + (*it-'0');
+			scale *= 10.0;
+		}
+		result /= scale;
+	}
+	return sign*result;
+}
+
+}//end namespace
+
+const std::string & OsmChange::Way::tag(const std::string & key) const {
+	static const std::string empty;
+	for(const std::pair<std::string, std::string> & t : tags) {
+		if (t.first == key) {
+			return t.second;
+		}
+	}
+	return empty;
+}
+
+OsmChange OsmChange::fromFile(const std::string & path) {
+	OsmChange oc;
+	XmlTagReader reader(path);
+	XmlTagReader::Tag tag;
+	if (!reader.next(tag) || tag.name != "osmChange") {
+		throw std::runtime_error("OsmChange: " + path + " is not an osmChange file");
+	}
+	Action action = A_MODIFY;
+	//tags and node references belong to the way only if they are not part of a node or relation
+	bool inWay = false;
+	while (reader.next(tag)) {
+		if (tag.closing) {
+			if (tag.name == "way") {
+				inWay = false;
+			}
+		}
+		else if (tag.name == "create" || tag.name == "modify" || tag.name == "delete") {
+			action = (tag.name == "create" ? A_CREATE : (tag.name == "modify" ? A_MODIFY : A_DELETE));
+		}
+		else if (tag.name == "node") {
+			Node n;
+			n.id = parseId(tag.attribute("id"));
+			n.action = action;
+			n.lat = parseCoordinate(tag.attribute("lat"));
+			n.lon = parseCoordinate(tag.attribute("lon"));
+			oc.nodes.push_back(n);
+			inWay = false;
+		}
+		else if (tag.name == "way") {
+			oc.ways.emplace_back();
+			oc.ways.back().id = parseId(tag.attribute("id"));
+			oc.ways.back().action = action;
+			inWay = !tag.selfClosing;
+		}
+		else if (tag.name == "relation") {
+			inWay = false;
+		}
+		else if (inWay && tag.name == "nd") {
+			oc.ways.back().refs.push_back(parseId(tag.attribute("ref")));
+		}
+		else if (inWay && tag.name == "tag") {
+			const std::string * k = tag.attribute("k");
+			const std::string * v = tag.attribute("v");
+			if (k && v) {
+				oc.ways.back().tags.emplace_back(*k, *v);
+			}
+		}
+	}
+	return oc;
+}
+
+}//end namespace simpleroute
@@ -0,0 +1,41 @@
+#ifndef SIMPLE_ROUTE_OSM_CHANGE_H
+#define SIMPLE_ROUTE_OSM_CHANGE_H
+#include <string>
+#include <vector>
+#include <utility>
+#include <stdint.h>
+
+namespace simpleroute {
+
+///Nodes and ways of an OpenStreetMap change file (.osc) in file order, relations are skipped.
+///Deleted elements only carry what the file has, usually their id
+struct OsmChange {
+	typedef enum { A_CREATE, A_MODIFY, A_DELETE } Action;
+	struct Node {
+		int64_t id;
+		Action action;
+		double lat;
+		double lon;
+		Node() : id(0), action(A_MODIFY), lat(0.0), lon(0.0) {}
+	};
+	struct Way {
+		int64_t id;
+		Action action;
+		///ids of the nodes of the way
+		std::vector<int64_t> refs;
+		std::vector< std::pair<std::string, std::string> > tags;
+		Way() : id(0), action(A_MODIFY) {}
+		///value of the tag key, empty if the way has no such tag
+		const std::string & tag(const std::string & key) const;
+	};
+	std::vector<Node> nodes;
+	std::vector<Way> ways;
+
+	///Reads a plain or gzip compressed change file.
+	///Throws std::runtime_error if the file can not be read or is not a change file
+	static OsmChange fromFile(const std::string & path);
+};
+
+}//end namespace simpleroute
+
+#endif
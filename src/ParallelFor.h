@@ -0,0 +1,84 @@
+#ifndef SIMPLE_ROUTE_PARALLEL_FOR_H
+#define SIMPLE_ROUTE_PARALLEL_FOR_H
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+
+namespace simpleroute {
+
+///number of threads used if a thread count of 0 is requested
+inline uint32_t defaultThreadCount() {
+	return std::max<uint32_t>(1, std::thread::hardware_concurrency());
+}
+
+///calls func(i, threadId) for every i in [begin, end) using threadCount threads
+///The work is distributed dynamically in blocks of blockSize to balance uneven work items
+template<typename TFunc>
+void parallelFor(uint32_t begin, uint32_t end, TFunc func, uint32_t threadCount = 0, uint32_t blockSize = 64) {
+	if (!threadCount) {
+		threadCount = defaultThreadCount();
+	}
+	if (begin >= end) {
+		return;
+	}
+	threadCount = std::min<uint32_t>(threadCount, (end-begin)/blockSize+1);
+	std::atomic<uint32_t> next(begin);
+	auto worker = [&next, &func, end, blockSize](uint32_t threadId) {
+		while (true) {
+			uint32_t blockBegin = next.fetch_add(blockSize);
+			if (blockBegin >= end) {
+				break;
+			}
+			uint32_t blockEnd = std::min<uint32_t>(end, blockBegin+blockSize);
+			for(uint32_t i(blockBegin); i < blockEnd; ++i) {
+				func(i, threadId);
+			}
+		}
+	};
+	if (threadCount == 1) {
+		worker(0);
+		return;
+	}
+	std::vector<std::thread> threads;
+	threads.reserve(threadCount-1);
+	for(uint32_t i(1); i < threadCount; ++i) {
+		threads.emplace_back(worker, i);
+	}
+	worker(0);
+	for(std::thread & t : threads) {
+		t.join();
+	}
+}
+
+///sorts [begin, end) by sorting blocks in parallel and merging them pairwise, every level of merges runs in parallel
+template<typename TRandomAccessIterator, typename TCompare>
+void parallelSort(TRandomAccessIterator begin, TRandomAccessIterator end, TCompare comp, uint32_t threadCount = 0) {
+	if (!threadCount) {
+		threadCount = defaultThreadCount();
+	}
+	uint64_t size = end-begin;
+	uint64_t blockSize = std::max<uint64_t>(size/threadCount+1, 1024);
+	uint32_t blockCount = (size+blockSize-1)/blockSize;
+	if (blockCount < 2) {
+		std::sort(begin, end, comp);
+		return;
+	}
+	parallelFor(0, blockCount, [&](uint32_t i, uint32_t) {
+		std::sort(begin+i*blockSize, begin+std::min<uint64_t>(size, (i+1)*blockSize), comp);
+	}, threadCount, 1);
+	for(uint64_t width(blockSize); width < size; width *= 2) {
+		uint32_t mergeCount = (size+2*width-1)/(2*width);
+		parallelFor(0, mergeCount, [&](uint32_t i, uint32_t) {
+			uint64_t first = i*2*width;
+			uint64_t middle = std::min<uint64_t>(size, first+width);
+			uint64_t last = std::min<uint64_t>(size, first+2*width);
+			std::inplace_merge(begin+first, begin+middle, begin+last, comp);
+		}, threadCount, 1);
+	}
+}
+
+}//end namespace simpleroute
+
+#endif
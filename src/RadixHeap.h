@@ -0,0 +1,185 @@
+#ifndef SIMPLE_ROUTE_RADIX_HEAP_H
+#define SIMPLE_ROUTE_RADIX_HEAP_H
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+namespace simpleroute {
+namespace detail {
+
+///Maps keys to unsigned integers preserving their order
+template<typename T_KEY>
+struct RadixHeapKeyTraits {
+	static_assert(std::is_unsigned<T_KEY>::value, "RadixHeap needs unsigned integral keys");
+	typedef T_KEY RadixType;
+	static inline RadixType radix(T_KEY k) { return k; }
+};
+
+///The bit pattern of non-negative doubles has the same order as their values
+template<>
+struct RadixHeapKeyTraits<double> {
+	typedef uint64_t RadixType;
+	static inline RadixType radix(double k) {
+		assert(k >= 0.0);
+		RadixType r;
+		::memcpy(&r, &k, sizeof(r));
+		return r;
+	}
+};
+
+}//end namespace detail
+
+///Monotone min-heap of ids in [0, idCount): pushed keys must not be smaller than the last popped key.
+///This holds for Dijkstra with non-negative edge weights.
+///An entry lives in bucket 0 if its key equals the last popped key,
+///otherwise in the bucket given by the highest bit in which it differs from the last popped key.
+///Every entry is moved at most once per bucket, which makes pop amortized O(bits).
+///The position of every id is tracked which allows a true decrease-key operation.
+template<typename T_KEY>
+class RadixHeap {
+public:
+	typedef T_KEY Key;
+	typedef detail::RadixHeapKeyTraits<T_KEY> KeyTraits;
+	typedef typename KeyTraits::RadixType RadixType;
+	static constexpr uint32_t bucket_count = std::numeric_limits<RadixType>::digits+1;
+	static constexpr uint32_t npos = 0xFFFFFFFF;
+public:
+	RadixHeap() : m_size(0), m_last(0) {}
+	RadixHeap(uint32_t idCount) : m_pos(idCount), m_size(0), m_last(0) {}
+	~RadixHeap() {}
+	///set the number of ids, this is O(1) if idCount did not change
+	void resize(uint32_t idCount);
+	inline bool empty() const { return !m_size; }
+	inline uint32_t size() const { return m_size; }
+	inline bool contains(uint32_t id) const { return m_pos[id].pos != npos; }
+	inline uint32_t top() { moveMinToFront(); return m_buckets[0].back().id; }
+	inline const Key & topKey() { moveMinToFront(); return m_buckets[0].back().key; }
+	///id must not be in the heap, key must not be smaller than the last popped key
+	void push(uint32_t id, const Key & key);
+	///id must be in the heap and key must not be larger than its current key
+	void decreaseKey(uint32_t id, const Key & key);
+	void pop();
+	///removes all remaining ids and resets the monotonicity bound, this is O(size())
+	void clear();
+private:
+	struct Entry {
+		Key key;
+		uint32_t id;
+		Entry(const Key & key, uint32_t id) : key(key), id(id) {}
+	};
+	struct Position {
+		uint32_t bucket;
+		uint32_t pos;
+		Position() : bucket(0), pos(npos) {}
+	};
+private:
+	inline uint32_t bucket(const Key & key) const {
+		RadixType diff = KeyTraits::radix(key) ^ m_last;
+		if (!diff) {
+			return 0;
+		}
+		return std::numeric_limits<RadixType>::digits - (sizeof(RadixType) > 4 ? __builtin_clzll(diff) : __builtin_clz(diff));
+	}
+	inline void insert(uint32_t bucketId, const Entry & e) {
+		std::vector<Entry> & b = m_buckets[bucketId];
+		m_pos[e.id].bucket = bucketId;
+		m_pos[e.id].pos = b.size();
+		b.push_back(e);
+	}
+	inline void remove(uint32_t id) {
+		Position & p = m_pos[id];
+		std::vector<Entry> & b = m_buckets[p.bucket];
+		if (p.pos+1 != b.size()) {
+			b[p.pos] = b.back();
+			m_pos[b[p.pos].id].pos = p.pos;
+		}
+		b.pop_back();
+		p.pos = npos;
+	}
+	///if bucket 0 is empty redistribute the first non-empty bucket with its minimum as the new last key
+	void moveMinToFront();
+private:
+	std::vector<Entry> m_buckets[bucket_count];
+	std::vector<Position> m_pos;
+	uint32_t m_size;
+	RadixType m_last;
+};
+
+template<typename T_KEY>
+void RadixHeap<T_KEY>::resize(uint32_t idCount) {
+	if (m_pos.size() != idCount) {
+		for(std::vector<Entry> & b : m_buckets) {
+			b.clear();
+		}
+		m_pos.assign(idCount, Position());
+		m_size = 0;
+		m_last = 0;
+	}
+}
+
+template<typename T_KEY>
+void RadixHeap<T_KEY>::push(uint32_t id, const Key & key) {
+	assert(!contains(id));
+	assert(KeyTraits::radix(key) >= m_last);
+	insert(bucket(key), Entry(key, id));
+	++m_size;
+}
+
+template<typename T_KEY>
+void RadixHeap<T_KEY>::decreaseKey(uint32_t id, const Key & key) {
+	assert(contains(id));
+	assert(KeyTraits::radix(key) >= m_last);
+	remove(id);
+	insert(bucket(key), Entry(key, id));
+}
+
+template<typename T_KEY>
+void RadixHeap<T_KEY>::moveMinToFront() {
+	assert(!empty());
+	if (m_buckets[0].size()) {
+		return;
+	}
+	uint32_t i = 1;
+	while (m_buckets[i].empty()) {
+		++i;
+	}
+	std::vector<Entry> & b = m_buckets[i];
+	RadixType minKey = KeyTraits::radix(b.front().key);
+	for(const Entry & e : b) {
+		minKey = std::min(minKey, KeyTraits::radix(e.key));
+	}
+	m_last = minKey;
+	//all entries end up in buckets smaller than i
+	for(const Entry & e : b) {
+		insert(bucket(e.key), e);
+	}
+	b.clear();
+}
+
+template<typename T_KEY>
+void RadixHeap<T_KEY>::pop() {
+	moveMinToFront();
+	m_pos[m_buckets[0].back().id].pos = npos;
+	m_buckets[0].pop_back();
+	--m_size;
+}
+
+template<typename T_KEY>
+void RadixHeap<T_KEY>::clear() {
+	for(std::vector<Entry> & b : m_buckets) {
+		for(const Entry & e : b) {
+			m_pos[e.id].pos = npos;
+		}
+		b.clear();
+	}
+	m_size = 0;
+	m_last = 0;
+}
+
+}//end namespace simpleroute
+
+#endif
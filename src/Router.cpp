@@ -1,80 +1,400 @@
 #include "Router.h"
 #include "Graph.h"
+#include "Metric.h"
+#include "Landmarks.h"
+#include "SearchWorkspace.h"
+#include "IndexedDaryHeap.h"
+#include "RadixHeap.h"
+#include "ParallelFor.h"
+#include "util.h"
 #include <vector>
 #include <unordered_map>
 #include <set>
 #include <queue>
+#include <limits>
+#include <cmath>
 
 
 namespace simpleroute {
 
-bool Router::AccessAllowanceEdgePreferences::accessAllowed(const Graph::Edge& e) const {
-	return e.access & accessTypeMask;
+Router::TimeEdgePreferences::TimeEdgePreferences(uint32_t accessTypeMask, double vehicleMaxSpeed) :
+AccessAllowanceWeightEdgePreferences(accessTypeMask),
+vehicleMaxSpeed((vehicleMaxSpeed*1000.0)/3.6)
+{}
+
+Router::MetricEdgePreferences::MetricEdgePreferences(const Metric * metric) :
+AccessAllowanceWeightEdgePreferences(Graph::Edge::AT_ALL),
+metric(metric),
+edgesBegin(metric->graph().edges().data()),
+lowerBoundFactor(metric->lowerBound(1.0))
+{}
+
+bool Router::MetricEdgePreferences::accessAllowed(const Graph::Edge & e) const {
+	return metric->accessAllowed(edgeId(e));
+}
+
+double Router::MetricEdgePreferences::weight(const Graph::Edge & e) const {
+	return metric->weight(edgeId(e));
+}
+
+void Router::route(uint32_t startNode, uint32_t endNode, PathVisitor * pathVisitor) {
+	routeEndpoints(SearchEndpoints(1, SearchEndpoint(startNode, 0.0)), SearchEndpoints(1, SearchEndpoint(endNode, 0.0)), pathVisitor);
+}
+
+bool Router::route(const Graph::PhantomNode & start, const Graph::PhantomNode & end, PathVisitor * pathVisitor) {
+	struct CountingVisitor: PathVisitor {
+		PathVisitor * pv;
+		uint32_t count;
+		CountingVisitor(PathVisitor * pv) : pv(pv), count(0) {}
+		virtual void visit(uint32_t nodeRef) override {
+			++count;
+			pv->visit(nodeRef);
+		}
+	};
+	const double infinity = std::numeric_limits<double>::infinity();
+	const Graph & g = graph();
+	m_stats = Stats();
+	
+	//the weights of both directions of the edges, there is a reverse edge for two-way roads
+	uint32_t startReverseEdgeId = g.reverseEdge(start.edgeId);
+	uint32_t endReverseEdgeId = g.reverseEdge(end.edgeId);
+	double startWeight = edgeWeight(start.edgeId);
+	double startReverseWeight = (startReverseEdgeId != Graph::invalid_edge ? edgeWeight(startReverseEdgeId) : infinity);
+	double endWeight = edgeWeight(end.edgeId);
+	double endReverseWeight = (endReverseEdgeId != Graph::invalid_edge ? edgeWeight(endReverseEdgeId) : infinity);
+	
+	//a path that leaves the edge and comes back is never shorter than the part of the edge between both positions
+	if (start.edgeId == end.edgeId || end.edgeId == startReverseEdgeId) {
+		double endOffset = (start.edgeId == end.edgeId ? end.offset : 1.0-end.offset);
+		if ((endOffset >= start.offset && startWeight < infinity) || (endOffset <= start.offset && startReverseWeight < infinity)) {
+			return true;
+		}
+	}
+	
+	const Graph::Edge & se = g.edge(start.edgeId);
+	const Graph::Edge & te = g.edge(end.edgeId);
+	SearchEndpoints sources;
+	SearchEndpoints targets;
+	if (startWeight < infinity) {
+		sources.emplace_back(se.target, (1.0-start.offset)*startWeight);
+	}
+	if (startReverseWeight < infinity) {
+		sources.emplace_back(se.source, start.offset*startReverseWeight);
+	}
+	if (endWeight < infinity) {
+		targets.emplace_back(te.source, end.offset*endWeight);
+	}
+	if (endReverseWeight < infinity) {
+		targets.emplace_back(te.target, (1.0-end.offset)*endReverseWeight);
+	}
+	if (!sources.size() || !targets.size()) {
+		return false;
+	}
+	CountingVisitor cv(pathVisitor);
+	routeEndpoints(sources, targets, &cv);
+	return cv.count;
 }
 
 namespace detail {
+namespace {
 
-struct NodeHopDistInfo {
-	uint32_t parentNodeId;
-	uint32_t distance;
-	NodeHopDistInfo() : parentNodeId(0xFFFFFFFF), distance(0xFFFFFFFF) {}
-	NodeHopDistInfo(uint32_t parentNodeId, uint32_t distance) : parentNodeId(parentNodeId), distance(distance) {}
+template<typename T_EP>
+inline double edgePreferencesWeight(const Graph & g, const T_EP & ep, uint32_t edgeId) {
+	const Graph::Edge & e = g.edge(edgeId);
+	return (ep.accessAllowed(e) ? ep.weight(e) : std::numeric_limits<double>::infinity());
+}
+
+///infinity for floating point weights, the maximum for integral weights
+template<typename T_WEIGHT>
+inline T_WEIGHT infiniteWeight() {
+	return (std::numeric_limits<T_WEIGHT>::has_infinity ? std::numeric_limits<T_WEIGHT>::infinity() : std::numeric_limits<T_WEIGHT>::max());
+}
+
+///How the routers read the edges of a node: the edge preferences are evaluated on Graph::Edge.
+///Weight is the type of the weights of a search
+template<typename T_EP>
+class EdgeReader {
+public:
+	typedef double Weight;
+public:
+	EdgeReader(const Graph & g, const T_EP & ep) : m_g(g), m_ep(ep) {}
+	inline bool accessAllowed(uint32_t edgeId) const { return m_ep.accessAllowed(m_g.edge(edgeId)); }
+	inline uint32_t target(uint32_t edgeId) const { return m_g.edge(edgeId).target; }
+	inline Weight weight(uint32_t edgeId) const { return m_ep.weight(m_g.edge(edgeId)); }
+private:
+	const Graph & m_g;
+	const T_EP & m_ep;
 };
 
-HopDistanceRouter::HopDistanceRouter(const Graph* g) :
-Router(g),
-m_ep(0)
-{}
+///Reads the packed targets and weights of the metric, Graph::Edge is not accessed.
+///The weights are integral, hence the searches use integral keys
+template<>
+class EdgeReader<Router::MetricEdgePreferences> {
+public:
+	typedef uint64_t Weight;
+public:
+	EdgeReader(const Graph & /*g*/, const Router::MetricEdgePreferences & ep) : m_arcs(ep.metric->arcs()) {}
+	inline bool accessAllowed(uint32_t edgeId) const { return m_arcs[edgeId].weight != Metric::infinite_weight; }
+	inline uint32_t target(uint32_t edgeId) const { return m_arcs[edgeId].target; }
+	inline Weight weight(uint32_t edgeId) const { return m_arcs[edgeId].weight; }
+private:
+	const Metric::Arc * m_arcs;
+};
 
-HopDistanceRouter::~HopDistanceRouter() {
-	delete m_ep;
+///Weights of endpoints and lower bounds in the unit of a search.
+///Integral weights are rounded down, hence lower bounds stay admissible
+template<typename T_WEIGHT>
+inline T_WEIGHT toWeight(double weight) {
+	if (!std::numeric_limits<T_WEIGHT>::is_integer) {
+		return weight;
+	}
+	return (weight < double(infiniteWeight<T_WEIGHT>()) ? T_WEIGHT(std::floor(weight)) : infiniteWeight<T_WEIGHT>());
 }
 
-void HopDistanceRouter::setEP(Router::AccessAllowanceEdgePreferences* ep) {
-	if (m_ep)
-		delete m_ep;
-	m_ep = ep;
+///weight of the endpoint of nodeId in targets, infinite if it is not a target
+template<typename T_WEIGHT>
+inline T_WEIGHT targetWeight(const Router::SearchEndpoints & targets, uint32_t nodeId) {
+	T_WEIGHT weight = infiniteWeight<T_WEIGHT>();
+	for(const Router::SearchEndpoint & t : targets) {
+		if (t.nodeId == nodeId) {
+			weight = std::min(weight, toWeight<T_WEIGHT>(t.weight));
+		}
+	}
+	return weight;
 }
 
-void HopDistanceRouter::route(uint32_t startNode, uint32_t endNode, Router::PathVisitor* pathVisitor) {
-	if (startNode == endNode) {
-		pathVisitor->visit(startNode);
-		return;
+///reports the path from its source to endNode, parent(nodeId) returns the parent in the search tree, sources are their own parent
+template<typename T_PARENT>
+void visitPath(uint32_t endNode, T_PARENT parent, Router::PathVisitor * pathVisitor) {
+	std::vector<uint32_t> tmp;
+	//backtrack
+	for(uint32_t curNodeId(endNode);;) {
+		tmp.push_back(curNodeId);
+		uint32_t parentNodeId = parent(curNodeId);
+		if (parentNodeId == curNodeId) {
+			break;
+		}
+		curNodeId = parentNodeId;
 	}
-	std::vector<uint32_t>  nodeQueue;
-	std::unordered_map<uint32_t, NodeHopDistInfo> visitedNodes;
 	
-	visitedNodes[startNode] = NodeHopDistInfo(startNode, 0);
-	nodeQueue.emplace_back(startNode);
-	for(uint32_t i(0); i < nodeQueue.size() && !visitedNodes.count(endNode); ++i) {
-		uint32_t curNodeId = nodeQueue.at(i);
-		const NodeHopDistInfo & ni = visitedNodes.at(curNodeId);
-		for (Graph::ConstEdgeIterator childIt(graph().edgesBegin(curNodeId)), childEnd(graph().edgesEnd(curNodeId)); childIt != childEnd; ++childIt) {
-			if (!m_ep->accessAllowed(*childIt)) {
+	//let pathVisitor know of the path
+	for(std::vector<uint32_t>::reverse_iterator it(tmp.rbegin()), end(tmp.rend()); it != end; ++it) {
+		pathVisitor->visit(*it);
+	}
+}
+
+}//end namespace
+
+template<typename T_EP>
+HopDistanceRouter<T_EP>::HopDistanceRouter(const Graph* g, const EdgePreferences & ep) :
+Router(g),
+m_ep(ep),
+m_directionOptimizing(false),
+m_threadCount(1),
+m_hopDistance(0xFFFFFFFF),
+m_visitedCount(0),
+m_unvisitedEdges(0)
+{}
+
+template<typename T_EP>
+bool HopDistanceRouter<T_EP>::visit(uint32_t nodeId, uint32_t parentNodeId) {
+	if (m_visited.isSet(nodeId)) {
+		return false;
+	}
+	m_visited.set(nodeId);
+	m_parents[nodeId] = parentNodeId;
+	m_nextFrontier.push_back(nodeId);
+	++m_visitedCount;
+	m_unvisitedEdges -= graph().node(nodeId).end - graph().node(nodeId).begin;
+	return true;
+}
+
+template<typename T_EP>
+void HopDistanceRouter<T_EP>::topDownStep(uint32_t threadCount) {
+	const Graph & g = graph();
+	EdgeReader<T_EP> er(g, m_ep);
+	if (threadCount == 1 || m_frontier.size() < parallel_min_level_size) {
+		for(uint32_t curNodeId : m_frontier) {
+			++m_stats.settledNodes;
+			if (isCancelled()) {
+				return;
+			}
+			for(uint32_t edgeId(g.node(curNodeId).begin), end(g.node(curNodeId).end); edgeId < end; ++edgeId) {
+				if (!er.accessAllowed(edgeId)) {
+					continue;
+				}
+				++m_stats.relaxedEdges;
+				visit(er.target(edgeId), curNodeId);
+			}
+		}
+		return;
+	}
+	m_stats.settledNodes += m_frontier.size();
+	if (isCancelled()) {
+		return;
+	}
+	//the visited bits are only read during the expansion, the candidates are merged afterwards
+	m_candidates.resize(threadCount);
+	std::vector<uint64_t> relaxedEdges(threadCount, 0);
+	parallelFor(0, m_frontier.size(), [&](uint32_t i, uint32_t threadId) {
+		uint32_t curNodeId = m_frontier[i];
+		Candidates & candidates = m_candidates[threadId];
+		for(uint32_t edgeId(g.node(curNodeId).begin), end(g.node(curNodeId).end); edgeId < end; ++edgeId) {
+			if (!er.accessAllowed(edgeId)) {
 				continue;
 			}
-			if (!visitedNodes.count(childIt->target)) {
-				nodeQueue.push_back(childIt->target);
-				visitedNodes[childIt->target] = NodeHopDistInfo(curNodeId, ni.distance);
+			++relaxedEdges[threadId];
+			uint32_t childNodeId = er.target(edgeId);
+			if (!m_visited.isSet(childNodeId)) {
+				candidates.emplace_back(childNodeId, curNodeId);
 			}
 		}
+	}, threadCount, 256);
+	for(uint32_t threadId(0); threadId < threadCount; ++threadId) {
+		m_stats.relaxedEdges += relaxedEdges[threadId];
+		for(const std::pair<uint32_t, uint32_t> & c : m_candidates[threadId]) {
+			visit(c.first, c.second);
+		}
+		m_candidates[threadId].clear();
+	}
+}
+
+template<typename T_EP>
+void HopDistanceRouter<T_EP>::bottomUpStep(uint32_t threadCount) {
+	typedef sserialize::SimpleBitVector::BaseStorageType Word;
+	static constexpr uint32_t digits = sserialize::SimpleBitVector::digits;
+	const Graph & g = graph();
+	EdgeReader<T_EP> er(g, m_ep);
+	uint32_t nodeCount = g.nodeCount();
+	m_frontierSet.reset();
+	for(uint32_t nodeId : m_frontier) {
+		m_frontierSet.set(nodeId);
 	}
-	if (!visitedNodes.count(endNode)) {
+	m_stats.settledNodes += m_frontier.size();
+	if (isCancelled()) {
 		return;
 	}
-	std::vector<uint32_t> tmp;
-	//backtrack
-	uint32_t curNodeId = endNode;
-	while(curNodeId != startNode) {
-		tmp.push_back(curNodeId);
-		curNodeId = visitedNodes.at(curNodeId).parentNodeId;
+	bool parallel = (threadCount != 1 && nodeCount - m_visitedCount >= parallel_min_level_size);
+	if (parallel) {
+		m_candidates.resize(threadCount);
 	}
-	tmp.push_back(startNode);
+	std::vector<uint64_t> relaxedEdges(parallel ? threadCount : 1, 0);
+	//scans the unvisited nodes of a word of the visited bitset, a node is done with its first incoming edge from the frontier
+	auto scanWord = [&](uint32_t wordId, uint32_t threadId) {
+		for(Word x(~m_visited.word(wordId)); x; x &= x-1) {
+			uint32_t nodeId = wordId*digits + __builtin_ctzll(x);
+			if (nodeId >= nodeCount) {
+				break;
+			}
+			for(Graph::ConstEdgeRefIterator it(g.reverseEdgesBegin(nodeId)), end(g.reverseEdgesEnd(nodeId)); it != end; ++it) {
+				if (!er.accessAllowed(*it)) {
+					continue;
+				}
+				++relaxedEdges[threadId];
+				//the reverse edges only know the edge ids, hence the source is read from the edge
+				uint32_t sourceNodeId = g.edge(*it).source;
+				if (m_frontierSet.isSet(sourceNodeId)) {
+					if (parallel) {
+						m_candidates[threadId].emplace_back(nodeId, sourceNodeId);
+					}
+					else {
+						visit(nodeId, sourceNodeId);
+					}
+					break;
+				}
+			}
+		}
+	};
+	uint32_t wordCount = (nodeCount+digits-1)/digits;
+	if (!parallel) {
+		for(uint32_t wordId(0); wordId < wordCount; ++wordId) {
+			scanWord(wordId, 0);
+		}
+		m_stats.relaxedEdges += relaxedEdges[0];
+		return;
+	}
+	parallelFor(0, wordCount, scanWord, threadCount, 16);
+	//every node is found by at most one thread
+	for(uint32_t threadId(0); threadId < threadCount; ++threadId) {
+		m_stats.relaxedEdges += relaxedEdges[threadId];
+		for(const std::pair<uint32_t, uint32_t> & c : m_candidates[threadId]) {
+			visit(c.first, c.second);
+		}
+		m_candidates[threadId].clear();
+	}
+}
+
+template<typename T_EP>
+double HopDistanceRouter<T_EP>::edgeWeight(uint32_t edgeId) const {
+	return (m_ep.accessAllowed(graph().edge(edgeId)) ? 0.0 : std::numeric_limits<double>::infinity());
+}
+
+template<typename T_EP>
+void HopDistanceRouter<T_EP>::routeEndpoints(const SearchEndpoints & sources, const SearchEndpoints & targets, Router::PathVisitor* pathVisitor) {
+	m_stats = Stats();
+	m_hopDistance = 0xFFFFFFFF;
+	const Graph & g = graph();
+	uint32_t nodeCount = g.nodeCount();
+	uint32_t threadCount = (m_threadCount ? m_threadCount : defaultThreadCount());
+	bool directionOptimizing = (m_directionOptimizing && g.hasReverseEdges());
 	
-	//let pathVisitor know of the path
-	for(std::vector<uint32_t>::reverse_iterator it(tmp.rbegin()), end(tmp.rend()); it != end; ++it) {
-		pathVisitor->visit(*it);
+	//the parents are only read for visited nodes and need no reset
+	m_visited.resize(nodeCount);
+	m_visited.reset();
+	m_parents.resize(nodeCount);
+	m_frontierSet.resize(nodeCount);
+	m_frontier.clear();
+	m_nextFrontier.clear();
+	m_visitedCount = 0;
+	m_unvisitedEdges = g.edgeCount();
+	
+	auto reachedTarget = [this, &targets]() -> uint32_t {
+		for(const SearchEndpoint & t : targets) {
+			if (m_visited.isSet(t.nodeId)) {
+				return t.nodeId;
+			}
+		}
+		return 0xFFFFFFFF;
+	};
+	
+	for(const SearchEndpoint & s : sources) {
+		visit(s.nodeId, s.nodeId);
+	}
+	bool bottomUp = false;
+	uint32_t level = 0;
+	uint32_t endNode = reachedTarget();
+	while (m_nextFrontier.size() && endNode == 0xFFFFFFFF) {
+		m_frontier.swap(m_nextFrontier);
+		m_nextFrontier.clear();
+		if (directionOptimizing) {
+			if (bottomUp) {
+				bottomUp = (uint64_t(m_frontier.size())*top_down_beta >= nodeCount);
+			}
+			else {
+				uint64_t frontierEdges = 0;
+				for(uint32_t nodeId : m_frontier) {
+					frontierEdges += g.node(nodeId).end - g.node(nodeId).begin;
+				}
+				bottomUp = (frontierEdges*bottom_up_alpha > m_unvisitedEdges);
+			}
+		}
+		if (bottomUp) {
+			bottomUpStep(threadCount);
+		}
+		else {
+			topDownStep(threadCount);
+		}
+		if (m_stats.cancelled) {
+			return;
+		}
+		++level;
+		endNode = reachedTarget();
 	}
+	if (endNode == 0xFFFFFFFF) {
+		return;
+	}
+	m_hopDistance = level;
+	visitPath(endNode, [this](uint32_t nodeId) { return m_parents[nodeId]; }, pathVisitor);
 }
 
 namespace DijkstraRouterImp {
@@ -95,17 +415,57 @@ namespace DijkstraRouterImp {
 
 	typedef std::multiset<uint32_t, BorderSmaller> BorderSet;
 	typedef BorderSet::iterator BorderIterator;
+	
+	template<typename T_WEIGHT>
+	struct BasicBorderInfo {
+		uint32_t nodeId;
+		T_WEIGHT distance;
+		BasicBorderInfo(uint32_t nodeId, T_WEIGHT distance) : nodeId(nodeId), distance(distance) {}
+		bool operator<(const BasicBorderInfo & other) const {
+			return (distance == other.distance ? nodeId < other.nodeId : distance >= other.distance);
+		}
+	};
+	
+	typedef BasicBorderInfo<double> BorderInfo;
+	typedef std::priority_queue<BorderInfo> BorderQueue;
 
-	struct DijkstraNodeInfo {
+	template<typename T_WEIGHT>
+	struct BasicDijkstraNodeInfo {
 		uint32_t parentNodeId;
-		double weight;
-		DijkstraNodeInfo() : parentNodeId(0xFFFFFFFF), weight(-1.0) {}
-		DijkstraNodeInfo(uint32_t parentNodeId, double weight) : parentNodeId(parentNodeId), weight(weight) {}
+		T_WEIGHT weight;
+		BasicDijkstraNodeInfo() : parentNodeId(0xFFFFFFFF), weight(0) {}
+		BasicDijkstraNodeInfo(uint32_t parentNodeId, T_WEIGHT weight) : parentNodeId(parentNodeId), weight(weight) {}
 		bool valid() {
 			return parentNodeId != 0xFFFFFFFF;
 		}
 	};
 	
+	typedef BasicDijkstraNodeInfo<double> DijkstraNodeInfo;
+	
+	template<typename T_WEIGHT>
+	struct BasicAStarNodeInfo: BasicDijkstraNodeInfo<T_WEIGHT> {
+		///lower bound of the distance to the target, only computed once per node
+		T_WEIGHT lowerBound;
+		BasicAStarNodeInfo() : lowerBound(0) {}
+		BasicAStarNodeInfo(uint32_t parentNodeId, T_WEIGHT weight, T_WEIGHT lowerBound) :
+		BasicDijkstraNodeInfo<T_WEIGHT>(parentNodeId, weight),
+		lowerBound(lowerBound)
+		{}
+		inline T_WEIGHT key() const { return this->weight + lowerBound; }
+	};
+	
+	///the types of a search whose weights are of type T_WEIGHT, see EdgeReader::Weight
+	template<typename T_WEIGHT>
+	struct SearchTypes {
+		typedef BasicBorderInfo<T_WEIGHT> BorderInfo;
+		typedef std::priority_queue<BorderInfo> BorderQueue;
+		typedef BasicDijkstraNodeInfo<T_WEIGHT> DijkstraNodeInfo;
+		typedef BasicAStarNodeInfo<T_WEIGHT> AStarNodeInfo;
+		///reused by all queries of a thread, see SearchWorkspace
+		typedef SearchWorkspace<DijkstraNodeInfo> NodeDistanceInfo;
+		typedef SearchWorkspace<AStarNodeInfo> AStarNodeDistanceInfo;
+	};
+	
 	struct DijkstraNodeInfoSet: DijkstraNodeInfo {
 		BorderIterator borderIt;
 		bool inBorder() const;
@@ -114,22 +474,6 @@ namespace DijkstraRouterImp {
 		DijkstraNodeInfoSet(uint32_t parentNodeId, double weight) : DijkstraNodeInfo(parentNodeId, weight), borderIt() {}
 	};
 
-	class NodeDistanceInfo {
-	public:
-		NodeDistanceInfo(uint32_t nodeCount) :
-		d(nodeCount)
-		{}
-		bool count(uint32_t nodeId) {
-			return d[nodeId].valid();
-		}
-		void emplace(uint32_t nodeId, DijkstraNodeInfo && data) {
-			d[nodeId] = std::move(data);
-		}
-		DijkstraNodeInfo & at(uint32_t nodeId) { return d[nodeId]; }
-	private:
-		std::vector<DijkstraNodeInfo> d;
-	};
-	
 	struct NodeDistanceInfoSet {
 		std::unordered_map<uint32_t, DijkstraNodeInfoSet> d;
 	};
@@ -157,87 +501,153 @@ namespace DijkstraRouterImp {
 	}
 }
 
-double DijkstraRouter::DistanceEdgePreferences::weight(const Graph::Edge& e) const {
-	return e.distance;
-}
-
-
-DijkstraRouter::TimeEdgePreferences::TimeEdgePreferences(uint32_t accessTypeMask, double vehicleMaxSpeed) :
-AccessAllowanceWeightEdgePreferences(accessTypeMask),
-vehicleMaxSpeed((vehicleMaxSpeed*1000.0)/3.6)
+template<typename T_EP>
+DijkstraRouter<T_EP>::DijkstraRouter(const Graph* g, const EdgePreferences & ep) :
+DijkstraRouterBase(g),
+m_ep(ep)
 {}
 
-double DijkstraRouter::TimeEdgePreferences::weight(const Graph::Edge& e) const {
-	return (double)e.distance / std::min<double>(e.speed, vehicleMaxSpeed);
+template<typename T_EP>
+double DijkstraRouter<T_EP>::edgeWeight(uint32_t edgeId) const {
+	return edgePreferencesWeight(graph(), m_ep, edgeId);
 }
 
-DijkstraRouter::DijkstraRouter(const Graph* g) :
-Router(g),
-m_ep(new DistanceEdgePreferences(Graph::Edge::AT_ALL))
-{}
-
-DijkstraRouter::~DijkstraRouter() {
-	delete m_ep;
-}
-
-void DijkstraRouter::setEP(Router::AccessAllowanceWeightEdgePreferences* ep) {
-	if (m_ep)
-		delete m_ep;
-	m_ep = ep;
-}
-
-void DijkstraRouter::route(uint32_t startNode, uint32_t endNode, Router::PathVisitor* pathVisitor) {
-	if (m_heapRoute) {
-		routeHeap(startNode, endNode, pathVisitor);
-	}
-	else {
-		routeSet(startNode, endNode, pathVisitor);
+template<typename T_EP>
+void DijkstraRouter<T_EP>::routeEndpoints(const SearchEndpoints & sources, const SearchEndpoints & targets, Router::PathVisitor* pathVisitor) {
+	typedef typename EdgeReader<T_EP>::Weight Weight;
+	m_stats = Stats();
+	switch (m_queueType) {
+	case QT_SET:
+		routeSet(sources, targets, pathVisitor);
+		break;
+	case QT_DARY_HEAP:
+		{
+			static thread_local IndexedDaryHeap<Weight, 4> border;
+			routeDecreaseKey(border, sources, targets, pathVisitor);
+		}
+		break;
+	case QT_RADIX_HEAP:
+		{
+			static thread_local RadixHeap<Weight> border;
+			routeDecreaseKey(border, sources, targets, pathVisitor);
+		}
+		break;
+	case QT_PRIO_QUEUE:
+	default:
+		routeHeap(sources, targets, pathVisitor);
+		break;
 	}
 }
 
-void DijkstraRouter::routeHeap(uint32_t startNode, uint32_t endNode, Router::PathVisitor* pathVisitor) {
-	using namespace DijkstraRouterImp;
-	
-	struct BorderInfo {
-		uint32_t nodeId;
-		double distance;
-		BorderInfo(uint32_t nodeId, double distance) : nodeId(nodeId), distance(distance) {}
-		bool operator<(const BorderInfo & other) const {
-			return (distance == other.distance ? nodeId < other.nodeId : distance >= other.distance);
-		}
-	};
+template<typename T_EP>
+template<typename T_HEAP>
+void DijkstraRouter<T_EP>::routeDecreaseKey(T_HEAP & border, const SearchEndpoints & sources, const SearchEndpoints & targets, Router::PathVisitor* pathVisitor) {
+	typedef typename EdgeReader<T_EP>::Weight Weight;
+	typedef DijkstraRouterImp::SearchTypes<Weight> ST;
+	typedef typename ST::DijkstraNodeInfo DijkstraNodeInfo;
 	
-	typedef std::priority_queue<BorderInfo> BorderQueue;
+	EdgeReader<T_EP> er(graph(), m_ep);
+	typename ST::NodeDistanceInfo & discoveredNodes = ST::NodeDistanceInfo::threadLocal();
+	discoveredNodes.reset(graph().nodeCount());
+	//keeps its storage between queries, only the remaining entries are removed by clear()
+	border.resize(graph().nodeCount());
 	
-	NodeDistanceInfo discoveredNodes(graph().nodeCount());
-	BorderQueue border;
-
+	//sources are their own parents
+	for(const SearchEndpoint & s : sources) {
+		Weight sw = toWeight<Weight>(s.weight);
+		if (!discoveredNodes.count(s.nodeId)) {
+			discoveredNodes.emplace(s.nodeId, DijkstraNodeInfo(s.nodeId, sw));
+			border.push(s.nodeId, sw);
+		}
+		else if (discoveredNodes.at(s.nodeId).weight > sw) {
+			discoveredNodes.at(s.nodeId).weight = sw;
+			border.decreaseKey(s.nodeId, sw);
+		}
+	}
 	
-	discoveredNodes.emplace(startNode, DijkstraNodeInfoSet(startNode, 0));
+	Weight bestWeight = infiniteWeight<Weight>();
+	uint32_t bestTarget = 0xFFFFFFFF;
 	
-	//first insert all neighbors of startNode into discovered nodes and into the border
-	{
-		for(Graph::ConstEdgeIterator eIt(graph().edgesBegin(startNode)), eEnd(graph().edgesEnd(startNode)); eIt != eEnd; ++eIt) {
-			const Graph::Edge & e = *eIt;
-			if (!m_ep->accessAllowed(e)) {
+	//every node is in the border at most once, hence there are no stale entries
+	while (!border.empty() && border.topKey() < bestWeight) {
+		uint32_t curNodeId = border.top();
+		border.pop();
+		++m_stats.settledNodes;
+		if (isCancelled()) {
+			break;
+		}
+		
+		Weight curWeight = discoveredNodes.at(curNodeId).weight;
+		Weight tw = targetWeight<Weight>(targets, curNodeId);
+		if (tw < bestWeight && curWeight + tw < bestWeight) {
+			bestWeight = curWeight + tw;
+			bestTarget = curNodeId;
+		}
+		if (bestWeight <= curWeight) {
+			break;
+		}
+		
+		for(uint32_t edgeId(graph().node(curNodeId).begin), end(graph().node(curNodeId).end); edgeId < end; ++edgeId) {
+			if (!er.accessAllowed(edgeId)) {
 				continue;
 			}
-			double weight = m_ep->weight(e);
-			if (discoveredNodes.count(e.target)) {
-				DijkstraNodeInfo & ni = discoveredNodes.at(e.target);
-				ni.weight = std::min(ni.weight, weight);
+			++m_stats.relaxedEdges;
+			uint32_t nextNodeId = er.target(edgeId);
+			Weight nw = curWeight + er.weight(edgeId);
+			if (!discoveredNodes.count(nextNodeId)) {
+				discoveredNodes.emplace(nextNodeId, DijkstraNodeInfo(curNodeId, nw));
+				border.push(nextNodeId, nw);
+				continue;
 			}
-			else {
-				discoveredNodes.emplace(e.target, DijkstraNodeInfoSet(startNode, weight));
+			DijkstraNodeInfo & nni = discoveredNodes.at(nextNodeId);
+			//settled nodes are not in the border and never get a smaller weight
+			if (nni.weight > nw && border.contains(nextNodeId)) {
+				nni.weight = nw;
+				nni.parentNodeId = curNodeId;
+				border.decreaseKey(nextNodeId, nw);
 			}
-			border.emplace(e.target, weight);
 		}
 	}
-	//now get the node on the border that is closest to startNode
+	border.clear();
+	
+	if (m_stats.cancelled || bestTarget == 0xFFFFFFFF) {
+		return;
+	}
+	visitPath(bestTarget, [&discoveredNodes](uint32_t nodeId) { return discoveredNodes.at(nodeId).parentNodeId; }, pathVisitor);
+}
+
+template<typename T_EP>
+void DijkstraRouter<T_EP>::routeHeap(const SearchEndpoints & sources, const SearchEndpoints & targets, Router::PathVisitor* pathVisitor) {
+	typedef typename EdgeReader<T_EP>::Weight Weight;
+	typedef DijkstraRouterImp::SearchTypes<Weight> ST;
+	typedef typename ST::DijkstraNodeInfo DijkstraNodeInfo;
+	
+	EdgeReader<T_EP> er(graph(), m_ep);
+	typename ST::NodeDistanceInfo & discoveredNodes = ST::NodeDistanceInfo::threadLocal();
+	discoveredNodes.reset(graph().nodeCount());
+	typename ST::BorderQueue border;
+	
+	//sources are their own parents
+	for(const SearchEndpoint & s : sources) {
+		Weight sw = toWeight<Weight>(s.weight);
+		if (!discoveredNodes.count(s.nodeId)) {
+			discoveredNodes.emplace(s.nodeId, DijkstraNodeInfo(s.nodeId, sw));
+			border.emplace(s.nodeId, sw);
+		}
+		else if (discoveredNodes.at(s.nodeId).weight > sw) {
+			discoveredNodes.at(s.nodeId).weight = sw;
+			border.emplace(s.nodeId, sw);
+		}
+	}
+	
+	Weight bestWeight = infiniteWeight<Weight>();
+	uint32_t bestTarget = 0xFFFFFFFF;
+	
+	//now get the node on the border that is closest to the sources
 	//remove it from the border and
 	//relax its neighbors if its distance is equal to the recorded in discoveredNodes
 	while (border.size()) {
-		BorderInfo binfo = border.top();
+		typename ST::BorderInfo binfo = border.top();
 		border.pop();
 		
 		uint32_t curNodeId = binfo.nodeId;
@@ -247,152 +657,622 @@ void DijkstraRouter::routeHeap(uint32_t startNode, uint32_t endNode, Router::Pat
 		if (binfo.distance > ni.weight) {
 			continue;
 		}
+		if (ni.weight >= bestWeight) {
+			break;
+		}
+		++m_stats.settledNodes;
+		if (isCancelled()) {
+			break;
+		}
 		
-		if (curNodeId == endNode) {
-			border = BorderQueue();
+		Weight tw = targetWeight<Weight>(targets, curNodeId);
+		if (tw < bestWeight && ni.weight + tw < bestWeight) {
+			bestWeight = ni.weight + tw;
+			bestTarget = curNodeId;
+		}
+		if (bestWeight <= ni.weight) {
 			break;
 		}
 		
-		for(Graph::ConstEdgeIterator eIt(graph().edgesBegin(curNodeId)), eEnd(graph().edgesEnd(curNodeId)); eIt != eEnd; ++eIt) {
-			const Graph::Edge & e = *eIt;
-			if (!m_ep->accessAllowed(e)) {
+		for(uint32_t edgeId(graph().node(curNodeId).begin), end(graph().node(curNodeId).end); edgeId < end; ++edgeId) {
+			if (!er.accessAllowed(edgeId)) {
 				continue;
 			}
-			if (discoveredNodes.count(e.target)) {//already there, update the distance if necessary
-				DijkstraNodeInfo & nni = discoveredNodes.at(e.target);
-				double edgeWeight = m_ep->weight(e);
-				if (nni.weight > ni.weight+edgeWeight) {
-					//this also means that e.target musst be in the border
-					nni.weight = ni.weight+edgeWeight;
+			++m_stats.relaxedEdges;
+			uint32_t nextNodeId = er.target(edgeId);
+			Weight nw = ni.weight + er.weight(edgeId);
+			if (discoveredNodes.count(nextNodeId)) {//already there, update the distance if necessary
+				DijkstraNodeInfo & nni = discoveredNodes.at(nextNodeId);
+				if (nni.weight > nw) {
+					//this also means that nextNodeId musst be in the border
+					nni.weight = nw;
 					nni.parentNodeId = curNodeId;
 					//just push it, don't do a decrease key
-					border.emplace(e.target, nni.weight);
+					border.emplace(nextNodeId, nni.weight);
 				}
 			}
 			else {
-				double nw = ni.weight+m_ep->weight(e);
-				discoveredNodes.emplace(e.target, DijkstraNodeInfoSet(curNodeId, nw));
-				border.emplace(e.target, nw);
+				discoveredNodes.emplace(nextNodeId, DijkstraNodeInfo(curNodeId, nw));
+				border.emplace(nextNodeId, nw);
 			}
 		}
 	}
 	
-	if (!discoveredNodes.count(endNode)) {
+	if (m_stats.cancelled || bestTarget == 0xFFFFFFFF) {
 		return;
 	}
-	
-	std::vector<uint32_t> tmp;
-	//backtrack
-	uint32_t curNodeId = endNode;
-	while(curNodeId != startNode) {
-		tmp.push_back(curNodeId);
-		curNodeId = discoveredNodes.at(curNodeId).parentNodeId;
-	}
-	tmp.push_back(startNode);
-	
-	//let pathVisitor know of the path
-	for(std::vector<uint32_t>::reverse_iterator it(tmp.rbegin()), end(tmp.rend()); it != end; ++it) {
-		pathVisitor->visit(*it);
-	}
+	visitPath(bestTarget, [&discoveredNodes](uint32_t nodeId) { return discoveredNodes.at(nodeId).parentNodeId; }, pathVisitor);
 }
 
-void DijkstraRouter::routeSet(uint32_t startNode, uint32_t endNode, Router::PathVisitor* pathVisitor) {
+template<typename T_EP>
+void DijkstraRouter<T_EP>::routeSet(const SearchEndpoints & sources, const SearchEndpoints & targets, Router::PathVisitor* pathVisitor) {
 	using namespace DijkstraRouterImp;
-
+	EdgeReader<T_EP> er(graph(), m_ep);
 	
 	NodeDistanceInfoSet discoveredNodes;
 	BorderSmaller bs(&discoveredNodes);
 	BorderSet border(bs); //this should actually be a heap, but C++ heap does not support decrease-key operation
 
-	
-	discoveredNodes.d.emplace(startNode, DijkstraNodeInfoSet(startNode, 0));
-	
-	//first insert all neighbors of startNode into discovered nodes and into the border
-	{
-		for(Graph::ConstEdgeIterator eIt(graph().edgesBegin(startNode)), eEnd(graph().edgesEnd(startNode)); eIt != eEnd; ++eIt) {
-			const Graph::Edge & e = *eIt;
-			if (!m_ep->accessAllowed(e)) {
-				continue;
-			}
-			if (discoveredNodes.d.count(e.target)) {
-				DijkstraNodeInfoSet & ni = discoveredNodes.d.at(e.target);
-				ni.weight = std::min(ni.weight, m_ep->weight(e));
-			}
-			else {
-				discoveredNodes.d.emplace(e.target, DijkstraNodeInfoSet(startNode, m_ep->weight(e)));
-			}
+	//sources are their own parents
+	for(const SearchEndpoint & s : sources) {
+		if (!discoveredNodes.d.count(s.nodeId)) {
+			auto x = discoveredNodes.d.emplace(s.nodeId, DijkstraNodeInfoSet(s.nodeId, s.weight));
+			x.first->second.setBorderIt( border.insert(s.nodeId) );
 		}
-		for(Graph::ConstEdgeIterator eIt(graph().edgesBegin(startNode)), eEnd(graph().edgesEnd(startNode)); eIt != eEnd; ++eIt) {
-			const Graph::Edge & e = *eIt;
-			if (m_ep->accessAllowed(e)) {
-				discoveredNodes.d.at(e.target).setBorderIt( border.insert(eIt->target) );
-			}
+		else if (discoveredNodes.d.at(s.nodeId).weight > s.weight) {
+			DijkstraNodeInfoSet & ni = discoveredNodes.d.at(s.nodeId);
+			border.erase(ni.borderIt);
+			ni.weight = s.weight;
+			ni.setBorderIt( border.insert(s.nodeId) );
 		}
 	}
-	//now get the node on the border that is closest to startNode
+	
+	double bestWeight = std::numeric_limits<double>::infinity();
+	uint32_t bestTarget = 0xFFFFFFFF;
+	
+	//now get the node on the border that is closest to the sources
 	//remove it from the border and relax its neighbors
 	while (border.size()) {
 		BorderIterator bIt = border.begin();
 		
 		uint32_t curNodeId = *bIt;
 		DijkstraNodeInfoSet & ni = discoveredNodes.d.at(curNodeId);
+		if (ni.weight >= bestWeight) {
+			break;
+		}
 		
 		border.erase(bIt);
 		ni.removeFromBorder();
+		++m_stats.settledNodes;
+		if (isCancelled()) {
+			break;
+		}
 		
-		if (curNodeId == endNode) {
-			border.clear();
+		if (ni.weight + targetWeight<double>(targets, curNodeId) < bestWeight) {
+			bestWeight = ni.weight + targetWeight<double>(targets, curNodeId);
+			bestTarget = curNodeId;
+		}
+		if (bestWeight <= ni.weight) {
 			break;
 		}
 		
-		for(Graph::ConstEdgeIterator eIt(graph().edgesBegin(curNodeId)), eEnd(graph().edgesEnd(curNodeId)); eIt != eEnd; ++eIt) {
-			const Graph::Edge & e = *eIt;
-			if (!m_ep->accessAllowed(e)) {
+		//the set keeps the weights as double, this queue is the baseline of the others
+		for(uint32_t edgeId(graph().node(curNodeId).begin), end(graph().node(curNodeId).end); edgeId < end; ++edgeId) {
+			if (!er.accessAllowed(edgeId)) {
 				continue;
 			}
-			if (discoveredNodes.d.count(e.target)) {//already there, update the distance if necessary
-				DijkstraNodeInfoSet & nni = discoveredNodes.d.at(e.target);
-				if (nni.weight > ni.weight+m_ep->weight(e)) {
-					//this also means that e.target musst be in the border
+			++m_stats.relaxedEdges;
+			uint32_t nextNodeId = er.target(edgeId);
+			double nw = ni.weight + er.weight(edgeId);
+			if (discoveredNodes.d.count(nextNodeId)) {//already there, update the distance if necessary
+				DijkstraNodeInfoSet & nni = discoveredNodes.d.at(nextNodeId);
+				if (nni.weight > nw) {
+					//this also means that nextNodeId musst be in the border
 					
 					//we FIRST have to remove this from the border to preserve the ordering in it
 					border.erase(nni.borderIt); //decrease-key operation part-1
 					
-					nni.weight = ni.weight+m_ep->weight(e);
+					nni.weight = nw;
 					nni.parentNodeId = curNodeId;
 					
-					nni.setBorderIt( border.insert(e.target) );  //decrease-key operation part-2
+					nni.setBorderIt( border.insert(nextNodeId) );  //decrease-key operation part-2
 				}
 			}
 			else {
-				auto x = discoveredNodes.d.emplace(e.target, DijkstraNodeInfoSet(curNodeId, ni.weight+m_ep->weight(e)));
-				x.first->second.setBorderIt( border.insert(e.target) );
+				auto x = discoveredNodes.d.emplace(nextNodeId, DijkstraNodeInfoSet(curNodeId, nw));
+				x.first->second.setBorderIt( border.insert(nextNodeId) );
 			}
 		}
 	}
 	
-	if (!discoveredNodes.d.count(endNode)) {
+	if (m_stats.cancelled || bestTarget == 0xFFFFFFFF) {
 		return;
 	}
+	visitPath(bestTarget, [&discoveredNodes](uint32_t nodeId) { return discoveredNodes.d.at(nodeId).parentNodeId; }, pathVisitor);
+}
+
+template<typename T_EP>
+BiDijkstraRouter<T_EP>::BiDijkstraRouter(const Graph* g, const EdgePreferences & ep) :
+Router(g),
+m_ep(ep)
+{}
+
+template<typename T_EP>
+double BiDijkstraRouter<T_EP>::edgeWeight(uint32_t edgeId) const {
+	return edgePreferencesWeight(graph(), m_ep, edgeId);
+}
+
+template<typename T_EP>
+void BiDijkstraRouter<T_EP>::routeEndpoints(const SearchEndpoints & sources, const SearchEndpoints & targets, Router::PathVisitor* pathVisitor) {
+	typedef typename EdgeReader<T_EP>::Weight Weight;
+	typedef DijkstraRouterImp::SearchTypes<Weight> ST;
+	typedef typename ST::DijkstraNodeInfo DijkstraNodeInfo;
+	typedef typename ST::NodeDistanceInfo NodeDistanceInfo;
+	m_stats = Stats();
 	
-	std::vector<uint32_t> tmp;
-	//backtrack
-	uint32_t curNodeId = endNode;
-	while(curNodeId != startNode) {
-		tmp.push_back(curNodeId);
-		curNodeId = discoveredNodes.d.at(curNodeId).parentNodeId;
+	EdgeReader<T_EP> er(graph(), m_ep);
+	//index 0 is the forward search, index 1 the backward search
+	NodeDistanceInfo * discoveredNodes[2] = { &NodeDistanceInfo::threadLocal(0), &NodeDistanceInfo::threadLocal(1) };
+	discoveredNodes[0]->reset(graph().nodeCount());
+	discoveredNodes[1]->reset(graph().nodeCount());
+	typename ST::BorderQueue border[2];
+	
+	Weight bestWeight = infiniteWeight<Weight>();
+	uint32_t meetingNode = std::numeric_limits<uint32_t>::max();
+	
+	//the forward search starts at the sources, the backward search at the targets, both are their own parents
+	const SearchEndpoints * endpoints[2] = { &sources, &targets };
+	for(uint32_t dir(0); dir < 2; ++dir) {
+		NodeDistanceInfo & myNodes = *discoveredNodes[dir];
+		for(const SearchEndpoint & x : *endpoints[dir]) {
+			Weight xw = toWeight<Weight>(x.weight);
+			if (!myNodes.count(x.nodeId)) {
+				myNodes.emplace(x.nodeId, DijkstraNodeInfo(x.nodeId, xw));
+				border[dir].emplace(x.nodeId, xw);
+			}
+			else if (myNodes.at(x.nodeId).weight > xw) {
+				myNodes.at(x.nodeId).weight = xw;
+				border[dir].emplace(x.nodeId, xw);
+			}
+		}
+	}
+	for(const SearchEndpoint & s : sources) {
+		if (discoveredNodes[1]->count(s.nodeId)) {
+			Weight w = discoveredNodes[0]->at(s.nodeId).weight + discoveredNodes[1]->at(s.nodeId).weight;
+			if (w < bestWeight) {
+				bestWeight = w;
+				meetingNode = s.nodeId;
+			}
+		}
 	}
-	tmp.push_back(startNode);
 	
-	//let pathVisitor know of the path
-	for(std::vector<uint32_t>::reverse_iterator it(tmp.rbegin()), end(tmp.rend()); it != end; ++it) {
-		pathVisitor->visit(*it);
+	//every path found later is at least as long as the sum of both minima
+	for(uint32_t dir(0); border[0].size() && border[1].size(); dir = 1-dir) {
+		if (border[0].top().distance + border[1].top().distance >= bestWeight) {
+			break;
+		}
+		typename ST::BorderInfo binfo = border[dir].top();
+		border[dir].pop();
+		
+		uint32_t curNodeId = binfo.nodeId;
+		NodeDistanceInfo & myNodes = *discoveredNodes[dir];
+		NodeDistanceInfo & otherNodes = *discoveredNodes[1-dir];
+		Weight curWeight = myNodes.at(curNodeId).weight;
+		
+		if (binfo.distance > curWeight) {
+			continue;
+		}
+		++m_stats.settledNodes;
+		if (isCancelled()) {
+			break;
+		}
+		
+		auto relax = [&](uint32_t edgeId, uint32_t nextNodeId) {
+			++m_stats.relaxedEdges;
+			Weight nw = curWeight + er.weight(edgeId);
+			if (!myNodes.count(nextNodeId)) {
+				myNodes.emplace(nextNodeId, DijkstraNodeInfo(curNodeId, nw));
+				border[dir].emplace(nextNodeId, nw);
+			}
+			else {
+				DijkstraNodeInfo & nni = myNodes.at(nextNodeId);
+				if (nni.weight > nw) {
+					nni.weight = nw;
+					nni.parentNodeId = curNodeId;
+					border[dir].emplace(nextNodeId, nw);
+				}
+				else {
+					return;
+				}
+			}
+			if (otherNodes.count(nextNodeId) && nw + otherNodes.at(nextNodeId).weight < bestWeight) {
+				bestWeight = nw + otherNodes.at(nextNodeId).weight;
+				meetingNode = nextNodeId;
+			}
+		};
+		
+		if (dir == 0) {
+			for(uint32_t edgeId(graph().node(curNodeId).begin), end(graph().node(curNodeId).end); edgeId < end; ++edgeId) {
+				if (er.accessAllowed(edgeId)) {
+					relax(edgeId, er.target(edgeId));
+				}
+			}
+		}
+		else {
+			//the reverse edges only know the edge ids, hence the source is read from the edge
+			for(Graph::ConstEdgeRefIterator it(graph().reverseEdgesBegin(curNodeId)), end(graph().reverseEdgesEnd(curNodeId)); it != end; ++it) {
+				if (er.accessAllowed(*it)) {
+					relax(*it, graph().edge(*it).source);
+				}
+			}
+		}
+	}
+	
+	if (m_stats.cancelled || meetingNode == std::numeric_limits<uint32_t>::max()) {
+		return;
+	}
+	
+	visitPath(meetingNode, [&discoveredNodes](uint32_t nodeId) { return discoveredNodes[0]->at(nodeId).parentNodeId; }, pathVisitor);
+	//the parents of the backward search point towards the target
+	for(uint32_t curNodeId = meetingNode; discoveredNodes[1]->at(curNodeId).parentNodeId != curNodeId;) {
+		curNodeId = discoveredNodes[1]->at(curNodeId).parentNodeId;
+		pathVisitor->visit(curNodeId);
 	}
 }
 
-void AStarRouter::route(uint32_t /*startNode*/, uint32_t /*endNode*/, Router::PathVisitor* /*pathVisitor*/) {
+namespace AStarRouterImp {
+	///Great-circle distance to the closest target converted by the edge preferences, see AccessAllowanceWeightEdgePreferences::lowerBound.
+	///The weight of a target is added to its bound, the minimum over all targets is still consistent.
+	///Both are rounded down separately for integral weights, like the weights of the endpoints
+	template<typename T_EP, typename T_WEIGHT>
+	class GreatCircleBound {
+	public:
+		GreatCircleBound(const Graph & g, const T_EP & ep, const Router::SearchEndpoints & targets) : m_g(g), m_ep(ep), m_targets(targets) {}
+		T_WEIGHT operator()(uint32_t nodeId) const {
+			const Graph::NodeInfo & ni = m_g.nodeInfo(nodeId);
+			T_WEIGHT lb = infiniteWeight<T_WEIGHT>();
+			for(const Router::SearchEndpoint & t : m_targets) {
+				const Graph::NodeInfo & ti = m_g.nodeInfo(t.nodeId);
+				lb = std::min(lb, toWeight<T_WEIGHT>(m_ep.lowerBound( distanceTo(ni.lat, ni.lon, ti.lat, ti.lon) )) + toWeight<T_WEIGHT>(t.weight));
+			}
+			return lb;
+		}
+	private:
+		const Graph & m_g;
+		const T_EP & m_ep;
+		const Router::SearchEndpoints & m_targets;
+	};
+	
+	///maximum of the landmark bounds of the given landmarks to the closest target
+	class LandmarkBound {
+	public:
+		LandmarkBound(const LandmarkInfo & li, const std::vector<uint32_t> & landmarks, const Router::SearchEndpoints & targets) :
+		m_li(li), m_landmarks(landmarks), m_targets(targets) {}
+		uint64_t operator()(uint32_t nodeId) const {
+			uint64_t result = infiniteWeight<uint64_t>();
+			for(const Router::SearchEndpoint & t : m_targets) {
+				uint64_t lb = 0;
+				for(uint32_t i : m_landmarks) {
+					lb = std::max(lb, m_li.lowerBound(nodeId, t.nodeId, i));
+				}
+				result = std::min(result, lb + toWeight<uint64_t>(t.weight));
+			}
+			return result;
+		}
+	private:
+		const LandmarkInfo & m_li;
+		const std::vector<uint32_t> & m_landmarks;
+		const Router::SearchEndpoints & m_targets;
+	};
 }
 
+template<typename T_EP>
+AStarRouterBase<T_EP>::AStarRouterBase(const Graph* g, const EdgePreferences & ep) :
+Router(g),
+m_ep(ep)
+{}
+
+template<typename T_EP>
+double AStarRouterBase<T_EP>::edgeWeight(uint32_t edgeId) const {
+	return edgePreferencesWeight(graph(), m_ep, edgeId);
+}
 
+template<typename T_EP>
+template<typename T_LOWER_BOUND>
+void AStarRouterBase<T_EP>::routeAStar(const SearchEndpoints & sources, const SearchEndpoints & targets, const T_LOWER_BOUND & lowerBound, Router::PathVisitor* pathVisitor) {
+	typedef typename EdgeReader<T_EP>::Weight Weight;
+	typedef DijkstraRouterImp::SearchTypes<Weight> ST;
+	typedef typename ST::AStarNodeInfo AStarNodeInfo;
+	
+	EdgeReader<T_EP> er(graph(), m_ep);
+	typename ST::AStarNodeDistanceInfo & discoveredNodes = ST::AStarNodeDistanceInfo::threadLocal();
+	discoveredNodes.reset(graph().nodeCount());
+	typename ST::BorderQueue border;
+	
+	//sources are their own parents
+	for(const SearchEndpoint & s : sources) {
+		Weight sw = toWeight<Weight>(s.weight);
+		if (!discoveredNodes.count(s.nodeId)) {
+			discoveredNodes.emplace(s.nodeId, AStarNodeInfo(s.nodeId, sw, lowerBound(s.nodeId)));
+			border.emplace(s.nodeId, discoveredNodes.at(s.nodeId).key());
+		}
+		else if (discoveredNodes.at(s.nodeId).weight > sw) {
+			discoveredNodes.at(s.nodeId).weight = sw;
+			border.emplace(s.nodeId, discoveredNodes.at(s.nodeId).key());
+		}
+	}
+	
+	Weight bestWeight = infiniteWeight<Weight>();
+	uint32_t bestTarget = 0xFFFFFFFF;
+	
+	//the border is ordered by weight+lowerBound instead of the weight alone
+	//otherwise this is the same as DijkstraRouter::routeHeap
+	while (border.size()) {
+		typename ST::BorderInfo binfo = border.top();
+		border.pop();
+		
+		uint32_t curNodeId = binfo.nodeId;
+		AStarNodeInfo & ni = discoveredNodes.at(curNodeId);
+		
+		//check if we have to expand it
+		if (binfo.distance > ni.key()) {
+			continue;
+		}
+		if (ni.key() >= bestWeight) {
+			break;
+		}
+		++m_stats.settledNodes;
+		if (isCancelled()) {
+			break;
+		}
+		
+		Weight tw = targetWeight<Weight>(targets, curNodeId);
+		if (tw < bestWeight && ni.weight + tw < bestWeight) {
+			bestWeight = ni.weight + tw;
+			bestTarget = curNodeId;
+		}
+		if (bestWeight <= ni.key()) {
+			break;
+		}
+		
+		for(uint32_t edgeId(graph().node(curNodeId).begin), end(graph().node(curNodeId).end); edgeId < end; ++edgeId) {
+			if (!er.accessAllowed(edgeId)) {
+				continue;
+			}
+			++m_stats.relaxedEdges;
+			uint32_t nextNodeId = er.target(edgeId);
+			Weight nw = ni.weight + er.weight(edgeId);
+			if (!discoveredNodes.count(nextNodeId)) {
+				discoveredNodes.emplace(nextNodeId, AStarNodeInfo(curNodeId, nw, lowerBound(nextNodeId)));
+				border.emplace(nextNodeId, discoveredNodes.at(nextNodeId).key());
+				continue;
+			}
+			AStarNodeInfo & nni = discoveredNodes.at(nextNodeId);
+			if (nni.weight > nw) {
+				//reuse the lower bound, it does not depend on the path
+				nni.weight = nw;
+				nni.parentNodeId = curNodeId;
+				border.emplace(nextNodeId, nni.key());
+			}
+		}
+	}
+	
+	if (m_stats.cancelled || bestTarget == 0xFFFFFFFF) {
+		return;
+	}
+	visitPath(bestTarget, [&discoveredNodes](uint32_t nodeId) { return discoveredNodes.at(nodeId).parentNodeId; }, pathVisitor);
+}
+
+template<typename T_EP>
+AStarRouter<T_EP>::AStarRouter(const Graph* g, const EdgePreferences & ep) :
+AStarRouterBase<T_EP>(g, ep)
+{}
+
+template<typename T_EP>
+void AStarRouter<T_EP>::routeEndpoints(const SearchEndpoints & sources, const SearchEndpoints & targets, Router::PathVisitor* pathVisitor) {
+	typedef typename EdgeReader<T_EP>::Weight Weight;
+	this->m_stats = Router::Stats();
+	
+	if (!sources.size() || !targets.size()) {
+		return;
+	}
+	this->routeAStar(sources, targets, AStarRouterImp::GreatCircleBound<T_EP, Weight>(this->graph(), this->m_ep, targets), pathVisitor);
+}
+
+template class HopDistanceRouter<Router::AccessAllowanceEdgePreferences>;
+template class HopDistanceRouter<Router::MetricEdgePreferences>;
+template class DijkstraRouter<Router::DistanceEdgePreferences>;
+template class DijkstraRouter<Router::TimeEdgePreferences>;
+template class DijkstraRouter<Router::MetricEdgePreferences>;
+template class BiDijkstraRouter<Router::DistanceEdgePreferences>;
+template class BiDijkstraRouter<Router::TimeEdgePreferences>;
+template class BiDijkstraRouter<Router::MetricEdgePreferences>;
+template class AStarRouterBase<Router::DistanceEdgePreferences>;
+template class AStarRouterBase<Router::TimeEdgePreferences>;
+template class AStarRouterBase<Router::MetricEdgePreferences>;
+template class AStarRouter<Router::DistanceEdgePreferences>;
+template class AStarRouter<Router::TimeEdgePreferences>;
+template class AStarRouter<Router::MetricEdgePreferences>;
+
+ALTRouter::ALTRouter(const Graph* g, const Metric* metric, const LandmarkInfo* landmarkInfo) :
+AStarRouterBase<MetricEdgePreferences>(g, MetricEdgePreferences(metric)),
+m_landmarkInfo(landmarkInfo),
+m_activeLandmarkCount(4)
+{}
+
+void ALTRouter::routeEndpoints(const SearchEndpoints & sources, const SearchEndpoints & targets, Router::PathVisitor* pathVisitor) {
+	m_stats = Stats();
+	
+	if (!sources.size() || !targets.size()) {
+		return;
+	}
+	
+	const LandmarkInfo & li = *m_landmarkInfo;
+	
+	//select the landmarks with the best lower bound of the whole route, endpoints of phantom nodes lie next to each other
+	uint32_t startNode = sources.front().nodeId;
+	uint32_t endNode = targets.front().nodeId;
+	m_activeLandmarks.resize(li.landmarkCount());
+	for(uint32_t i(0), s(li.landmarkCount()); i < s; ++i) {
+		m_activeLandmarks[i] = i;
+	}
+	uint32_t activeCount = std::min<uint32_t>(m_activeLandmarkCount, m_activeLandmarks.size());
+	std::partial_sort(m_activeLandmarks.begin(), m_activeLandmarks.begin()+activeCount, m_activeLandmarks.end(),
+		[&li, startNode, endNode](uint32_t a, uint32_t b) {
+			return li.lowerBound(startNode, endNode, a) > li.lowerBound(startNode, endNode, b);
+		}
+	);
+	m_activeLandmarks.resize(activeCount);
+	
+	routeAStar(sources, targets, AStarRouterImp::LandmarkBound(li, m_activeLandmarks, targets), pathVisitor);
+}
+
+namespace CHRouterImp {
+	struct CHNodeInfo {
+		uint64_t weight;
+		///edge used to reach this node, CHInfo::invalid_edge for the start node
+		uint32_t parentEdgeId;
+		CHNodeInfo() : weight(std::numeric_limits<uint64_t>::max()), parentEdgeId(CHInfo::invalid_edge) {}
+		CHNodeInfo(uint64_t weight, uint32_t parentEdgeId) : weight(weight), parentEdgeId(parentEdgeId) {}
+	};
+	
+	///search spaces of a CH query are small, hence a hash map is cheaper than a vector of nodeCount entries
+	typedef std::unordered_map<uint32_t, CHNodeInfo> CHNodeInfoMap;
+}
+
+CHRouter::CHRouter(const Graph* g, const CHInfo* chinfo, const Metric* metric) :
+Router(g),
+m_chInfo(chinfo),
+m_ep(metric)
+{}
+
+double CHRouter::edgeWeight(uint32_t edgeId) const {
+	//the weights of the metric are those of the base edges in the CH, parallel edges keep their own weight
+	return edgePreferencesWeight(graph(), m_ep, edgeId);
+}
+
+void CHRouter::routeEndpoints(const SearchEndpoints & sources, const SearchEndpoints & targets, Router::PathVisitor* pathVisitor) {
+	using namespace DijkstraRouterImp;
+	using namespace CHRouterImp;
+	m_stats = Stats();
+	
+	const CHInfo & ch = *m_chInfo;
+	
+	//index 0 is the forward search in the upward graph
+	//index 1 is the backward search in the downward graph
+	CHNodeInfoMap discoveredNodes[2];
+	BorderQueue border[2];
+	
+	uint64_t bestWeight = std::numeric_limits<uint64_t>::max();
+	uint32_t meetingNode = std::numeric_limits<uint32_t>::max();
+	
+	//the weights of the CH are integral and rounded down like those of the other routers, endpoints without parent edge end the backtracking
+	const SearchEndpoints * endpoints[2] = { &sources, &targets };
+	for(uint32_t dir(0); dir < 2; ++dir) {
+		for(const SearchEndpoint & x : *endpoints[dir]) {
+			uint64_t weight = toWeight<uint64_t>(x.weight);
+			CHNodeInfo & ni = discoveredNodes[dir][x.nodeId];
+			if (ni.weight > weight) {
+				ni = CHNodeInfo(weight, CHInfo::invalid_edge);
+				border[dir].emplace(x.nodeId, weight);
+			}
+		}
+	}
+	
+	//alternate between both directions, a direction is done once its minimum is not smaller than the best path
+	for(uint32_t dir(0); border[0].size() || border[1].size(); dir = 1-dir) {
+		if (border[dir].size() && border[dir].top().distance >= bestWeight) {
+			border[dir] = BorderQueue();
+		}
+		if (!border[dir].size()) {
+			continue;
+		}
+		BorderInfo binfo = border[dir].top();
+		border[dir].pop();
+		
+		uint32_t curNodeId = binfo.nodeId;
+		CHNodeInfoMap & myNodes = discoveredNodes[dir];
+		CHNodeInfoMap & otherNodes = discoveredNodes[1-dir];
+		uint64_t curWeight = myNodes.at(curNodeId).weight;
+		
+		if (binfo.distance > curWeight) {
+			continue;
+		}
+		++m_stats.settledNodes;
+		if (isCancelled()) {
+			break;
+		}
+		
+		{
+			CHNodeInfoMap::const_iterator it = otherNodes.find(curNodeId);
+			if (it != otherNodes.cend() && curWeight + it->second.weight < bestWeight) {
+				bestWeight = curWeight + it->second.weight;
+				meetingNode = curNodeId;
+			}
+		}
+		
+		//stall-on-demand: if a node of higher level reaches curNodeId with a smaller weight
+		//then curNodeId is not on a shortest path and does not need to be expanded
+		bool stalled = false;
+		for(CHInfo::ConstEdgeRefIterator it(dir ? ch.upEdgesBegin(curNodeId) : ch.downEdgesBegin(curNodeId)),
+			end(dir ? ch.upEdgesEnd(curNodeId) : ch.downEdgesEnd(curNodeId)); it != end && !stalled; ++it)
+		{
+			const CHInfo::CHEdge & e = ch.edge(*it);
+			CHNodeInfoMap::const_iterator nIt = myNodes.find(dir ? e.target : e.source);
+			stalled = (nIt != myNodes.cend() && nIt->second.weight + e.weight < curWeight);
+		}
+		if (stalled) {
+			continue;
+		}
+		
+		for(CHInfo::ConstEdgeRefIterator it(dir ? ch.downEdgesBegin(curNodeId) : ch.upEdgesBegin(curNodeId)),
+			end(dir ? ch.downEdgesEnd(curNodeId) : ch.upEdgesEnd(curNodeId)); it != end; ++it)
+		{
+			const CHInfo::CHEdge & e = ch.edge(*it);
+			uint32_t nextNodeId = (dir ? e.source : e.target);
+			uint64_t nw = curWeight + e.weight;
+			++m_stats.relaxedEdges;
+			CHNodeInfo & nni = myNodes[nextNodeId];
+			if (nni.weight > nw) {
+				nni = CHNodeInfo(nw, *it);
+				border[dir].emplace(nextNodeId, nw);
+			}
+		}
+	}
+	
+	if (m_stats.cancelled || meetingNode == std::numeric_limits<uint32_t>::max()) {
+		return;
+	}
+	
+	std::vector<uint32_t> tmp;
+	//backtrack the forward search
+	uint32_t startNode = meetingNode;
+	for(uint32_t edgeId(discoveredNodes[0].at(startNode).parentEdgeId); edgeId != CHInfo::invalid_edge; edgeId = discoveredNodes[0].at(startNode).parentEdgeId) {
+		tmp.push_back(edgeId);
+		startNode = ch.edge(edgeId).source;
+	}
+	
+	//let pathVisitor know of the path, shortcuts are unpacked to base graph nodes
+	struct VisitIterator {
+		PathVisitor * pv;
+		VisitIterator & operator*() { return *this; }
+		VisitIterator & operator++() { return *this; }
+		VisitIterator & operator=(uint32_t nodeId) {
+			pv->visit(nodeId);
+			return *this;
+		}
+	};
+	VisitIterator out{pathVisitor};
+	pathVisitor->visit(startNode);
+	for(std::vector<uint32_t>::reverse_iterator it(tmp.rbegin()), end(tmp.rend()); it != end; ++it) {
+		ch.unpack(*it, out);
+	}
+	//the backward search already has the correct order
+	for(uint32_t curNodeId = meetingNode; discoveredNodes[1].at(curNodeId).parentEdgeId != CHInfo::invalid_edge;) {
+		uint32_t edgeId = discoveredNodes[1].at(curNodeId).parentEdgeId;
+		ch.unpack(edgeId, out);
+		curNodeId = ch.edge(edgeId).target;
+	}
+}
 
-}}//end namespace
\ No newline at end of file
+}}//end namespace
@@ -2,11 +2,32 @@
 #define SIMPLE_ROUTE_ROUTER_H
 #include "Graph.h"
 #include "CHGraph.h"
+#include "SimpleBitVector.h"
 
 #include <unordered_set>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <memory>
 
 namespace simpleroute {
 
+class Metric;
+class LandmarkInfo;
+
+///Cooperative cancellation of Router::route(), cancel() may be called from any thread.
+///The routers check it once per settled node
+class CancellationToken {
+public:
+	CancellationToken() : m_cancelled(false) {}
+	inline void cancel() { m_cancelled.store(true, std::memory_order_relaxed); }
+	inline bool cancelled() const { return m_cancelled.load(std::memory_order_relaxed); }
+private:
+	std::atomic<bool> m_cancelled;
+};
+
+typedef std::shared_ptr<CancellationToken> CancellationTokenPtr;
+
 class Router {
 public:
 	struct PathVisitor {
@@ -18,91 +39,296 @@ public:
 		uint32_t accessTypeMask;
 		AccessAllowanceEdgePreferences(uint32_t accessTypeMask = Graph::Edge::AT_ALL) : accessTypeMask(accessTypeMask) {}
 		virtual ~AccessAllowanceEdgePreferences() {}
-		virtual bool accessAllowed(const Graph::Edge & e) const;
+		virtual bool accessAllowed(const Graph::Edge & e) const { return e.access & accessTypeMask; }
 	};
 	
 	struct AccessAllowanceWeightEdgePreferences: AccessAllowanceEdgePreferences {
 		AccessAllowanceWeightEdgePreferences(uint32_t accessTypeMask) : AccessAllowanceEdgePreferences(accessTypeMask) {}
 		virtual ~AccessAllowanceWeightEdgePreferences() {}
 		virtual double weight(const Graph::Edge & e) const = 0;
+		///lower bound of the weight of a path whose endpoints have the beeline distance @param distance (in meters)
+		///The default of 0.0 is always admissible
+		virtual double lowerBound(double /*distance*/) const { return 0.0; }
+	};
+	
+	//The routers store the preferences by value, so calls to their final overriders are resolved at compile time
+	
+	struct DistanceEdgePreferences final: AccessAllowanceWeightEdgePreferences {
+		DistanceEdgePreferences(uint32_t accessTypeMask) : AccessAllowanceWeightEdgePreferences(accessTypeMask) {}
+		virtual ~DistanceEdgePreferences() {}
+		virtual double weight(const Graph::Edge& e) const override { return e.distance; }
+		virtual double lowerBound(double distance) const override { return distance; }
+	};
+
+	struct TimeEdgePreferences final: AccessAllowanceWeightEdgePreferences {
+		///@param vehicleMaxSpeed in km/h
+		TimeEdgePreferences(uint32_t accessTypeMask, double vehicleMaxSpeed);
+		virtual ~TimeEdgePreferences() {}
+		virtual double weight(const Graph::Edge& e) const override {
+			return (double)e.distance / std::min<double>(e.speed, vehicleMaxSpeed);
+		}
+		///no edge can be traversed faster than with vehicleMaxSpeed
+		virtual double lowerBound(double distance) const override { return distance / vehicleMaxSpeed; }
+		double vehicleMaxSpeed;
+	};
+	
+	///Uses the weights materialised by a Metric, the edges passed in have to be those of the graph of the metric.
+	///The routers do not call accessAllowed() and weight() but read the targets and weights of the metric directly
+	///and search with integral weights, edges with infinite weight are not allowed
+	struct MetricEdgePreferences final: AccessAllowanceWeightEdgePreferences {
+		MetricEdgePreferences(const Metric * metric);
+		virtual ~MetricEdgePreferences() {}
+		virtual bool accessAllowed(const Graph::Edge & e) const override;
+		virtual double weight(const Graph::Edge & e) const override;
+		virtual double lowerBound(double distance) const override { return lowerBoundFactor*distance; }
+		inline uint32_t edgeId(const Graph::Edge & e) const { return &e - edgesBegin; }
+		const Metric * metric;
+		const Graph::Edge * edgesBegin;
+		double lowerBoundFactor;
+	};
+	
+	struct Stats {
+		///number of nodes removed from the border (including the target)
+		uint32_t settledNodes;
+		///number of allowed edges whose target weight was computed
+		uint64_t relaxedEdges;
+		///the query was cancelled and did not report a path
+		bool cancelled;
+		Stats() : settledNodes(0), relaxedEdges(0), cancelled(false) {}
+	};
+	
+	///A node where a search starts or ends, weight is the weight between the node and the actual start or end of the route
+	struct SearchEndpoint {
+		uint32_t nodeId;
+		double weight;
+		SearchEndpoint(uint32_t nodeId, double weight) : nodeId(nodeId), weight(weight) {}
 	};
+	typedef std::vector<SearchEndpoint> SearchEndpoints;
 	
 	typedef enum {
 		HOP_DISTANCE,
 		DIJKSTRA_SET_DISTANCE, DIJKSTRA_SET_TIME,
 		DIJKSTRA_PRIO_QUEUE_DISTANCE, DIJKSTRA_PRIO_QUEUE_TIME,
-		A_STAR_DISTANCE, A_STAR_TIME
+		DIJKSTRA_DARY_HEAP_DISTANCE, DIJKSTRA_DARY_HEAP_TIME,
+		DIJKSTRA_RADIX_HEAP_DISTANCE, DIJKSTRA_RADIX_HEAP_TIME,
+		BI_DIJKSTRA_DISTANCE, BI_DIJKSTRA_TIME,
+		ALT_DISTANCE, ALT_TIME,
+		A_STAR_DISTANCE, A_STAR_TIME,
+		CH_DISTANCE, CH_TIME
 	} RouterTypes;
 public:
 	Router(const Graph * g) : m_g(g) {}
 	virtual ~Router() {}
-	virtual void route(uint32_t startNode, uint32_t endNode, PathVisitor * pathVisitor) = 0;
+	///same as routeEndpoints() with startNode and endNode as only endpoints
+	void route(uint32_t startNode, uint32_t endNode, PathVisitor * pathVisitor);
+	///Route between two positions on edges, e.g. from Grid::closestEdge. The path starts at a node of the edge of start and ends at a node of the edge of end,
+	///the search includes the weights of the traversed parts of both edges. Use Graph::routeInfo(const PhantomNode &...) to measure the route.
+	///Returns false if there is no route, the path is empty if end lies ahead of start on the same edge
+	bool route(const Graph::PhantomNode & start, const Graph::PhantomNode & end, PathVisitor * pathVisitor);
+	///Shortest path from any of the sources to any of the targets, the weights of the endpoints are part of the weight of a path.
+	///The path is reported from the chosen source to the chosen target. Targets are looked up linearly, they are meant to be few
+	virtual void routeEndpoints(const SearchEndpoints & sources, const SearchEndpoints & targets, PathVisitor * pathVisitor) = 0;
+	///statistics of the last call to route()
+	inline const Stats & stats() const { return m_stats; }
+	///route() returns without a path as soon as ct is cancelled, ct may be null
+	inline void setCancellationToken(const CancellationTokenPtr & ct) { m_cancellationToken = ct; }
 protected:
 	inline const Graph & graph() const { return *m_g; }
+	///weight the router uses for edgeId, infinite if the edge is not allowed. Phantom nodes are placed on edges with it
+	virtual double edgeWeight(uint32_t edgeId) const = 0;
+	///checks the cancellation token and records the result in m_stats
+	inline bool isCancelled() {
+		m_stats.cancelled = (m_cancellationToken && m_cancellationToken->cancelled());
+		return m_stats.cancelled;
+	}
+protected:
+	Stats m_stats;
 private:
 	const Graph * m_g;
+	CancellationTokenPtr m_cancellationToken;
 };
 
 namespace detail {
 
+//The routers are templated on their edge preferences (T_EP), which are one of the preferences of Router.
+//They are instantiated in Router.cpp for the preferences they support.
+
+///Level-synchronous breadth first search with a visited bitset and a dense parent array.
+///With direction optimisation a level whose frontier has many outgoing edges compared to the unvisited part of the graph
+///is expanded bottom-up: every unvisited node scans its incoming edges for a parent in the frontier.
+///This needs the reverse adjacency of the graph, without it all levels are expanded top-down.
+///Large levels can be expanded by several threads, small levels are always expanded by the calling thread.
+///The cancellation token is checked once per expanded node in sequential top-down levels and once per level otherwise
+template<typename T_EP = Router::AccessAllowanceEdgePreferences>
 class HopDistanceRouter: public Router {
 public:
-	HopDistanceRouter(const Graph * g);
-	virtual ~HopDistanceRouter();
-	///takes ownership of ep
-	void setEP(AccessAllowanceEdgePreferences * ep);
-	virtual void route(uint32_t startNode, uint32_t endNode, PathVisitor * pathVisitor) override;
+	typedef T_EP EdgePreferences;
+	///a top-down level switches to bottom-up if the edges of the frontier exceed 1/alpha of the edges of the unvisited nodes
+	static constexpr uint32_t bottom_up_alpha = 14;
+	///a bottom-up level switches back to top-down if the frontier is smaller than 1/beta of the nodes
+	static constexpr uint32_t top_down_beta = 24;
+	///levels with fewer nodes to scan are not expanded in parallel
+	static constexpr uint32_t parallel_min_level_size = 4096;
+public:
+	HopDistanceRouter(const Graph * g, const EdgePreferences & ep);
+	virtual ~HopDistanceRouter() {}
+	void setEP(const EdgePreferences & ep) { m_ep = ep; }
+	///disabled by default, it pays off for graphs with a high degree and small diameter.
+	///The frontiers of road networks are rarely large enough to switch to bottom-up
+	inline void setDirectionOptimizing(bool enabled) { m_directionOptimizing = enabled; }
+	///1 by default, 0 uses all cores
+	inline void setThreadCount(uint32_t threadCount) { m_threadCount = threadCount; }
+	///The weights of the endpoints are ignored, the path ends at the first target reached
+	virtual void routeEndpoints(const SearchEndpoints & sources, const SearchEndpoints & targets, PathVisitor * pathVisitor) override;
+	///number of edges of the path found by the last call to route(), 0xFFFFFFFF if there was none
+	inline uint32_t hopDistance() const { return m_hopDistance; }
+protected:
+	///0 for allowed edges, hence phantom nodes do not count as hops
+	virtual double edgeWeight(uint32_t edgeId) const override;
 private:
-	AccessAllowanceEdgePreferences * m_ep;
+	///(node, parent) pairs found by one thread in a parallel level
+	typedef std::vector< std::pair<uint32_t, uint32_t> > Candidates;
+private:
+	void topDownStep(uint32_t threadCount);
+	void bottomUpStep(uint32_t threadCount);
+	///marks nodeId as visited and appends it to the next frontier, returns false if it was already visited
+	inline bool visit(uint32_t nodeId, uint32_t parentNodeId);
+private:
+	EdgePreferences m_ep;
+	bool m_directionOptimizing;
+	uint32_t m_threadCount;
+	uint32_t m_hopDistance;
+	sserialize::SimpleBitVector m_visited;
+	///only valid for visited nodes
+	std::vector<uint32_t> m_parents;
+	std::vector<uint32_t> m_frontier;
+	std::vector<uint32_t> m_nextFrontier;
+	///the frontier as bitset for bottom-up levels
+	sserialize::SimpleBitVector m_frontierSet;
+	uint32_t m_visitedCount;
+	///sum of the out degrees of the unvisited nodes
+	uint64_t m_unvisitedEdges;
+	std::vector<Candidates> m_candidates;
 };
 
+class DijkstraRouterBase: public Router {
+public:
+	typedef enum {
+		///std::multiset with decrease-key by erase/insert
+		QT_SET,
+		///std::priority_queue with lazy deletion
+		QT_PRIO_QUEUE,
+		///IndexedDaryHeap with decrease-key
+		QT_DARY_HEAP,
+		///RadixHeap with decrease-key
+		QT_RADIX_HEAP
+	} QueueType;
+public:
+	DijkstraRouterBase(const Graph * g) : Router(g), m_queueType(QT_PRIO_QUEUE) {}
+	virtual ~DijkstraRouterBase() {}
+	void setQueueType(QueueType qt) { m_queueType = qt; }
+protected:
+	QueueType m_queueType;
+};
 
-class DijkstraRouter: public Router {
+template<typename T_EP>
+class DijkstraRouter: public DijkstraRouterBase {
 public:
-	struct DistanceEdgePreferences: AccessAllowanceWeightEdgePreferences {
-		DistanceEdgePreferences(uint32_t accessTypeMask) : AccessAllowanceWeightEdgePreferences(accessTypeMask) {}
-		virtual ~DistanceEdgePreferences() {}
-		virtual double weight(const Graph::Edge& e) const override;
-	};
+	typedef T_EP EdgePreferences;
+public:
+	DijkstraRouter(const Graph * g, const EdgePreferences & ep);
+	virtual ~DijkstraRouter() {}
+	void setEP(const EdgePreferences & ep) { m_ep = ep; }
+	virtual void routeEndpoints(const SearchEndpoints & sources, const SearchEndpoints & targets, PathVisitor * pathVisitor) override;
+protected:
+	virtual double edgeWeight(uint32_t edgeId) const override;
+	void routeSet(const SearchEndpoints & sources, const SearchEndpoints & targets, PathVisitor * pathVisitor);
+	void routeHeap(const SearchEndpoints & sources, const SearchEndpoints & targets, PathVisitor * pathVisitor);
+	///T_HEAP has the interface of IndexedDaryHeap
+	template<typename T_HEAP>
+	void routeDecreaseKey(T_HEAP & border, const SearchEndpoints & sources, const SearchEndpoints & targets, PathVisitor * pathVisitor);
+private:
+	EdgePreferences m_ep;
+};
 
-	struct TimeEdgePreferences: AccessAllowanceWeightEdgePreferences {
-		///@param vehicleMaxSpeed in km/h
-		TimeEdgePreferences(uint32_t accessTypeMask, double vehicleMaxSpeed);
-		virtual ~TimeEdgePreferences() {}
-		virtual double weight(const Graph::Edge& e) const override;
-		double vehicleMaxSpeed;
-	};
+///Bidirectional Dijkstra: alternates between a forward search from the start and a backward search from the end.
+///The backward search uses the reverse adjacency of the graph, see Graph::createReverseEdges
+template<typename T_EP>
+class BiDijkstraRouter: public Router {
 public:
-	DijkstraRouter(const Graph * g);
-	virtual ~DijkstraRouter();
-	
-	///takes ownership of ep
-	void setEP(AccessAllowanceWeightEdgePreferences * ep);
-	void setHeapType(bool usePrioQueue) { m_heapRoute = usePrioQueue; }
-	virtual void route(uint32_t startNode, uint32_t endNode, PathVisitor * pathVisitor) override;
+	typedef T_EP EdgePreferences;
+public:
+	BiDijkstraRouter(const Graph * g, const EdgePreferences & ep);
+	virtual ~BiDijkstraRouter() {}
+	void setEP(const EdgePreferences & ep) { m_ep = ep; }
+	virtual void routeEndpoints(const SearchEndpoints & sources, const SearchEndpoints & targets, PathVisitor * pathVisitor) override;
 protected:
-	void routeSet(uint32_t startNode, uint32_t endNode, PathVisitor * pathVisitor);
-	void routeHeap(uint32_t startNode, uint32_t endNode, PathVisitor * pathVisitor);
+	virtual double edgeWeight(uint32_t edgeId) const override;
 private:
-	AccessAllowanceWeightEdgePreferences * m_ep;
-	bool m_heapRoute;
+	EdgePreferences m_ep;
 };
 
-class AStarRouter: public Router {
+///A* search shared by AStarRouter and ALTRouter, they only differ in the lower bound
+template<typename T_EP>
+class AStarRouterBase: public Router {
+public:
+	typedef T_EP EdgePreferences;
 public:
-	AStarRouter(const Graph * g) : Router(g) {}
+	AStarRouterBase(const Graph * g, const EdgePreferences & ep);
+	virtual ~AStarRouterBase() {}
+protected:
+	virtual double edgeWeight(uint32_t edgeId) const override;
+	///T_LOWER_BOUND returns for a node a consistent lower bound of the weight to the closest target including the weight of the target.
+	///It is evaluated once per discovered node
+	template<typename T_LOWER_BOUND>
+	void routeAStar(const SearchEndpoints & sources, const SearchEndpoints & targets, const T_LOWER_BOUND & lowerBound, PathVisitor * pathVisitor);
+protected:
+	EdgePreferences m_ep;
+};
+
+///Goal-directed Dijkstra using the great-circle distance to the target as lower bound.
+///The lower bound is derived from the edge preferences, see AccessAllowanceWeightEdgePreferences::lowerBound
+template<typename T_EP>
+class AStarRouter: public AStarRouterBase<T_EP> {
+public:
+	typedef T_EP EdgePreferences;
+	typedef Router::SearchEndpoints SearchEndpoints;
+public:
+	AStarRouter(const Graph * g, const EdgePreferences & ep);
 	virtual ~AStarRouter() {}
-	virtual void route(uint32_t startNode, uint32_t endNode, PathVisitor * pathVisitor);
+	void setEP(const EdgePreferences & ep) { this->m_ep = ep; }
+	virtual void routeEndpoints(const SearchEndpoints & sources, const SearchEndpoints & targets, Router::PathVisitor * pathVisitor) override;
 };
 
+///A* with lower bounds from landmark distances (ALT).
+///Weights are those of the Metric the LandmarkInfo was created from.
+///Every query only uses the active landmarks which give the best lower bound from start to end
+class ALTRouter: public AStarRouterBase<Router::MetricEdgePreferences> {
+public:
+	ALTRouter(const Graph * g, const Metric * metric, const LandmarkInfo * landmarkInfo);
+	virtual ~ALTRouter() {}
+	///number of landmarks used per query
+	void setActiveLandmarkCount(uint32_t count) { m_activeLandmarkCount = count; }
+	virtual void routeEndpoints(const SearchEndpoints & sources, const SearchEndpoints & targets, PathVisitor * pathVisitor) override;
+private:
+	const LandmarkInfo * m_landmarkInfo;
+	uint32_t m_activeLandmarkCount;
+	std::vector<uint32_t> m_activeLandmarks;
+};
+
+///Bidirectional search in the upward graphs of a contraction hierarchy with stall-on-demand.
+///Access types and metric are those used to create the CHInfo, see CHConstructor.
+///Phantom nodes are placed with the weights of metric, which has to be the one the CHInfo was created from
 class CHRouter: public Router {
 public:
-	CHRouter(const Graph * g, const CHInfo * chinfo, Graph::Edge::AccessTypes at);
+	CHRouter(const Graph * g, const CHInfo * chinfo, const Metric * metric);
 	virtual ~CHRouter() {}
-	virtual void route(uint32_t startNode, uint32_t endNode, PathVisitor * pathVisitor);
+	virtual void routeEndpoints(const SearchEndpoints & sources, const SearchEndpoints & targets, PathVisitor * pathVisitor) override;
+protected:
+	virtual double edgeWeight(uint32_t edgeId) const override;
 private:
 	const CHInfo * m_chInfo;
-	Graph::Edge::AccessTypes at;
+	MetricEdgePreferences m_ep;
 };
 
 }}//end namespace
@@ -0,0 +1,219 @@
+#include "RouterFactory.h"
+#include "ChConstructor.h"
+#include <sstream>
+
+namespace simpleroute {
+
+double RouterFactory::vehicleMaxSpeed(int accessType) {
+	double vehicleMaxSpeed = 0.0;
+	if (Graph::Edge::AT_FOOT & accessType) {
+		vehicleMaxSpeed = 5.0;
+	}
+	if (Graph::Edge::AT_BIKE & accessType) {
+		vehicleMaxSpeed = 15.0;
+	}
+	if (Graph::Edge::AT_CAR & accessType) {
+		vehicleMaxSpeed = 130.0;
+	}
+	return vehicleMaxSpeed;
+}
+
+bool RouterFactory::timeMetric(int routerType) {
+	switch (routerType) {
+	case Router::DIJKSTRA_SET_TIME:
+	case Router::DIJKSTRA_PRIO_QUEUE_TIME:
+	case Router::DIJKSTRA_DARY_HEAP_TIME:
+	case Router::DIJKSTRA_RADIX_HEAP_TIME:
+	case Router::BI_DIJKSTRA_TIME:
+	case Router::ALT_TIME:
+	case Router::A_STAR_TIME:
+	case Router::CH_TIME:
+		return true;
+	default:
+		return false;
+	}
+}
+
+int RouterFactory::requiredData(int routerType) {
+	switch (routerType) {
+	case Router::HOP_DISTANCE:
+		return RD_NONE;
+	case Router::CH_DISTANCE:
+	case Router::CH_TIME:
+		return RD_METRIC | RD_CH;
+	case Router::ALT_DISTANCE:
+	case Router::ALT_TIME:
+		return RD_METRIC | RD_LANDMARKS;
+	default:
+		return RD_METRIC;
+	}
+}
+
+const char * RouterFactory::name(int routerType) {
+	switch (routerType) {
+	case Router::HOP_DISTANCE: return "hop-distance";
+	case Router::DIJKSTRA_SET_DISTANCE: return "dijkstra-set-distance";
+	case Router::DIJKSTRA_SET_TIME: return "dijkstra-set-time";
+	case Router::DIJKSTRA_PRIO_QUEUE_DISTANCE: return "dijkstra-prio-queue-distance";
+	case Router::DIJKSTRA_PRIO_QUEUE_TIME: return "dijkstra-prio-queue-time";
+	case Router::DIJKSTRA_DARY_HEAP_DISTANCE: return "dijkstra-dary-heap-distance";
+	case Router::DIJKSTRA_DARY_HEAP_TIME: return "dijkstra-dary-heap-time";
+	case Router::DIJKSTRA_RADIX_HEAP_DISTANCE: return "dijkstra-radix-heap-distance";
+	case Router::DIJKSTRA_RADIX_HEAP_TIME: return "dijkstra-radix-heap-time";
+	case Router::BI_DIJKSTRA_DISTANCE: return "bidijkstra-distance";
+	case Router::BI_DIJKSTRA_TIME: return "bidijkstra-time";
+	case Router::ALT_DISTANCE: return "alt-distance";
+	case Router::ALT_TIME: return "alt-time";
+	case Router::A_STAR_DISTANCE: return "astar-distance";
+	case Router::A_STAR_TIME: return "astar-time";
+	case Router::CH_DISTANCE: return "ch-distance";
+	case Router::CH_TIME: return "ch-time";
+	default: return "unknown";
+	}
+}
+
+int RouterFactory::routerType(const std::string & name) {
+	for(int rt(0); rt < router_type_count; ++rt) {
+		if (name == RouterFactory::name(rt)) {
+			return rt;
+		}
+	}
+	return -1;
+}
+
+Router * RouterFactory::create(int rt, const Graph * g, int accessType, const Metric * metric, const CHInfo * chInfo, const LandmarkInfo * landmarkInfo) {
+	detail::DijkstraRouterBase::QueueType queueType = detail::DijkstraRouterBase::QT_SET;
+	switch (rt) {
+	case Router::DIJKSTRA_PRIO_QUEUE_DISTANCE:
+	case Router::DIJKSTRA_PRIO_QUEUE_TIME:
+		queueType = detail::DijkstraRouterBase::QT_PRIO_QUEUE;
+		break;
+	case Router::DIJKSTRA_DARY_HEAP_DISTANCE:
+	case Router::DIJKSTRA_DARY_HEAP_TIME:
+		queueType = detail::DijkstraRouterBase::QT_DARY_HEAP;
+		break;
+	case Router::DIJKSTRA_RADIX_HEAP_DISTANCE:
+	case Router::DIJKSTRA_RADIX_HEAP_TIME:
+		queueType = detail::DijkstraRouterBase::QT_RADIX_HEAP;
+		break;
+	default:
+		break;
+	}
+
+	//the routers are specialized for their edge preferences, weighted routers use the materialised weights of the profile
+	switch (rt) {
+	case Router::DIJKSTRA_SET_DISTANCE:
+	case Router::DIJKSTRA_PRIO_QUEUE_DISTANCE:
+	case Router::DIJKSTRA_DARY_HEAP_DISTANCE:
+	case Router::DIJKSTRA_RADIX_HEAP_DISTANCE:
+	case Router::DIJKSTRA_SET_TIME:
+	case Router::DIJKSTRA_PRIO_QUEUE_TIME:
+	case Router::DIJKSTRA_DARY_HEAP_TIME:
+	case Router::DIJKSTRA_RADIX_HEAP_TIME:
+		{
+			auto tmp = new detail::DijkstraRouter<Router::MetricEdgePreferences>(g, Router::MetricEdgePreferences(metric));
+			tmp->setQueueType(queueType);
+			return tmp;
+		}
+	case Router::BI_DIJKSTRA_DISTANCE:
+	case Router::BI_DIJKSTRA_TIME:
+		return new detail::BiDijkstraRouter<Router::MetricEdgePreferences>(g, Router::MetricEdgePreferences(metric));
+	case Router::ALT_DISTANCE:
+	case Router::ALT_TIME:
+		return new detail::ALTRouter(g, metric, landmarkInfo);
+	case Router::A_STAR_DISTANCE:
+	case Router::A_STAR_TIME:
+		return new detail::AStarRouter<Router::MetricEdgePreferences>(g, Router::MetricEdgePreferences(metric));
+	case Router::CH_DISTANCE:
+	case Router::CH_TIME:
+		return new detail::CHRouter(g, chInfo, metric);
+	case Router::HOP_DISTANCE:
+	default:
+		return new detail::HopDistanceRouter<>(g, Router::AccessAllowanceEdgePreferences(accessType));
+	}
+}
+
+MatrixRouter * RouterFactory::createMatrixRouter(int rt, const Graph * g, const Metric * metric, const CHInfo * chInfo) {
+	switch (rt) {
+	case Router::HOP_DISTANCE:
+		return 0;
+	case Router::CH_DISTANCE:
+	case Router::CH_TIME:
+		return new detail::CHMatrixRouter(g, chInfo);
+	default:
+		return new detail::DijkstraMatrixRouter(g, metric);
+	}
+}
+
+OneToAllRouter * RouterFactory::createOneToAllRouter(int rt, const Graph * g, const Metric * metric, const CHInfo * chInfo) {
+	switch (rt) {
+	case Router::HOP_DISTANCE:
+		return 0;
+	case Router::CH_DISTANCE:
+	case Router::CH_TIME:
+		return new detail::PHASTRouter(g, chInfo);
+	default:
+		return new detail::DijkstraOneToAllRouter(g, metric);
+	}
+}
+
+Metric * RouterFactory::createMetric(const Graph * g, int accessType, bool timeMetric, double vehicleMaxSpeed, std::ostream & log) {
+	log << "Creating metric" << std::endl;
+	Metric * m;
+	if (timeMetric) {
+		//time weights are fractional, keep 3 decimal places
+		m = new Metric(g, Router::TimeEdgePreferences(accessType, vehicleMaxSpeed), 1000.0);
+	}
+	else {
+		m = new Metric(g, Router::DistanceEdgePreferences(accessType), 1.0);
+	}
+	m->printStats(log);
+	log << std::endl;
+	return m;
+}
+
+CHInfo * RouterFactory::createCHInfo(const Graph * g, const Metric & metric, std::ostream & log) {
+	log << "Creating contraction hierarchy" << std::endl;
+	CHInfo * ch = new CHInfo();
+	CHConstructor chc(g, ch);
+	chc.run(metric, log);
+	ch->printStats(log);
+	log << std::endl;
+	return ch;
+}
+
+LandmarkInfo * RouterFactory::loadLandmarkInfo(const std::string & graphFileName, int accessType, bool timeMetric, const Metric & metric, uint32_t landmarkCount, std::ostream & log) {
+	std::stringstream ss;
+	ss << graphFileName << "." << accessType << (timeMetric ? ".time" : ".distance") << ".landmarks";
+	std::string path = ss.str();
+	LandmarkInfo * li = new LandmarkInfo();
+	try {
+		li->read(path, metric, landmarkCount);
+		log << "Read landmarks from " << path << std::endl;
+	}
+	catch (const std::exception & e) {
+		log << e.what() << std::endl;
+		log << "Creating landmarks" << std::endl;
+		li->create(metric, (landmarkCount ? landmarkCount : LandmarkInfo::default_landmark_count), LandmarkInfo::LS_AVOID, log);
+		try {
+			li->write(path);
+		}
+		catch (const std::exception & e) {
+			log << e.what() << std::endl;
+		}
+	}
+	li->printStats(log);
+	log << std::endl;
+	return li;
+}
+
+LandmarkInfo * RouterFactory::createLandmarkInfo(const Metric & metric, uint32_t landmarkCount, std::ostream & log) {
+	log << "Creating landmarks" << std::endl;
+	LandmarkInfo * li = new LandmarkInfo();
+	li->create(metric, (landmarkCount ? landmarkCount : LandmarkInfo::default_landmark_count), LandmarkInfo::LS_AVOID, log);
+	li->printStats(log);
+	log << std::endl;
+	return li;
+}
+
+}//end namespace simpleroute
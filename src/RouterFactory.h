@@ -0,0 +1,57 @@
+#ifndef SIMPLE_ROUTE_ROUTER_FACTORY_H
+#define SIMPLE_ROUTE_ROUTER_FACTORY_H
+#include "Router.h"
+#include "Metric.h"
+#include "CHGraph.h"
+#include "Landmarks.h"
+#include "MatrixRouter.h"
+#include "OneToAllRouter.h"
+#include <string>
+#include <ostream>
+
+namespace simpleroute {
+
+///Creates the routers of Router::RouterTypes. This is the only place that dispatches on the router type.
+///The GUI, the command line interface and the benchmarks share it
+class RouterFactory {
+public:
+	///preprocessed data a router type needs in addition to the graph
+	typedef enum { RD_NONE=0x0, RD_METRIC=0x1, RD_CH=0x2, RD_LANDMARKS=0x4 } RequiredData;
+	///all router types in the order of Router::RouterTypes
+	static constexpr int router_type_count = Router::CH_TIME+1;
+public:
+	///maximum speed in km/h of the fastest of the given access types
+	static double vehicleMaxSpeed(int accessType);
+	///true if the router type uses the time metric, false for distance (and hop distance)
+	static bool timeMetric(int routerType);
+	///combination of RequiredData
+	static int requiredData(int routerType);
+	///short name usable on the command line, e.g. "dijkstra-prio-queue-time"
+	static const char * name(int routerType);
+	///inverse of name(), returns -1 for unknown names
+	static int routerType(const std::string & name);
+	///Creates a router of the given type, data not required by the type may be null.
+	///metric, chInfo and landmarkInfo have to be of the profile (access type and metric) of the router type
+	static Router * create(int routerType, const Graph * g, int accessType, const Metric * metric, const CHInfo * chInfo, const LandmarkInfo * landmarkInfo);
+	///Creates a many-to-many router for the profile of routerType, CH types use the CH, all others the metric.
+	///Returns null for Router::HOP_DISTANCE
+	static MatrixRouter * createMatrixRouter(int routerType, const Graph * g, const Metric * metric, const CHInfo * chInfo);
+	///Creates a one-to-all router for the profile of routerType, CH types use PHAST, all others a Dijkstra search on the metric.
+	///Returns null for Router::HOP_DISTANCE
+	static OneToAllRouter * createOneToAllRouter(int routerType, const Graph * g, const Metric * metric, const CHInfo * chInfo);
+public:
+	///Creates the edge weights of the given profile.
+	///Time weights are those of Router::TimeEdgePreferences scaled by 1000, distance weights are Graph::Edge::distance
+	static Metric * createMetric(const Graph * g, int accessType, bool timeMetric, double vehicleMaxSpeed, std::ostream & log);
+	static CHInfo * createCHInfo(const Graph * g, const Metric & metric, std::ostream & log);
+	///Reads the landmarks of metric from the file next to graphFileName, they are only created (and written) if it does not exist, is outdated
+	///or has a different number of landmarks than landmarkCount. A landmarkCount of 0 uses the landmarks of the file
+	static LandmarkInfo * loadLandmarkInfo(const std::string & graphFileName, int accessType, bool timeMetric, const Metric & metric, uint32_t landmarkCount, std::ostream & log);
+	///Creates the landmarks of metric without reading or writing the file, e.g. for a graph that differs from graphFileName.
+	///A landmarkCount of 0 creates LandmarkInfo::default_landmark_count landmarks
+	static LandmarkInfo * createLandmarkInfo(const Metric & metric, uint32_t landmarkCount, std::ostream & log);
+};
+
+}//end namespace simpleroute
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef SIMPLE_ROUTE_SEARCH_WORKSPACE_H
+#define SIMPLE_ROUTE_SEARCH_WORKSPACE_H
+#include <vector>
+#include <stdint.h>
+
+namespace simpleroute {
+
+///Per-node data of a graph search which can be reset in O(1).
+///Every entry carries the epoch in which it was written, entries of older epochs count as not present.
+///Hence a search only touches the nodes it reaches and the storage is reused by subsequent searches.
+template<typename T_INFO>
+class SearchWorkspace {
+public:
+	typedef T_INFO value_type;
+	///number of independent instances per thread, e.g. for the two directions of a bidirectional search
+	static constexpr uint32_t thread_local_slots = 2;
+public:
+	SearchWorkspace() : m_epoch(0) {}
+	~SearchWorkspace() {}
+	///start a new search on a graph with nodeCount nodes, this is O(1) unless nodeCount changed
+	void reset(uint32_t nodeCount);
+	inline bool count(uint32_t nodeId) const { return m_d[nodeId].epoch == m_epoch; }
+	///only valid if count(nodeId) is true
+	inline T_INFO & at(uint32_t nodeId) { return m_d[nodeId].info; }
+	inline const T_INFO & at(uint32_t nodeId) const { return m_d[nodeId].info; }
+	inline void emplace(uint32_t nodeId, T_INFO && info) {
+		Entry & e = m_d[nodeId];
+		e.epoch = m_epoch;
+		e.info = std::move(info);
+	}
+	///the instance of the calling thread
+	static SearchWorkspace & threadLocal(uint32_t slot = 0);
+private:
+	struct Entry {
+		uint32_t epoch;
+		T_INFO info;
+		Entry() : epoch(0) {}
+	};
+private:
+	std::vector<Entry> m_d;
+	uint32_t m_epoch;
+};
+
+template<typename T_INFO>
+void SearchWorkspace<T_INFO>::reset(uint32_t nodeCount) {
+	if (m_d.size() != nodeCount) {
+		m_d.assign(nodeCount, Entry());
+		m_epoch = 0;
+	}
+	++m_epoch;
+	//after 2^32 searches the epoch wraps around, only then the stamps have to be cleared
+	if (!m_epoch) {
+		for(Entry & e : m_d) {
+			e.epoch = 0;
+		}
+		m_epoch = 1;
+	}
+}
+
+template<typename T_INFO>
+SearchWorkspace<T_INFO> & SearchWorkspace<T_INFO>::threadLocal(uint32_t slot) {
+	static thread_local SearchWorkspace<T_INFO> ws[thread_local_slots];
+	return ws[slot];
+}
+
+}//end namespace simpleroute
+
+#endif
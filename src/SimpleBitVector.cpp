@@ -1,5 +1,4 @@
-#include <sserialize/containers/SimpleBitVector.h>
-#include <sserialize/utility/constants.h>
+#include "SimpleBitVector.h"
 
 namespace sserialize {
 
@@ -21,20 +20,6 @@ void SimpleBitVector::resize(std::size_t count) {
 	m_d.resize(count/digits+1, 0);
 }
 
-void SimpleBitVector::set(std::size_t pos) {
-	if (UNLIKELY_BRANCH(pos/digits >= m_d.size())) {
-		resize(pos);
-	}
-	m_d.at(pos/digits) |= (static_cast<BaseStorageType>(1) << (pos%digits));
-}
-
-bool SimpleBitVector::isSet(std::size_t pos) {
-	if (UNLIKELY_BRANCH(pos/digits >= m_d.size())) {
-		return false;
-	}
-	return m_d.at(pos/digits) & (static_cast<BaseStorageType>(1) << (pos%digits));
-}
-
 void SimpleBitVector::reset() {
 	m_d.assign(m_d.size(), 0);
 }
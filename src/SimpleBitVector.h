@@ -9,7 +9,7 @@ namespace sserialize {
 class SimpleBitVector {
 public:
 	typedef uint64_t BaseStorageType;
-private:
+	///number of bits per storage word, bit pos is stored in word pos/digits
 	static constexpr int digits = std::numeric_limits<BaseStorageType>::digits;
 public:
 	SimpleBitVector();
@@ -18,9 +18,12 @@ public:
 	std::size_t storageSizeInBytes() const;
 	std::size_t capacity() const;
 	void resize(std::size_t count);
-	void set(std::size_t pos);
-	bool isSet(std::size_t pos);
+	inline void set(std::size_t pos);
+	inline bool isSet(std::size_t pos) const;
 	void reset();
+	///number of storage words
+	inline std::size_t wordCount() const { return m_d.size(); }
+	inline BaseStorageType word(std::size_t i) const { return m_d[i]; }
 	template<typename TInputIterator>
 	void set(TInputIterator begin, const TInputIterator & end);
 	///get all set positions in ascending order 
@@ -30,6 +33,20 @@ private:
 	std::vector<BaseStorageType> m_d;
 };
 
+void SimpleBitVector::set(std::size_t pos) {
+	if (__builtin_expect(pos/digits >= m_d.size(), 0)) {
+		resize(pos);
+	}
+	m_d[pos/digits] |= (static_cast<BaseStorageType>(1) << (pos%digits));
+}
+
+bool SimpleBitVector::isSet(std::size_t pos) const {
+	if (__builtin_expect(pos/digits >= m_d.size(), 0)) {
+		return false;
+	}
+	return m_d[pos/digits] & (static_cast<BaseStorageType>(1) << (pos%digits));
+}
+
 template<typename TInputIterator>
 void SimpleBitVector::set(TInputIterator begin, const TInputIterator & end) {
 	for(; begin != end; ++begin) {
@@ -41,11 +58,10 @@ template<typename TOutputIterator>
 void SimpleBitVector::getSet(TOutputIterator out) const {
 	std::size_t v = 0;
 	for(BaseStorageType x : m_d) {
-		for(std::size_t myV(v); x; ++myV, x >>= 1) {
-			if (x & 0x1) {
-				*out = myV;
-				++out;
-			}
+		//only the set bits are visited, the lowest one is cleared in every step
+		for(; x; x &= x-1) {
+			*out = v + __builtin_ctzll(x);
+			++out;
 		}
 		v += digits;
 	}
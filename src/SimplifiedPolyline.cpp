@@ -0,0 +1,98 @@
+#include "SimplifiedPolyline.h"
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+namespace simpleroute {
+
+SimplifiedPolyline::SimplifiedPolyline() {}
+
+SimplifiedPolyline::SimplifiedPolyline(std::vector<Point> && points, double minTolerance) :
+m_points(std::move(points))
+{
+	uint32_t pointCount = m_points.size();
+	m_tolerances.push_back(0.0);
+	m_levels.emplace_back(pointCount);
+	for(uint32_t i(0); i < pointCount; ++i) {
+		m_levels.back()[i] = i;
+	}
+	
+	std::vector<double> sig = significance();
+	//the levels shrink until only the end points are left, a point of a level is in all finer levels as well
+	for(double tolerance(minTolerance); m_levels.back().size() > 2; tolerance *= 2.0) {
+		std::vector<uint32_t> level;
+		for(uint32_t i : m_levels.back()) {
+			if (sig[i] > tolerance) {
+				level.push_back(i);
+			}
+		}
+		//equal levels are skipped, level() then selects the finer one
+		if (level.size() < m_levels.back().size()) {
+			m_tolerances.push_back(tolerance);
+			m_levels.push_back(std::move(level));
+		}
+	}
+}
+
+uint32_t SimplifiedPolyline::level(double tolerance) const {
+	uint32_t l = std::upper_bound(m_tolerances.begin(), m_tolerances.end(), tolerance) - m_tolerances.begin();
+	return (l ? l-1 : 0);
+}
+
+std::vector<double> SimplifiedPolyline::significance() const {
+	uint32_t pointCount = m_points.size();
+	std::vector<double> sig(pointCount, 0.0);
+	if (pointCount < 2) {
+		std::fill(sig.begin(), sig.end(), std::numeric_limits<double>::max());
+		return sig;
+	}
+	double meanLat = 0.0;
+	for(const Point & p : m_points) {
+		meanLat += p.lat;
+	}
+	meanLat /= pointCount;
+	double lonScale = ::cos(meanLat*(M_PI/180.0));
+	
+	//distance of p to the segment a-b
+	auto distance = [lonScale](const Point & a, const Point & b, const Point & p) -> double {
+		double bx = (b.lon-a.lon)*lonScale, by = b.lat-a.lat;
+		double px = (p.lon-a.lon)*lonScale, py = p.lat-a.lat;
+		double len2 = bx*bx + by*by;
+		double t = (len2 > 0.0 ? std::max(0.0, std::min(1.0, (px*bx + py*by)/len2)) : 0.0);
+		double dx = px - t*bx, dy = py - t*by;
+		return ::sqrt(dx*dx + dy*dy);
+	};
+	
+	//a point is only kept if the point that split its range is kept, hence its significance is bounded by that of the split point.
+	//The ranges are processed with an explicit stack since degenerate polylines split at one end every time
+	struct Range {
+		uint32_t begin;
+		uint32_t end;
+		double bound;
+	};
+	std::vector<Range> stack;
+	sig.front() = sig.back() = std::numeric_limits<double>::max();
+	stack.push_back(Range{0, pointCount-1, std::numeric_limits<double>::max()});
+	while (stack.size()) {
+		Range r = stack.back();
+		stack.pop_back();
+		if (r.end - r.begin < 2) {
+			continue;
+		}
+		uint32_t split = r.begin+1;
+		double maxDist = -1.0;
+		for(uint32_t i(r.begin+1); i < r.end; ++i) {
+			double d = distance(m_points[r.begin], m_points[r.end], m_points[i]);
+			if (d > maxDist) {
+				maxDist = d;
+				split = i;
+			}
+		}
+		sig[split] = std::min(maxDist, r.bound);
+		stack.push_back(Range{r.begin, split, sig[split]});
+		stack.push_back(Range{split, r.end, sig[split]});
+	}
+	return sig;
+}
+
+}//end namespace
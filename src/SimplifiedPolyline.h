@@ -0,0 +1,40 @@
+#ifndef SIMPLE_ROUTE_SIMPLIFIED_POLYLINE_H
+#define SIMPLE_ROUTE_SIMPLIFIED_POLYLINE_H
+#include <vector>
+#include <stdint.h>
+
+namespace simpleroute {
+
+///Douglas-Peucker simplifications of a polyline for a range of tolerances.
+///A single run of the algorithm computes for every point the largest tolerance at which it is still kept.
+///Level 0 holds all points, level i > 0 the points kept at minTolerance*2^(i-1), the last level has only the end points.
+///Distances are in degrees of latitude, longitudes are scaled by the cosine of the mean latitude of the polyline
+class SimplifiedPolyline {
+public:
+	struct Point {
+		double lat;
+		double lon;
+	};
+public:
+	SimplifiedPolyline();
+	SimplifiedPolyline(std::vector<Point> && points, double minTolerance = 1e-6);
+	inline const std::vector<Point> & points() const { return m_points; }
+	inline uint32_t levelCount() const { return m_levels.size(); }
+	///0 for level 0
+	inline double levelTolerance(uint32_t level) const { return m_tolerances.at(level); }
+	///the positions of the points of the level in points() in ascending order
+	inline const std::vector<uint32_t> & levelPoints(uint32_t level) const { return m_levels.at(level); }
+	///the coarsest level whose tolerance is at most tolerance
+	uint32_t level(double tolerance) const;
+private:
+	///the largest tolerance at which each point is kept, the end points are kept at every tolerance
+	std::vector<double> significance() const;
+private:
+	std::vector<Point> m_points;
+	std::vector<double> m_tolerances;
+	std::vector< std::vector<uint32_t> > m_levels;
+};
+
+}//end namespace
+
+#endif
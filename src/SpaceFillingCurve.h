@@ -0,0 +1,43 @@
+#ifndef SIMPLE_ROUTE_SPACE_FILLING_CURVE_H
+#define SIMPLE_ROUTE_SPACE_FILLING_CURVE_H
+#include <stdint.h>
+
+namespace simpleroute {
+
+///position of (x, y) on the Hilbert curve through a 2^32 x 2^32 grid
+inline uint64_t hilbertIndex(uint32_t x, uint32_t y) {
+	uint64_t d = 0;
+	for(uint32_t s(uint32_t(1) << 31); s; s >>= 1) {
+		uint32_t rx = (x & s) ? 1 : 0;
+		uint32_t ry = (y & s) ? 1 : 0;
+		d += uint64_t(s) * uint64_t(s) * ((3*rx) ^ ry);
+		//rotate the quadrant so that the curve is continuous
+		if (!ry) {
+			if (rx) {
+				x = ~x;
+				y = ~y;
+			}
+			uint32_t tmp = x;
+			x = y;
+			y = tmp;
+		}
+	}
+	return d;
+}
+
+///position of (x, y) on the Z-order (Morton) curve, the bits of x and y are interleaved
+inline uint64_t zOrderIndex(uint32_t x, uint32_t y) {
+	auto spread = [](uint64_t v) -> uint64_t {
+		v = (v | (v << 16)) & 0x0000FFFF0000FFFFULL;
+		v = (v | (v << 8)) & 0x00FF00FF00FF00FFULL;
+		v = (v | (v << 4)) & 0x0F0F0F0F0F0F0F0FULL;
+		v = (v | (v << 2)) & 0x3333333333333333ULL;
+		v = (v | (v << 1)) & 0x5555555555555555ULL;
+		return v;
+	};
+	return (spread(y) << 1) | spread(x);
+}
+
+}//end namespace simpleroute
+
+#endif
@@ -1,19 +1,89 @@
 #include "State.h"
+#include "RouterFactory.h"
+#include "GraphSnapshot.h"
 #include <iostream>
 
 namespace simpleroute {
 
-State::State(const Config& cfg) {
-	std::cout << "Parsing graph from " << cfg.graphFileName << std::endl;
-	graph = Graph::fromPBF(cfg.graphFileName, cfg.doSpatialSort, cfg.at);
-	graph.printStats(std::cout);
-	std::cout << std::endl;
-	std::cout << "Creating grid" << std::endl;
-	grid = Grid(&graph, cfg.latCount, cfg.lonCount);
-	grid.printStats(std::cout);
-	std::cout << std::endl;
+State::State(const Config& cfg) :
+config(cfg)
+{
+	GraphSnapshot::Options snapshotOptions;
+	snapshotOptions.accessTypes = cfg.at;
+	snapshotOptions.spatialSort = cfg.doSpatialSort;
+	snapshotOptions.latCount = cfg.latCount;
+	snapshotOptions.lonCount = cfg.lonCount;
+	GraphSnapshot::load(cfg.graphFileName, snapshotOptions, cfg.useSnapshot, graph, grid, std::cout);
+	//routes start and end on the closest edge, the edge bins are not part of the snapshot
+	grid.createEdgeIndex();
 }
 
+const Metric & State::metric(int accessType, bool timeMetric, double vehicleMaxSpeed) {
+	std::pair<int, bool> key(accessType, timeMetric);
+	{
+		MultiReaderSingleWriterLocker lck(metricsLock, MultiReaderSingleWriterLocker::READ_LOCK);
+		auto it = metrics.find(key);
+		if (it != metrics.end() && it->second) {
+			return *(it->second);
+		}
+	}
+	//another thread may have created it in the meantime
+	MultiReaderSingleWriterLocker lck(metricsLock, MultiReaderSingleWriterLocker::WRITE_LOCK);
+	std::unique_ptr<Metric> & m = metrics[key];
+	if (!m) {
+		m.reset(RouterFactory::createMetric(&graph, accessType, timeMetric, vehicleMaxSpeed, std::cout));
+	}
+	return *m;
+}
+
+const CHInfo & State::chInfo(int accessType, bool timeMetric, double vehicleMaxSpeed) {
+	std::pair<int, bool> key(accessType, timeMetric);
+	{
+		MultiReaderSingleWriterLocker lck(chInfosLock, MultiReaderSingleWriterLocker::READ_LOCK);
+		auto it = chInfos.find(key);
+		if (it != chInfos.end() && it->second) {
+			return *(it->second);
+		}
+	}
+	const Metric & m = metric(accessType, timeMetric, vehicleMaxSpeed);
+	//another thread may have created it in the meantime
+	MultiReaderSingleWriterLocker lck(chInfosLock, MultiReaderSingleWriterLocker::WRITE_LOCK);
+	std::unique_ptr<CHInfo> & ch = chInfos[key];
+	if (!ch) {
+		ch.reset(RouterFactory::createCHInfo(&graph, m, std::cout));
+	}
+	return *ch;
+}
+
+const LandmarkInfo & State::landmarkInfo(int accessType, bool timeMetric, double vehicleMaxSpeed) {
+	std::pair<int, bool> key(accessType, timeMetric);
+	{
+		MultiReaderSingleWriterLocker lck(landmarkInfosLock, MultiReaderSingleWriterLocker::READ_LOCK);
+		auto it = landmarkInfos.find(key);
+		if (it != landmarkInfos.end() && it->second) {
+			return *(it->second);
+		}
+	}
+	const Metric & m = metric(accessType, timeMetric, vehicleMaxSpeed);
+	//another thread may have created it in the meantime
+	MultiReaderSingleWriterLocker lck(landmarkInfosLock, MultiReaderSingleWriterLocker::WRITE_LOCK);
+	std::unique_ptr<LandmarkInfo> & li = landmarkInfos[key];
+	if (!li) {
+		li.reset(RouterFactory::loadLandmarkInfo(config.graphFileName, accessType, timeMetric, m, config.landmarkCount, std::cout));
+	}
+	return *li;
+}
 
+StateHolder::StateHolder(const StatePtr & state) :
+m_state(state)
+{}
+
+StatePtr StateHolder::current() const {
+	return std::atomic_load(&m_state);
+}
+
+void StateHolder::replace(const StatePtr & state) {
+	std::atomic_store(&m_state, state);
+}
 
 }//end namespace simpleroute
@@ -3,23 +3,35 @@
 #include "Grid.h"
 #include "Graph.h"
 #include "Router.h"
+#include "CHGraph.h"
+#include "Metric.h"
+#include "Landmarks.h"
 #include "MultiReaderSingleWriterLock.h"
 
 #include <memory>
 #include <unordered_set>
+#include <map>
 
 namespace simpleroute {
 
 struct Config {
-	Config() : latCount(100), lonCount(100), doSpatialSort(false), at(0) {}
+	Config() : latCount(0), lonCount(0), doSpatialSort(false), at(0), landmarkCount(16), useSnapshot(true) {}
 	std::string graphFileName;
+	///grid dimensions, 0 chooses them from the graph, see Grid::autoDimensions
 	uint32_t latCount;
 	uint32_t lonCount;
 	bool doSpatialSort;
 	int at;
+	///number of landmarks of the ALT router
+	uint32_t landmarkCount;
+	///read the graph and grid from a snapshot next to graphFileName, the snapshot is written if it is missing or outdated
+	bool useSnapshot;
 };
 
+///Graph, grid and the data derived from them, a State is not modified after its construction except for the lazily created profile data and the shown nodes and edges.
+///A new graph is loaded into a new State which replaces the current one in the StateHolder
 struct State {
+	Config config;
 	Graph graph;
 	Grid grid;
 	
@@ -28,11 +40,53 @@ struct State {
 	
 	std::unordered_set<uint32_t> enabledEdges;
 	MultiReaderSingleWriterLock enabledEdgesLock;
+	
+	///materialised edge weights by (access type, time metric)
+	std::map<std::pair<int, bool>, std::unique_ptr<Metric> > metrics;
+	MultiReaderSingleWriterLock metricsLock;
+	
+	///contraction hierarchies by (access type, time metric)
+	std::map<std::pair<int, bool>, std::unique_ptr<CHInfo> > chInfos;
+	MultiReaderSingleWriterLock chInfosLock;
+	
+	///landmark tables by (access type, time metric)
+	std::map<std::pair<int, bool>, std::unique_ptr<LandmarkInfo> > landmarkInfos;
+	MultiReaderSingleWriterLock landmarkInfosLock;
 	State(const Config & cfg);
+	
+	//The accessors below look up the profile data with a read lock, only creating missing data takes the write lock.
+	//Entries are never removed, hence the returned references stay valid as long as the State
+	
+	///returns the edge weights of the given profile, they are created on first use
+	///Time weights are those of Router::TimeEdgePreferences scaled by 1000, distance weights are Graph::Edge::distance
+	const Metric & metric(int accessType, bool timeMetric, double vehicleMaxSpeed);
+	///returns the contraction hierarchy of the given profile, it is created on first use
+	const CHInfo & chInfo(int accessType, bool timeMetric, double vehicleMaxSpeed);
+	///returns the landmarks of the given profile
+	///They are read from a file next to the graph file and only created (and written) if it does not exist or is outdated
+	const LandmarkInfo & landmarkInfo(int accessType, bool timeMetric, double vehicleMaxSpeed);
 };
 
 typedef std::shared_ptr<State> StatePtr;
 
+///The current State which may be replaced while it is in use.
+///An operation takes a snapshot with current() and uses it until it is done, it is unaffected by a replace in the meantime.
+///A replaced State is freed when the last snapshot of it is gone.
+///All functions are thread-safe
+class StateHolder {
+public:
+	StateHolder(const StatePtr & state);
+	///snapshot of the current state
+	StatePtr current() const;
+	///makes state the current one
+	void replace(const StatePtr & state);
+private:
+	///only accessed by std::atomic_load and std::atomic_store
+	StatePtr m_state;
+};
+
+typedef std::shared_ptr<StateHolder> StateHolderPtr;
+
 
 }//end namespace simpleroute
 
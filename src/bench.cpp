@@ -0,0 +1,287 @@
+#include "Graph.h"
+#include "Grid.h"
+#include "GraphSnapshot.h"
+#include "RouterFactory.h"
+#include "Benchmark.h"
+#include "TimeMeasurer.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <memory>
+#include <map>
+#include <set>
+#include <cstdlib>
+
+void help() {
+	std::cerr << "simpleroute-bench [options] file.osm.pbf\n";
+	std::cerr << "Runs the same query sets with every router and writes one csv line per router and query set\n";
+	std::cerr << "\t-r\tcomma separated routers (default all), see simpleroute-cli --list\n";
+	std::cerr << "\t-f\taccess types (car|bike|foot|all)\n";
+	std::cerr << "\t-q\tnumber of random queries (default 1000)\n";
+	std::cerr << "\t-k\tnumber of sources of the Dijkstra rank queries (default 100, 0 disables them)\n";
+	std::cerr << "\t-m\tinstead of the queries calculate matrices of n random sources and n random targets with the many-to-many routers\n";
+	std::cerr << "\t-a\tinstead of the queries run the one-to-all routers (PHAST and Dijkstra) from n random sources\n";
+	std::cerr << "\t-d\tbudget of the one-to-all routers in the units of the metric (default unlimited)\n";
+	std::cerr << "\t--queues\tinstead of the queries compare the queues of the Dijkstra router with n random queries\n";
+	std::cerr << "\t--node-order\tinstead of the queries compare node orders with n random queries, use it without -s\n";
+	std::cerr << "\t-e\tseed of the query generators (default 42)\n";
+	std::cerr << "\t-o\toutput file (default stdout)\n";
+	std::cerr << "\t-s\tspatial sort nodes along a Hilbert curve\n";
+	std::cerr << "\t-x\tgrid bins in lat (default: chosen from the graph)\n";
+	std::cerr << "\t-y\tgrid bins in lon (default: chosen from the graph)\n";
+	std::cerr << "\t-n\tdo not read or write a graph snapshot\n";
+	std::cerr << "\t-l\tnumber of landmarks of the ALT router (default 16, 0 uses those of an existing landmarks file)\n";
+	std::cerr << std::endl;
+}
+
+int main(int argc, char ** argv) {
+	using namespace simpleroute;
+	std::string graphFileName;
+	std::string outFileName;
+	GraphSnapshot::Options snapshotOptions;
+	bool useSnapshot = true;
+	uint32_t landmarkCount = 16;
+	uint32_t randomQueryCount = 1000;
+	uint32_t rankSourceCount = 100;
+	uint32_t seed = 42;
+	uint32_t matrixSize = 0;
+	uint32_t oneToAllCount = 0;
+	OneToAllRouter::WeightType budget = OneToAllRouter::infinite_weight;
+	uint32_t queueQueryCount = 0;
+	uint32_t nodeOrderQueryCount = 0;
+	std::vector<int> routerTypes;
+	for(int i(1); i < argc; ++i) {
+		std::string token(argv[i]);
+		bool hasArg = i+1 < argc;
+		if (token == "-s") {
+			snapshotOptions.spatialSort = true;
+		}
+		else if (token == "-n") {
+			useSnapshot = false;
+		}
+		else if (token == "-r" && hasArg) {
+			std::stringstream ss(argv[++i]);
+			std::string name;
+			while (std::getline(ss, name, ',')) {
+				int rt = RouterFactory::routerType(name);
+				if (rt < 0) {
+					std::cerr << "Unknown router " << name << std::endl;
+					return -1;
+				}
+				routerTypes.push_back(rt);
+			}
+		}
+		else if (token == "-q" && hasArg) {
+			randomQueryCount = ::atoi(argv[++i]);
+		}
+		else if (token == "-k" && hasArg) {
+			rankSourceCount = ::atoi(argv[++i]);
+		}
+		else if (token == "-m" && hasArg) {
+			matrixSize = ::atoi(argv[++i]);
+		}
+		else if (token == "-a" && hasArg) {
+			oneToAllCount = ::atoi(argv[++i]);
+		}
+		else if (token == "-d" && hasArg) {
+			budget = std::min<unsigned long long>(::strtoull(argv[++i], 0, 10), OneToAllRouter::infinite_weight);
+		}
+		else if (token == "--queues" && hasArg) {
+			queueQueryCount = ::atoi(argv[++i]);
+		}
+		else if (token == "--node-order" && hasArg) {
+			nodeOrderQueryCount = ::atoi(argv[++i]);
+		}
+		else if (token == "-e" && hasArg) {
+			seed = ::atoi(argv[++i]);
+		}
+		else if (token == "-o" && hasArg) {
+			outFileName = argv[++i];
+		}
+		else if (token == "-x" && hasArg) {
+			snapshotOptions.latCount = ::atoi(argv[++i]);
+		}
+		else if (token == "-y" && hasArg) {
+			snapshotOptions.lonCount = ::atoi(argv[++i]);
+		}
+		else if (token == "-l" && hasArg) {
+			landmarkCount = ::atoi(argv[++i]);
+		}
+		else if (token == "-f" && hasArg) {
+			std::string at(argv[++i]);
+			if (at == "car") {
+				snapshotOptions.accessTypes |= Graph::Edge::AT_CAR;
+			}
+			else if (at == "bike") {
+				snapshotOptions.accessTypes |= Graph::Edge::AT_BIKE;
+			}
+			else if (at == "foot") {
+				snapshotOptions.accessTypes |= Graph::Edge::AT_FOOT;
+			}
+			else if (at == "all") {
+				snapshotOptions.accessTypes |= Graph::Edge::AT_ALL;
+			}
+			else {
+				help();
+				return -1;
+			}
+		}
+		else if (token == "--help" || token == "-h") {
+			help();
+			return 0;
+		}
+		else if (token.size() && token[0] != '-' && graphFileName.empty()) {
+			graphFileName = token;
+		}
+		else {
+			help();
+			return -1;
+		}
+	}
+	if (!graphFileName.size()) {
+		help();
+		return -1;
+	}
+	if (!snapshotOptions.accessTypes) {
+		snapshotOptions.accessTypes = Graph::Edge::AT_ALL;
+	}
+	if (routerTypes.empty()) {
+		for(int rt(0); rt < RouterFactory::router_type_count; ++rt) {
+			routerTypes.push_back(rt);
+		}
+	}
+	int at = snapshotOptions.accessTypes;
+	double vehicleMaxSpeed = RouterFactory::vehicleMaxSpeed(at);
+	//the many-to-many and one-to-all cases replace the point-to-point queries
+	bool batchMode = matrixSize || oneToAllCount;
+
+	Graph graph;
+	Grid grid;
+	try {
+		GraphSnapshot::load(graphFileName, snapshotOptions, useSnapshot, graph, grid, std::cerr);
+	}
+	catch (const std::exception & e) {
+		std::cerr << "Could not load " << graphFileName << ": " << e.what() << std::endl;
+		return -1;
+	}
+
+	std::ofstream outFile;
+	std::ostream * out = &std::cout;
+	if (outFileName.size() && outFileName != "-") {
+		outFile.open(outFileName, std::ios::out | std::ios::trunc);
+		if (!outFile.is_open()) {
+			std::cerr << "Could not open " << outFileName << " for writing" << std::endl;
+			return -1;
+		}
+		out = &outFile;
+	}
+
+	if (queueQueryCount) {
+		benchmarkDijkstraQueues(graph, queueQueryCount, at, *out);
+		return 0;
+	}
+	if (nodeOrderQueryCount) {
+		benchmarkNodeOrder(graph, nodeOrderQueryCount, at, *out);
+		return 0;
+	}
+
+	//profile data by time metric, only what the selected routers need is created
+	std::map<bool, std::unique_ptr<Metric> > metrics;
+	std::map<bool, std::unique_ptr<CHInfo> > chInfos;
+	std::map<bool, std::unique_ptr<LandmarkInfo> > landmarkInfos;
+	auto metric = [&](bool timeMetric) -> const Metric & {
+		std::unique_ptr<Metric> & m = metrics[timeMetric];
+		if (!m) {
+			m.reset(RouterFactory::createMetric(&graph, at, timeMetric, vehicleMaxSpeed, std::cerr));
+		}
+		return *m;
+	};
+
+	//the ranks are those of the time metric, the same queries are used for all routers
+	std::vector<BenchmarkQuerySet> querySets;
+	if (!batchMode) {
+		querySets.push_back(randomQueries(graph, randomQueryCount, seed));
+	}
+	if (rankSourceCount && !batchMode) {
+		TimeMeasurer tm;
+		tm.begin();
+		std::vector<BenchmarkQuerySet> rankSets = dijkstraRankQueries(metric(true), rankSourceCount, seed);
+		tm.end();
+		std::cerr << "Created " << rankSets.size() << " Dijkstra rank query sets in " << tm.elapsedMilliSeconds() << " ms" << std::endl;
+		querySets.insert(querySets.end(), rankSets.begin(), rankSets.end());
+	}
+
+	std::vector<uint32_t> matrixSources = randomNodes(graph, matrixSize, seed);
+	std::vector<uint32_t> matrixTargets = randomNodes(graph, matrixSize, seed+1);
+	std::vector<uint32_t> oneToAllSources = randomNodes(graph, oneToAllCount, seed+2);
+	//the many-to-many and one-to-all routers only depend on the metric and on whether the router uses the CH
+	std::set< std::pair<bool, bool> > batchRouterTypes;
+
+	if (batchMode) {
+		printBatchBenchmarkHeader(*out);
+	}
+	else {
+		printBenchmarkHeader(*out);
+	}
+	for(int rt : routerTypes) {
+		bool timeMetric = RouterFactory::timeMetric(rt);
+		int requiredData = RouterFactory::requiredData(rt);
+		if (batchMode) {
+			bool useCH = requiredData & RouterFactory::RD_CH;
+			if (rt == Router::HOP_DISTANCE || !batchRouterTypes.insert(std::make_pair(timeMetric, useCH)).second) {
+				continue;
+			}
+			requiredData &= ~RouterFactory::RD_LANDMARKS;
+		}
+		const Metric * m = 0;
+		const CHInfo * ch = 0;
+		const LandmarkInfo * li = 0;
+		if (requiredData & RouterFactory::RD_METRIC) {
+			m = &metric(timeMetric);
+		}
+		if (requiredData & RouterFactory::RD_CH) {
+			std::unique_ptr<CHInfo> & tmp = chInfos[timeMetric];
+			if (!tmp) {
+				tmp.reset(RouterFactory::createCHInfo(&graph, *m, std::cerr));
+			}
+			ch = tmp.get();
+		}
+		if (requiredData & RouterFactory::RD_LANDMARKS) {
+			std::unique_ptr<LandmarkInfo> & tmp = landmarkInfos[timeMetric];
+			if (!tmp) {
+				tmp.reset(RouterFactory::loadLandmarkInfo(graphFileName, at, timeMetric, *m, landmarkCount, std::cerr));
+			}
+			li = tmp.get();
+		}
+		if (matrixSize) {
+			std::unique_ptr<MatrixRouter> router(RouterFactory::createMatrixRouter(rt, &graph, m, ch));
+			std::string caseName = "matrix-" + std::to_string(matrixSize) + "x" + std::to_string(matrixSize);
+			std::cerr << "Calculating " << caseName << " with " << RouterFactory::name(rt) << std::endl;
+			BatchBenchmarkResult r = benchmarkMatrixRouter(*router, matrixSources, matrixTargets, 5);
+			printBatchBenchmarkResult(RouterFactory::name(rt), caseName, r, *out);
+			out->flush();
+		}
+		if (oneToAllCount) {
+			std::unique_ptr<OneToAllRouter> router(RouterFactory::createOneToAllRouter(rt, &graph, m, ch));
+			std::string caseName = "one-to-all";
+			if (budget != OneToAllRouter::infinite_weight) {
+				caseName += "-" + std::to_string(budget);
+			}
+			std::cerr << "Running " << oneToAllSources.size() << " sources of " << caseName << " with " << RouterFactory::name(rt) << std::endl;
+			BatchBenchmarkResult r = benchmarkOneToAllRouter(graph, *router, oneToAllSources, budget);
+			printBatchBenchmarkResult(RouterFactory::name(rt), caseName, r, *out);
+			out->flush();
+		}
+		if (batchMode) {
+			continue;
+		}
+		std::unique_ptr<Router> router(RouterFactory::create(rt, &graph, at, m, ch, li));
+		for(const BenchmarkQuerySet & qs : querySets) {
+			std::cerr << "Running " << qs.queries.size() << " queries of " << qs.name << " with " << RouterFactory::name(rt) << std::endl;
+			RouterBenchmarkResult r = benchmarkRouter(*router, qs);
+			printBenchmarkResult(RouterFactory::name(rt), qs.name, r, *out);
+			out->flush();
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,659 @@
+#include "Graph.h"
+#include "Grid.h"
+#include "GraphSnapshot.h"
+#include "GraphUpdater.h"
+#include "RouterFactory.h"
+#include "ParallelFor.h"
+#include "TimeMeasurer.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <map>
+#include <thread>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <limits>
+
+namespace simpleroute {
+namespace {
+
+struct CliConfig {
+	CliConfig() :
+	latCount(0), lonCount(0), doSpatialSort(false), at(0), landmarkCount(16), useSnapshot(true),
+	routerType(Router::DIJKSTRA_DARY_HEAP_TIME), threadCount(0), chunkSize(256), binary(false), withPath(false),
+	oneToAll(false), budget(OneToAllRouter::infinite_weight)
+	{}
+	std::string graphFileName;
+	uint32_t latCount;
+	uint32_t lonCount;
+	bool doSpatialSort;
+	int at;
+	uint32_t landmarkCount;
+	bool useSnapshot;
+	int routerType;
+	uint32_t threadCount;
+	///number of queries a worker takes at once
+	uint32_t chunkSize;
+	bool binary;
+	bool withPath;
+	std::string inFileName;
+	std::string outFileName;
+	///OpenStreetMap change files applied in order after loading the graph
+	std::vector<std::string> changeFileNames;
+	///matrix mode if set: the input holds the sources and this file the targets
+	std::string targetsFileName;
+	///isochrone mode: the input holds the sources, all nodes within budget are written
+	bool oneToAll;
+	uint32_t budget;
+};
+
+///status of a query in the output
+typedef enum { QS_OK=0, QS_INVALID=1, QS_NOT_SNAPPED=2, QS_UNREACHABLE=3 } QueryStatus;
+
+const char * statusName(uint32_t status) {
+	switch (status) {
+	case QS_OK: return "ok";
+	case QS_INVALID: return "invalid";
+	case QS_NOT_SNAPPED: return "not_snapped";
+	case QS_UNREACHABLE: return "unreachable";
+	default: return "unknown";
+	}
+}
+
+struct PathCollector: public Router::PathVisitor {
+	std::vector<uint32_t> p;
+	virtual void visit(uint32_t nodeRef) override {
+		p.push_back(nodeRef);
+	}
+};
+
+///Routes chunks of queries read from in on a fixed set of worker threads and writes the results to out in input order.
+///Every worker owns its router (and thereby its search workspace) for the whole run, the graph and the profile data are shared read-only.
+///Reading is serialised by m_inMutex, results of out-of-order chunks wait in m_pending until their predecessors are written.
+class BatchRouter {
+public:
+	BatchRouter(const CliConfig & cfg, const Graph & g, const Grid & grid, std::istream & in, std::ostream & out) :
+	m_cfg(cfg), m_g(g), m_grid(grid), m_in(in), m_out(out),
+	m_nextChunk(0), m_nextQueryId(0), m_nextWrittenChunk(0), m_inputDone(false)
+	{}
+	///returns the number of queries
+	uint64_t run(const Metric * metric, const CHInfo * ch, const LandmarkInfo * li) {
+		uint32_t threadCount = m_cfg.threadCount ? m_cfg.threadCount : defaultThreadCount();
+		m_maxPendingChunks = 4*threadCount;
+		if (!m_cfg.binary) {
+			m_out << "id,source_node,target_node,status,distance,time,node_count";
+			if (m_cfg.withPath) {
+				m_out << ",path";
+			}
+			m_out << '\n';
+		}
+		std::vector<std::thread> threads;
+		threads.reserve(threadCount);
+		for(uint32_t i(0); i < threadCount; ++i) {
+			threads.emplace_back([this, metric, ch, li]() {
+				std::unique_ptr<Router> router(RouterFactory::create(m_cfg.routerType, &m_g, m_cfg.at, metric, ch, li));
+				work(router.get());
+			});
+		}
+		for(std::thread & t : threads) {
+			t.join();
+		}
+		m_out.flush();
+		return m_nextQueryId;
+	}
+private:
+	struct Query {
+		uint64_t id;
+		uint32_t status;
+		double srcLat, srcLon, tgtLat, tgtLon;
+	};
+private:
+	///reads the next chunk of queries, returns false if the input is exhausted
+	bool readChunk(std::vector<Query> & queries, uint64_t & chunkId) {
+		queries.clear();
+		std::lock_guard<std::mutex> lck(m_inMutex);
+		{
+			//do not run too far ahead of the writer, otherwise a slow chunk lets m_pending grow without bound
+			std::unique_lock<std::mutex> outLck(m_outMutex);
+			m_writtenCv.wait(outLck, [this]() {
+				return m_nextChunk - m_nextWrittenChunk < m_maxPendingChunks;
+			});
+		}
+		if (m_inputDone) {
+			return false;
+		}
+		std::string line;
+		while (queries.size() < m_cfg.chunkSize && std::getline(m_in, line)) {
+			if (line.empty() || line[0] == '#') {
+				continue;
+			}
+			for(char & c : line) {
+				if (c == ',' || c == ';') {
+					c = ' ';
+				}
+			}
+			Query q;
+			q.id = m_nextQueryId++;
+			q.status = QS_OK;
+			if (std::sscanf(line.c_str(), "%lf %lf %lf %lf", &q.srcLat, &q.srcLon, &q.tgtLat, &q.tgtLon) != 4) {
+				q.status = QS_INVALID;
+			}
+			queries.push_back(q);
+		}
+		if (queries.empty()) {
+			m_inputDone = true;
+			return false;
+		}
+		chunkId = m_nextChunk++;
+		return true;
+	}
+	void writeChunk(uint64_t chunkId, std::string && data) {
+		{
+			std::lock_guard<std::mutex> lck(m_outMutex);
+			m_pending[chunkId] = std::move(data);
+			auto it = m_pending.begin();
+			while (it != m_pending.end() && it->first == m_nextWrittenChunk) {
+				m_out.write(it->second.data(), it->second.size());
+				it = m_pending.erase(it);
+				++m_nextWrittenChunk;
+			}
+		}
+		m_writtenCv.notify_all();
+	}
+	void appendCsv(std::string & buffer, const Query & q, uint32_t src, uint32_t tgt, const Graph::Route & r) {
+		char tmp[160];
+		if (q.status == QS_OK) {
+			std::snprintf(tmp, sizeof(tmp), "%llu,%u,%u,%s,%.3f,%.3f,%zu",
+				(unsigned long long) q.id, src, tgt, statusName(q.status), r.distance, r.time, r.nodes.size());
+		}
+		else {
+			std::snprintf(tmp, sizeof(tmp), "%llu,%u,%u,%s,,,0", (unsigned long long) q.id, src, tgt, statusName(q.status));
+		}
+		buffer += tmp;
+		if (m_cfg.withPath) {
+			buffer += ',';
+			for(std::size_t i(0), s(r.nodes.size()); i < s; ++i) {
+				if (i) {
+					buffer += ' ';
+				}
+				std::snprintf(tmp, sizeof(tmp), "%u", r.nodes[i]);
+				buffer += tmp;
+			}
+		}
+		buffer += '\n';
+	}
+	template<typename T>
+	static void appendRaw(std::string & buffer, const T & v) {
+		buffer.append(reinterpret_cast<const char*>(&v), sizeof(T));
+	}
+	///record: uint64 id, uint32 source node, uint32 target node, uint32 status, uint32 node count, double distance, double time
+	///followed by node count uint32 node ids if paths are requested, all in host byte order
+	void appendBinary(std::string & buffer, const Query & q, uint32_t src, uint32_t tgt, const Graph::Route & r) {
+		uint32_t nodeCount = q.status == QS_OK ? r.nodes.size() : 0;
+		double distance = q.status == QS_OK ? r.distance : std::numeric_limits<double>::quiet_NaN();
+		double time = q.status == QS_OK ? r.time : std::numeric_limits<double>::quiet_NaN();
+		appendRaw(buffer, q.id);
+		appendRaw(buffer, src);
+		appendRaw(buffer, tgt);
+		appendRaw(buffer, q.status);
+		appendRaw(buffer, nodeCount);
+		appendRaw(buffer, distance);
+		appendRaw(buffer, time);
+		if (m_cfg.withPath && nodeCount) {
+			buffer.append(reinterpret_cast<const char*>(r.nodes.data()), nodeCount*sizeof(uint32_t));
+		}
+	}
+	void work(Router * router) {
+		std::vector<Query> queries;
+		std::string buffer;
+		uint64_t chunkId;
+		double vehicleMaxSpeed = RouterFactory::vehicleMaxSpeed(m_cfg.at);
+		std::vector<double> lats;
+		std::vector<double> lons;
+		std::vector<uint32_t> snapped;
+		while (readChunk(queries, chunkId)) {
+			buffer.clear();
+			//snap the whole chunk at once, the workers already run in parallel
+			lats.clear();
+			lons.clear();
+			for(const Query & q : queries) {
+				bool valid = (q.status == QS_OK);
+				lats.push_back(valid ? q.srcLat : 0.0);
+				lons.push_back(valid ? q.srcLon : 0.0);
+				lats.push_back(valid ? q.tgtLat : 0.0);
+				lons.push_back(valid ? q.tgtLon : 0.0);
+			}
+			m_grid.closest(lats, lons, snapped, 1);
+			for(uint32_t i(0), s(queries.size()); i < s; ++i) {
+				Query & q = queries[i];
+				uint32_t src = std::numeric_limits<uint32_t>::max();
+				uint32_t tgt = std::numeric_limits<uint32_t>::max();
+				Graph::Route r;
+				r.distance = 0;
+				r.time = 0;
+				if (q.status == QS_OK) {
+					src = snapped[2*i];
+					tgt = snapped[2*i+1];
+					if (src >= m_g.nodeCount() || tgt >= m_g.nodeCount()) {
+						q.status = QS_NOT_SNAPPED;
+					}
+				}
+				if (q.status == QS_OK) {
+					PathCollector pc;
+					router->route(src, tgt, &pc);
+					if (pc.p.empty() && src != tgt) {
+						q.status = QS_UNREACHABLE;
+					}
+					else {
+						r = m_g.routeInfo(std::move(pc.p), vehicleMaxSpeed, m_cfg.at);
+					}
+				}
+				if (m_cfg.binary) {
+					appendBinary(buffer, q, src, tgt, r);
+				}
+				else {
+					appendCsv(buffer, q, src, tgt, r);
+				}
+			}
+			writeChunk(chunkId, std::move(buffer));
+			buffer = std::string();
+		}
+	}
+private:
+	const CliConfig & m_cfg;
+	const Graph & m_g;
+	const Grid & m_grid;
+	std::istream & m_in;
+	std::ostream & m_out;
+	///protects m_in, m_nextChunk, m_nextQueryId and m_inputDone
+	std::mutex m_inMutex;
+	///protects m_out, m_pending and m_nextWrittenChunk, lock order is m_inMutex before m_outMutex
+	std::mutex m_outMutex;
+	std::condition_variable m_writtenCv;
+	uint64_t m_nextChunk;
+	uint64_t m_nextQueryId;
+	uint64_t m_nextWrittenChunk;
+	uint64_t m_maxPendingChunks;
+	bool m_inputDone;
+	std::map<uint64_t, std::string> m_pending;
+};
+
+///Reads points "lat lon" (separated by whitespace or commas), one per line, and snaps them to the closest nodes.
+///nodes holds one entry per point, std::numeric_limits<uint32_t>::max() for invalid points and points that could not be snapped
+void readNodes(std::istream & in, const Graph & g, const Grid & grid, uint32_t threadCount, std::vector<uint32_t> & nodes) {
+	std::vector<double> lats;
+	std::vector<double> lons;
+	std::vector<bool> valid;
+	std::string line;
+	while (std::getline(in, line)) {
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+		for(char & c : line) {
+			if (c == ',' || c == ';') {
+				c = ' ';
+			}
+		}
+		double lat, lon;
+		valid.push_back(std::sscanf(line.c_str(), "%lf %lf", &lat, &lon) == 2);
+		lats.push_back(valid.back() ? lat : 0.0);
+		lons.push_back(valid.back() ? lon : 0.0);
+	}
+	grid.closest(lats, lons, nodes, threadCount);
+	for(std::size_t i(0), s(nodes.size()); i < s; ++i) {
+		if (!valid[i] || nodes[i] >= g.nodeCount()) {
+			nodes[i] = std::numeric_limits<uint32_t>::max();
+		}
+	}
+}
+
+///Calculates the weights between all sources read from in and all targets read from targetsIn with a MatrixRouter
+///and writes one csv line per pair in row-major order. Returns the number of pairs
+uint64_t routeMatrix(const CliConfig & cfg, const Graph & g, const Grid & grid, MatrixRouter & router, std::istream & in, std::istream & targetsIn, std::ostream & out) {
+	std::vector<uint32_t> sources;
+	std::vector<uint32_t> targets;
+	readNodes(in, g, grid, cfg.threadCount, sources);
+	readNodes(targetsIn, g, grid, cfg.threadCount, targets);
+	//only snapped points go into the matrix, matrixIds maps every point to its row or column
+	auto compact = [](const std::vector<uint32_t> & nodes, std::vector<uint32_t> & matrixNodes, std::vector<uint32_t> & matrixIds) {
+		for(uint32_t nodeId : nodes) {
+			if (nodeId != std::numeric_limits<uint32_t>::max()) {
+				matrixIds.push_back(matrixNodes.size());
+				matrixNodes.push_back(nodeId);
+			}
+			else {
+				matrixIds.push_back(std::numeric_limits<uint32_t>::max());
+			}
+		}
+	};
+	std::vector<uint32_t> matrixSources, sourceIds;
+	std::vector<uint32_t> matrixTargets, targetIds;
+	compact(sources, matrixSources, sourceIds);
+	compact(targets, matrixTargets, targetIds);
+	DistanceMatrix dm;
+	router.setThreadCount(cfg.threadCount);
+	router.calculate(matrixSources, matrixTargets, dm);
+
+	out << "source,target,source_node,target_node,status,weight\n";
+	std::string buffer;
+	char tmp[96];
+	for(uint32_t i(0), is(sources.size()); i < is; ++i) {
+		buffer.clear();
+		for(uint32_t j(0), js(targets.size()); j < js; ++j) {
+			uint32_t status = QS_NOT_SNAPPED;
+			DistanceMatrix::WeightType w = DistanceMatrix::infinite_weight;
+			if (sourceIds[i] != std::numeric_limits<uint32_t>::max() && targetIds[j] != std::numeric_limits<uint32_t>::max()) {
+				w = dm.at(sourceIds[i], targetIds[j]);
+				status = (w == DistanceMatrix::infinite_weight ? QS_UNREACHABLE : QS_OK);
+			}
+			if (status == QS_OK) {
+				std::snprintf(tmp, sizeof(tmp), "%u,%u,%u,%u,%s,%u\n", i, j, sources[i], targets[j], statusName(status), w);
+			}
+			else {
+				std::snprintf(tmp, sizeof(tmp), "%u,%u,%u,%u,%s,\n", i, j, sources[i], targets[j], statusName(status));
+			}
+			buffer += tmp;
+		}
+		out.write(buffer.data(), buffer.size());
+	}
+	out.flush();
+	return uint64_t(sources.size())*targets.size();
+}
+
+///Calculates the weights from every source read from in to all nodes within cfg.budget with a OneToAllRouter
+///and writes one csv line per reached node. Returns the number of sources
+uint64_t routeOneToAll(const CliConfig & cfg, const Graph & g, const Grid & grid, OneToAllRouter & router, std::istream & in, std::ostream & out) {
+	std::vector<uint32_t> sources;
+	readNodes(in, g, grid, cfg.threadCount, sources);
+	out << "source,source_node,status,node,weight\n";
+	std::vector<OneToAllRouter::WeightType> weights;
+	std::string buffer;
+	char tmp[96];
+	for(uint32_t i(0), s(sources.size()); i < s; ++i) {
+		buffer.clear();
+		if (sources[i] == std::numeric_limits<uint32_t>::max()) {
+			std::snprintf(tmp, sizeof(tmp), "%u,%u,%s,,\n", i, sources[i], statusName(QS_NOT_SNAPPED));
+			buffer += tmp;
+		}
+		else {
+			router.calculate(sources[i], cfg.budget, &weights, 0);
+			for(uint32_t nodeId(0), nodeCount(g.nodeCount()); nodeId < nodeCount; ++nodeId) {
+				if (weights[nodeId] != OneToAllRouter::infinite_weight) {
+					std::snprintf(tmp, sizeof(tmp), "%u,%u,%s,%u,%u\n", i, sources[i], statusName(QS_OK), nodeId, weights[nodeId]);
+					buffer += tmp;
+				}
+			}
+		}
+		out.write(buffer.data(), buffer.size());
+	}
+	out.flush();
+	return sources.size();
+}
+
+}//end namespace
+}//end namespace simpleroute
+
+void help() {
+	std::cerr << "simpleroute-cli [options] file.osm.pbf\n";
+	std::cerr << "Reads queries \"srcLat srcLon tgtLat tgtLon\" (separated by whitespace or commas), one per line,\n";
+	std::cerr << "snaps them to the closest nodes and writes one result per query in input order\n";
+	std::cerr << "\t-r\trouter (default dijkstra-dary-heap-time), --list prints all routers\n";
+	std::cerr << "\t-f\taccess types (car|bike|foot|all)\n";
+	std::cerr << "\t-t\tnumber of worker threads (default all cores)\n";
+	std::cerr << "\t-i\tinput file (default stdin)\n";
+	std::cerr << "\t-o\toutput file (default stdout)\n";
+	std::cerr << "\t-b\tbinary output instead of csv\n";
+	std::cerr << "\t-p\tinclude the node ids of the paths\n";
+	std::cerr << "\t-k\tqueries per work item (default 256)\n";
+	std::cerr << "\t-s\tspatial sort nodes along a Hilbert curve\n";
+	std::cerr << "\t-x\tgrid bins in lat (default: chosen from the graph)\n";
+	std::cerr << "\t-y\tgrid bins in lon (default: chosen from the graph)\n";
+	std::cerr << "\t-n\tdo not read or write a graph snapshot\n";
+	std::cerr << "\t-l\tnumber of landmarks of the ALT router (default 16, 0 uses those of an existing landmarks file)\n";
+	std::cerr << "\t-u\tapply an OpenStreetMap change file (.osc or .osc.gz), may be given multiple times\n";
+	std::cerr << "\t-m\tmatrix mode: the input holds the sources and the given file the targets as \"lat lon\", one per line,\n";
+	std::cerr << "\t\twrites the weight of every source and target pair in the units of the metric of the router\n";
+	std::cerr << "\t-d\tisochrone mode: the input holds the sources as \"lat lon\", one per line,\n";
+	std::cerr << "\t\twrites every node within the given budget in the units of the metric of the router\n";
+	std::cerr << std::endl;
+}
+
+int main(int argc, char ** argv) {
+	using namespace simpleroute;
+	CliConfig cfg;
+	for(int i(1); i < argc; ++i) {
+		std::string token(argv[i]);
+		bool hasArg = i+1 < argc;
+		if (token == "-b") {
+			cfg.binary = true;
+		}
+		else if (token == "-p") {
+			cfg.withPath = true;
+		}
+		else if (token == "-s") {
+			cfg.doSpatialSort = true;
+		}
+		else if (token == "-n") {
+			cfg.useSnapshot = false;
+		}
+		else if (token == "--list") {
+			for(int rt(0); rt < RouterFactory::router_type_count; ++rt) {
+				std::cout << RouterFactory::name(rt) << '\n';
+			}
+			return 0;
+		}
+		else if (token == "-r" && hasArg) {
+			cfg.routerType = RouterFactory::routerType(argv[++i]);
+			if (cfg.routerType < 0) {
+				std::cerr << "Unknown router " << argv[i] << std::endl;
+				return -1;
+			}
+		}
+		else if (token == "-t" && hasArg) {
+			cfg.threadCount = ::atoi(argv[++i]);
+		}
+		else if (token == "-k" && hasArg) {
+			cfg.chunkSize = std::max(1, ::atoi(argv[++i]));
+		}
+		else if (token == "-i" && hasArg) {
+			cfg.inFileName = argv[++i];
+		}
+		else if (token == "-o" && hasArg) {
+			cfg.outFileName = argv[++i];
+		}
+		else if (token == "-x" && hasArg) {
+			cfg.latCount = ::atoi(argv[++i]);
+		}
+		else if (token == "-y" && hasArg) {
+			cfg.lonCount = ::atoi(argv[++i]);
+		}
+		else if (token == "-l" && hasArg) {
+			cfg.landmarkCount = ::atoi(argv[++i]);
+		}
+		else if (token == "-u" && hasArg) {
+			cfg.changeFileNames.emplace_back(argv[++i]);
+		}
+		else if (token == "-m" && hasArg) {
+			cfg.targetsFileName = argv[++i];
+		}
+		else if (token == "-d" && hasArg) {
+			cfg.oneToAll = true;
+			cfg.budget = std::min<unsigned long long>(::strtoull(argv[++i], 0, 10), OneToAllRouter::infinite_weight);
+		}
+		else if (token == "-f" && hasArg) {
+			std::string at(argv[++i]);
+			if (at == "car") {
+				cfg.at |= Graph::Edge::AT_CAR;
+			}
+			else if (at == "bike") {
+				cfg.at |= Graph::Edge::AT_BIKE;
+			}
+			else if (at == "foot") {
+				cfg.at |= Graph::Edge::AT_FOOT;
+			}
+			else if (at == "all") {
+				cfg.at |= Graph::Edge::AT_ALL;
+			}
+			else {
+				help();
+				return -1;
+			}
+		}
+		else if (token == "--help" || token == "-h") {
+			help();
+			return 0;
+		}
+		else if (token.size() && token[0] != '-' && cfg.graphFileName.empty()) {
+			cfg.graphFileName = token;
+		}
+		else {
+			help();
+			return -1;
+		}
+	}
+	if (!cfg.graphFileName.size() || (cfg.oneToAll && cfg.targetsFileName.size())) {
+		help();
+		return -1;
+	}
+	if (!cfg.at) {
+		cfg.at = Graph::Edge::AT_ALL;
+	}
+
+	//stdout may carry the results, all diagnostics go to stderr
+	Graph graph;
+	Grid grid;
+	GraphSnapshot::Options snapshotOptions;
+	snapshotOptions.accessTypes = cfg.at;
+	snapshotOptions.spatialSort = cfg.doSpatialSort;
+	snapshotOptions.latCount = cfg.latCount;
+	snapshotOptions.lonCount = cfg.lonCount;
+	try {
+		GraphSnapshot::load(cfg.graphFileName, snapshotOptions, cfg.useSnapshot, graph, grid, std::cerr);
+	}
+	catch (const std::exception & e) {
+		std::cerr << "Could not load " << cfg.graphFileName << ": " << e.what() << std::endl;
+		return -1;
+	}
+	if (cfg.changeFileNames.size()) {
+		GraphUpdater updater(&graph, &grid, cfg.at);
+		for(const std::string & changeFileName : cfg.changeFileNames) {
+			try {
+				updater.apply(changeFileName).print(std::cerr);
+				std::cerr << std::endl;
+			}
+			catch (const std::exception & e) {
+				std::cerr << "Could not apply " << changeFileName << ": " << e.what() << std::endl;
+				return -1;
+			}
+		}
+		//the metric and the contraction hierarchy below are created from the updated edges
+		if (graph.unusedEdgeCount()) {
+			updater.compact();
+		}
+	}
+	grid.createNodeVectors();
+
+	bool timeMetric = RouterFactory::timeMetric(cfg.routerType);
+	double vehicleMaxSpeed = RouterFactory::vehicleMaxSpeed(cfg.at);
+	int requiredData = RouterFactory::requiredData(cfg.routerType);
+	if (cfg.targetsFileName.size() || cfg.oneToAll) {
+		//the many-to-many and one-to-all routers search the metric (or the CH) directly
+		requiredData &= ~RouterFactory::RD_LANDMARKS;
+		if (cfg.routerType == Router::HOP_DISTANCE) {
+			std::cerr << "The matrix and isochrone modes need a router with a metric" << std::endl;
+			return -1;
+		}
+	}
+	std::unique_ptr<Metric> metric;
+	std::unique_ptr<CHInfo> ch;
+	std::unique_ptr<LandmarkInfo> li;
+	if (requiredData & RouterFactory::RD_METRIC) {
+		metric.reset(RouterFactory::createMetric(&graph, cfg.at, timeMetric, vehicleMaxSpeed, std::cerr));
+	}
+	if (requiredData & RouterFactory::RD_CH) {
+		ch.reset(RouterFactory::createCHInfo(&graph, *metric, std::cerr));
+	}
+	if (requiredData & RouterFactory::RD_LANDMARKS) {
+		//the landmark file belongs to the unmodified graph, it is neither used nor overwritten for an updated one
+		if (cfg.changeFileNames.size()) {
+			li.reset(RouterFactory::createLandmarkInfo(*metric, cfg.landmarkCount, std::cerr));
+		}
+		else {
+			li.reset(RouterFactory::loadLandmarkInfo(cfg.graphFileName, cfg.at, timeMetric, *metric, cfg.landmarkCount, std::cerr));
+		}
+	}
+
+	std::ifstream inFile;
+	std::ofstream outFile;
+	std::istream * in = &std::cin;
+	std::ostream * out = &std::cout;
+	if (cfg.inFileName.size() && cfg.inFileName != "-") {
+		inFile.open(cfg.inFileName);
+		if (!inFile.is_open()) {
+			std::cerr << "Could not open " << cfg.inFileName << std::endl;
+			return -1;
+		}
+		in = &inFile;
+	}
+	if (cfg.outFileName.size() && cfg.outFileName != "-") {
+		outFile.open(cfg.outFileName, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!outFile.is_open()) {
+			std::cerr << "Could not open " << cfg.outFileName << " for writing" << std::endl;
+			return -1;
+		}
+		out = &outFile;
+	}
+	std::ios::sync_with_stdio(false);
+
+	if (cfg.targetsFileName.size()) {
+		std::ifstream targetsFile(cfg.targetsFileName);
+		if (!targetsFile.is_open()) {
+			std::cerr << "Could not open " << cfg.targetsFileName << std::endl;
+			return -1;
+		}
+		std::unique_ptr<MatrixRouter> router(RouterFactory::createMatrixRouter(cfg.routerType, &graph, metric.get(), ch.get()));
+		TimeMeasurer tm;
+		tm.begin();
+		uint64_t pairCount = routeMatrix(cfg, graph, grid, *router, *in, targetsFile, *out);
+		tm.end();
+		std::cerr << "Calculated " << pairCount << " weights with " << RouterFactory::name(cfg.routerType) << " in " << tm.elapsedMilliSeconds() << " ms" << std::endl;
+		if (!*out) {
+			std::cerr << "Could not write the results" << std::endl;
+			return -1;
+		}
+		return 0;
+	}
+	if (cfg.oneToAll) {
+		std::unique_ptr<OneToAllRouter> router(RouterFactory::createOneToAllRouter(cfg.routerType, &graph, metric.get(), ch.get()));
+		TimeMeasurer tm;
+		tm.begin();
+		uint64_t sourceCount = routeOneToAll(cfg, graph, grid, *router, *in, *out);
+		tm.end();
+		std::cerr << "Calculated the isochrones of " << sourceCount << " sources with " << RouterFactory::name(cfg.routerType) << " in " << tm.elapsedMilliSeconds() << " ms" << std::endl;
+		if (!*out) {
+			std::cerr << "Could not write the results" << std::endl;
+			return -1;
+		}
+		return 0;
+	}
+
+	BatchRouter br(cfg, graph, grid, *in, *out);
+	TimeMeasurer tm;
+	tm.begin();
+	uint64_t queryCount = br.run(metric.get(), ch.get(), li.get());
+	tm.end();
+	std::cerr << "Routed " << queryCount << " queries with " << RouterFactory::name(cfg.routerType) << " in " << tm.elapsedMilliSeconds() << " ms";
+	if (tm.elapsedMilliSeconds()) {
+		std::cerr << " (" << queryCount*1000/tm.elapsedMilliSeconds() << " queries/s)";
+	}
+	std::cerr << std::endl;
+	if (!*out) {
+		std::cerr << "Could not write the results" << std::endl;
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,172 @@
+#include "MultiReaderSingleWriterLock.h"
+#include "ParallelFor.h"
+#include "TimeMeasurer.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstdlib>
+
+namespace {
+
+///the lock before MultiReaderSingleWriterLock was sharded: a counting semaphore of which a writer acquires all permits
+class SemaphoreLock: public simpleroute::MultiReaderSingleWriterLockBase {
+public:
+	SemaphoreLock() : m_permits(WRITE_LOCK) {}
+	void lock(LockType lt) {
+		std::unique_lock<std::mutex> lck(m_mutex);
+		m_cv.wait(lck, [this, lt]() { return m_permits >= uint32_t(lt); });
+		m_permits -= lt;
+	}
+	void unlock(LockType lt) {
+		{
+			std::lock_guard<std::mutex> lck(m_mutex);
+			m_permits += lt;
+		}
+		m_cv.notify_all();
+	}
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	uint32_t m_permits;
+};
+
+///a plain mutex, readers are serialised as well
+class MutexLock: public simpleroute::MultiReaderSingleWriterLockBase {
+public:
+	void lock(LockType) { m_mutex.lock(); }
+	void unlock(LockType) { m_mutex.unlock(); }
+private:
+	std::mutex m_mutex;
+};
+
+struct LockBenchmarkResult {
+	uint64_t readCount;
+	uint64_t writeCount;
+	double ms;
+	LockBenchmarkResult() : readCount(0), writeCount(0), ms(0.0) {}
+};
+
+///every thread runs opCount critical sections, every writeInterval-th one of them is a write.
+///The critical section reads (writes) a few cache lines of shared data
+template<typename T_LOCK>
+LockBenchmarkResult benchmarkLock(uint32_t threadCount, uint32_t opCount, uint32_t writeInterval) {
+	using simpleroute::MultiReaderSingleWriterLockBase;
+	T_LOCK lock;
+	std::vector<uint64_t> data(64, 0);
+	std::vector<uint64_t> readCounts(threadCount, 0);
+	std::vector<uint64_t> writeCounts(threadCount, 0);
+	std::vector<uint64_t> sums(threadCount, 0);
+	simpleroute::TimeMeasurer tm;
+	tm.begin();
+	simpleroute::parallelFor(0, threadCount, [&](uint32_t t, uint32_t) {
+		uint64_t sum = 0;
+		for(uint32_t i(0); i < opCount; ++i) {
+			if (writeInterval && (i+t) % writeInterval == 0) {
+				lock.lock(MultiReaderSingleWriterLockBase::WRITE_LOCK);
+				for(uint64_t & v : data) {
+					++v;
+				}
+				lock.unlock(MultiReaderSingleWriterLockBase::WRITE_LOCK);
+				++writeCounts[t];
+			}
+			else {
+				lock.lock(MultiReaderSingleWriterLockBase::READ_LOCK);
+				for(uint32_t j(0), s(data.size()); j < s; j += 8) {
+					sum += data[j];
+				}
+				lock.unlock(MultiReaderSingleWriterLockBase::READ_LOCK);
+				++readCounts[t];
+			}
+		}
+		sums[t] = sum;
+	}, threadCount, 1);
+	tm.end();
+	LockBenchmarkResult r;
+	r.ms = tm.elapsedMilliSeconds();
+	for(uint32_t t(0); t < threadCount; ++t) {
+		r.readCount += readCounts[t];
+		r.writeCount += writeCounts[t];
+	}
+	//data is incremented by every write
+	if (data.front() != r.writeCount) {
+		std::cerr << "Lost writes: " << data.front() << " != " << r.writeCount << std::endl;
+	}
+	return r;
+}
+
+void printLockBenchmarkResult(const std::string & lockName, uint32_t threadCount, uint32_t writeInterval, const LockBenchmarkResult & r, std::ostream & out) {
+	double opsPerSecond = (r.ms > 0.0 ? (r.readCount+r.writeCount)/(r.ms/1000.0) : 0.0);
+	out << lockName << ',' << threadCount << ',' << writeInterval << ',' << r.readCount << ',' << r.writeCount << ',' << r.ms << ',' << opsPerSecond << '\n';
+}
+
+void help() {
+	std::cerr << "simpleroute-lockbench [options]\n";
+	std::cerr << "Contention benchmark of MultiReaderSingleWriterLock against a semaphore and a mutex, writes one csv line per lock and thread count\n";
+	std::cerr << "\t-t\tmaximal number of threads, the thread counts are doubled from 1 (default all cores)\n";
+	std::cerr << "\t-q\tnumber of critical sections per thread (default 1000000)\n";
+	std::cerr << "\t-w\tevery w-th critical section is a write, 0 for reads only (default 1000)\n";
+	std::cerr << "\t-o\toutput file (default stdout)\n";
+	std::cerr << std::endl;
+}
+
+}//end namespace
+
+int main(int argc, char ** argv) {
+	using namespace simpleroute;
+	std::string outFileName;
+	uint32_t maxThreadCount = defaultThreadCount();
+	uint32_t opCount = 1000000;
+	uint32_t writeInterval = 1000;
+	for(int i(1); i < argc; ++i) {
+		std::string token(argv[i]);
+		bool hasArg = i+1 < argc;
+		if (token == "-t" && hasArg) {
+			maxThreadCount = std::max(1, ::atoi(argv[++i]));
+		}
+		else if (token == "-q" && hasArg) {
+			opCount = ::atoi(argv[++i]);
+		}
+		else if (token == "-w" && hasArg) {
+			writeInterval = ::atoi(argv[++i]);
+		}
+		else if (token == "-o" && hasArg) {
+			outFileName = argv[++i];
+		}
+		else if (token == "--help" || token == "-h") {
+			help();
+			return 0;
+		}
+		else {
+			help();
+			return -1;
+		}
+	}
+
+	std::ofstream outFile;
+	std::ostream * out = &std::cout;
+	if (outFileName.size() && outFileName != "-") {
+		outFile.open(outFileName, std::ios::out | std::ios::trunc);
+		if (!outFile.is_open()) {
+			std::cerr << "Could not open " << outFileName << " for writing" << std::endl;
+			return -1;
+		}
+		out = &outFile;
+	}
+
+	*out << "lock,threads,write_interval,reads,writes,ms,ops_per_s\n";
+	for(uint32_t threadCount(1); ; threadCount = std::min(2*threadCount, maxThreadCount)) {
+		std::cerr << "Running " << opCount << " critical sections on " << threadCount << " threads" << std::endl;
+		printLockBenchmarkResult("sharded", threadCount, writeInterval, benchmarkLock<MultiReaderSingleWriterLock>(threadCount, opCount, writeInterval), *out);
+		printLockBenchmarkResult("semaphore", threadCount, writeInterval, benchmarkLock<SemaphoreLock>(threadCount, opCount, writeInterval), *out);
+		printLockBenchmarkResult("mutex", threadCount, writeInterval, benchmarkLock<MutexLock>(threadCount, opCount, writeInterval), *out);
+		out->flush();
+		if (threadCount == maxThreadCount) {
+			break;
+		}
+	}
+	return 0;
+}
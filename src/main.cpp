@@ -8,16 +8,20 @@ Q_DECLARE_METATYPE(simpleroute::Graph::Route);
 
 void help() {
 	std::cout << "simpleroute [options] file.osm.pbf\n";
-	std::cout << "\t-s\tspatial sort nodes\n";
-	std::cout << "\t-x\tgrid bins in lat\n";
-	std::cout << "\t-y\tgrid bins in lon\n";
+	std::cout << "\t-s\tspatial sort nodes along a Hilbert curve\n";
+	std::cout << "\t-x\tgrid bins in lat (default: chosen from the graph)\n";
+	std::cout << "\t-y\tgrid bins in lon (default: chosen from the graph)\n";
 	std::cout << "\t-c\tdo a self-check\n";
+	std::cout << "\t-n\tdo not read or write a graph snapshot\n";
 	std::cout << "\t-f\taccess types (car|bike|foot|all)\n";
+	std::cout << "\t-l\tnumber of landmarks of the ALT router (default 16, 0 uses those of an existing landmarks file)\n";
 	std::cout << std::endl;
 }
 
 int main(int argc, char ** argv) {
 	qRegisterMetaType<simpleroute::Graph::Route>();
+	//the signals of the background router use the unqualified name and are delivered queued
+	qRegisterMetaType<simpleroute::Graph::Route>("Graph::Route");
 	
 	QApplication app(argc, argv);
 	QStringList cmdline_args = QCoreApplication::arguments();
@@ -29,6 +33,9 @@ int main(int argc, char ** argv) {
 		if (cmdline_args.at(i) == "-c") {
 			doSelfCheck = true;
 		}
+		else if (cmdline_args.at(i) == "-n") {
+			cfg.useSnapshot = false;
+		}
 		else if(cmdline_args.at(i) == "-s") {
 			cfg.doSpatialSort = true;
 		}
@@ -36,6 +43,10 @@ int main(int argc, char ** argv) {
 			cfg.latCount = cmdline_args.at(i+1).toUInt();
 			++i;
 		}
+		else if (cmdline_args.at(i) == "-l" && i+1 < s) {
+			cfg.landmarkCount = cmdline_args.at(i+1).toUInt();
+			++i;
+		}
 		else if (cmdline_args.at(i) == "-y" && i+1 < s) {
 			cfg.lonCount = cmdline_args.at(i+1).toUInt();
 			++i;
@@ -104,7 +115,10 @@ int main(int argc, char ** argv) {
 		}
 	}
 
-	simpleroute::MainWindow mainWindow(state);
+	//the holder owns the state from now on, a replaced state is freed once it is no longer used
+	simpleroute::StateHolderPtr states(new simpleroute::StateHolder(state));
+	state.reset();
+	simpleroute::MainWindow mainWindow(states);
 	mainWindow.show();
 	return app.exec();
 }
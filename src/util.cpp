@@ -1,5 +1,6 @@
 #include "util.h"
 #include <cmath>
+#include <algorithm>
 
 
 inline double sqr(double a) { return a*a;}
@@ -43,4 +44,17 @@ double crossTrackDistance(double lat0, double lon0, double lat1, double lon1, do
 	return dxt;
 }
 
+double alongTrackDistance(double lat0, double lon0, double lat1, double lon1, double latq, double lonq) {
+	double radius(6371e3);
+
+	double delta13 = distanceTo(lat0, lon0, latq, lonq, radius)/radius;
+	double theta13 = toRadian( bearingTo(lat0, lon0, latq, lonq) );
+	double theta12 = toRadian( bearingTo(lat0, lon0, lat1, lon1) );
+
+	double deltaXt = ::asin( ::sin(delta13) * ::sin(theta13-theta12) );
+	//clamp rounding errors for points on the arc
+	double deltaAt = ::acos( std::min(1.0, ::cos(delta13) / ::cos(deltaXt)) );
+	return (::cos(theta13-theta12) < 0 ? -deltaAt : deltaAt) * radius;
+}
+
 }//end namespace simpleroute
\ No newline at end of file
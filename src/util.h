@@ -13,6 +13,9 @@ double bearingTo(double lat0, double lon0, double lat1, double lon1);
 ///Cross-track distance: minimum distance between a point on the great-circle arc of p0->p1 and q
 double crossTrackDistance(double lat0, double lon0, double lat1, double lon1, double latq, double lonq);
 
+///Along-track distance: distance from p0 to the point on the great-circle arc of p0->p1 that is closest to q, negative if that point lies behind p0
+double alongTrackDistance(double lat0, double lon0, double lat1, double lon1, double latq, double lonq);
+
 double distanceTo(double lat0, double lon0, double lat1, double lon1, double earthRadius = 6371000.0);
 
 }//end namespace